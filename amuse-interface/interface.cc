@@ -851,6 +851,30 @@ extern "C" {
         return 0;
     }
 
+    // add a particle to the tracked list, written to [prefix].track.[rank] every track_interval tree steps
+    int add_tracked_particle(int index_of_the_particle) {
+        ptr->particle_track.addId(index_of_the_particle);
+        return 0;
+    }
+
+    // remove a particle from the tracked list
+    int remove_tracked_particle(int index_of_the_particle) {
+        if (ptr->particle_track.removeId(index_of_the_particle)) return 0;
+        else return -1;
+    }
+
+    // set the number of tree steps between two outputs of tracked particles
+    int set_track_interval(int track_interval) {
+        if (track_interval<=0) return -1;
+        ptr->input_parameters.track_interval.value = track_interval;
+        return 0;
+    }
+
+    int get_track_interval(int* track_interval) {
+        *track_interval = ptr->input_parameters.track_interval.value;
+        return 0;
+    }
+
     //// set gravitational constant
     //int set_gravitational_constant(double G) {
     //    ptr->input_parameters.unit_set.value=-1;
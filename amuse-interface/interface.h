@@ -87,6 +87,14 @@ int get_tree_step(double * dt_soft);
 
 int set_tree_step(double dt_soft);
 
+int add_tracked_particle(int index_of_the_particle);
+
+int remove_tracked_particle(int index_of_the_particle);
+
+int get_track_interval(int * track_interval);
+
+int set_track_interval(int track_interval);
+
 int get_kinetic_energy(double * kinetic_energy);
 
 int get_potential_energy(double * potential_energy);
@@ -356,6 +356,87 @@ class petarInterface(
         """
         return function
 
+    @legacy_function
+    def add_tracked_particle():
+        """
+        Add a particle to the tracked list, the tracked particles are
+        written to [prefix].track.[MPI rank] every track_interval tree steps
+        """
+        function = LegacyFunctionSpecification()
+        function.addParameter(
+            'index_of_the_particle', dtype='int32', direction=function.IN,
+            description="index of the particle to track"
+        )
+        function.result_type = 'int32'
+        function.result_doc = """
+        0 - OK
+            the particle was added
+        """
+        return function
+
+    @legacy_function
+    def remove_tracked_particle():
+        """
+        Remove a particle from the tracked list
+        """
+        function = LegacyFunctionSpecification()
+        function.addParameter(
+            'index_of_the_particle', dtype='int32', direction=function.IN,
+            description="index of the tracked particle"
+        )
+        function.result_type = 'int32'
+        function.result_doc = """
+        0 - OK
+            the particle was removed
+        -1 - ERROR
+            the particle is not in the tracked list
+        """
+        return function
+
+    @legacy_function
+    def get_track_interval():
+        """
+        Get the number of tree steps between two outputs of tracked particles
+        """
+        function = LegacyFunctionSpecification()
+        function.addParameter(
+            'track_interval', dtype='int32', direction=function.OUT,
+            description=(
+                "number of tree steps between two outputs of tracked"
+                " particles"
+            )
+        )
+        function.result_type = 'int32'
+        function.result_doc = """
+        0 - OK
+            the parameter was retrieved
+        -1 - ERROR
+            could not retrieve parameter
+        """
+        return function
+
+    @legacy_function
+    def set_track_interval():
+        """
+        Set the number of tree steps between two outputs of tracked particles
+        """
+        function = LegacyFunctionSpecification()
+        function.addParameter(
+            'track_interval', dtype='int32', direction=function.IN,
+            description=(
+                "number of tree steps between two outputs of tracked"
+                " particles (> 0)"
+            )
+        )
+        function.result_type = 'int32'
+        function.result_doc = """
+        0 - OK
+            the parameter was set
+        -1 - ERROR
+            could not set parameter
+        """
+        return function
+
 
 class petar(GravitationalDynamics, GravityFieldCode):
 
@@ -443,6 +524,14 @@ class petar(GravitationalDynamics, GravityFieldCode):
             default_value=0.0 | nbody_system.time
         )
 
+        handler.add_method_parameter(
+            "get_track_interval",
+            "set_track_interval",
+            "track_interval",
+            "Number of tree steps between two outputs of tracked particles",
+            default_value=1
+        )
+
     def define_methods(self, handler):
         GravitationalDynamics.define_methods(self, handler)
         self.stopping_conditions.define_methods(handler)
@@ -13,12 +13,14 @@ public:
     typedef H4::Neighbor<PtclHard> NB;
     TidalTensor* soft_pert;  ///> soft perturbation 
     Float soft_pert_min; ///> minimum soft perturbation
+    Float r_out_max;  ///> maximum changeover outer radius of members for the Hermite pair force
 
-    ARPerturber(): NB(), soft_pert(NULL), soft_pert_min(Float(0.0)) {}
+    ARPerturber(): NB(), soft_pert(NULL), soft_pert_min(Float(0.0)), r_out_max(Float(0.0)) {}
 
     //! clear function
     void clear() {
         NB::clear();
+        r_out_max = 0.0;
         if (soft_pert!=NULL) {
             ASSERT(soft_pert->group_id>0.0);
             soft_pert->group_id = -soft_pert->group_id;
@@ -34,6 +36,18 @@ public:
         return true;
     }
 
+    //! calculate maximum changeover outer radius of group members
+    /*! Called once when the group is initialized in the Hermite integrator, 
+        the changeover radii of members do not change during the hard integration.
+      @param[in] _ptcl: member particle array
+      @param[in] _n: number of members
+     */
+    template <class Tptcl>
+    void calcRoutMax(const Tptcl* _ptcl, const int _n) {
+        r_out_max = 0.0;
+        for (int i=0; i<_n; i++) r_out_max = std::max(r_out_max, _ptcl[i].changeover.getRout());
+    }
+
     //! find close tidal tensor and if (-) tensor group id is the same as input, initial tidal tensor c.m.
     /*! if the tidal tensor is already in used (group_id>=0), copy a new one after _n_tt
       @param[in,out] _tt: tensor array
@@ -6,6 +6,9 @@
 #ifdef ORBIT_SAMPLING
 #include "orbit_sampling.hpp"
 typedef OrbitalSamplingManager OrbitManager;
+#elif defined(ORBIT_QUADRUPOLE)
+#include "orbit_quadrupole.hpp"
+typedef OrbitalQuadrupoleManager OrbitManager;
 #else
 #include "pseudoparticle_multipole.hpp"
 typedef PseudoParticleMultipoleManager OrbitManager;
@@ -265,7 +268,7 @@ public:
       c.m.: n_members
 
       mass_backup:
-      Tidial tensors/orbital: 0.0 (_data_to_store <=0.0)
+      Tidial tensors/orbital: 0.0 or -_data_to_store if the status slots are not enough (e.g. no tidal tensor particles with TIDAL_TENSOR_TREE)
       c.m.:  mass(cm)
 
       @param[out]    _ptcl_new: artificial particles that will be added
@@ -311,10 +314,13 @@ public:
         }
 
         // store the additional data (should be positive) 
+        // the status slots after the member numbers are used first, the remaining data are stored with negative sign in mass_backup
+        const PS::S32 n_slot_status = getStatusDataSlotN();
         // ensure the data size is not overflow
-        assert(_n_data+2<n_artificial-1);
+        assert(_n_data<=n_slot_status+n_artificial-1);
         for (int j=0; j<_n_data; j++) {
-            _ptcl_artificial[j+2].group_data.artificial.storeData(_data_to_store[j]);
+            if (j<n_slot_status) _ptcl_artificial[j+2].group_data.artificial.storeData(_data_to_store[j]);
+            else _ptcl_artificial[j-n_slot_status].group_data.artificial.storeData(-_data_to_store[j]);
 #ifdef ARTIFICIAL_PARTICLE_DEBUG
             assert(_data_to_store[j]>0);
 #endif
@@ -477,12 +483,27 @@ public:
     //! get stored data 
     template <class Tptcl>
     PS::F64 getStoredData(const Tptcl* _ptcl_list, const PS::S32 _index, const bool _is_positive) const {
+        const PS::S32 n_slot_status = getStatusDataSlotN();
+        if (_index>=n_slot_status) {
+#ifdef ARTIFICIAL_PARTICLE_DEBUG
+            assert(_is_positive);
+            assert(_ptcl_list[_index-n_slot_status].group_data.artificial.isArtificial());
+#endif
+            return -_ptcl_list[_index-n_slot_status].group_data.artificial.getData(false);
+        }
 #ifdef ARTIFICIAL_PARTICLE_DEBUG
         assert(_ptcl_list[_index+2].group_data.artificial.isArtificial());
 #endif
         return _ptcl_list[_index+2].group_data.artificial.getData(_is_positive);
     }
 
+    //! get number of additional data that can be stored in the status of artificial particles
+    /*! The first two are used for member numbers, the last one is c.m.
+     */
+    PS::S32 getStatusDataSlotN() const {
+        return std::max(getArtificialParticleN()-3, 0);
+    }
+
     //! write class data to file with binary format
     /*! @param[in] _fp: FILE type file for output
      */
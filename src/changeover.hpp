@@ -379,6 +379,50 @@ public:
         if (_ch1.getRout()> _ch2.getRout()) return _ch1.calcAcc1W(_dr, _drdot);
         else return _ch2.calcAcc1W(_dr, _drdot);
     }
-    
+
+    //! calculate changeover function Acc0 and Acc1 from r_in and r_out without branches
+    /*! The same as calcAcc0W and calcAcc1W after setR(_r_in, _r_out), used in vectorized loops.
+        x is clamped to [0,1], W_1 vanishes at both ends.
+      @param[out] _k: \f$ W_0(x) \f$
+      @param[out] _kdot: \f$ W_1(x) dx/dt \f$
+      @param[in] _r_in: changeover function inner boundary
+      @param[in] _r_out: changeover function outer boundary
+      @param[in] _dr: particle separation
+      @param[in] _drdot: time derivation of _dr
+     */
+    static inline void calcAcc0WAcc1W(Float& _k, Float& _kdot, const Float _r_in, const Float _r_out, const Float _dr, const Float _drdot) {
+        const Float norm = 1.0/(_r_out-_r_in);
+        Float x = (_dr - _r_in)*norm;
+        x = (x < 1.0) ? x : 1.0;
+        x = (x > 0.0) ? x : 0.0;
+        const Float xdot = norm*_drdot;
+        const Float x2 = x*x;
+        const Float x3 = x2*x;
+        const Float x4 = x2*x2;
+#ifdef INTEGRATED_CUTOFF_FUNCTION
+        _k = 1-(((-20.0*x+70.0)*x-84.0)*x+35.0)*x4;
+        _kdot = -(((-140.0*x + 420.0)*x - 420.0)*x + 140.0)*x3 * xdot;
+#else
+        const Float coff = (_r_out-_r_in)/(_r_out+_r_in);
+        const Float x_1 = x - 1;
+        const Float x_3 = x_1*x_1*x_1;
+        _k = x_3*x_1*(1.0 + 4.0*x + 10.0*x2 + 20.0*x3 + 35.0*coff*x4);
+        _kdot = coff*280.0*x3*(_r_in*norm + x)*x_3*xdot;
+#endif
+    }
+
+    //! get potential offset for the separation beyond r_out by selecting maximum rout
+    /*! For dr >= r_out, calcPotW returns pot_off*dr (0 for the integrated cutoff function),
+        thus the potential of the pair is -G m pot_off and the acceleration is zero
+     */
+    static Float getPotOffTwo(const ChangeOver& _ch1, const ChangeOver& _ch2) {
+#ifdef INTEGRATED_CUTOFF_FUNCTION
+        return 0.0;
+#else
+        if (_ch1.getRout()> _ch2.getRout()) return _ch1.pot_off_;
+        else return _ch2.pot_off_;
+#endif
+    }
+
 };
 
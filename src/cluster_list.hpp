@@ -2,6 +2,8 @@
 #include<particle_simulator.hpp>
 #include<unordered_map>
 #include<map>
+#include<vector>
+#include<algorithm>
 #include"ptcl.hpp"
 #include"Common/binary_tree.h"
 
@@ -204,6 +206,15 @@ private:
     PS::ReallocatableArray<PS::S32> rank_recv_ptcl_;
     PS::ReallocatableArray<PS::S32> n_ptcl_recv_;
     PS::ReallocatableArray<PS::S32> n_ptcl_disp_recv_;
+    // neighbor group c.m. mode: a stable group is represented by its leader (the member with the minimum id) in the neighbor tree
+    PS::S32 n_ptcl_nb_tree_; // number of local particles in the neighbor tree, -1: the mode is not used in this step
+    PS::ReallocatableArray<PS::S32> nb_group_index_;         // group index of particles in the neighbor tree, -1: not a leader
+    PS::ReallocatableArray<PS::S32> nb_group_adr_leader_;    // address of leaders
+    PS::ReallocatableArray<PS::S64> nb_group_id_leader_;     // sorted id of leaders, the index is the group index
+    PS::ReallocatableArray<PS::F64> nb_group_r_search_bk_;   // original r_search of leaders
+    PS::ReallocatableArray<PS::S32> nb_group_member_offset_; // offset of the other members of each group in nb_group_member_adr_
+    PS::ReallocatableArray<PS::S32> nb_group_member_adr_;    // address of the other members, located after the particles in the neighbor tree
+
     template<class T>
     void packDataToThread0(T * data){
         const PS::S32 n_thread = PS::Comm::getNumberOfThread();
@@ -328,12 +339,59 @@ private:
     };
 
 public:
+    SearchCluster(): adr_sys_one_cluster_(NULL), ptcl_cluster_(NULL), n_ptcl_nb_tree_(-1) {}
+
     void initialize(){
         const PS::S32 n_thread = PS::Comm::getNumberOfThread();
         adr_sys_one_cluster_  = new PS::ReallocatableArray<PS::S32>[n_thread];
         ptcl_cluster_ = new PS::ReallocatableArray<PtclCluster>[n_thread];
     }
 
+    //! get allocated memory size (bytes) of all buffers
+    /*! The node size of id_to_adr_pcluster_ is estimated by the key-value pair and one link pointer
+     */
+    size_t getMemSizeUsed() const {
+        size_t size = n_ptcl_in_multi_cluster_isolated_.getMemSize()
+            + n_ptcl_in_multi_cluster_isolated_offset_.getMemSize()
+            + mediator_sorted_id_cluster_.getMemSize()
+            + ptcl_recv_.getMemSize()
+            + adr_sys_multi_cluster_isolated_.getMemSize()
+            + cluster_comm_.getMemSize()
+            + adr_ngb_multi_cluster_.getMemSize()
+            + id_cluster_send_.getMemSize()
+            + id_cluster_recv_.getMemSize()
+            + adr_pcluster_send_.getMemSize()
+            + adr_pcluster_recv_.getMemSize()
+            + n_cluster_send_.getMemSize()
+            + n_cluster_recv_.getMemSize()
+            + n_cluster_disp_send_.getMemSize()
+            + n_cluster_disp_recv_.getMemSize()
+            + rank_send_cluster_.getMemSize()
+            + rank_recv_cluster_.getMemSize()
+            + adr_sys_ptcl_send_.getMemSize()
+            + ptcl_send_.getMemSize()
+            + rank_send_ptcl_.getMemSize()
+            + n_ptcl_send_.getMemSize()
+            + n_ptcl_disp_send_.getMemSize()
+            + rank_recv_ptcl_.getMemSize()
+            + n_ptcl_recv_.getMemSize()
+            + n_ptcl_disp_recv_.getMemSize()
+            + nb_group_index_.getMemSize()
+            + nb_group_adr_leader_.getMemSize()
+            + nb_group_id_leader_.getMemSize()
+            + nb_group_r_search_bk_.getMemSize()
+            + nb_group_member_offset_.getMemSize()
+            + nb_group_member_adr_.getMemSize();
+        size += id_to_adr_pcluster_.size()*(sizeof(std::pair<const PS::S32, PS::S32>)+sizeof(void*)) 
+            + id_to_adr_pcluster_.bucket_count()*sizeof(void*);
+        if (adr_sys_one_cluster_!=NULL) {
+            const PS::S32 n_thread = PS::Comm::getNumberOfThread();
+            for (PS::S32 i=0; i<n_thread; i++) 
+                size += adr_sys_one_cluster_[i].getMemSize() + ptcl_cluster_[i].getMemSize();
+        }
+        return size;
+    }
+
 
     //! identify whether the neighbor satisfy velocity criterion
     /*! 
@@ -418,7 +476,260 @@ public:
         return n_nb_new;
     }
 
+    //! represent stable groups by their leaders in the neighbor tree
+    /*! The members of stable groups are marked by nb_group_id (minimum member id) and nb_group_n (number of members) at the end of the last drift.
+        A group is used only if all members are local particles. The other members except the leader are moved to the end of the particle system,
+        thus the first returned number of particles are used to build the neighbor tree. 
+        The neighbor tree is symmetric, thus a member is also a neighbor of any particle j inside the search radius of j. 
+        To find all of such pairs, the search radius of the leader is enlarged to the global maximum search radius plus the maximum distance to the members.
+        The neighbors found by the enlarged radius are filtered with the original radii of all members in searchNeighborOMP (checkNeighborGroupPair), 
+        thus the cluster membership is the same as that without the mode.
+        With multiple MPI processes, a group is used only if the sphere of the enlarged radius is inside the local domain, so that no remote particle has the leader as a neighbor.
+        The original search radius of the leader is recovered in searchNeighborOMP.
+        Notice that the particle order is changed.
+      @param[in,out] sys: particle system
+      @param[in] _pos_domain: local domain of the particle system
+      \return number of local particles used in the neighbor tree
+     */
+    template<class Tsys>
+    PS::S32 setNeighborGroupLeader(Tsys & sys, const PS::F64ort & _pos_domain) {
+        struct GroupMember{ PS::S64 id_group; PS::S64 id; PS::S32 adr; PS::S32 n_member; };
+        const PS::S32 n_loc = sys.getNumberOfParticleLocal();
+        const bool domain_check_flag = (PS::Comm::getNumberOfProc()>1);
+
+        // global maximum search radius 
+        PS::F64 r_search_max_loc = 0.0;
+#pragma omp parallel for reduction(max: r_search_max_loc)
+        for (PS::S32 i=0; i<n_loc; i++) r_search_max_loc = std::max(r_search_max_loc, sys[i].r_search);
+        const PS::F64 r_search_max_glb = PS::Comm::getMaxValue(r_search_max_loc);
+
+        // collect candidate members
+        std::vector<GroupMember> member_list;
+#pragma omp parallel
+        {
+            std::vector<GroupMember> member_list_loc;
+#pragma omp for
+            for (PS::S32 i=0; i<n_loc; i++) {
+                if (sys[i].nb_group_id>0) member_list_loc.push_back(GroupMember{sys[i].nb_group_id, sys[i].id, i, sys[i].nb_group_n});
+            }
+#pragma omp critical
+            member_list.insert(member_list.end(), member_list_loc.begin(), member_list_loc.end());
+        }
+        std::sort(member_list.begin(), member_list.end(), 
+                  [](const GroupMember& a, const GroupMember& b) { return a.id_group<b.id_group || (a.id_group==b.id_group && a.id<b.id);});
+
+        // find complete groups, the leader is the first member (id==id_group)
+        std::vector<PS::S64> id_group_valid;
+        std::vector<PS::F64> r_search_leader;
+        std::vector<char> tail_flag(n_loc, 0);
+        const PS::S32 n_cand = member_list.size();
+        PS::S32 n_tail = 0;
+        PS::S32 k = 0;
+        while (k<n_cand) {
+            PS::S32 k_end = k+1;
+            bool valid_flag = (member_list[k].id==member_list[k].id_group);
+            while (k_end<n_cand && member_list[k_end].id_group==member_list[k].id_group) {
+                if (member_list[k_end].n_member!=member_list[k].n_member) valid_flag = false;
+                k_end++;
+            }
+            if (k_end-k!=member_list[k].n_member || member_list[k].n_member<2) valid_flag = false;
+            PS::F64 r_search_k = 0.0;
+            if (valid_flag) {
+                // the neighbor list uses the search radius multiplied by SAFTY_FACTOR_FOR_SEARCH, the distance is scaled to keep the enlarged radius large enough
+                const PS::F64vec& pos_leader = sys[member_list[k].adr].pos;
+                PS::F64 dr_max_sq = 0.0;
+                for (PS::S32 j=k+1; j<k_end; j++) {
+                    PS::F64vec dr = sys[member_list[j].adr].pos - pos_leader;
+                    dr_max_sq = std::max(dr_max_sq, dr*dr);
+                }
+                r_search_k = r_search_max_glb + std::sqrt(dr_max_sq)/SAFTY_FACTOR_FOR_SEARCH;
+                if (domain_check_flag) {
+                    const PS::F64 r_k = r_search_k*SAFTY_FACTOR_FOR_SEARCH;
+                    for (PS::S32 d=0; d<3; d++) {
+                        if (pos_leader[d]-r_k<_pos_domain.low_[d] || pos_leader[d]+r_k>=_pos_domain.high_[d]) valid_flag = false;
+                    }
+                }
+            }
+            if (valid_flag) {
+                id_group_valid.push_back(member_list[k].id_group);
+                r_search_leader.push_back(r_search_k);
+                for (PS::S32 j=k+1; j<k_end; j++) tail_flag[member_list[j].adr] = 1;
+                n_tail += k_end-k-1;
+            }
+            k = k_end;
+        }
+
+        // move the other members to the end
+        PS::S32 i_front = 0;
+        PS::S32 i_end = n_loc-1;
+        while (i_front<i_end) {
+            if (!tail_flag[i_front]) i_front++;
+            else if (tail_flag[i_end]) i_end--;
+            else {
+                std::swap(sys[i_front], sys[i_end]);
+                std::swap(tail_flag[i_front], tail_flag[i_end]);
+            }
+        }
+        const PS::S32 n_tree = n_loc - n_tail;
+        const PS::S32 n_group = id_group_valid.size();
+
+        // collect the new addresses of leaders and members
+        nb_group_index_.resizeNoInitialize(n_tree);
+        nb_group_adr_leader_.resizeNoInitialize(n_group);
+        nb_group_id_leader_.resizeNoInitialize(n_group);
+        nb_group_r_search_bk_.resizeNoInitialize(n_group);
+        for (PS::S32 i=0; i<n_group; i++) nb_group_id_leader_[i] = id_group_valid[i];
+#pragma omp parallel for
+        for (PS::S32 i=0; i<n_tree; i++) {
+            nb_group_index_[i] = -1;
+            if (sys[i].nb_group_id>0 && sys[i].nb_group_id==sys[i].id) {
+                auto it = std::lower_bound(id_group_valid.begin(), id_group_valid.end(), sys[i].nb_group_id);
+                if (it!=id_group_valid.end() && *it==sys[i].nb_group_id) {
+                    const PS::S32 i_group = it - id_group_valid.begin();
+                    nb_group_index_[i] = i_group;
+                    nb_group_adr_leader_[i_group] = i;
+                }
+            }
+        }
+        member_list.clear();
+        for (PS::S32 i=n_tree; i<n_loc; i++) 
+            member_list.push_back(GroupMember{sys[i].nb_group_id, sys[i].id, i, sys[i].nb_group_n});
+        std::sort(member_list.begin(), member_list.end(), 
+                  [](const GroupMember& a, const GroupMember& b) { return a.id_group<b.id_group || (a.id_group==b.id_group && a.id<b.id);});
+        nb_group_member_offset_.resizeNoInitialize(n_group+1);
+        nb_group_member_adr_.resizeNoInitialize(member_list.size());
+        nb_group_member_offset_[0] = 0;
+        for (PS::S32 i=0; i<n_group; i++) {
+            PS::S32 offset = nb_group_member_offset_[i];
+            const PS::S32 n_other = member_list[offset].n_member-1;
+            nb_group_member_offset_[i+1] = offset + n_other;
+            for (PS::S32 j=offset; j<offset+n_other; j++) {
+                assert(member_list[j].id_group==id_group_valid[i]);
+                nb_group_member_adr_[j] = member_list[j].adr;
+            }
+        }
+
+        // enlarge the search radius of leaders
+#pragma omp parallel for
+        for (PS::S32 i=0; i<n_group; i++) {
+            auto& pl = sys[nb_group_adr_leader_[i]];
+            nb_group_r_search_bk_[i] = pl.r_search;
+            pl.r_search = r_search_leader[i];
+        }
+
+        n_ptcl_nb_tree_ = n_tree;
+        return n_tree;
+    }
+
+    //! copy the neighbor number of leaders to the other members of the stable groups after the neighbor tree is built
+    template<class Tsys>
+    void setNeighborGroupMemberNgb(Tsys & sys) {
+        const PS::S32 n_group = nb_group_adr_leader_.size();
+#pragma omp parallel for
+        for (PS::S32 i=0; i<n_group; i++) {
+            const PS::S64 n_ngb = sys[nb_group_adr_leader_[i]].n_ngb;
+            for (PS::S32 j=nb_group_member_offset_[i]; j<nb_group_member_offset_[i+1]; j++) 
+                sys[nb_group_member_adr_[j]].n_ngb = n_ngb;
+        }
+    }
+
+    //! get the group index of a neighbor from the neighbor tree, -1 if it is not a local leader
+    template<class Tepj>
+    PS::S32 getNeighborGroupIndex(const Tepj & _pj, const PS::S32 _my_rank) {
+        if (_pj.rank_org!=_my_rank) return -1;
+        const PS::S64* id_first = nb_group_id_leader_.getPointer();
+        const PS::S64* id_last = nb_group_id_leader_.getPointer(nb_group_id_leader_.size());
+        const PS::S64* it = std::lower_bound(id_first, id_last, PS::S64(_pj.id));
+        if (it!=id_last && *it==_pj.id) return it - id_first;
+        return -1;
+    }
+
+    //! check whether a stable group and a particle (or another stable group) are neighbors with the original search radii of all members
+    /*! The neighbors found with the enlarged search radius of leaders can be false, this function checks the pairs of members with the same criterion as the neighbor tree.
+      @param[in] sys: particle system
+      @param[in] _i_group: group index
+      @param[in] _pos_j: position of the particle j, not used if _j_group>=0
+      @param[in] _r_search_j: search radius of the particle j, not used if _j_group>=0
+      @param[in] _j_group: group index of the particle j, -1: a single particle
+     */
+    template<class Tsys>
+    bool checkNeighborGroupPair(Tsys & sys, 
+                                const PS::S32 _i_group, 
+                                const PS::F64vec & _pos_j, 
+                                const PS::F64 _r_search_j, 
+                                const PS::S32 _j_group) {
+        // the leader is k = k_start-1
+        const PS::S32 k_start = nb_group_member_offset_[_i_group];
+        const PS::S32 k_end = nb_group_member_offset_[_i_group+1];
+        for (PS::S32 k=k_start-1; k<k_end; k++) {
+            const bool leader_flag = (k<k_start);
+            const auto& pk = sys[leader_flag ? nb_group_adr_leader_[_i_group] : nb_group_member_adr_[k]];
+            const PS::F64 r_search_k = leader_flag ? nb_group_r_search_bk_[_i_group] : pk.r_search;
+            if (_j_group>=0) {
+                if (checkNeighborGroupPair(sys, _j_group, pk.pos, r_search_k, -1)) return true;
+            }
+            else {
+                const PS::F64vec dr = pk.pos - _pos_j;
+                const PS::F64 r_search = std::max(r_search_k, _r_search_j)*SAFTY_FACTOR_FOR_SEARCH;
+                if (dr*dr < r_search*r_search) return true;
+            }
+        }
+        return false;
+    }
+
+    //! check a neighbor of a particle in the neighbor tree when stable groups are represented by leaders
+    /*! @param[in] sys: particle system
+        @param[in] _i: address of the particle i
+        @param[in] _i_group: group index of the particle i, -1: not a leader
+        @param[in] _pj: neighbor from the neighbor tree
+        @param[in] _my_rank: MPI rank
+        \return true: the particle (group) i and the neighbor (group) j are neighbors with the original search radii
+     */
+    template<class Tsys, class Tepj>
+    bool checkNeighborGroupNgb(Tsys & sys, const PS::S32 _i, const PS::S32 _i_group, const Tepj & _pj, const PS::S32 _my_rank) {
+        const PS::S32 j_group = getNeighborGroupIndex(_pj, _my_rank);
+        if (_i_group>=0) return checkNeighborGroupPair(sys, _i_group, _pj.pos, _pj.r_search, j_group);
+        else if (j_group>=0) return checkNeighborGroupPair(sys, j_group, sys[_i].pos, sys[_i].r_search, -1);
+        return true;
+    }
+
+    //! add the other members of a stable group to the neighbors of the leader and add the cluster entries of the members
+    /*! Called after the neighbors of the leader found in the tree are added to _id_ngb.
+        Each member has the leader as the only neighbor, thus the group is always in the same cluster.
+      @param[in] sys: particle system
+      @param[in] _i_group: group index
+      @param[in] _n_ngb_tree: number of neighbors of the leader found in the tree
+      @param[in,out] _id_ngb: neighbor id pairs of the current thread
+      @param[in,out] _ptcl_cluster: cluster particles of the current thread
+      @param[in] _my_rank: MPI rank
+     */
+    template<class Tsys>
+    void addNeighborGroupMembers(Tsys & sys, 
+                                 const PS::S32 _i_group, 
+                                 const PS::S32 _n_ngb_tree,
+                                 PS::ReallocatableArray< std::pair<PS::S32, PS::S32> > & _id_ngb, 
+                                 PS::ReallocatableArray<PtclCluster> & _ptcl_cluster,
+                                 const PS::S32 _my_rank) {
+        const PS::S32 adr_leader = nb_group_adr_leader_[_i_group];
+        const PS::S32 id_leader = sys[adr_leader].id;
+        const PS::S32 adr_ngb_head = _id_ngb.size() - _n_ngb_tree;
+        const PS::S32 k_start = nb_group_member_offset_[_i_group];
+        const PS::S32 k_end = nb_group_member_offset_[_i_group+1];
+        for (PS::S32 k=k_start; k<k_end; k++) 
+            _id_ngb.push_back( std::pair<PS::S32, PS::S32>(id_leader, sys[nb_group_member_adr_[k]].id) );
+        _ptcl_cluster.push_back( PtclCluster(id_leader, adr_leader, adr_ngb_head, _n_ngb_tree + k_end - k_start, false, NULL, _my_rank) );
+        for (PS::S32 k=k_start; k<k_end; k++) {
+            const PS::S32 adr_k = nb_group_member_adr_[k];
+            const PS::S32 id_k = sys[adr_k].id;
+            _ptcl_cluster.push_back( PtclCluster(id_k, adr_k, _id_ngb.size(), 1, false, NULL, _my_rank) );
+            _id_ngb.push_back( std::pair<PS::S32, PS::S32>(id_k, id_leader) );
+        }
+    }
+
     //! search neighbors and separate isolated and multiple clusters
+    /*! If setNeighborGroupLeader is called before building the neighbor tree, 
+        only the particles in the neighbor tree are searched and the other members of stable groups are added to the clusters of their leaders.
+     */
     template<class Tsys, class Ttree, class Tepj>
     void searchNeighborOMP(Tsys & sys,
                            Ttree & tree,
@@ -432,7 +743,8 @@ public:
         if(id_ngb_multi_cluster==NULL) id_ngb_multi_cluster = new PS::ReallocatableArray< std::pair<PS::S32, PS::S32> >[n_thread];
         const PS::S32 my_rank = PS::Comm::getRank();
         //        const PS::S32 n_proc_tot = PS::Comm::getNumberOfProc();
-        const PS::S32 n_loc = sys.getNumberOfParticleLocal();
+        const bool nb_group_flag = (n_ptcl_nb_tree_>=0);
+        const PS::S32 n_loc = nb_group_flag ? n_ptcl_nb_tree_ : sys.getNumberOfParticleLocal();
 #ifdef CLUSTER_VELOCITY
         assert(Ptcl::group_data_mode==GroupDataMode::cm);
 #endif
@@ -447,9 +759,12 @@ public:
             ptcl_cluster_[ith].clearSize();
             for(PS::S32 i=0; i<ptcl_outer[ith].size(); i++) ptcl_outer[ith][i].clear();
             ptcl_outer[ith].clearSize();
-#pragma omp for 
+            // static schedule: packDataToThread0 joins the per-thread lists in thread order, which keeps the particle index order for any thread number
+#pragma omp for schedule(static)
             for(PS::S32 i=0; i<n_loc; i++){
-                if(sys[i].n_ngb == 1){
+                // group index if the particle is the leader of a stable group
+                const PS::S32 i_group = nb_group_flag ? nb_group_index_[i] : -1;
+                if(sys[i].n_ngb == 1 && i_group<0){
                     // no neighbor
                     adr_sys_one_cluster_[ith].push_back(i);
 #ifdef CLUSTER_DEBUG
@@ -502,7 +817,7 @@ public:
 #endif
 
                     // no neighbor
-                    if(sys[i].n_ngb == 0){
+                    if(sys[i].n_ngb == 0 && i_group<0){
 //#ifdef CLUSTER_DEBUG
 //                        assert(sys[i].group_data.artificial.isSingle()); // in cm mode, this should not be used
 //#endif
@@ -515,15 +830,24 @@ public:
                     
 #ifdef CLUSTER_VELOCITY
                     // Use velocity criterion to select neighbors
-                    PS::S32 neighbor_index[n_ngb_i];
+                    PS::S32 neighbor_index[n_ngb_i+1];
                     PS::S32 n_ngb_check = checkNeighborWithVelocity(neighbor_index, sys[i], nbl, n_ngb_i+1, _G, _radius_factor);
 #ifdef CLUSTER_DEBUG
                     assert(n_ngb_check>=0);
 #endif
+                    // remove false neighbors found by the enlarged search radius of leaders
+                    if (nb_group_flag) {
+                        PS::S32 n_ngb_group_check = 0;
+                        for (PS::S32 j=0; j<n_ngb_check; j++) {
+                            if (checkNeighborGroupNgb(sys, i, i_group, nbl[neighbor_index[j]], my_rank)) 
+                                neighbor_index[n_ngb_group_check++] = neighbor_index[j];
+                        }
+                        n_ngb_check = n_ngb_group_check;
+                    }
                     sys[i].n_ngb = n_ngb_check;
 
                     // no neighbor
-                    if (n_ngb_check==0) {
+                    if (n_ngb_check==0 && i_group<0) {
                         adr_sys_one_cluster_[ith].push_back(i);
                         continue;
                     }
@@ -537,24 +861,46 @@ public:
                                 ptcl_outer[ith].push_back(PtclOuter(nbj->id, sys[i].id, nbj->rank_org));
                             }
                         }
-                        ptcl_cluster_[ith].push_back( PtclCluster(sys[i].id, i, adr_ngb_head_i, n_ngb_check, false, NULL, my_rank) );
+                        if (i_group>=0) addNeighborGroupMembers(sys, i_group, n_ngb_check, id_ngb_multi_cluster[ith], ptcl_cluster_[ith], my_rank);
+                        else ptcl_cluster_[ith].push_back( PtclCluster(sys[i].id, i, adr_ngb_head_i, n_ngb_check, false, NULL, my_rank) );
                     }
 #else
                     // use neighbor lists from tree neighbor search
+                    PS::S32 n_ngb_group_check = 0;
                     for (int j=0; j<n_ngb_i+1; j++) {
                         auto* nbj = nbl + j;
                         if (sys[i].id==nbj->id) continue;
+                        // remove false neighbors found by the enlarged search radius of leaders
+                        if (nb_group_flag && !checkNeighborGroupNgb(sys, i, i_group, *nbj, my_rank)) continue;
+                        n_ngb_group_check++;
                         
                         id_ngb_multi_cluster[ith].push_back( std::pair<PS::S32, PS::S32>(sys[i].id, nbj->id) );
                         if( nbj->rank_org != my_rank ){
                             ptcl_outer[ith].push_back(PtclOuter(nbj->id, sys[i].id, nbj->rank_org));
                         }
                     }
-                    ptcl_cluster_[ith].push_back( PtclCluster(sys[i].id, i, adr_ngb_head_i, n_ngb_i, false, NULL, my_rank) );
+                    if (nb_group_flag) {
+                        n_ngb_i = n_ngb_group_check;
+                        sys[i].n_ngb = n_ngb_i;
+                        if (n_ngb_i==0 && i_group<0) {
+                            adr_sys_one_cluster_[ith].push_back(i);
+                            continue;
+                        }
+                    }
+                    if (i_group>=0) addNeighborGroupMembers(sys, i_group, n_ngb_i, id_ngb_multi_cluster[ith], ptcl_cluster_[ith], my_rank);
+                    else ptcl_cluster_[ith].push_back( PtclCluster(sys[i].id, i, adr_ngb_head_i, n_ngb_i, false, NULL, my_rank) );
 #endif
                 }
             }
         } // end of OMP parallel 
+
+        // recover the search radius of leaders
+        if (nb_group_flag) {
+            for (PS::S32 i=0; i<nb_group_adr_leader_.size(); i++) 
+                sys[nb_group_adr_leader_[i]].r_search = nb_group_r_search_bk_[i];
+            n_ptcl_nb_tree_ = -1;
+        }
+
         packDataToThread0(adr_sys_one_cluster_);
         packDataToThread0(ptcl_cluster_);
         packDataToThread0(id_ngb_multi_cluster);
@@ -0,0 +1,32 @@
+#pragma once
+#include<vector>
+#include<particle_simulator.hpp>
+
+//! summation of an array with an order independent of the OpenMP thread number
+/*! The array is split into blocks of a fixed size.
+    The partial sums of blocks are calculated in parallel and then added in the block order,
+    thus the floating-point result does not depend on the thread number.
+    @param[in] _a: array
+    @param[in] _n: array size
+    \return sum of the array
+ */
+inline PS::F64 sumFixedOrder(const PS::F64* _a, const PS::S64 _n) {
+    const PS::S64 n_block_size = 256;
+    if (_n<=n_block_size) {
+        PS::F64 sum = 0.0;
+        for (PS::S64 i=0; i<_n; i++) sum += _a[i];
+        return sum;
+    }
+    const PS::S64 n_block = (_n-1)/n_block_size + 1;
+    std::vector<PS::F64> sum_block(n_block);
+#pragma omp parallel for
+    for (PS::S64 k=0; k<n_block; k++) {
+        const PS::S64 i_end = std::min(_n, (k+1)*n_block_size);
+        PS::F64 sum = 0.0;
+        for (PS::S64 i=k*n_block_size; i<i_end; i++) sum += _a[i];
+        sum_block[k] = sum;
+    }
+    PS::F64 sum = 0.0;
+    for (PS::S64 k=0; k<n_block; k++) sum += sum_block[k];
+    return sum;
+}
@@ -0,0 +1,521 @@
+#pragma once
+#ifdef USE_AARCH64
+#if defined(__ARM_FEATURE_SVE)
+#include <arm_sve.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#else
+#error "USE_AARCH64 needs a compiler target with SVE or NEON (-march=armv8-a or newer)"
+#endif
+#include <vector>
+#include <algorithm>
+#include "soft_ptcl.hpp"
+#include "soft_force.hpp"
+
+//! single-precision vector operations for the aarch64 soft force kernels
+/*! SVE: vector-length agnostic, the lane number is obtained at run time (svcntw) and the loop tail is masked by svwhilelt.
+    NEON: 4 lanes, the j arrays are padded to a multiple of the lane number and the tail is masked.
+    The same kernel source is used for both, inactive lanes never change the accumulators.
+ */
+namespace AArch64Vec {
+#ifdef __ARM_FEATURE_SVE
+    typedef svfloat32_t F32v;
+    typedef svint32_t S32v;
+    typedef svbool_t Mask;
+
+    inline PS::S32 getLaneN() { return svcntw(); }
+    inline Mask loopMask(const PS::S32 _j, const PS::S32 _n) { return svwhilelt_b32_s32(_j, _n); }
+    inline F32v load(const Mask _m, const float* _a) { return svld1_f32(_m, _a); }
+    inline F32v dup(const float _a) { return svdup_n_f32(_a); }
+    inline S32v dupInt(const int _a) { return svdup_n_s32(_a); }
+    inline F32v add(const Mask _m, const F32v _a, const F32v _b) { return svadd_f32_x(_m, _a, _b); }
+    inline F32v sub(const Mask _m, const F32v _a, const F32v _b) { return svsub_f32_x(_m, _a, _b); }
+    inline F32v mul(const Mask _m, const F32v _a, const F32v _b) { return svmul_f32_x(_m, _a, _b); }
+    //! _a*_b + _c
+    inline F32v madd(const Mask _m, const F32v _a, const F32v _b, const F32v _c) { return svmla_f32_x(_m, _c, _a, _b); }
+    inline F32v max(const Mask _m, const F32v _a, const F32v _b) { return svmax_f32_x(_m, _a, _b); }
+    //! 1/sqrt(_a): hardware estimate with two Newton-Raphson steps
+    inline F32v rsqrt(const Mask _m, const F32v _a) {
+        F32v r = svrsqrte_f32(_a);
+        r = svmul_f32_x(_m, r, svrsqrts_f32(svmul_f32_x(_m, _a, r), r));
+        r = svmul_f32_x(_m, r, svrsqrts_f32(svmul_f32_x(_m, _a, r), r));
+        return r;
+    }
+    //! _acc + _a in active lanes, _acc in others
+    inline F32v accum(const Mask _m, const F32v _acc, const F32v _a) { return svadd_f32_m(_m, _acc, _a); }
+    inline Mask lessThan(const Mask _m, const F32v _a, const F32v _b) { return svcmplt_f32(_m, _a, _b); }
+    //! add one to _c in active lanes
+    inline S32v count(const Mask _m, const S32v _c) { return svadd_n_s32_m(_m, _c, 1); }
+    inline float reduce(const F32v _a) { return svaddv_f32(svptrue_b32(), _a); }
+    inline int reduce(const S32v _a) { return svaddv_s32(svptrue_b32(), _a); }
+#else
+    typedef float32x4_t F32v;
+    typedef int32x4_t S32v;
+    typedef uint32x4_t Mask;
+
+    inline PS::S32 getLaneN() { return 4; }
+    inline Mask loopMask(const PS::S32 _j, const PS::S32 _n) {
+        const int32_t index[4] = {0, 1, 2, 3};
+        return vcltq_s32(vaddq_s32(vdupq_n_s32(_j), vld1q_s32(index)), vdupq_n_s32(_n));
+    }
+    // the arrays are padded, no mask is needed for load
+    inline F32v load(const Mask, const float* _a) { return vld1q_f32(_a); }
+    inline F32v dup(const float _a) { return vdupq_n_f32(_a); }
+    inline S32v dupInt(const int _a) { return vdupq_n_s32(_a); }
+    inline F32v add(const Mask, const F32v _a, const F32v _b) { return vaddq_f32(_a, _b); }
+    inline F32v sub(const Mask, const F32v _a, const F32v _b) { return vsubq_f32(_a, _b); }
+    inline F32v mul(const Mask, const F32v _a, const F32v _b) { return vmulq_f32(_a, _b); }
+    //! _a*_b + _c
+    inline F32v madd(const Mask, const F32v _a, const F32v _b, const F32v _c) { return vfmaq_f32(_c, _a, _b); }
+    inline F32v max(const Mask, const F32v _a, const F32v _b) { return vmaxq_f32(_a, _b); }
+    //! 1/sqrt(_a): hardware estimate with two Newton-Raphson steps
+    inline F32v rsqrt(const Mask, const F32v _a) {
+        F32v r = vrsqrteq_f32(_a);
+        r = vmulq_f32(r, vrsqrtsq_f32(vmulq_f32(_a, r), r));
+        r = vmulq_f32(r, vrsqrtsq_f32(vmulq_f32(_a, r), r));
+        return r;
+    }
+    //! _acc + _a in active lanes, _acc in others
+    inline F32v accum(const Mask _m, const F32v _acc, const F32v _a) {
+        return vaddq_f32(_acc, vreinterpretq_f32_u32(vandq_u32(_m, vreinterpretq_u32_f32(_a))));
+    }
+    inline Mask lessThan(const Mask _m, const F32v _a, const F32v _b) { return vandq_u32(_m, vcltq_f32(_a, _b)); }
+    //! add one to _c in active lanes (true lanes are -1)
+    inline S32v count(const Mask _m, const S32v _c) { return vsubq_s32(_c, vreinterpretq_s32_u32(_m)); }
+    inline float reduce(const F32v _a) { return vaddvq_f32(_a); }
+    inline int reduce(const S32v _a) { return vaddvq_s32(_a); }
+#endif
+}
+
+//! single-precision structure-of-arrays buffer of j particles for the aarch64 kernels
+/*! The arrays are padded with zero to a multiple of the lane number. One buffer is used per thread.
+ */
+class AArch64JBuffer{
+public:
+    enum {X=0, Y, Z, MASS, RSEARCH, AX, AY, AZ, QXX, QYY, QZZ, QXY, QXZ, QYZ, TRACE, N_FIELD};
+    std::vector<float> data[N_FIELD];
+
+    //! set the size of the first _n_field arrays for _n particles
+    void resize(const PS::S32 _n, const PS::S32 _n_field) {
+        const PS::S32 n_lane = AArch64Vec::getLaneN();
+        const PS::S32 n_pad = ((_n+n_lane-1)/n_lane)*n_lane;
+        for (PS::S32 k=0; k<_n_field; k++) {
+            data[k].resize(n_pad);
+            std::fill(data[k].begin()+_n, data[k].end(), 0.0f);
+        }
+    }
+
+    float* get(const PS::S32 _k) { return data[_k].data(); }
+};
+
+inline AArch64JBuffer& getAArch64JBuffer() {
+    static thread_local AArch64JBuffer buf;
+    return buf;
+}
+
+//! force kernel for EP EP with linear cutoff (aarch64 SVE/NEON)
+/*! The same as CalcForceEpEpWithLinearCutoffSimd: only i particles with type 1 and j particles with positive mass are calculated.
+    The positions are shifted to the first i particle in double precision before the single-precision calculation.
+    The neighbor criterion is the same as CalcForceEpEpWithLinearCutoffNoSimd.
+ */
+struct CalcForceEpEpWithLinearCutoffAArch64{
+    template<class Tepj>
+    void operator () (const EPISoft * ep_i,
+                      const PS::S32 n_ip,
+                      const Tepj * ep_j,
+                      const PS::S32 n_jp,
+                      ForceSoft * force){
+        using namespace AArch64Vec;
+        if (n_ip==0) return;
+        const PS::F64 eps2 = EPISoft::eps * EPISoft::eps;
+        const PS::F64 r_out2 = EPISoft::r_out*EPISoft::r_out;
+        const PS::F64 G = ForceSoft::grav_const;
+        const PS::F64vec pos_o = ep_i[0].getPos();
+
+        PS::S32 ep_j_list[n_jp], n_jp_local=0;
+#ifdef ORBIT_QUADRUPOLE
+        // group c.m. with quadrupole, the quadrupole term is added after the monopole kernel
+        PS::S32 ep_j_quad_list[n_jp], n_jp_quad=0;
+#endif
+        for (PS::S32 j=0; j<n_jp; j++){
+            if(ep_j[j].mass>0) {
+                ep_j_list[n_jp_local++] = j;
+#ifdef ORBIT_QUADRUPOLE
+                if(ep_j[j].quad.getTrace()>0) ep_j_quad_list[n_jp_quad++] = j;
+#endif
+            }
+        }
+
+        AArch64JBuffer& jbuf = getAArch64JBuffer();
+        jbuf.resize(n_jp_local, AArch64JBuffer::RSEARCH+1);
+        float* xj  = jbuf.get(AArch64JBuffer::X);
+        float* yj  = jbuf.get(AArch64JBuffer::Y);
+        float* zj  = jbuf.get(AArch64JBuffer::Z);
+        float* mj  = jbuf.get(AArch64JBuffer::MASS);
+        float* rsj = jbuf.get(AArch64JBuffer::RSEARCH);
+        for (PS::S32 k=0; k<n_jp_local; k++) {
+            const PS::S32 j = ep_j_list[k];
+            const PS::F64vec dpos = ep_j[j].getPos() - pos_o;
+            xj[k]  = dpos.x;
+            yj[k]  = dpos.y;
+            zj[k]  = dpos.z;
+            mj[k]  = ep_j[j].mass;
+            rsj[k] = ep_j[j].r_search;
+        }
+
+        const PS::S32 n_lane = getLaneN();
+        const F32v veps2  = dup(eps2);
+        const F32v vr_out2 = dup(r_out2);
+        for(PS::S32 i=0; i<n_ip; i++){
+            // remove the orbital sample for the force calculation
+            if (ep_i[i].type!=1) continue;
+            const PS::F64vec dpos_i = ep_i[i].getPos() - pos_o;
+            const F32v xi = dup(dpos_i.x);
+            const F32v yi = dup(dpos_i.y);
+            const F32v zi = dup(dpos_i.z);
+            const float rsi = ep_i[i].r_search;
+            const F32v rsi2 = dup(rsi*rsi);
+            F32v ax = dup(0.0f), ay = dup(0.0f), az = dup(0.0f), pot = dup(0.0f);
+            S32v n_ngb = dupInt(0);
+            for(PS::S32 j=0; j<n_jp_local; j+=n_lane){
+                const Mask m = loopMask(j, n_jp_local);
+                const F32v dx = sub(m, xi, load(m, &xj[j]));
+                const F32v dy = sub(m, yi, load(m, &yj[j]));
+                const F32v dz = sub(m, zi, load(m, &zj[j]));
+                const F32v r2 = madd(m, dz, dz, madd(m, dy, dy, mul(m, dx, dx)));
+                const F32v rs = load(m, &rsj[j]);
+                n_ngb = count(lessThan(m, r2, max(m, rsi2, mul(m, rs, rs))), n_ngb);
+                const F32v r2_cut = max(m, add(m, r2, veps2), vr_out2);
+                const F32v r_inv = rsqrt(m, r2_cut);
+                const F32v m_r = mul(m, load(m, &mj[j]), r_inv);
+                const F32v m_r3 = mul(m, m_r, mul(m, r_inv, r_inv));
+                ax  = accum(m, ax, mul(m, m_r3, dx));
+                ay  = accum(m, ay, mul(m, m_r3, dy));
+                az  = accum(m, az, mul(m, m_r3, dz));
+                pot = accum(m, pot, m_r);
+            }
+            force[i].acc.x -= G*reduce(ax);
+            force[i].acc.y -= G*reduce(ay);
+            force[i].acc.z -= G*reduce(az);
+            force[i].pot   -= G*reduce(pot);
+            force[i].n_ngb += reduce(n_ngb);
+#ifdef NAN_CHECK_DEBUG
+            assert(!std::isnan(force[i].acc.x));
+            assert(!std::isnan(force[i].acc.y));
+            assert(!std::isnan(force[i].acc.z));
+            assert(!std::isnan(force[i].pot));
+#endif
+        }
+#ifdef ORBIT_QUADRUPOLE
+        if (n_jp_quad>0) {
+            for(PS::S32 i=0; i<n_ip; i++){
+                if (ep_i[i].type!=1) continue;
+                const PS::F64vec xi = ep_i[i].pos;
+                PS::F64vec ai = 0.0;
+                PS::F64 poti = 0.0;
+                for(PS::S32 jq=0; jq<n_jp_quad; jq++){
+                    const PS::S32 j = ep_j_quad_list[jq];
+                    const PS::F64vec rij = xi - ep_j[j].getPos();
+                    const PS::F64 r2_eps = rij * rij + eps2;
+                    if (r2_eps > r_out2) calcAccPotOrbitQuadrupole(ai, poti, rij, r2_eps, ep_j[j].quad);
+                }
+                force[i].acc += G*ai;
+                force[i].pot += G*poti;
+            }
+        }
+#endif
+    }
+};
+
+#ifdef KDKDK_4TH
+//! gradient correction of the KDKDK 4th-order step with linear cutoff (aarch64 SVE/NEON)
+/*! The same as CalcCorrectEpEpWithLinearCutoffNoSimd in single precision
+ */
+struct CalcCorrectEpEpWithLinearCutoffAArch64{
+    template<class Tepj>
+    void operator () (const EPISoft * ep_i,
+                      const PS::S32 n_ip,
+                      const Tepj * ep_j,
+                      const PS::S32 n_jp,
+                      ForceSoft * force){
+        using namespace AArch64Vec;
+        if (n_ip==0) return;
+        const PS::F64 eps2 = EPISoft::eps * EPISoft::eps;
+        const PS::F64 r_out2 = EPISoft::r_out*EPISoft::r_out;
+        const PS::F64vec pos_o = ep_i[0].getPos();
+
+        PS::S32 ep_j_list[n_jp], n_jp_local=0;
+        for (PS::S32 j=0; j<n_jp; j++){
+            if(ep_j[j].mass>0) ep_j_list[n_jp_local++] = j;
+        }
+
+        AArch64JBuffer& jbuf = getAArch64JBuffer();
+        jbuf.resize(n_jp_local, AArch64JBuffer::AZ+1);
+        float* xj  = jbuf.get(AArch64JBuffer::X);
+        float* yj  = jbuf.get(AArch64JBuffer::Y);
+        float* zj  = jbuf.get(AArch64JBuffer::Z);
+        float* mj  = jbuf.get(AArch64JBuffer::MASS);
+        float* axj = jbuf.get(AArch64JBuffer::AX);
+        float* ayj = jbuf.get(AArch64JBuffer::AY);
+        float* azj = jbuf.get(AArch64JBuffer::AZ);
+        for (PS::S32 k=0; k<n_jp_local; k++) {
+            const PS::S32 j = ep_j_list[k];
+            const PS::F64vec dpos = ep_j[j].getPos() - pos_o;
+            xj[k]  = dpos.x;
+            yj[k]  = dpos.y;
+            zj[k]  = dpos.z;
+            mj[k]  = ep_j[j].mass;
+            axj[k] = ep_j[j].acc.x;
+            ayj[k] = ep_j[j].acc.y;
+            azj[k] = ep_j[j].acc.z;
+        }
+
+        const PS::S32 n_lane = getLaneN();
+        const F32v veps2  = dup(eps2);
+        const F32v vr_out2 = dup(r_out2);
+        const F32v three = dup(3.0f);
+        for(PS::S32 i=0; i<n_ip; i++){
+            const PS::F64vec dpos_i = ep_i[i].getPos() - pos_o;
+            const PS::F64vec acc_i = ep_i[i].acc;
+            const F32v xi = dup(dpos_i.x);
+            const F32v yi = dup(dpos_i.y);
+            const F32v zi = dup(dpos_i.z);
+            const F32v axi = dup(acc_i.x);
+            const F32v ayi = dup(acc_i.y);
+            const F32v azi = dup(acc_i.z);
+            F32v cx = dup(0.0f), cy = dup(0.0f), cz = dup(0.0f);
+            for(PS::S32 j=0; j<n_jp_local; j+=n_lane){
+                const Mask m = loopMask(j, n_jp_local);
+                const F32v dx  = sub(m, xi,  load(m, &xj[j]));
+                const F32v dy  = sub(m, yi,  load(m, &yj[j]));
+                const F32v dz  = sub(m, zi,  load(m, &zj[j]));
+                const F32v dax = sub(m, axi, load(m, &axj[j]));
+                const F32v day = sub(m, ayi, load(m, &ayj[j]));
+                const F32v daz = sub(m, azi, load(m, &azj[j]));
+                const F32v r2 = add(m, madd(m, dz, dz, madd(m, dy, dy, mul(m, dx, dx))), veps2);
+                const F32v drda = madd(m, dz, daz, madd(m, dy, day, mul(m, dx, dax)));
+                const F32v r2_cut = max(m, r2, vr_out2);
+                const F32v r_inv = rsqrt(m, r2_cut);
+                const F32v r2_inv = mul(m, r_inv, r_inv);
+                const F32v m_r3 = mul(m, mul(m, load(m, &mj[j]), r_inv), r2_inv);
+                const F32v alpha = mul(m, three, mul(m, drda, r2_inv));
+                // m_r3 * (da - alpha * dr)
+                cx = accum(m, cx, mul(m, m_r3, sub(m, dax, mul(m, alpha, dx))));
+                cy = accum(m, cy, mul(m, m_r3, sub(m, day, mul(m, alpha, dy))));
+                cz = accum(m, cz, mul(m, m_r3, sub(m, daz, mul(m, alpha, dz))));
+            }
+            force[i].acorr.x -= 2.0*reduce(cx);
+            force[i].acorr.y -= 2.0*reduce(cy);
+            force[i].acorr.z -= 2.0*reduce(cz);
+            force[i].acc = acc_i;
+        }
+    }
+};
+#endif
+
+//! force kernel for EP SP monopole (aarch64 SVE/NEON)
+struct CalcForceEpSpMonoAArch64{
+    template<class Tsp>
+    void operator () (const EPISoft * ep_i,
+                      const PS::S32 n_ip,
+                      const Tsp * sp_j,
+                      const PS::S32 n_jp,
+                      ForceSoft * force){
+        using namespace AArch64Vec;
+        if (n_ip==0) return;
+        const PS::F64 eps2 = EPISoft::eps * EPISoft::eps;
+        const PS::F64 G = ForceSoft::grav_const;
+        const PS::F64vec pos_o = ep_i[0].getPos();
+
+        AArch64JBuffer& jbuf = getAArch64JBuffer();
+        jbuf.resize(n_jp, AArch64JBuffer::MASS+1);
+        float* xj = jbuf.get(AArch64JBuffer::X);
+        float* yj = jbuf.get(AArch64JBuffer::Y);
+        float* zj = jbuf.get(AArch64JBuffer::Z);
+        float* mj = jbuf.get(AArch64JBuffer::MASS);
+        for (PS::S32 j=0; j<n_jp; j++) {
+            const PS::F64vec dpos = sp_j[j].getPos() - pos_o;
+            xj[j] = dpos.x;
+            yj[j] = dpos.y;
+            zj[j] = dpos.z;
+            mj[j] = sp_j[j].getCharge();
+        }
+
+        const PS::S32 n_lane = getLaneN();
+        const F32v veps2 = dup(eps2);
+        for(PS::S32 i=0; i<n_ip; i++){
+            const PS::F64vec dpos_i = ep_i[i].getPos() - pos_o;
+            const F32v xi = dup(dpos_i.x);
+            const F32v yi = dup(dpos_i.y);
+            const F32v zi = dup(dpos_i.z);
+            F32v ax = dup(0.0f), ay = dup(0.0f), az = dup(0.0f), pot = dup(0.0f);
+            for(PS::S32 j=0; j<n_jp; j+=n_lane){
+                const Mask m = loopMask(j, n_jp);
+                const F32v dx = sub(m, xi, load(m, &xj[j]));
+                const F32v dy = sub(m, yi, load(m, &yj[j]));
+                const F32v dz = sub(m, zi, load(m, &zj[j]));
+                const F32v r2 = add(m, madd(m, dz, dz, madd(m, dy, dy, mul(m, dx, dx))), veps2);
+                const F32v r_inv = rsqrt(m, r2);
+                const F32v m_r = mul(m, load(m, &mj[j]), r_inv);
+                const F32v m_r3 = mul(m, m_r, mul(m, r_inv, r_inv));
+                ax  = accum(m, ax, mul(m, m_r3, dx));
+                ay  = accum(m, ay, mul(m, m_r3, dy));
+                az  = accum(m, az, mul(m, m_r3, dz));
+                pot = accum(m, pot, m_r);
+            }
+            force[i].acc.x -= G*reduce(ax);
+            force[i].acc.y -= G*reduce(ay);
+            force[i].acc.z -= G*reduce(az);
+            force[i].pot   -= G*reduce(pot);
+        }
+    }
+};
+
+//! force kernel for EP SP quadrupole (aarch64 SVE/NEON)
+/*! The same formula as CalcForceEpSpQuadNoSimd in single precision
+ */
+struct CalcForceEpSpQuadAArch64{
+    template<class Tsp>
+    void operator () (const EPISoft * ep_i,
+                      const PS::S32 n_ip,
+                      const Tsp * sp_j,
+                      const PS::S32 n_jp,
+                      ForceSoft * force){
+        using namespace AArch64Vec;
+        if (n_ip==0) return;
+        const PS::F64 eps2 = EPISoft::eps * EPISoft::eps;
+        const PS::F64 G = ForceSoft::grav_const;
+        const PS::F64vec pos_o = ep_i[0].getPos();
+
+        AArch64JBuffer& jbuf = getAArch64JBuffer();
+        jbuf.resize(n_jp, AArch64JBuffer::N_FIELD);
+        float* xj  = jbuf.get(AArch64JBuffer::X);
+        float* yj  = jbuf.get(AArch64JBuffer::Y);
+        float* zj  = jbuf.get(AArch64JBuffer::Z);
+        float* mj  = jbuf.get(AArch64JBuffer::MASS);
+        float* qxx = jbuf.get(AArch64JBuffer::QXX);
+        float* qyy = jbuf.get(AArch64JBuffer::QYY);
+        float* qzz = jbuf.get(AArch64JBuffer::QZZ);
+        float* qxy = jbuf.get(AArch64JBuffer::QXY);
+        float* qxz = jbuf.get(AArch64JBuffer::QXZ);
+        float* qyz = jbuf.get(AArch64JBuffer::QYZ);
+        float* tr  = jbuf.get(AArch64JBuffer::TRACE);
+        for (PS::S32 j=0; j<n_jp; j++) {
+            const PS::F64vec dpos = sp_j[j].getPos() - pos_o;
+            xj[j]  = dpos.x;
+            yj[j]  = dpos.y;
+            zj[j]  = dpos.z;
+            mj[j]  = sp_j[j].mass;
+            qxx[j] = sp_j[j].quad.xx;
+            qyy[j] = sp_j[j].quad.yy;
+            qzz[j] = sp_j[j].quad.zz;
+            qxy[j] = sp_j[j].quad.xy;
+            qxz[j] = sp_j[j].quad.xz;
+            qyz[j] = sp_j[j].quad.yz;
+            tr[j]  = sp_j[j].quad.getTrace();
+        }
+
+        const PS::S32 n_lane = getLaneN();
+        const F32v veps2 = dup(eps2);
+        const F32v c1_5 = dup(1.5f);
+        const F32v c0_5 = dup(0.5f);
+        const F32v c2 = dup(2.0f);
+        const F32v c5 = dup(5.0f);
+        for(PS::S32 i=0; i<n_ip; i++){
+            const PS::F64vec dpos_i = ep_i[i].getPos() - pos_o;
+            const F32v xi = dup(dpos_i.x);
+            const F32v yi = dup(dpos_i.y);
+            const F32v zi = dup(dpos_i.z);
+            F32v ax = dup(0.0f), ay = dup(0.0f), az = dup(0.0f), pot = dup(0.0f);
+            for(PS::S32 j=0; j<n_jp; j+=n_lane){
+                const Mask m = loopMask(j, n_jp);
+                const F32v dx = sub(m, xi, load(m, &xj[j]));
+                const F32v dy = sub(m, yi, load(m, &yj[j]));
+                const F32v dz = sub(m, zi, load(m, &zj[j]));
+                const F32v vqxx = load(m, &qxx[j]);
+                const F32v vqyy = load(m, &qyy[j]);
+                const F32v vqzz = load(m, &qzz[j]);
+                const F32v vqxy = load(m, &qxy[j]);
+                const F32v vqxz = load(m, &qxz[j]);
+                const F32v vqyz = load(m, &qyz[j]);
+                const F32v vtr  = load(m, &tr[j]);
+                const F32v vmj  = load(m, &mj[j]);
+                const F32v qrx = madd(m, vqxz, dz, madd(m, vqxy, dy, mul(m, vqxx, dx)));
+                const F32v qry = madd(m, vqxy, dx, madd(m, vqyz, dz, mul(m, vqyy, dy)));
+                const F32v qrz = madd(m, vqyz, dy, madd(m, vqxz, dx, mul(m, vqzz, dz)));
+                const F32v qrr = madd(m, qrz, dz, madd(m, qry, dy, mul(m, qrx, dx)));
+                const F32v r2 = add(m, madd(m, dz, dz, madd(m, dy, dy, mul(m, dx, dx))), veps2);
+                const F32v r_inv = rsqrt(m, r2);
+                const F32v r2_inv = mul(m, r_inv, r_inv);
+                const F32v r3_inv = mul(m, r2_inv, r_inv);
+                const F32v r5_inv = mul(m, mul(m, r2_inv, r3_inv), c1_5);
+                const F32v qrr_r5 = mul(m, r5_inv, qrr);
+                const F32v qrr_r7 = mul(m, r2_inv, qrr_r5);
+                // A = mj*r3_inv - tr*r5_inv + 5*qrr_r7, B = -2*r5_inv; acc -= A*rij + B*qr
+                const F32v A = madd(m, c5, qrr_r7, sub(m, mul(m, vmj, r3_inv), mul(m, vtr, r5_inv)));
+                const F32v B = mul(m, c2, r5_inv);
+                ax = accum(m, ax, sub(m, mul(m, A, dx), mul(m, B, qrx)));
+                ay = accum(m, ay, sub(m, mul(m, A, dy), mul(m, B, qry)));
+                az = accum(m, az, sub(m, mul(m, A, dz), mul(m, B, qrz)));
+                // pot -= mj*r_inv - 0.5*tr*r3_inv + qrr_r5
+                pot = accum(m, pot, add(m, sub(m, mul(m, vmj, r_inv), mul(m, c0_5, mul(m, vtr, r3_inv))), qrr_r5));
+            }
+            force[i].acc.x -= G*reduce(ax);
+            force[i].acc.y -= G*reduce(ay);
+            force[i].acc.z -= G*reduce(az);
+            force[i].pot   -= G*reduce(pot);
+        }
+    }
+};
+
+//! neighbor search kernel (aarch64 SVE/NEON)
+/*! The same criterion as SearchNeighborEpEpNoSimd
+ */
+struct SearchNeighborEpEpAArch64{
+    void operator () (const EPISoft * ep_i,
+                      const PS::S32 n_ip,
+                      const EPJSoft * ep_j,
+                      const PS::S32 n_jp,
+                      ForceSoft * force){
+        using namespace AArch64Vec;
+        if (n_ip==0) return;
+        const PS::F64vec pos_o = ep_i[0].getPos();
+
+        AArch64JBuffer& jbuf = getAArch64JBuffer();
+        jbuf.resize(n_jp, AArch64JBuffer::RSEARCH+1);
+        float* xj  = jbuf.get(AArch64JBuffer::X);
+        float* yj  = jbuf.get(AArch64JBuffer::Y);
+        float* zj  = jbuf.get(AArch64JBuffer::Z);
+        float* rsj = jbuf.get(AArch64JBuffer::RSEARCH);
+        for (PS::S32 j=0; j<n_jp; j++) {
+            const PS::F64vec dpos = ep_j[j].pos - pos_o;
+            xj[j]  = dpos.x;
+            yj[j]  = dpos.y;
+            zj[j]  = dpos.z;
+            rsj[j] = ep_j[j].r_search;
+        }
+
+        const PS::S32 n_lane = getLaneN();
+        for(PS::S32 i=0; i<n_ip; i++){
+            const PS::F64vec dpos_i = ep_i[i].pos - pos_o;
+            const F32v xi = dup(dpos_i.x);
+            const F32v yi = dup(dpos_i.y);
+            const F32v zi = dup(dpos_i.z);
+            const float rsi = ep_i[i].r_search;
+            const F32v rsi2 = dup(rsi*rsi);
+            S32v n_ngb = dupInt(0);
+            for(PS::S32 j=0; j<n_jp; j+=n_lane){
+                const Mask m = loopMask(j, n_jp);
+                const F32v dx = sub(m, xi, load(m, &xj[j]));
+                const F32v dy = sub(m, yi, load(m, &yj[j]));
+                const F32v dz = sub(m, zi, load(m, &zj[j]));
+                const F32v r2 = madd(m, dz, dz, madd(m, dy, dy, mul(m, dx, dx)));
+                const F32v rs = load(m, &rsj[j]);
+                n_ngb = count(lessThan(m, r2, max(m, rsi2, mul(m, rs, rs))), n_ngb);
+            }
+            force[i].n_ngb = reduce(n_ngb);
+        }
+    }
+};
+
+#endif
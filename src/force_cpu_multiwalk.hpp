@@ -0,0 +1,438 @@
+#pragma once
+#if defined(USE_SIMD) && defined(INTRINSIC_X86) && !defined(USE_GPU) && !defined(USE_FUGAKU) && !defined(TIDAL_TENSOR_TREE)
+#define USE_CPU_MULTI_WALK
+#include <vector>
+#include <algorithm>
+#include <particle_simulator.hpp>
+#include "soft_ptcl.hpp"
+#include "soft_force.hpp"
+
+//! CPU multi-walk tree soft force
+/*! The interface is the same as the GPU multi-walk index mode (CalcForceWithLinearCutoffCUDAMultiWalk and RetrieveForceCUDA):
+    the j particles and super particles of all walks are copied once into shared SoA buffers (send_flag=true),
+    then each dispatch receives n_walk i-groups with index lists of j and super particles.
+    The walks are distributed to OpenMP threads, each walk is calculated by one thread:
+    1. i-groups with at least CPU_MULTI_WALK_LANE active particles use the i-parallel PhantomGrapeQuad kernels,
+       the j particles are gathered from the shared buffers by indices.
+    2. smaller i-groups use a j-parallel kernel (OpenMP SIMD over j), thus the SIMD lanes are filled by j particles instead of the few i particles.
+    The forces of one dispatch are kept until the next retrieve; two buffers are used alternately.
+    As the SIMD kernels, orbital artificial particles (EPISoft::type==0) and inactive particles of the hierarchical tree step are skipped,
+    massless j particles are not counted in the neighbor number.
+ */
+#ifdef USE__AVX512
+#define CPU_MULTI_WALK_LANE 16
+#else
+#define CPU_MULTI_WALK_LANE 8
+#endif
+
+//! shared j-particle buffers and force buffers of the CPU multi-walk tree force
+struct CPUMultiWalkBuffer{
+    // j particles
+    std::vector<PS::F64> epj_x, epj_y, epj_z, epj_m, epj_rs;
+#ifdef ORBIT_QUADRUPOLE
+    std::vector<PS::F64mat> epj_quad;
+#endif
+    // super particles
+    std::vector<PS::F64> spj_x, spj_y, spj_z, spj_m;
+#ifdef USE_QUAD
+    std::vector<PS::F64> spj_qxx, spj_qyy, spj_qzz, spj_qxy, spj_qxz, spj_qyz;
+#endif
+    // forces of the last two dispatches
+    std::vector<ForceSoft> force[2];
+    PS::S32 n_dispatch;
+    PS::S32 n_retrieve;
+
+    CPUMultiWalkBuffer(): n_dispatch(0), n_retrieve(0) {}
+
+    //! get memory size (bytes) of buffers
+    size_t getMemSizeUsed() const {
+        size_t size = (epj_x.capacity() + epj_y.capacity() + epj_z.capacity() + epj_m.capacity() + epj_rs.capacity()
+                       + spj_x.capacity() + spj_y.capacity() + spj_z.capacity() + spj_m.capacity())*sizeof(PS::F64)
+            + (force[0].capacity() + force[1].capacity())*sizeof(ForceSoft);
+#ifdef ORBIT_QUADRUPOLE
+        size += epj_quad.capacity()*sizeof(PS::F64mat);
+#endif
+#ifdef USE_QUAD
+        size += (spj_qxx.capacity() + spj_qyy.capacity() + spj_qzz.capacity()
+                 + spj_qxy.capacity() + spj_qxz.capacity() + spj_qyz.capacity())*sizeof(PS::F64);
+#endif
+        return size;
+    }
+};
+
+//! get the CPU multi-walk buffer (one for the process)
+inline CPUMultiWalkBuffer& getCPUMultiWalkBuffer() {
+    static CPUMultiWalkBuffer buf;
+    return buf;
+}
+
+//! dispatch function of the CPU multi-walk tree soft force with the linear cutoff
+struct CalcForceWithLinearCutoffCPUMultiWalk{
+    PS::F64 eps2;
+    PS::F64 rcut2;
+    PS::F64 G;
+
+#if defined(CALC_EP_64bit) || defined(CALC_EP_MIX)
+    typedef PhantomGrapeQuad64Bit PhantomGrapeEpEp;
+#else
+    typedef PhantomGrapeQuad PhantomGrapeEpEp;
+#endif
+#if defined(CALC_EP_64bit)
+    typedef PhantomGrapeQuad64Bit PhantomGrapeEpSp;
+#else
+    typedef PhantomGrapeQuad PhantomGrapeEpSp;
+#endif
+
+    CalcForceWithLinearCutoffCPUMultiWalk(){}
+
+    CalcForceWithLinearCutoffCPUMultiWalk(PS::F64 _eps2, PS::F64 _rcut2, PS::F64 _G): eps2(_eps2), rcut2(_rcut2), G(_G) {}
+
+    //! copy j particles and super particles to the shared buffers
+    template <class Tspj>
+    void setJParticles(CPUMultiWalkBuffer& _buf,
+                       const EPJSoftTree * _epj,
+                       const PS::S32 _n_epj_tot,
+                       const Tspj * _spj,
+                       const PS::S32 _n_spj_tot) {
+        _buf.epj_x.resize(_n_epj_tot);
+        _buf.epj_y.resize(_n_epj_tot);
+        _buf.epj_z.resize(_n_epj_tot);
+        _buf.epj_m.resize(_n_epj_tot);
+        _buf.epj_rs.resize(_n_epj_tot);
+#ifdef ORBIT_QUADRUPOLE
+        _buf.epj_quad.resize(_n_epj_tot);
+#endif
+#pragma omp parallel for
+        for(PS::S32 i=0; i<_n_epj_tot; i++){
+            const PS::F64vec pos = _epj[i].getPos();
+            _buf.epj_x[i]  = pos.x;
+            _buf.epj_y[i]  = pos.y;
+            _buf.epj_z[i]  = pos.z;
+            _buf.epj_m[i]  = _epj[i].mass;
+            _buf.epj_rs[i] = _epj[i].r_search;
+#ifdef ORBIT_QUADRUPOLE
+            const auto& quad = _epj[i].quad;
+            _buf.epj_quad[i] = PS::F64mat(quad.xx, quad.yy, quad.zz, quad.xy, quad.xz, quad.yz);
+#endif
+        }
+
+        _buf.spj_x.resize(_n_spj_tot);
+        _buf.spj_y.resize(_n_spj_tot);
+        _buf.spj_z.resize(_n_spj_tot);
+        _buf.spj_m.resize(_n_spj_tot);
+#ifdef USE_QUAD
+        _buf.spj_qxx.resize(_n_spj_tot);
+        _buf.spj_qyy.resize(_n_spj_tot);
+        _buf.spj_qzz.resize(_n_spj_tot);
+        _buf.spj_qxy.resize(_n_spj_tot);
+        _buf.spj_qxz.resize(_n_spj_tot);
+        _buf.spj_qyz.resize(_n_spj_tot);
+#endif
+#pragma omp parallel for
+        for(PS::S32 i=0; i<_n_spj_tot; i++){
+            const PS::F64vec pos = _spj[i].getPos();
+            _buf.spj_x[i] = pos.x;
+            _buf.spj_y[i] = pos.y;
+            _buf.spj_z[i] = pos.z;
+            _buf.spj_m[i] = _spj[i].getCharge();
+#ifdef USE_QUAD
+            _buf.spj_qxx[i] = _spj[i].quad.xx;
+            _buf.spj_qyy[i] = _spj[i].quad.yy;
+            _buf.spj_qzz[i] = _spj[i].quad.zz;
+            _buf.spj_qxy[i] = _spj[i].quad.xy;
+            _buf.spj_qxz[i] = _spj[i].quad.xz;
+            _buf.spj_qyz[i] = _spj[i].quad.yz;
+#endif
+        }
+    }
+
+    //! i-parallel EP-EP and EP-SP force of one walk by PhantomGrapeQuad
+    void calcForceIParallel(const CPUMultiWalkBuffer& _buf,
+                            const EPISoft * _epi,
+                            const PS::S32 * _adr_i,
+                            const PS::S32 _n_i,
+                            const PS::S32 * _adr_j,
+                            const PS::S32 _n_j,
+                            const PS::S32 * _id_spj,
+                            const PS::S32 _n_sp,
+                            ForceSoft * _force) {
+        static thread_local PhantomGrapeEpEp pg;
+        assert(_n_i<=pg.NIMAX);
+        pg.set_eps2(eps2);
+        pg.set_r_crit2(rcut2);
+        for(PS::S32 k=0; k<_n_i; k++){
+            const PS::F64vec pos_i = _epi[_adr_i[k]].pos;
+            pg.set_xi_one(k, pos_i.x, pos_i.y, pos_i.z, _epi[_adr_i[k]].r_search);
+        }
+        for(PS::S32 jh=0; jh<_n_j; jh+=PhantomGrapeEpEp::NJMAX){
+            const PS::S32 n_j_tmp = std::min(_n_j - jh, (PS::S32)PhantomGrapeEpEp::NJMAX);
+            for(PS::S32 jj=0; jj<n_j_tmp; jj++){
+                const PS::S32 j = _adr_j[jh+jj];
+                pg.set_epj_one(jj, _buf.epj_x[j], _buf.epj_y[j], _buf.epj_z[j], _buf.epj_m[j], _buf.epj_rs[j]);
+            }
+            pg.run_epj_for_p3t_with_linear_cutoff(_n_i, n_j_tmp);
+            for(PS::S32 k=0; k<_n_i; k++){
+                ForceSoft& fi = _force[_adr_i[k]];
+                PS::F64 p = 0;
+                PS::F64 a[3]= {0,0,0};
+                PS::F64 n_ngb = 0;
+                pg.accum_accp_one(k, a[0], a[1], a[2], p, n_ngb);
+                fi.acc[0] += G*a[0];
+                fi.acc[1] += G*a[1];
+                fi.acc[2] += G*a[2];
+                fi.pot += G*p;
+                fi.n_ngb += (PS::S32)(n_ngb*1.00001);
+            }
+        }
+
+        if (_n_sp==0) return;
+        static thread_local PhantomGrapeEpSp pg_sp;
+        pg_sp.set_eps2(eps2);
+        for(PS::S32 k=0; k<_n_i; k++){
+            const PS::F64vec pos_i = _epi[_adr_i[k]].pos;
+            pg_sp.set_xi_one(k, pos_i.x, pos_i.y, pos_i.z, 0.0);
+        }
+        for(PS::S32 jh=0; jh<_n_sp; jh+=PhantomGrapeEpSp::NJMAX){
+            const PS::S32 n_j_tmp = std::min(_n_sp - jh, (PS::S32)PhantomGrapeEpSp::NJMAX);
+            for(PS::S32 jj=0; jj<n_j_tmp; jj++){
+                const PS::S32 j = _id_spj[jh+jj];
+#ifdef USE_QUAD
+                pg_sp.set_spj_one(jj, _buf.spj_x[j], _buf.spj_y[j], _buf.spj_z[j], _buf.spj_m[j],
+                                  _buf.spj_qxx[j], _buf.spj_qyy[j], _buf.spj_qzz[j], _buf.spj_qxy[j], _buf.spj_qyz[j], _buf.spj_qxz[j]);
+#else
+                pg_sp.set_epj_one(jj, _buf.spj_x[j], _buf.spj_y[j], _buf.spj_z[j], _buf.spj_m[j], 0.0);
+#endif
+            }
+#ifdef USE_QUAD
+            pg_sp.run_spj(_n_i, n_j_tmp);
+#else
+            pg_sp.run_epj(_n_i, n_j_tmp);
+#endif
+            for(PS::S32 k=0; k<_n_i; k++){
+                ForceSoft& fi = _force[_adr_i[k]];
+                PS::F64 p = 0;
+                PS::F64 a[3]= {0,0,0};
+                pg_sp.accum_accp_one(k, a[0], a[1], a[2], p);
+                fi.acc[0] += G*a[0];
+                fi.acc[1] += G*a[1];
+                fi.acc[2] += G*a[2];
+                fi.pot += G*p;
+            }
+        }
+    }
+
+    //! j-parallel EP-EP and EP-SP force of one walk for small i-groups
+    void calcForceJParallel(const CPUMultiWalkBuffer& _buf,
+                            const EPISoft * _epi,
+                            const PS::S32 * _adr_i,
+                            const PS::S32 _n_i,
+                            const PS::S32 * _adr_j,
+                            const PS::S32 _n_j,
+                            const PS::S32 * _id_spj,
+                            const PS::S32 _n_sp,
+                            ForceSoft * _force) {
+        const PS::F64* xj = _buf.epj_x.data();
+        const PS::F64* yj = _buf.epj_y.data();
+        const PS::F64* zj = _buf.epj_z.data();
+        const PS::F64* mj = _buf.epj_m.data();
+        const PS::F64* rsj = _buf.epj_rs.data();
+        const PS::F64* xs = _buf.spj_x.data();
+        const PS::F64* ys = _buf.spj_y.data();
+        const PS::F64* zs = _buf.spj_z.data();
+        const PS::F64* ms = _buf.spj_m.data();
+#ifdef USE_QUAD
+        const PS::F64* qxx = _buf.spj_qxx.data();
+        const PS::F64* qyy = _buf.spj_qyy.data();
+        const PS::F64* qzz = _buf.spj_qzz.data();
+        const PS::F64* qxy = _buf.spj_qxy.data();
+        const PS::F64* qxz = _buf.spj_qxz.data();
+        const PS::F64* qyz = _buf.spj_qyz.data();
+#endif
+        for(PS::S32 k=0; k<_n_i; k++){
+            const EPISoft& pi = _epi[_adr_i[k]];
+            const PS::F64 xi = pi.pos.x;
+            const PS::F64 yi = pi.pos.y;
+            const PS::F64 zi = pi.pos.z;
+            const PS::F64 rsi = pi.r_search;
+            PS::F64 ax = 0.0, ay = 0.0, az = 0.0, pot = 0.0;
+            PS::S32 n_ngb = 0;
+#pragma omp simd reduction(+:ax,ay,az,pot,n_ngb)
+            for(PS::S32 jj=0; jj<_n_j; jj++){
+                const PS::S32 j = _adr_j[jj];
+                const PS::F64 dx = xi - xj[j];
+                const PS::F64 dy = yi - yj[j];
+                const PS::F64 dz = zi - zj[j];
+                const PS::F64 r2 = dx*dx + dy*dy + dz*dz;
+                const PS::F64 r2_eps = r2 + eps2;
+                const PS::F64 r_search = (rsi > rsj[j]) ? rsi : rsj[j];
+                n_ngb += (r2_eps <= r_search*r_search) ? 1 : 0;
+                const PS::F64 r2_tmp = (r2_eps > rcut2) ? r2_eps : rcut2;
+                const PS::F64 r_inv = 1.0/sqrt(r2_tmp);
+                const PS::F64 m_r = mj[j] * r_inv;
+                const PS::F64 m_r3 = m_r * r_inv * r_inv;
+                ax -= m_r3 * dx;
+                ay -= m_r3 * dy;
+                az -= m_r3 * dz;
+                pot -= m_r;
+            }
+#pragma omp simd reduction(+:ax,ay,az,pot)
+            for(PS::S32 jj=0; jj<_n_sp; jj++){
+                const PS::S32 j = _id_spj[jj];
+                const PS::F64 dx = xi - xs[j];
+                const PS::F64 dy = yi - ys[j];
+                const PS::F64 dz = zi - zs[j];
+                const PS::F64 r2 = dx*dx + dy*dy + dz*dz + eps2;
+                const PS::F64 r_inv = 1.0/sqrt(r2);
+#ifdef USE_QUAD
+                const PS::F64 tr = qxx[j] + qyy[j] + qzz[j];
+                const PS::F64 qrx = qxx[j]*dx + qxy[j]*dy + qxz[j]*dz;
+                const PS::F64 qry = qyy[j]*dy + qyz[j]*dz + qxy[j]*dx;
+                const PS::F64 qrz = qzz[j]*dz + qxz[j]*dx + qyz[j]*dy;
+                const PS::F64 qrr = qrx*dx + qry*dy + qrz*dz;
+                const PS::F64 r2_inv = r_inv * r_inv;
+                const PS::F64 r3_inv = r2_inv * r_inv;
+                const PS::F64 r5_inv = r2_inv * r3_inv * 1.5;
+                const PS::F64 qrr_r5 = r5_inv * qrr;
+                const PS::F64 qrr_r7 = r2_inv * qrr_r5;
+                const PS::F64 A = ms[j]*r3_inv - tr*r5_inv + 5*qrr_r7;
+                const PS::F64 B = -2.0*r5_inv;
+                ax -= A*dx + B*qrx;
+                ay -= A*dy + B*qry;
+                az -= A*dz + B*qrz;
+                pot -= ms[j]*r_inv - 0.5*tr*r3_inv + qrr_r5;
+#else
+                const PS::F64 m_r = ms[j] * r_inv;
+                const PS::F64 m_r3 = m_r * r_inv * r_inv;
+                ax -= m_r3 * dx;
+                ay -= m_r3 * dy;
+                az -= m_r3 * dz;
+                pot -= m_r;
+#endif
+            }
+            ForceSoft& fi = _force[_adr_i[k]];
+            fi.acc.x += G*ax;
+            fi.acc.y += G*ay;
+            fi.acc.z += G*az;
+            fi.pot += G*pot;
+            fi.n_ngb += n_ngb;
+        }
+    }
+
+    //! calculate force of one walk
+    void calcForceOneWalk(const CPUMultiWalkBuffer& _buf,
+                          const EPISoft * _epi,
+                          const PS::S32 _n_epi,
+                          const PS::S32 * _id_epj,
+                          const PS::S32 _n_epj,
+                          const PS::S32 * _id_spj,
+                          const PS::S32 _n_spj,
+                          ForceSoft * _force) {
+        for(PS::S32 i=0; i<_n_epi; i++) _force[i].clear();
+
+        // active i particles, orbital artificial particles are skipped
+        PS::S32 adr_i[_n_epi], n_i=0;
+        for(PS::S32 i=0; i<_n_epi; i++) {
+#ifdef TREE_LEVEL_STEP
+            if (EPISoft::active_check && !_epi[i].active) continue;
+#endif
+            if (_epi[i].type==1) adr_i[n_i++] = i;
+        }
+        if (n_i==0) return;
+
+        // j particles with mass
+        PS::S32 adr_j[_n_epj], n_j=0;
+#ifdef ORBIT_QUADRUPOLE
+        PS::S32 adr_j_quad[_n_epj], n_j_quad=0;
+#endif
+        for(PS::S32 jj=0; jj<_n_epj; jj++) {
+            const PS::S32 j = _id_epj[jj];
+            if (_buf.epj_m[j]>0) {
+                adr_j[n_j++] = j;
+#ifdef ORBIT_QUADRUPOLE
+                if (_buf.epj_quad[j].getTrace()>0) adr_j_quad[n_j_quad++] = j;
+#endif
+            }
+        }
+
+        if (n_i>=CPU_MULTI_WALK_LANE) calcForceIParallel(_buf, _epi, adr_i, n_i, adr_j, n_j, _id_spj, _n_spj, _force);
+        else calcForceJParallel(_buf, _epi, adr_i, n_i, adr_j, n_j, _id_spj, _n_spj, _force);
+
+#ifdef ORBIT_QUADRUPOLE
+        for(PS::S32 k=0; k<n_i && n_j_quad>0; k++){
+            const PS::S32 i = adr_i[k];
+            PS::F64vec ai = 0.0;
+            PS::F64 poti = 0.0;
+            for(PS::S32 jq=0; jq<n_j_quad; jq++){
+                const PS::S32 j = adr_j_quad[jq];
+                const PS::F64vec rij = _epi[i].pos - PS::F64vec(_buf.epj_x[j], _buf.epj_y[j], _buf.epj_z[j]);
+                const PS::F64 r2_eps = rij * rij + eps2;
+                if (r2_eps > rcut2) calcAccPotOrbitQuadrupole(ai, poti, rij, r2_eps, _buf.epj_quad[j]);
+            }
+            _force[i].acc += G*ai;
+            _force[i].pot += G*poti;
+        }
+#endif
+    }
+
+    template <class Tspj>
+    PS::S32 operator()(const PS::S32 tag,
+                       const PS::S32 n_walk,
+                       const EPISoft ** epi,
+                       const PS::S32 *  n_epi,
+                       const PS::S32 ** id_epj,
+                       const PS::S32 *  n_epj,
+                       const PS::S32 ** id_spj,
+                       const PS::S32 *  n_spj,
+                       const EPJSoftTree * epj,
+                       const PS::S32 n_epj_tot,
+                       const Tspj * spj,
+                       const PS::S32 n_spj_tot,
+                       const bool send_flag) {
+        CPUMultiWalkBuffer& buf = getCPUMultiWalkBuffer();
+        if (send_flag) {
+            setJParticles(buf, epj, n_epj_tot, spj, n_spj_tot);
+            buf.n_dispatch = buf.n_retrieve = 0;
+            return 0;
+        }
+
+        PS::S32 i_disp[n_walk+1];
+        i_disp[0] = 0;
+        for(PS::S32 iw=0; iw<n_walk; iw++) i_disp[iw+1] = i_disp[iw] + n_epi[iw];
+        std::vector<ForceSoft>& force = buf.force[buf.n_dispatch&1];
+        buf.n_dispatch++;
+        force.resize(i_disp[n_walk]);
+
+#pragma omp parallel for schedule(dynamic)
+        for(PS::S32 iw=0; iw<n_walk; iw++) {
+            calcForceOneWalk(buf, epi[iw], n_epi[iw], id_epj[iw], n_epj[iw], id_spj[iw], n_spj[iw], force.data()+i_disp[iw]);
+        }
+        return 0;
+    }
+};
+
+//! retrieve function of the CPU multi-walk tree soft force
+inline PS::S32 RetrieveForceCPUMultiWalk(const PS::S32 tag,
+                                         const PS::S32 n_walk,
+                                         const PS::S32 * ni,
+                                         ForceSoft ** force) {
+    CPUMultiWalkBuffer& buf = getCPUMultiWalkBuffer();
+    const std::vector<ForceSoft>& force_buf = buf.force[buf.n_retrieve&1];
+    buf.n_retrieve++;
+    PS::S32 i_disp[n_walk+1];
+    i_disp[0] = 0;
+    for(PS::S32 iw=0; iw<n_walk; iw++) i_disp[iw+1] = i_disp[iw] + ni[iw];
+    assert(i_disp[n_walk]<=(PS::S32)force_buf.size());
+#pragma omp parallel for
+    for(PS::S32 iw=0; iw<n_walk; iw++) {
+        for(PS::S32 i=0; i<ni[iw]; i++) force[iw][i] = force_buf[i_disp[iw]+i];
+    }
+    return 0;
+}
+
+//! get memory size (bytes) of the CPU multi-walk buffers, including the thread-local PhantomGrapeQuad buffers
+inline size_t getCPUMultiWalkMemSizeUsed() {
+    return getCPUMultiWalkBuffer().getMemSizeUsed()
+        + PS::Comm::getNumberOfThread()*(sizeof(CalcForceWithLinearCutoffCPUMultiWalk::PhantomGrapeEpEp) + sizeof(CalcForceWithLinearCutoffCPUMultiWalk::PhantomGrapeEpSp));
+}
+
+#endif
@@ -0,0 +1,184 @@
+#pragma once
+#include<vector>
+#include<fstream>
+#include<iomanip>
+#include<algorithm>
+#include<cmath>
+#include"stability.hpp"
+
+//! one binary (node) of the hierarchical binary tree of a group in the hard integrator
+struct GroupCatalogEntry{
+    PS::F64 time;      ///> time
+    PS::S64 id_group;  ///> group id (minimum member id of the root binary)
+    PS::S64 id;        ///> binary id (minimum member id)
+    PS::S64 level;     ///> hierarchical level, 0: root
+    PS::S64 n_members; ///> number of members
+    PS::S64 id1;       ///> id of the first component (binary id if it is a sub-system)
+    PS::S64 id2;       ///> id of the second component (binary id if it is a sub-system)
+    PS::F64 m1;        ///> mass of the first component
+    PS::F64 m2;        ///> mass of the second component
+    PS::F64 semi;      ///> semi-major axis
+    PS::F64 ecc;       ///> eccentricity
+    PS::F64 period;    ///> period
+    PS::F64 incline;   ///> inclination
+    PS::F64 stab;      ///> maximum three-body stability factor for the inner sub-systems (<1: stable), 0 if both components are single
+    PS::F64 sd;        ///> slow-down factor
+
+    //! print titles of class members using column style
+    /*! print titles of class members in one line for column style
+      @param[out] _fout: std::ostream output object
+      @param[in] _width: print width (defaulted 20)
+    */
+    static void printColumnTitle(std::ostream & _fout, const PS::S32 _width=20) {
+        _fout<<std::setw(_width)<<"Time"
+             <<std::setw(_width)<<"ID_group"
+             <<std::setw(_width)<<"ID"
+             <<std::setw(_width)<<"Level"
+             <<std::setw(_width)<<"N_members"
+             <<std::setw(_width)<<"ID1"
+             <<std::setw(_width)<<"ID2"
+             <<std::setw(_width)<<"m1"
+             <<std::setw(_width)<<"m2"
+             <<std::setw(_width)<<"semi"
+             <<std::setw(_width)<<"ecc"
+             <<std::setw(_width)<<"period"
+             <<std::setw(_width)<<"incline"
+             <<std::setw(_width)<<"stab"
+             <<std::setw(_width)<<"sd";
+    }
+
+    //! print data of class members using column style
+    /*! print data of class members in one line for column style. Notice no newline is printed at the end
+      @param[out] _fout: std::ostream output object
+      @param[in] _width: print width (defaulted 20)
+    */
+    void printColumn(std::ostream & _fout, const PS::S32 _width=20) const {
+        _fout<<std::setw(_width)<<time
+             <<std::setw(_width)<<id_group
+             <<std::setw(_width)<<id
+             <<std::setw(_width)<<level
+             <<std::setw(_width)<<n_members
+             <<std::setw(_width)<<id1
+             <<std::setw(_width)<<id2
+             <<std::setw(_width)<<m1
+             <<std::setw(_width)<<m2
+             <<std::setw(_width)<<semi
+             <<std::setw(_width)<<ecc
+             <<std::setw(_width)<<period
+             <<std::setw(_width)<<incline
+             <<std::setw(_width)<<stab
+             <<std::setw(_width)<<sd;
+    }
+};
+
+//! catalog of binaries and multiple systems collected from the hard integrators
+/*! Each OpenMP thread appends the binary trees of the groups it integrates to its own buffer, the buffers are merged at output.
+ */
+class GroupCatalog{
+public:
+    bool record_flag; ///> if true, the hard integrators record their groups after initialization
+    PS::F64 time_record; ///> time of the recorded groups
+    std::vector<std::vector<GroupCatalogEntry>> buffer_thread; ///> buffer of each thread
+
+    GroupCatalog(): record_flag(false), time_record(-1.0), buffer_thread() {}
+
+    //! prepare buffers for all threads
+    void resizeThread(const PS::S32 _n_thread) {
+        if ((PS::S32)buffer_thread.size()<_n_thread) buffer_thread.resize(_n_thread);
+    }
+
+    //! clear all buffers
+    void clear() {
+        for (auto& buf : buffer_thread) buf.clear();
+    }
+
+    //! get number of recorded entries
+    PS::S64 getSize() const {
+        PS::S64 n = 0;
+        for (auto& buf : buffer_thread) n += buf.size();
+        return n;
+    }
+
+    //! move entries of all threads to _out (appended) and clear the buffers
+    void gather(std::vector<GroupCatalogEntry>& _out) {
+        for (auto& buf : buffer_thread) {
+            _out.insert(_out.end(), buf.begin(), buf.end());
+            buf.clear();
+        }
+    }
+
+    //! record one binary tree node and its sub-systems iteratively
+    /*! @param[out] _buf: entry buffer
+        @param[in] _bin: binary tree node
+        @param[in] _level: hierarchical level
+        @param[in] _t_crit: time interval for the three-body stability factor
+        @param[in] _time: current time
+        \return binary id (minimum member id)
+     */
+    template <class Tbin>
+    static PS::S64 recordBinaryTreeIter(std::vector<GroupCatalogEntry>& _buf, Tbin& _bin, const PS::S64 _level, const PS::F64 _t_crit, const PS::F64 _time) {
+        const std::size_t index = _buf.size();
+        _buf.push_back(GroupCatalogEntry());
+        PS::S64 id_member[2];
+        PS::F64 stab = 0.0;
+        for (int k=0; k<2; k++) {
+            if (_bin.isMemberTree(k)) {
+                auto* bink = _bin.getMemberAsTree(k);
+                id_member[k] = recordBinaryTreeIter(_buf, *bink, _level+1, _t_crit, _time);
+                // inclination between inner and outer orbit
+                PS::F64 incline = std::acos(std::min(1.0, _bin.am*bink->am/std::sqrt((_bin.am*_bin.am)*(bink->am*bink->am))));
+                stab = std::max(stab, Stability<Ptcl>::stable3body(*bink, _bin, incline, _t_crit, k==0));
+            }
+            else id_member[k] = _bin.getMember(k)->id;
+        }
+        auto& entry = _buf[index];
+        entry.time = _time;
+        entry.id_group = 0;
+        entry.id = std::min(id_member[0], id_member[1]);
+        entry.level = _level;
+        entry.n_members = _bin.getMemberN();
+        entry.id1 = id_member[0];
+        entry.id2 = id_member[1];
+        entry.m1 = _bin.m1;
+        entry.m2 = _bin.m2;
+        entry.semi = _bin.semi;
+        entry.ecc = _bin.ecc;
+        entry.period = _bin.period;
+        entry.incline = _bin.incline;
+        entry.stab = stab;
+        entry.sd = _bin.slowdown.getSlowDownFactor();
+        return entry.id;
+    }
+
+    //! get the maximum three-body stability factor of all sub-systems in a binary tree
+    /*! @param[in] _bin: binary tree node
+        @param[in] _t_crit: time interval for the three-body stability factor
+        \return maximum stability factor (<1: all sub-systems are stable), 0 if the tree is a two-body system
+     */
+    template <class Tbin>
+    static PS::F64 getStabilityMaxIter(Tbin& _bin, const PS::F64 _t_crit) {
+        PS::F64 stab = 0.0;
+        for (int k=0; k<2; k++) {
+            if (_bin.isMemberTree(k)) {
+                auto* bink = _bin.getMemberAsTree(k);
+                stab = std::max(stab, getStabilityMaxIter(*bink, _t_crit));
+                PS::F64 incline = std::acos(std::min(1.0, _bin.am*bink->am/std::sqrt((_bin.am*_bin.am)*(bink->am*bink->am))));
+                stab = std::max(stab, Stability<Ptcl>::stable3body(*bink, _bin, incline, _t_crit, k==0));
+            }
+        }
+        return stab;
+    }
+
+    //! record all binaries of one group
+    /*! @param[out] _buf: entry buffer
+        @param[in] _bin_root: root of the binary tree of the group
+        @param[in] _t_crit: time interval for the three-body stability factor
+        @param[in] _time: current time
+     */
+    template <class Tbin>
+    static void recordGroup(std::vector<GroupCatalogEntry>& _buf, Tbin& _bin_root, const PS::F64 _t_crit, const PS::F64 _time) {
+        const std::size_t index = _buf.size();
+        const PS::S64 id_group = recordBinaryTreeIter(_buf, _bin_root, 0, _t_crit, _time);
+        for (std::size_t k=index; k<_buf.size(); k++) _buf[k].id_group = id_group;
+    }
+};
@@ -19,6 +19,10 @@
 #include"search_group_candidate.hpp"
 #include"artificial_particles.hpp"
 #include"stability.hpp"
+#include"group_catalog.hpp"
+#include"hard_warm_start.hpp"
+#include"hard_error_budget.hpp"
+#include"fixed_order_sum.hpp"
 
 typedef H4::ParticleH4<PtclHard> PtclH4;
 
@@ -152,6 +156,13 @@ struct HardEnergy{
 
 };
 
+//! member of a stable group found at the end of the drift, used for representing the group by one particle in the neighbor searching tree
+struct NeighborGroupMark{
+    PS::S32 adr;      ///> address of the member in the global particle system
+    PS::S32 n_member; ///> number of members in the group
+    PS::S64 id_group; ///> group id (minimum member id)
+};
+
 //! hard integrator 
 class HardIntegrator{
 public:
@@ -173,6 +184,7 @@ public:
     PS::S64 ARC_substep_sum;
     PS::S64 ARC_tsyn_step_sum;
     PS::S64 H4_step_sum;
+    PS::S64 warm_start_count;
 #endif
 
 #ifdef HARD_COUNT_NO_NEIGHBOR
@@ -182,9 +194,11 @@ public:
 
     bool use_sym_int;  ///> use AR integrator flag
     bool is_initialized; ///> indicator whether initialization is done
+    PS::F64 error_budget_factor; ///> tolerance factor of the error-budget controller used in this drift
 
 #ifdef HARD_CHECK_ENERGY
     HardEnergy energy;
+    PS::F64 etot_sd; ///> total energy (slowdown) of the cluster at the end of the drift
 #endif
 
     //! initializer
@@ -194,14 +208,15 @@ public:
                       n_group_sub_init(), n_group_sub_tot_init(0),
 #endif
 #ifdef PROFILE
-                      ARC_substep_sum(0), ARC_tsyn_step_sum(0), H4_step_sum(0), 
+                      ARC_substep_sum(0), ARC_tsyn_step_sum(0), H4_step_sum(0), warm_start_count(0),
 #endif
 #ifdef HARD_COUNT_NO_NEIGHBOR
                       table_neighbor_exist(), n_neighbor_zero(0),
 #endif
-                      use_sym_int(true), is_initialized(false) {
+                      use_sym_int(true), is_initialized(false), error_budget_factor(1.0) {
 #ifdef HARD_CHECK_ENERGY
                           energy.clear();
+                          etot_sd = 0.0;
 #endif
                       }
 
@@ -478,6 +493,7 @@ public:
 
                     ASSERT(m_fac>0.0);
                     pcm.changeover.setR(m_fac, manager->r_in_base, manager->r_out_base);
+                    groupi.perturber.calcRoutMax(groupi.particles.getDataAddress(), groupi.particles.getSize());
 
 #ifdef HARD_DEBUG
                     PS::F64 r_out_cm = pcm.changeover.getRout();
@@ -515,6 +531,7 @@ public:
                 PS::F64 m_fac = pcm.mass*Ptcl::mean_mass_inv;
                 ASSERT(m_fac>0.0);
                 pcm.changeover.setR(m_fac, manager->r_in_base, manager->r_out_base);
+                groupi.perturber.calcRoutMax(groupi.particles.getDataAddress(), groupi.particles.getSize());
 
 /*  It is not consistent to use tidal tensor for different group
 #ifdef SOFT_PERT                
@@ -650,7 +667,7 @@ public:
                     PS::F64 m_fac = pcm.mass*Ptcl::mean_mass_inv;
                     ASSERT(m_fac>0.0);
                     pcm.changeover.setR(m_fac, manager->r_in_base, manager->r_out_base);
-                    
+                    groupi.perturber.calcRoutMax(groupi.particles.getDataAddress(), groupi.particles.getSize());
 
 #ifdef SOFT_PERT                
                     // find corresponding tidal tensor if exist
@@ -1094,6 +1111,7 @@ public:
 #ifdef HARD_CHECK_ENERGY
         energy.ekin_sd_correction = ekin_sd - ekin;
         energy.epot_sd_correction = epot_sd - epot;
+        etot_sd = ekin_sd + epot_sd;
         // exclude the slowdown energy change due to the turn off of slowdown
         energy.de_sd_change_cum  -= energy.ekin_sd_correction + energy.epot_sd_correction;
 
@@ -1151,6 +1169,230 @@ public:
         }
     }
 
+    //! record the binary trees of all groups to the catalog buffer
+    /*! Should be called after initial(), the orbits and slowdown factors are those at the initial time
+      @param[out] _buf: catalog buffer of the current thread
+     */
+    void recordGroupCatalog(std::vector<GroupCatalogEntry>& _buf) {
+        ASSERT(is_initialized);
+        const PS::F64 t_crit = manager->ar_manager.slowdown_timescale_max;
+        if (use_sym_int) {
+            GroupCatalog::recordGroup(_buf, sym_int.info.getBinaryTreeRoot(), t_crit, time_origin);
+        }
+        else {
+            const PS::S32* group_index = h4_int.getSortDtIndexGroup();
+            for (PS::S32 i=0; i<h4_int.getNGroup(); i++) {
+                auto& groupi = h4_int.groups[group_index[i]];
+                GroupCatalog::recordGroup(_buf, groupi.info.getBinaryTreeRoot(), t_crit, time_origin);
+            }
+        }
+    }
+
+    //! check whether a group can be represented by one particle in the neighbor searching tree
+    /*! The outermost orbit is bound with the apocenter inside the group radius (same as the group finding) 
+        and all inner sub-systems are stable
+      @param[in] _bin_root: root of the binary tree of the group
+      @param[in] _pcm: c.m. particle of the group
+     */
+    template <class Tbin, class Tpcm>
+    bool isStableGroupForNeighborSearch(Tbin& _bin_root, Tpcm& _pcm) {
+        if (_bin_root.semi<=0.0) return false;
+        if (_bin_root.semi*(1.0+_bin_root.ecc)>_pcm.getRGroup()) return false;
+        return GroupCatalog::getStabilityMaxIter(_bin_root, manager->ar_manager.slowdown_timescale_max)<1.0;
+    }
+
+    //! collect the members of stable groups for the neighbor searching
+    /*! Should be called after driftClusterCMRecordGroupCMDataAndWriteBack (before clear). 
+        A group is skipped when any member is removed (zero mass).
+      @param[out] _buf: member buffer of the current thread
+     */
+    void collectStableGroupMembers(std::vector<NeighborGroupMark>& _buf) {
+        ASSERT(is_initialized);
+        if (use_sym_int) {
+            auto& pcm = sym_int.particles.cm;
+            if (!isStableGroupForNeighborSearch(sym_int.info.getBinaryTreeRoot(), pcm)) return;
+            const PS::S32 n_members = sym_int.particles.getSize();
+            PS::S64 id_group = ptcl_origin[0].id;
+            for (PS::S32 i=0; i<n_members; i++) {
+                if (ptcl_origin[i].mass==0.0) return;
+                id_group = std::min(id_group, ptcl_origin[i].id);
+            }
+            for (PS::S32 i=0; i<n_members; i++) 
+                _buf.push_back(NeighborGroupMark{ptcl_origin[i].adr_org, n_members, id_group});
+        }
+        else {
+            const PS::S32* group_index = h4_int.getSortDtIndexGroup();
+            for (PS::S32 i=0; i<h4_int.getNGroup(); i++) {
+                auto& groupi = h4_int.groups[group_index[i]];
+                if (!isStableGroupForNeighborSearch(groupi.info.getBinaryTreeRoot(), groupi.particles.cm)) continue;
+                const PS::S32 n_members = groupi.particles.getSize();
+                PS::S64 id_group = groupi.particles.getMemberOriginAddress(0)->id;
+                bool removed_flag = false;
+                for (PS::S32 j=0; j<n_members; j++) {
+                    auto* pj = groupi.particles.getMemberOriginAddress(j);
+                    if (pj->mass==0.0) removed_flag = true;
+                    id_group = std::min(id_group, pj->id);
+                }
+                if (removed_flag) continue;
+                for (PS::S32 j=0; j<n_members; j++) 
+                    _buf.push_back(NeighborGroupMark{groupi.particles.getMemberOriginAddress(j)->adr_org, n_members, id_group});
+            }
+        }
+    }
+
+    //! get the key and the minimum member id of the cluster for the warm start
+    /*! @param[out] _id_min: minimum member id
+        \return hash of sorted member ids
+     */
+    PS::U64 calcWarmStartKey(PS::S64& _id_min) {
+        const PS::S32 n_ptcl = use_sym_int ? sym_int.particles.getSize() : h4_int.particles.getSize();
+        PS::S64 id_sort[n_ptcl];
+        for (PS::S32 i=0; i<n_ptcl; i++) id_sort[i] = ptcl_origin[i].id;
+        PS::U64 key = HardWarmStart::calcKey(id_sort, n_ptcl);
+        _id_min = id_sort[0];
+        return key;
+    }
+
+    //! reuse the Hermite block steps and AR step sizes saved at the end of the previous drift
+    /*! Should be called after initial(). Only used when the cluster has the same members as one cluster in the previous drift.
+        For each single and group, the carried state is used only if the single or group exists in the previous drift
+        and the carried state is consistent with the new acceleration (Hermite) or the new orbit (AR).
+      @param[in] _warm_start: saved states of the previous drift
+     */
+    void applyWarmStart(const HardWarmStart& _warm_start) {
+        ASSERT(is_initialized);
+        const PS::S32 n_ptcl = use_sym_int ? sym_int.particles.getSize() : h4_int.particles.getSize();
+        PS::S64 id_min;
+        PS::S32 n_step;
+        const WarmStartStep* steps = _warm_start.find(calcWarmStartKey(id_min), n_ptcl, n_step);
+        if (steps==NULL) return;
+
+        if (use_sym_int) {
+            auto* step = HardWarmStart::findStep(steps, n_step, id_min, n_ptcl);
+            if (step!=NULL && HardWarmStart::isARStepValid(sym_int.info.getBinaryTreeRoot(), *step)) {
+                sym_int.info.ds = step->ds;
+#ifdef PROFILE
+                warm_start_count++;
+#endif
+            }
+        }
+        else {
+            const PS::F64 dt_max = h4_int.step.getDtMax();
+            bool modified_flag = false;
+            const PS::S32* single_index = h4_int.getSortDtIndexSingle();
+            for (PS::S32 i=0; i<h4_int.getNSingle(); i++) {
+                auto& pi = h4_int.particles[single_index[i]];
+                auto* step = HardWarmStart::findStep(steps, n_step, pi.id, 0);
+                if (step==NULL) continue;
+                PS::F64 dt = std::min(HardWarmStart::calcWarmStartDt(pi, *step), dt_max);
+                if (dt>pi.dt) {
+                    pi.dt = dt;
+                    modified_flag = true;
+#ifdef PROFILE
+                    warm_start_count++;
+#endif
+                }
+            }
+            const PS::S32* group_index = h4_int.getSortDtIndexGroup();
+            for (PS::S32 i=0; i<h4_int.getNGroup(); i++) {
+                auto& groupi = h4_int.groups[group_index[i]];
+                const PS::S32 n_members = groupi.particles.getSize();
+                PS::S64 id_group = groupi.particles.getMemberOriginAddress(0)->id;
+                for (PS::S32 j=1; j<n_members; j++) id_group = std::min(id_group, groupi.particles.getMemberOriginAddress(j)->id);
+                auto* step = HardWarmStart::findStep(steps, n_step, id_group, n_members);
+                if (step==NULL) continue;
+                auto& pcm = groupi.particles.cm;
+                PS::F64 dt = std::min(HardWarmStart::calcWarmStartDt(pcm, *step), dt_max);
+                const bool dt_flag = (dt>pcm.dt);
+                if (dt_flag) {
+                    pcm.dt = dt;
+                    modified_flag = true;
+                }
+                const bool ds_flag = HardWarmStart::isARStepValid(groupi.info.getBinaryTreeRoot(), *step);
+                if (ds_flag) groupi.info.ds = step->ds;
+#ifdef PROFILE
+                // count only if the saved step or step size is applied
+                if (dt_flag||ds_flag) warm_start_count++;
+#endif
+            }
+            // the active particles are selected again with new steps
+            if (modified_flag) h4_int.sortDtAndSelectActParticle();
+        }
+    }
+
+    //! save the Hermite block steps and AR step sizes for the warm start in the next drift
+    /*! Should be called after driftClusterCMRecordGroupCMDataAndWriteBack (before clear).
+      @param[in,out] _warm_start: saved states
+      @param[in] _ith: thread index
+     */
+    void saveWarmStart(HardWarmStart& _warm_start, const PS::S32 _ith) {
+        ASSERT(is_initialized);
+        const PS::S32 n_ptcl = use_sym_int ? sym_int.particles.getSize() : h4_int.particles.getSize();
+        PS::S64 id_min;
+        const PS::U64 key = calcWarmStartKey(id_min);
+        auto& buf = _warm_start.buffer_thread[_ith];
+        const PS::S32 offset = buf.size();
+        if (use_sym_int) {
+            auto& bin_root = sym_int.info.getBinaryTreeRoot();
+            buf.push_back(WarmStartStep{id_min, n_ptcl, 0.0, 0.0, sym_int.info.ds, bin_root.slowdown.getSlowDownFactor(), bin_root.semi, bin_root.ecc});
+        }
+        else {
+            const PS::S32* single_index = h4_int.getSortDtIndexSingle();
+            for (PS::S32 i=0; i<h4_int.getNSingle(); i++) {
+                auto& pi = h4_int.particles[single_index[i]];
+                buf.push_back(WarmStartStep{pi.id, 0, pi.dt, HardWarmStart::calcAccTimescale(pi), 0.0, 0.0, 0.0, 0.0});
+            }
+            const PS::S32* group_index = h4_int.getSortDtIndexGroup();
+            for (PS::S32 i=0; i<h4_int.getNGroup(); i++) {
+                auto& groupi = h4_int.groups[group_index[i]];
+                const PS::S32 n_members = groupi.particles.getSize();
+                PS::S64 id_group = groupi.particles.getMemberOriginAddress(0)->id;
+                for (PS::S32 j=1; j<n_members; j++) id_group = std::min(id_group, groupi.particles.getMemberOriginAddress(j)->id);
+                auto& pcm = groupi.particles.cm;
+                auto& bin_root = groupi.info.getBinaryTreeRoot();
+                buf.push_back(WarmStartStep{id_group, n_members, pcm.dt, HardWarmStart::calcAccTimescale(pcm), groupi.info.ds, bin_root.slowdown.getSlowDownFactor(), bin_root.semi, bin_root.ecc});
+            }
+        }
+        _warm_start.saveCluster(_ith, key, n_ptcl, offset);
+    }
+
+    //! scale the accuracy parameters of this cluster by the tolerance factor carried from the previous drift
+    /*! Should be called after initial() (and applyWarmStart()). The Hermite eta of the integrator copy is scaled by f^(1/2)
+        and the AR step sizes are scaled by f^(1/6), the step sizes of the first block steps are not changed.
+      @param[in] _error_budget: error-budget controller
+     */
+    void applyErrorBudget(const HardErrorBudget& _error_budget) {
+        ASSERT(is_initialized);
+        const PS::S32 n_ptcl = use_sym_int ? sym_int.particles.getSize() : h4_int.particles.getSize();
+        PS::S64 id_min;
+        error_budget_factor = _error_budget.getFactor(calcWarmStartKey(id_min), n_ptcl);
+        if (error_budget_factor==1.0) return;
+
+        const PS::F64 ds_scale = std::pow(error_budget_factor, 1.0/6.0);
+        if (use_sym_int) sym_int.info.ds *= ds_scale;
+        else {
+            const PS::F64 eta_scale = std::sqrt(error_budget_factor);
+            h4_int.step.eta_4th *= eta_scale;
+            h4_int.step.eta_2nd *= eta_scale;
+            for (PS::S32 i=0; i<h4_int.getNGroup(); i++) h4_int.groups[i].info.ds *= ds_scale;
+        }
+    }
+
+#ifdef HARD_CHECK_ENERGY
+    //! save the tolerance factor for the next drift from the energy error of this drift
+    /*! Should be called after driftClusterCMRecordGroupCMDataAndWriteBack (before clear).
+      @param[in,out] _error_budget: error-budget controller
+      @param[in] _ith: thread index
+     */
+    void saveErrorBudget(HardErrorBudget& _error_budget, const PS::S32 _ith) {
+        ASSERT(is_initialized);
+        const PS::S32 n_ptcl = use_sym_int ? sym_int.particles.getSize() : h4_int.particles.getSize();
+        PS::S64 id_min;
+        const PS::U64 key = calcWarmStartKey(id_min);
+        _error_budget.saveCluster(_ith, key, n_ptcl, error_budget_factor, energy.de_sd, etot_sd);
+    }
+#endif
+
     //! clear function
     void clear() {
         sym_int.clear();
@@ -1161,11 +1403,13 @@ public:
         ptcl_origin = NULL;
         interrupt_binary.clear();
         is_initialized = false;
+        error_budget_factor = 1.0;
 
 #ifdef PROFILE
         ARC_substep_sum = 0;
         ARC_tsyn_step_sum = 0;
         H4_step_sum = 0;
+        warm_start_count = 0;
 #endif
 #ifdef HARD_COUNT_NO_NEIGHBOR
         table_neighbor_exist.resizeNoInitialize(0);
@@ -1173,12 +1417,19 @@ public:
 #endif
 #ifdef HARD_CHECK_ENERGY
         energy.clear();
+        etot_sd = 0.0;
 #endif
 
     }       
 
 };
 
+//! handler of an interrupted hard cluster, called before the interrupted integration continues
+/*! @param[in,out] _hard_int: interrupted hard integrator, the interrupt binary is _hard_int.interrupt_binary
+    @param[in,out] _data: user data
+ */
+typedef void (*InterruptHandler)(HardIntegrator& _hard_int, void* _data);
+
 //! Hard system
 class SystemHard{
 private:
@@ -1201,6 +1452,16 @@ private:
     PS::S32 n_hard_int_use_; ///> number of used hard integrator
     PS::ReallocatableArray<HardIntegrator*> interrupt_list_; ///> interrupt integrator list
     PS::F64 interrupt_dt_; ///> time end record for interrupt clusters;
+    PS::ReallocatableArray<PS::S32> i_cluster_parked_; ///> indices of interrupted clusters that are not written back yet
+#ifdef HARD_CHECK_ENERGY
+    PS::ReallocatableArray<HardEnergy> energy_slot_; ///> energy change of each thread, or of each cluster (interrupted cluster) in the reproducible mode, summed in order after the parallel integration
+#endif
+#ifdef STELLAR_EVOLUTION
+    PS::ReallocatableArray<PS::F64> de_kin_single_; ///> kinetic energy change of each single particle due to modification
+#endif
+#ifdef ORBIT_QUADRUPOLE
+    std::vector<PS::ReallocatableArray<PS::F64mat>> orbit_quad_thread_; ///> orbit-averaged second moment of each new group (in the order of artificial particles) of each thread
+#endif
 
     struct OPLessIDCluster{
         template<class T> bool operator() (const T & left, const T & right) const {
@@ -1212,6 +1473,13 @@ private:
 public:
     PS::ReallocatableArray<COMM::BinaryTree<PtclH4,COMM::Binary>> binary_table;
     HardManager* manager;
+    bool reproducible_mode; ///> the artificial particles and the interrupted clusters are ordered independent of the thread number
+    GroupCatalog group_catalog; ///> catalog of groups recorded at the beginning of the drift when record_flag is set
+    bool neighbor_group_flag; ///> if true, collect members of stable groups at the end of the drift for the neighbor group c.m. mode
+    bool changeover_adapt_flag; ///> if true, particles may carry a pending changeover rescaling (r_scale_next) from the adaptive changeover
+    std::vector<std::vector<NeighborGroupMark>> neighbor_group_thread; ///> stable group members collected by each thread
+    HardWarmStart warm_start; ///> Hermite and AR step states carried to the next drift
+    HardErrorBudget error_budget; ///> per-cluster tolerance factors of the error-budget controller
 
 #ifdef PROFILE
     PS::S64 ARC_substep_sum;
@@ -1219,6 +1487,7 @@ public:
     PS::S64 ARC_n_groups;
     PS::S64 ARC_n_groups_iso;
     PS::S64 H4_step_sum;
+    PS::S64 warm_start_count;
 #endif
 #ifdef HARD_COUNT_NO_NEIGHBOR
     PS::S64 n_neighbor_zero;
@@ -1286,6 +1555,8 @@ private:
                 _par.changeover_update_flag = true;
             }
         }
+        // the group changeover replaces a pending rescaling from the adaptive changeover
+        else if (_par.changeover_adapt_flag) _ptcl->changeover.r_scale_next = 1.0;
     }
 
 
@@ -1392,13 +1663,14 @@ private:
       @param[in,out] _pi: particle for correction
       @param[in] _pj: j particle to calculate correction
      */
-    template <class Tpi>
-    static void calcAccPotShortWithLinearCutoff(Tpi& _pi,
-                                                const EPJSoft& _pj) {
+    template <class Tpi, class Tepj>
+    static void calcAccPotShortWithLinearCutoffEpj(Tpi& _pi,
+                                                   const Tepj& _pj) {
         const PS::F64 G = ForceSoft::grav_const;
         const PS::F64 eps_sq = EPISoft::eps * EPISoft::eps;
 
-        const PS::F64vec dr = _pi.pos - _pj.pos;
+        const PS::F64vec pos_j = _pj.getPos();
+        const PS::F64vec dr = _pi.pos - pos_j;
         const PS::F64 dr2 = dr * dr;
 #ifdef HARD_DEBUG
         assert(dr2>0.0);
@@ -1418,7 +1690,7 @@ private:
         const PS::F32 r_out_32 = EPISoft::r_out;
         const PS::F32 r_out2 = r_out_32 * r_out_32;
         PS::F32vec ri_32 = PS::F32vec(_pi.pos.x, _pi.pos.y, _pi.pos.z);
-        PS::F32vec rj_32 = PS::F32vec(_pj.pos.x, _pj.pos.y, _pj.pos.z);
+        PS::F32vec rj_32 = PS::F32vec(pos_j.x, pos_j.y, pos_j.z);
         PS::F32vec dr_32 = ri_32 - rj_32;
         PS::F32 dr2_eps_32 = dr_32*dr_32 + (PS::F32)eps_sq;
         const PS::F32 dr2_max = (dr2_eps_32 > r_out2) ? dr2_eps_32 : r_out2;
@@ -1466,6 +1738,57 @@ private:
 #endif
     }
 
+    //! changeover correction of force and potential for the j particle of the soft tree
+    template <class Tpi>
+    static void calcAccPotShortWithLinearCutoff(Tpi& _pi,
+                                                const EPJSoft& _pj) {
+        calcAccPotShortWithLinearCutoffEpj(_pi, _pj);
+    }
+
+#ifdef COMPACT_LET
+    //! changeover correction of force and potential for the compact j particle of the soft tree
+    template <class Tpi>
+    static void calcAccPotShortWithLinearCutoff(Tpi& _pi,
+                                                const EPJSoftCompact& _pj) {
+        calcAccPotShortWithLinearCutoffEpj(_pi, _pj);
+    }
+#endif
+
+#ifdef TIDAL_TENSOR_TREE
+    //! correct acceleration gradient of c.m. particle for soft force with changeover function
+    /*! Remove the linear cutoff gradient from the tree force and add the changeover soft gradient.
+      The derivative of the changeover function is only included in the gradient, not in the 2nd derivative.
+      @param[in,out] _pi: c.m. particle for correction
+      @param[in] _pos_j: position of j particle
+      @param[in] _mass_j: mass of j particle
+      @param[in] _ch_j: changeover of j particle
+     */
+    template <class Tpi>
+    static void calcAccGradShortWithLinearCutoff(Tpi& _pi,
+                                                 const PS::F64vec& _pos_j,
+                                                 const PS::F64 _mass_j,
+                                                 const ChangeOver& _ch_j) {
+        if (_mass_j==0.0) return;
+        const PS::F64 G = ForceSoft::grav_const;
+        const PS::F64 eps_sq = EPISoft::eps * EPISoft::eps;
+        const PS::F64 r_out2 = EPISoft::r_out * EPISoft::r_out;
+
+        const PS::F64vec dr = _pi.pos - _pos_j;
+        const PS::F64 dr2_eps = dr * dr + eps_sq;
+        const PS::F64 dr_eps = sqrt(dr2_eps);
+        const PS::F64 gm = G*_mass_j;
+        const PS::F64 k  = 1.0 - ChangeOver::calcAcc0WTwo(_pi.changeover, _ch_j, dr_eps);
+        const PS::F64 dk = - ChangeOver::calcAcc1WTwo(_pi.changeover, _ch_j, dr_eps, 1.0);
+#ifdef TIDAL_TENSOR_3RD
+        PS::F64* grad2 = _pi.acc_grad2;
+#else
+        PS::F64* grad2 = NULL;
+#endif
+        TidalTensor::addPointMassGradient(_pi.acc_grad, grad2, dr, dr2_eps, gm, k, dk);
+        TidalTensor::addPointMassGradientWithLinearCutoff(_pi.acc_grad, grad2, dr, dr2_eps, -gm, r_out2);
+    }
+#endif
+
     //! correct force and potential for changeover function change
     /*!
       @param[in,out] _pi: particle for correction
@@ -1507,13 +1830,14 @@ private:
       @param[in,out] _pi: particle for correction
       @param[in] _pj: j particle to calculate correction
      */
-    template <class Tpi>
-    static void calcAccChangeOverCorrection(Tpi& _pi,
-                                            const EPJSoft& _pj) {
+    template <class Tpi, class Tepj>
+    static void calcAccChangeOverCorrectionEpj(Tpi& _pi,
+                                               const Tepj& _pj) {
         const PS::F64 G = ForceSoft::grav_const;
         const PS::F64 eps_sq = EPISoft::eps * EPISoft::eps;
 
-        const PS::F64vec dr = _pi.pos - _pj.pos;
+        const PS::F64vec pos_j = _pj.getPos();
+        const PS::F64vec dr = _pi.pos - pos_j;
         const PS::F64 dr2 = dr * dr;
         const PS::F64 dr2_eps = dr2 + eps_sq;
         const PS::F64 drinv = 1.0/sqrt(dr2_eps);
@@ -1537,6 +1861,22 @@ private:
         _pi.acc -= gmor3*(knew-kold)*dr;
     }
 
+    //! correction for changeover function change for the j particle of the soft tree
+    template <class Tpi>
+    static void calcAccChangeOverCorrection(Tpi& _pi,
+                                            const EPJSoft& _pj) {
+        calcAccChangeOverCorrectionEpj(_pi, _pj);
+    }
+
+#ifdef COMPACT_LET
+    //! correction for changeover function change for the compact j particle of the soft tree
+    template <class Tpi>
+    static void calcAccChangeOverCorrection(Tpi& _pi,
+                                            const EPJSoftCompact& _pj) {
+        calcAccChangeOverCorrectionEpj(_pi, _pj);
+    }
+#endif
+
 #ifdef KDKDK_4TH
     template <class Tpi>
     static void calcAcorrShortWithLinearCutoff(Tpi& _pi,
@@ -1545,7 +1885,7 @@ private:
         const PS::F64 eps_sq = EPISoft::eps * EPISoft::eps;
 
         const PS::F64vec dr = _pi.pos - _pj.pos;
-        const PS::F64vec da = _pi.acc - _pi.acc;
+        const PS::F64vec da = _pi.acc - _pj.acc;
         const PS::F64 dr2 = dr * dr;
         const PS::F64 dr2_eps = dr2 + eps_sq;
         const PS::F64 drda = dr*da;
@@ -1597,16 +1937,17 @@ private:
         //acci + dt_kick * dt_kick * acorri /48; 
     }
 
-    template <class Tpi>
-    static void calcAcorrShortWithLinearCutoff(Tpi& _pi,
-                                               const EPJSoft& _pj) {
+    template <class Tpi, class Tepj>
+    static void calcAcorrShortWithLinearCutoffEpj(Tpi& _pi,
+                                                  const Tepj& _pj) {
         const PS::F64 G = ForceSoft::grav_const;
         const PS::F64 eps_sq = EPISoft::eps * EPISoft::eps;
         const PS::F64 r_out = EPISoft::r_out;
         const PS::F64 r_out2 = r_out * r_out;
 
-        const PS::F64vec dr = _pi.pos - _pj.pos;
-        const PS::F64vec da = _pi.acc - _pi.acc;
+        const PS::F64vec pos_j = _pj.getPos();
+        const PS::F64vec dr = _pi.pos - pos_j;
+        const PS::F64vec da = _pi.acc - PS::F64vec(_pj.acc.x, _pj.acc.y, _pj.acc.z);
         const PS::F64 dr2 = dr * dr;
         const PS::F64 dr2_eps = dr2 + eps_sq;
         const PS::F64 drda = dr*da;
@@ -1635,6 +1976,101 @@ private:
         _pi.acorr -= 2.0 * (acorr_k - acorr_max);
         //acci + dt_kick * dt_kick * acorri /48; 
     }
+
+    //! gradient correction with linear cutoff for the j particle of the soft tree
+    template <class Tpi>
+    static void calcAcorrShortWithLinearCutoff(Tpi& _pi,
+                                               const EPJSoft& _pj) {
+        calcAcorrShortWithLinearCutoffEpj(_pi, _pj);
+    }
+
+#ifdef COMPACT_LET
+    //! gradient correction with linear cutoff for the compact j particle of the soft tree
+    template <class Tpi>
+    static void calcAcorrShortWithLinearCutoff(Tpi& _pi,
+                                               const EPJSoftCompact& _pj) {
+        calcAcorrShortWithLinearCutoffEpj(_pi, _pj);
+    }
+#endif
+
+    //! gradient correction with linear cutoff for all neighbors of one particle
+    /*! Vectorized version of calcAcorrShortWithLinearCutoff (EPJSoft):
+        the neighbors (excluding the particle itself) are packed into arrays and the correction is summed in one SIMD loop.
+      @param[in,out] _pi: particle to be corrected, acorr is updated
+      @param[in] _pj: neighbor list
+      @param[in] _n_ngb: number of neighbors
+     */
+    template <class Tpi, class Tepj>
+    static void calcAcorrShortWithLinearCutoffNeighbor(Tpi& _pi,
+                                                       const Tepj* _pj,
+                                                       const PS::S32 _n_ngb) {
+        const PS::F64 G = ForceSoft::grav_const;
+        const PS::F64 eps_sq = EPISoft::eps * EPISoft::eps;
+        const PS::F64 r_out = EPISoft::r_out;
+        const PS::F64 r_out2 = r_out * r_out;
+        const PS::F64 r_in_i  = _pi.changeover.getRin();
+        const PS::F64 r_out_i = _pi.changeover.getRout();
+
+        PS::F64 dx[_n_ngb], dy[_n_ngb], dz[_n_ngb];
+        PS::F64 dax[_n_ngb], day[_n_ngb], daz[_n_ngb];
+        PS::F64 mass[_n_ngb], r_in_ij[_n_ngb], r_out_ij[_n_ngb];
+        PS::S32 n = 0;
+        for(PS::S32 k=0; k<_n_ngb; k++){
+            if (_pj[k].id == _pi.id) continue;
+            const PS::F64vec dr = _pi.pos - _pj[k].getPos();
+            const PS::F64vec da = _pi.acc - PS::F64vec(_pj[k].acc.x, _pj[k].acc.y, _pj[k].acc.z);
+            dx[n] = dr.x;
+            dy[n] = dr.y;
+            dz[n] = dr.z;
+            dax[n] = da.x;
+            day[n] = da.y;
+            daz[n] = da.z;
+            mass[n] = _pj[k].mass;
+            // select the changeover with maximum rout, the same as ChangeOver::calcAcc0WTwo
+            if (r_out_i > _pj[k].r_out) {
+                r_in_ij[n]  = r_in_i;
+                r_out_ij[n] = r_out_i;
+            }
+            else {
+                r_in_ij[n]  = _pj[k].r_in;
+                r_out_ij[n] = _pj[k].r_out;
+            }
+            n++;
+        }
+
+        PS::F64 acorr_x = 0.0, acorr_y = 0.0, acorr_z = 0.0;
+#pragma omp simd reduction(+:acorr_x,acorr_y,acorr_z)
+        for(PS::S32 k=0; k<n; k++){
+            const PS::F64 dr2 = dx[k]*dx[k] + dy[k]*dy[k] + dz[k]*dz[k];
+            const PS::F64 dr2_eps = dr2 + eps_sq;
+            const PS::F64 drda = dx[k]*dax[k] + dy[k]*day[k] + dz[k]*daz[k];
+            const PS::F64 drinv = 1.0/sqrt(dr2_eps);
+            const PS::F64 drdadrinv = drda*drinv;
+            const PS::F64 drinv2 = drinv * drinv;
+            const PS::F64 gmor3 = G*mass[k] * drinv * drinv2;
+            const PS::F64 dr_eps = drinv * dr2_eps;
+            PS::F64 w0, w1;
+            ChangeOver::calcAcc0WAcc1W(w0, w1, r_in_ij[k], r_out_ij[k], dr_eps, drdadrinv);
+            const PS::F64 kc = 1.0 - w0;
+            const PS::F64 kdot = - w1;
+
+            const PS::F64 dr2_max = (dr2_eps > r_out2) ? dr2_eps : r_out2;
+            const PS::F64 drinv_max = 1.0/sqrt(dr2_max);
+            const PS::F64 drinv2_max = drinv_max*drinv_max;
+            const PS::F64 gmor3_max = G*mass[k] * drinv_max * drinv2_max;
+
+            const PS::F64 alpha = drda*drinv2;
+            const PS::F64 alpha_max = drda * drinv2_max;
+            const PS::F64 fk_da = gmor3*kc - gmor3_max;
+            const PS::F64 fk_dr = gmor3*(3.0*kc*alpha - kdot) - gmor3_max*3.0*alpha_max;
+            acorr_x += fk_da*dax[k] - fk_dr*dx[k];
+            acorr_y += fk_da*day[k] - fk_dr*dy[k];
+            acorr_z += fk_da*daz[k] - fk_dr*dz[k];
+        }
+        _pi.acorr.x -= 2.0 * acorr_x;
+        _pi.acorr.y -= 2.0 * acorr_y;
+        _pi.acorr.z -= 2.0 * acorr_z;
+    }
 #endif
 
     //! soft force correction use tree neighbor search for one particle
@@ -1664,16 +2100,30 @@ private:
             
         }
 
+#ifdef TIDAL_TENSOR_TREE
+        // acceleration gradient is only used for c.m. particle
+        const bool grad_flag = !_acorr_flag && _psoft.group_data.artificial.isCM();
+#endif
+
+#ifdef KDKDK_4TH
+        if(_acorr_flag) {
+            calcAcorrShortWithLinearCutoffNeighbor(_psoft, ptcl_nb, n_ngb);
+            return;
+        }
+#endif
+
         // loop neighbors
         for(PS::S32 k=0; k<n_ngb; k++){
             if (ptcl_nb[k].id == _psoft.id) continue;
 
-#ifdef KDKDK_4TH
-            if(_acorr_flag) 
-                calcAcorrShortWithLinearCutoff(_psoft, ptcl_nb[k]);
-            else
+            calcAccPotShortWithLinearCutoff(_psoft, ptcl_nb[k]);
+#ifdef TIDAL_TENSOR_TREE
+            if (grad_flag) {
+                ChangeOver chk;
+                chk.setR(ptcl_nb[k].r_in, ptcl_nb[k].r_out);
+                calcAccGradShortWithLinearCutoff(_psoft, ptcl_nb[k].getPos(), ptcl_nb[k].mass, chk);
+            }
 #endif
-                calcAccPotShortWithLinearCutoff(_psoft, ptcl_nb[k]);
         }
 //#ifdef STELLAR_EVOLUTION
 //        // correct soft potential energy of one particle change due to mass change
@@ -1752,6 +2202,21 @@ private:
             // for c.m. particle
             pj = ap_manager.getCMParticles(p_arti_j);
             correctionLoop(0);
+
+#ifdef TIDAL_TENSOR_TREE
+            // acceleration gradient of c.m. particle
+            if (!_acorr_flag) {
+                for (int kj=0; kj<_n_group; kj++) {
+                    PS::S32 kj_start = adr_first_ptcl_arti_in_cluster_[kj];
+                    if (kj_start<0) continue;
+                    auto* porb_kj = ap_manager.getOrbitalParticles(&_sys[kj_start]);
+                    for (int kk=0; kk<ap_manager.getOrbitalParticleN(); kk++) 
+                        calcAccGradShortWithLinearCutoff(pj[0], porb_kj[kk].pos, porb_kj[kk].mass, porb_kj[kk].changeover);
+                }
+                for (int kj=_adr_real_start; kj<_adr_real_end; kj++) 
+                    calcAccGradShortWithLinearCutoff(pj[0], _ptcl_local[kj].pos, _ptcl_local[kj].mass, _ptcl_local[kj].changeover);
+            }
+#endif
             
             ap_manager.correctArtficialParticleForce(p_arti_j);
         }
@@ -1800,6 +2265,9 @@ public:
 
     SystemHard(){
         manager = NULL;
+        reproducible_mode = false;
+        neighbor_group_flag = false;
+        changeover_adapt_flag = false;
         hard_int_ = NULL;
         n_hard_int_max_ = 0;
         n_hard_int_use_ = 0;
@@ -1810,6 +2278,7 @@ public:
         ARC_n_groups = 0;
         ARC_n_groups_iso = 0;
         H4_step_sum = 0;
+        warm_start_count = 0;
 #endif
 #ifdef HARD_COUNT_NO_NEIGHBOR
         n_neighbor_zero = 0;
@@ -1953,6 +2422,37 @@ public:
         return i_cluster_changeover_update_.size();
     }
 
+    //! get allocated memory size (bytes) of particle, cluster and group arrays
+    /*! The hard integrator array is counted by the object size, the internal buffers of Hermite and AR integrators are not included
+     */
+    size_t getMemSizeUsed() const {
+        size_t size = ptcl_hard_.getMemSize()
+            + n_ptcl_in_cluster_.getMemSize()
+            + n_ptcl_in_cluster_disp_.getMemSize()
+            + n_group_in_cluster_.getMemSize()
+            + n_group_in_cluster_offset_.getMemSize()
+            + n_member_in_group_.getMemSize()
+            + n_member_in_group_offset_.getMemSize()
+            + adr_first_ptcl_arti_in_cluster_.getMemSize()
+            + i_cluster_changeover_update_.getMemSize()
+            + interrupt_list_.getMemSize()
+            + i_cluster_parked_.getMemSize()
+            + binary_table.getMemSize()
+            + warm_start.getMemSizeUsed()
+            + error_budget.getMemSizeUsed();
+        if (hard_int_!=NULL) size += n_hard_int_max_*sizeof(HardIntegrator);
+#ifdef HARD_CHECK_ENERGY
+        size += energy_slot_.getMemSize();
+#endif
+#ifdef ORBIT_QUADRUPOLE
+        for (auto& quad : orbit_quad_thread_) size += quad.getMemSize();
+#endif
+#ifdef STELLAR_EVOLUTION
+        size += de_kin_single_.getMemSize();
+#endif
+        return size;
+    }
+
     void setTimeOrigin(const PS::F64 _time_origin){
         time_origin_ = _time_origin;
     }
@@ -2036,6 +2536,9 @@ public:
      */
     void driveForOneClusterOMP(const PS::F64 _dt) {
         const PS::S32 n = ptcl_hard_.size();
+#ifdef STELLAR_EVOLUTION
+        de_kin_single_.resizeNoInitialize(n);
+#endif
 
 #pragma omp parallel for
         for(PS::S32 i=0; i<n; i++){
@@ -2048,13 +2551,10 @@ public:
 
             PS::F64vec vbk = pi.vel; //back up velocity in case of change
             int modify_flag = manager->ar_manager.interaction.modifyOneParticle(pi, time_origin_, time_origin_ + _dt);
+            de_kin_single_[i] = 0.0;
             if (modify_flag) {
                 auto& v = pi.vel;
-                Float de_kin = 0.5*(pi.mass*(v[0]*v[0]+v[1]*v[1]+v[2]*v[2]) - mbk*(vbk[0]*vbk[0]+vbk[1]*vbk[1]+vbk[2]*vbk[2]));
-                energy.de_sd_change_cum += de_kin;
-                energy.de_sd_change_modify_single += de_kin;
-                energy.de_change_cum += de_kin;
-                energy.de_change_modify_single += de_kin;
+                de_kin_single_[i] = 0.5*(pi.mass*(v[0]*v[0]+v[1]*v[1]+v[2]*v[2]) - mbk*(vbk[0]*vbk[0]+vbk[1]*vbk[1]+vbk[2]*vbk[2]));
             }
             // shift time interrupt in order to get consistent time for stellar evolution in the next drift
             //pi.time_record    -= _dt;
@@ -2083,6 +2583,15 @@ public:
             */
         }
 
+#ifdef STELLAR_EVOLUTION
+        // sum in a fixed order to avoid the race condition and the dependence on the thread number
+        const PS::F64 de_kin = sumFixedOrder(de_kin_single_.getPointer(), n);
+        energy.de_sd_change_cum += de_kin;
+        energy.de_sd_change_modify_single += de_kin;
+        energy.de_change_cum += de_kin;
+        energy.de_change_modify_single += de_kin;
+#endif
+
         time_origin_ += _dt;
     }
 
@@ -2096,29 +2605,39 @@ public:
                                     PS::ReallocatableArray<PS::S32> & _mass_modify_list) {
         const PS::S32 n = ptcl_hard_.size();
         //PS::ReallocatableArray<PS::S32> removelist(n);
-        for(PS::S32 i=0; i<n; i++){
-            //PS::S32 adr = adr_array[i];
-            PS::S32 adr = ptcl_hard_[i].adr_org;
+        for(PS::S32 i=0; i<n; i++) writeBackOnePtcl(sys, i, _mass_modify_list);
+        updateTimeWriteBack();
+    }
+
+    //! write back one hard particle to global system and check mass modification
+    /*! 
+      @param[in,out] sys: particle system
+      @param[in] _i: particle index in ptcl_hard_
+      @param[out] _mass_modify_list: address on _sys of particles where mass is modified
+     */
+    template<class Tsys>
+    void writeBackOnePtcl(Tsys & sys,
+                          const PS::S32 _i,
+                          PS::ReallocatableArray<PS::S32> & _mass_modify_list) {
+        PS::S32 adr = ptcl_hard_[_i].adr_org;
 #ifdef HARD_DEBUG
-            assert(sys[adr].id == ptcl_hard_[i].id);
+        assert(sys[adr].id == ptcl_hard_[_i].id);
 #endif
 #ifdef STELLAR_EVOLUTION
-            PS::F64 mass_bk = sys[adr].group_data.artificial.isMember()? sys[adr].group_data.artificial.getMassBackup(): sys[adr].mass;
-            assert(mass_bk!=0.0);
+        PS::F64 mass_bk = sys[adr].group_data.artificial.isMember()? sys[adr].group_data.artificial.getMassBackup(): sys[adr].mass;
+        assert(mass_bk!=0.0);
 #endif
-            sys[adr].DataCopy(ptcl_hard_[i]);
+        sys[adr].DataCopy(ptcl_hard_[_i]);
 
 #ifdef STELLAR_EVOLUTION
-            //// record mass change for later energy correction
-            sys[adr].dm = sys[adr].mass - mass_bk;
-            if (sys[adr].dm!=0.0) _mass_modify_list.push_back(adr);
-#endif
-            assert(!std::isinf(sys[adr].pos[0]));
-            assert(!std::isnan(sys[adr].pos[0]));
-            assert(!std::isinf(sys[adr].vel[0]));
-            assert(!std::isnan(sys[adr].vel[0]));
-        }
-        updateTimeWriteBack();
+        //// record mass change for later energy correction
+        sys[adr].dm = sys[adr].mass - mass_bk;
+        if (sys[adr].dm!=0.0) _mass_modify_list.push_back(adr);
+#endif
+        assert(!std::isinf(sys[adr].pos[0]));
+        assert(!std::isnan(sys[adr].pos[0]));
+        assert(!std::isinf(sys[adr].vel[0]));
+        assert(!std::isnan(sys[adr].vel[0]));
     }
 
     //! write back hard particles to global system and update time of write back OMP version
@@ -2139,7 +2658,8 @@ public:
 #ifdef STELLAR_EVOLUTION
             const PS::S32 ith = PS::Comm::getThreadNum();
 #endif
-#pragma omp for 
+            // static schedule: the per-thread mass modification lists are joined in thread order, which keeps the particle index order
+#pragma omp for schedule(static)
             for(PS::S32 i=0; i<n; i++){
                 PS::S32 adr = ptcl_hard_[i].adr_org;
                 //PS::S32 adr = adr_array[i];
@@ -2193,6 +2713,73 @@ public:
         writeBackPtclForOneClusterOMP(_sys, _mass_modify_list);
     }
 
+    //! park interrupted clusters and write back particles of all other clusters
+    /*! The time of write back is not updated. 
+        The parked clusters are written back by writeBackPtclForParkedClusters after the interruptions are resolved.
+      @param[in,out] _sys: particle system
+      @param[out] _mass_modify_list: address on _sys of particles where mass is modified
+     */
+    template<class Tsys>
+    void writeBackPtclForNonInterruptClusters(Tsys & _sys,
+                                              PS::ReallocatableArray<PS::S32> & _mass_modify_list) {
+        const PS::S32 n_cluster = n_ptcl_in_cluster_.size();
+        const PS::S32 n_interrupt = interrupt_list_.size();
+        i_cluster_parked_.resizeNoInitialize(n_interrupt);
+        for (PS::S32 k=0; k<n_interrupt; k++) {
+            // find the cluster from the address of the first particle
+            const PS::S32 adr_head = interrupt_list_[k]->ptcl_origin - ptcl_hard_.getPointer();
+            const PS::S32* disp = n_ptcl_in_cluster_disp_.getPointer();
+            const PS::S32 i_cluster = std::upper_bound(disp, disp+n_cluster, adr_head) - disp - 1;
+            assert(disp[i_cluster]==adr_head);
+            i_cluster_parked_[k] = i_cluster;
+        }
+        std::sort(i_cluster_parked_.getPointer(), i_cluster_parked_.getPointer()+n_interrupt);
+
+        PS::S32 k_parked = 0;
+        for (PS::S32 i=0; i<n_cluster; i++) {
+            if (k_parked<n_interrupt && i_cluster_parked_[k_parked]==i) {
+                k_parked++;
+                continue;
+            }
+            for (PS::S32 j=n_ptcl_in_cluster_disp_[i]; j<n_ptcl_in_cluster_disp_[i+1]; j++) 
+                writeBackOnePtcl(_sys, j, _mass_modify_list);
+        }
+    }
+
+    //! write back particles of parked clusters and update time of write back
+    /*! Should be called after all interruptions are resolved
+      @param[in,out] _sys: particle system
+      @param[out] _mass_modify_list: address on _sys of particles where mass is modified
+     */
+    template<class Tsys>
+    void writeBackPtclForParkedClusters(Tsys & _sys,
+                                        PS::ReallocatableArray<PS::S32> & _mass_modify_list) {
+        assert(interrupt_list_.size()==0);
+        for (PS::S32 k=0; k<i_cluster_parked_.size(); k++) {
+            const PS::S32 i = i_cluster_parked_[k];
+            for (PS::S32 j=n_ptcl_in_cluster_disp_[i]; j<n_ptcl_in_cluster_disp_[i+1]; j++) 
+                writeBackOnePtcl(_sys, j, _mass_modify_list);
+        }
+        i_cluster_parked_.resizeNoInitialize(0);
+        updateTimeWriteBack();
+    }
+
+    //! set the stable group ids of members collected at the end of the drift to the global particle system
+    /*! The collected buffers are cleared. The addresses are valid only before the particle system is modified (removing or exchanging particles)
+      @param[in,out] _sys: particle system
+     */
+    template<class Tsys>
+    void setNeighborGroupToPtcl(Tsys & _sys) {
+        for (auto& buf : neighbor_group_thread) {
+            for (auto& mark : buf) {
+                auto& pi = _sys[mark.adr];
+                pi.nb_group_id = mark.id_group;
+                pi.nb_group_n  = mark.n_member;
+            }
+            buf.clear();
+        }
+    }
+
 //    template<class Tsys>
 //    void writeBackPtclLocalOnlyOMP(Tsys & sys) {
 //        const PS::S32 n = ptcl_hard_.size();
@@ -2244,9 +2831,19 @@ public:
         }
 
         interrupt_list_.resizeNoInitialize(0);
+        i_cluster_parked_.resizeNoInitialize(0);
     }
 
 
+    //! sort interrupt list by the address of the first particle of clusters
+    /*! The hard integrators are assigned to interrupted clusters in the finishing order of threads, 
+        thus the sort makes the order of the interrupt list independent of the thread number.
+     */
+    void sortInterruptList() {
+        std::sort(interrupt_list_.getPointer(), interrupt_list_.getPointer()+interrupt_list_.size(), 
+                  [](const HardIntegrator* a, const HardIntegrator* b){ return a->ptcl_origin < b->ptcl_origin;});
+    }
+
     //! Hard integration for clusters
     /*! Integrate (drift) all clusters with OpenMP
       If interrupt integration exist, record in the interrupt_list_;
@@ -2289,6 +2886,19 @@ public:
         }
 #endif
 
+        if (group_catalog.record_flag) group_catalog.resizeThread(num_thread);
+        if (neighbor_group_flag && (PS::S32)neighbor_group_thread.size()<num_thread) neighbor_group_thread.resize(num_thread);
+        if (warm_start.flag) warm_start.update(num_thread);
+        if (error_budget.isActive()) error_budget.update(num_thread);
+
+#if defined(HARD_CHECK_ENERGY) && !defined(ONLY_SOFT)
+        // energy of each thread is accumulated in one slot and summed after the loop,
+        // in the reproducible mode, one slot per cluster is used and summed in the cluster order
+        const PS::S32 n_energy_slot = reproducible_mode ? n_cluster : num_thread;
+        energy_slot_.resizeNoInitialize(n_energy_slot);
+        for (PS::S32 i=0; i<n_energy_slot; i++) energy_slot_[i].clear();
+#endif
+
 #pragma omp parallel for schedule(dynamic)
         for(PS::S32 i=0; i<n_cluster; i++){
             const PS::S32 ith = PS::Comm::getThreadNum();
@@ -2331,6 +2941,11 @@ public:
             // if interrupt exist, escape initial
             hard_int_thread[ith]->initial(ptcl_hard_.getPointer(adr_head), n_ptcl, ptcl_artificial_ptr, n_group, n_member_in_group_ptr, manager, time_origin_);
 
+            if (group_catalog.record_flag && n_group>0) hard_int_thread[ith]->recordGroupCatalog(group_catalog.buffer_thread[ith]);
+
+            if (warm_start.flag) hard_int_thread[ith]->applyWarmStart(warm_start);
+            if (error_budget.isActive()) hard_int_thread[ith]->applyErrorBudget(error_budget);
+
             auto& interrupt_binary = hard_int_thread[ith]->integrateToTime(dt);
 
             if (interrupt_binary.status!=AR::InterruptStatus::none) {
@@ -2346,13 +2961,17 @@ public:
                 ARC_substep_sum    += hard_int_thread[ith]->ARC_substep_sum;
                 ARC_tsyn_step_sum  += hard_int_thread[ith]->ARC_tsyn_step_sum;
                 H4_step_sum        += hard_int_thread[ith]->H4_step_sum;
+                warm_start_count   += hard_int_thread[ith]->warm_start_count;
 #endif
 #ifdef HARD_COUNT_NO_NEIGHBOR
                 n_neighbor_zero    += hard_int_thread[ith]->n_neighbor_zero;
 #endif
 #ifdef HARD_CHECK_ENERGY
-                energy += hard_int_thread[ith]->energy;
+                energy_slot_[reproducible_mode ? i : ith] += hard_int_thread[ith]->energy;
+                if (error_budget.isActive()) hard_int_thread[ith]->saveErrorBudget(error_budget, ith);
 #endif
+                if (neighbor_group_flag && n_group>0) hard_int_thread[ith]->collectStableGroupMembers(neighbor_group_thread[ith]);
+                if (warm_start.flag) hard_int_thread[ith]->saveWarmStart(warm_start, ith);
                 
                 hard_int_thread[ith]->clear();
             }
@@ -2382,6 +3001,10 @@ public:
 
         }
 
+#if defined(HARD_CHECK_ENERGY) && !defined(ONLY_SOFT)
+        for (PS::S32 i=0; i<n_energy_slot; i++) energy += energy_slot_[i];
+#endif
+
         // regist interrupted hard integrator
         assert(interrupt_list_.size()==0);
         for (auto iptr = hard_int_; iptr<hard_int_front_ptr; iptr++) 
@@ -2392,6 +3015,7 @@ public:
 #endif
                 interrupt_list_.push_back(iptr);
             }
+        if (reproducible_mode) sortInterruptList();
 
 
         // advance time_origin if all clusters finished
@@ -2409,6 +3033,11 @@ public:
      */
     PS::S32 finishIntegrateInterruptClustersOMP() {
         PS::S32 n_interrupt = interrupt_list_.size();
+#ifdef HARD_CHECK_ENERGY
+        const PS::S32 n_energy_slot = reproducible_mode ? n_interrupt : PS::Comm::getNumberOfThread();
+        energy_slot_.resizeNoInitialize(n_energy_slot);
+        for (PS::S32 i=0; i<n_energy_slot; i++) energy_slot_[i].clear();
+#endif
 #pragma omp parallel for schedule(dynamic)
         for (PS::S32 i=0; i<n_interrupt; i++) {
             auto hard_int_ptr = interrupt_list_[i];
@@ -2421,14 +3050,21 @@ public:
                 ARC_substep_sum    += hard_int_ptr->ARC_substep_sum;
                 ARC_tsyn_step_sum  += hard_int_ptr->ARC_tsyn_step_sum;
                 H4_step_sum        += hard_int_ptr->H4_step_sum;
+                warm_start_count   += hard_int_ptr->warm_start_count;
 #endif
 #ifdef HARD_CHECK_ENERGY
-                energy += hard_int_ptr->energy;
+                energy_slot_[reproducible_mode ? i : PS::Comm::getThreadNum()] += hard_int_ptr->energy;
+                if (error_budget.isActive()) hard_int_ptr->saveErrorBudget(error_budget, PS::Comm::getThreadNum());
 #endif
+                if (neighbor_group_flag) hard_int_ptr->collectStableGroupMembers(neighbor_group_thread[PS::Comm::getThreadNum()]);
+                if (warm_start.flag) hard_int_ptr->saveWarmStart(warm_start, PS::Comm::getThreadNum());
                 
                 hard_int_ptr->clear();
             }
         }
+#ifdef HARD_CHECK_ENERGY
+        for (PS::S32 i=0; i<n_energy_slot; i++) energy += energy_slot_[i];
+#endif
         
         // record new interrupt list
         PS::S32 i_front = 0;
@@ -2448,6 +3084,7 @@ public:
             }
         }
 
+        if (reproducible_mode) sortInterruptList();
         n_interrupt =  interrupt_list_.size();
 
         // advance time_origin if all clusters finished
@@ -2456,6 +3093,25 @@ public:
         return n_interrupt;
     }
 
+    //! resolve interrupted clusters locally until all of them finish the drift
+    /*! The handler is called serially for each interrupted cluster before the integration continues, 
+        then the clusters are integrated in parallel. No MPI communication is done.
+      @param[in] _handler: interrupt handler, NULL: continue the integration directly
+      @param[in,out] _data: user data passed to the handler
+      \return total number of interruptions resolved
+     */
+    PS::S32 resolveInterruptClustersOMP(InterruptHandler _handler, void* _data) {
+        PS::S32 n_resolve = 0;
+        while (interrupt_list_.size()>0) {
+            n_resolve += interrupt_list_.size();
+            if (_handler!=NULL) {
+                for (PS::S32 i=0; i<interrupt_list_.size(); i++) _handler(*interrupt_list_[i], _data);
+            }
+            finishIntegrateInterruptClustersOMP();
+        }
+        return n_resolve;
+    }
+
     struct GroupIndexInfo{
         PS::S32 cluster_index, group_index, n_members, n_member_offset, isolated_case;
         GroupIndexInfo() {}
@@ -2463,6 +3119,11 @@ public:
             cluster_index(_cluster), group_index(_group), n_members(_member), n_member_offset(_offset), isolated_case(_isolated_case) {}
     };
 
+    //! range of artificial particles and binary table of one cluster in the thread arrays
+    struct ClusterSliceInfo{
+        PS::S32 i_thread, artificial_start, artificial_end, binary_start, binary_end;
+    };
+
     //! generate artificial particles,
     /*  
         @param[in]     _i_cluster: cluster index
@@ -2566,8 +3227,8 @@ public:
                 if (bin.period*sd.getSlowDownFactor() > dt_nstep) {
                     // Set member particle type, backup mass, collect member particle index to group_ptcl_adr_list
                     //use _ptcl_in_cluster as the first particle address as reference to calculate the particle index.
-                    struct { Tptcl* adr_ref; PS::S32* group_list; PS::S32 n; PS::S64 pcm_id; ChangeOver* changeover_cm; PS::F64 rsearch_cm; bool changeover_update_flag;}
-                    group_index_pars = { _ptcl_in_cluster,  &group_ptcl_adr_list[group_ptcl_adr_offset], 0, -1, &bin.changeover, bin.r_search, false};
+                    struct { Tptcl* adr_ref; PS::S32* group_list; PS::S32 n; PS::S64 pcm_id; ChangeOver* changeover_cm; PS::F64 rsearch_cm; bool changeover_update_flag; bool changeover_adapt_flag;}
+                    group_index_pars = { _ptcl_in_cluster,  &group_ptcl_adr_list[group_ptcl_adr_offset], 0, -1, &bin.changeover, bin.r_search, false, changeover_adapt_flag};
                     bin.processLeafIter(group_index_pars, collectGroupMemberAdrAndSetMemberParametersIter);
                     if (group_index_pars.changeover_update_flag) changeover_update_flag = true;
 #ifdef ARTIFICIAL_PARTICLE_DEBUG
@@ -2608,8 +3269,8 @@ public:
                 // Set member particle type to member, set mass to zero, backup mass and collect member particle index to group_ptcl_adr_list
                 // set rsearch and changeover for members
                 //use _ptcl_in_cluster as the first particle address as reference to calculate the particle index.
-                struct { Tptcl* adr_ref; PS::S32* group_list; PS::S32 n; PS::S64 pcm_id; ChangeOver* changeover_cm; PS::F64 rsearch_cm; bool changeover_update_flag;}
-                group_index_pars = { _ptcl_in_cluster,  &group_ptcl_adr_list[group_ptcl_adr_offset], 0, n_ptcl_artificial, &binary_stable_i.changeover, binary_stable_i.r_search, false};
+                struct { Tptcl* adr_ref; PS::S32* group_list; PS::S32 n; PS::S64 pcm_id; ChangeOver* changeover_cm; PS::F64 rsearch_cm; bool changeover_update_flag; bool changeover_adapt_flag;}
+                group_index_pars = { _ptcl_in_cluster,  &group_ptcl_adr_list[group_ptcl_adr_offset], 0, n_ptcl_artificial, &binary_stable_i.changeover, binary_stable_i.r_search, false, changeover_adapt_flag};
                 binary_stable_i.processLeafIter(group_index_pars, collectGroupMemberAdrAndSetMemberParametersIter);
 #ifdef ARTIFICIAL_PARTICLE_DEBUG
                 assert(group_index_pars.n==n_members);
@@ -2618,6 +3279,12 @@ public:
 
                 // generate artificial particles
                 ap_manager.createArtificialParticles(ptcl_artificial_i, binary_stable_i, index_group, 2);
+#ifdef ORBIT_QUADRUPOLE
+                // orbit-averaged quadrupole carried by the c.m. particle in the soft tree, the buffers are only prepared in findGroupsAndCreateArtificialParticlesOMP
+                const PS::S32 ith = PS::Comm::getThreadNum();
+                if (ith<(PS::S32)orbit_quad_thread_.size()) 
+                    orbit_quad_thread_[ith].push_back(OrbitalQuadrupoleManager::calcQuadrupole(binary_stable_i));
+#endif
 
                 // set rsearch and changeover for c.m. particle
                 auto* pcm = ap_manager.getCMParticles(ptcl_artificial_i);
@@ -2730,7 +3397,15 @@ public:
         // reorder ptcl
         for (int i=0; i<_n_ptcl; i++) _ptcl_in_cluster[i]=ptcl_tmp[ptcl_list_reorder[i]];
 
-        // changeover update
+        // changeover update, including pending rescaling of members from the adaptive changeover
+        if (changeover_adapt_flag && !changeover_update_flag) {
+            for (int i=0; i<_n_ptcl; i++) {
+                if (_ptcl_in_cluster[i].changeover.r_scale_next!=1.0) {
+                    changeover_update_flag = true;
+                    break;
+                }
+            }
+        }
         if (changeover_update_flag) _changeover_update_list.push_back(_i_cluster);
     }
 
@@ -2759,11 +3434,22 @@ public:
             n_member_in_group_thread[i].resizeNoInitialize(0);
             i_cluster_changeover_update_threads[i].resizeNoInitialize(0);
         }
+#ifdef ORBIT_QUADRUPOLE
+        if ((PS::S32)orbit_quad_thread_.size()<num_thread) orbit_quad_thread_.resize(num_thread);
+        for (PS::S32 i=0; i<num_thread; i++) orbit_quad_thread_[i].resizeNoInitialize(0);
+#endif
         auto& ap_manager = manager->ap_manager;
+        PS::ReallocatableArray<ClusterSliceInfo> cluster_slice;
+        if (reproducible_mode) cluster_slice.resizeNoInitialize(n_cluster);
 
 #pragma omp parallel for schedule(dynamic)
         for (PS::S32 i=0; i<n_cluster; i++){
             const PS::S32 ith = PS::Comm::getThreadNum();
+            if (reproducible_mode) {
+                cluster_slice[i].i_thread = ith;
+                cluster_slice[i].artificial_start = ptcl_artificial_thread[ith].size();
+                cluster_slice[i].binary_start = binary_table_thread[ith].size();
+            }
             PtclH4* ptcl_in_cluster = ptcl_hard_.getPointer() + n_ptcl_in_cluster_disp_[i];
             const PS::S32 n_ptcl = n_ptcl_in_cluster_[i];
             // reset particle type to single
@@ -2780,6 +3466,53 @@ public:
 
             // find groups and generate artificial particles for cluster i
             findGroupsAndCreateArtificialParticlesOneCluster(i, ptcl_in_cluster, n_ptcl, ptcl_artificial_thread[ith], binary_table_thread[ith], n_group_in_cluster_[i], n_member_in_group_thread[ith], i_cluster_changeover_update_threads[ith], group_candidate, _dt_tree);
+
+            // with the adaptive changeover, ensure the pending changeover rescaling is consistent in the global system before the soft tree is built (isolated binary members are not updated later)
+            if (changeover_adapt_flag) {
+                for(PS::S32 j=0; j<n_ptcl; j++) {
+                    PS::S64 adr=ptcl_in_cluster[j].adr_org;
+                    if(adr>=0) _sys[adr].changeover.r_scale_next = ptcl_in_cluster[j].changeover.r_scale_next;
+                }
+            }
+            if (reproducible_mode) {
+                cluster_slice[i].artificial_end = ptcl_artificial_thread[ith].size();
+                cluster_slice[i].binary_end = binary_table_thread[ith].size();
+            }
+        }
+
+        // in the reproducible mode, reorder the artificial particles and binary tables in the cluster order and move them to the first thread,
+        // so that the particle addresses in _sys do not depend on the dynamic scheduling of clusters
+        if (reproducible_mode && num_thread>1) {
+            PS::ReallocatableArray<PtclH4> ptcl_artificial_ordered;
+            PS::ReallocatableArray<COMM::BinaryTree<PtclH4,COMM::Binary>> binary_table_ordered;
+            for (PS::S32 i=0; i<n_cluster; i++) {
+                auto& slice = cluster_slice[i];
+                for (PS::S32 k=slice.artificial_start; k<slice.artificial_end; k++)
+                    ptcl_artificial_ordered.push_back(ptcl_artificial_thread[slice.i_thread][k]);
+                for (PS::S32 k=slice.binary_start; k<slice.binary_end; k++)
+                    binary_table_ordered.push_back(binary_table_thread[slice.i_thread][k]);
+            }
+            ptcl_artificial_thread[0].resizeNoInitialize(0);
+            binary_table_thread[0].resizeNoInitialize(0);
+            for (PS::S32 k=0; k<ptcl_artificial_ordered.size(); k++) ptcl_artificial_thread[0].push_back(ptcl_artificial_ordered[k]);
+            for (PS::S32 k=0; k<binary_table_ordered.size(); k++) binary_table_thread[0].push_back(binary_table_ordered[k]);
+            for (PS::S32 i=1; i<num_thread; i++) {
+                ptcl_artificial_thread[i].resizeNoInitialize(0);
+                binary_table_thread[i].resizeNoInitialize(0);
+            }
+#ifdef ORBIT_QUADRUPOLE
+            // one quadrupole per group, the group index is the artificial particle index divided by the group size
+            const PS::S32 n_artificial_per_group = ap_manager.getArtificialParticleN();
+            PS::ReallocatableArray<PS::F64mat> orbit_quad_ordered;
+            for (PS::S32 i=0; i<n_cluster; i++) {
+                auto& slice = cluster_slice[i];
+                for (PS::S32 k=slice.artificial_start; k<slice.artificial_end; k+=n_artificial_per_group)
+                    orbit_quad_ordered.push_back(orbit_quad_thread_[slice.i_thread][k/n_artificial_per_group]);
+            }
+            orbit_quad_thread_[0].resizeNoInitialize(0);
+            for (PS::S32 k=0; k<orbit_quad_ordered.size(); k++) orbit_quad_thread_[0].push_back(orbit_quad_ordered[k]);
+            for (PS::S32 i=1; i<num_thread; i++) orbit_quad_thread_[i].resizeNoInitialize(0);
+#endif
         }
 
         // gether binary table
@@ -2812,7 +3545,8 @@ public:
         for (PS::S32 i=0; i<n_member_in_group_.size(); i++) n_member_in_group_[i] = 0;
 #endif
 
-#pragma omp parallel for 
+        PS::S32 n_group_member_remote_isolated=0;
+#pragma omp parallel for reduction(+:n_group_member_remote_isolated)
         for (PS::S32 i=0; i<num_thread; i++) {
             for (PS::S32 k=0; k<n_member_in_group_thread[i].size(); k++) {
                 PS::S32 i_cluster = n_member_in_group_thread[i][k].cluster_index;
@@ -2839,12 +3573,13 @@ public:
                         }
                         else {
                             // this is remoted member;
-                            n_group_member_remote_++;
+                            n_group_member_remote_isolated++;
                         }
                     }
                 }
             }
         }
+        n_group_member_remote_ += n_group_member_remote_isolated;
 
 
 #ifdef ARTIFICIAL_PARTICLE_DEBUG
@@ -2863,7 +3598,8 @@ public:
         _sys.setNumberOfParticleLocal(sys_ptcl_artificial_thread_offset[num_thread]);
         
         const PS::S32 n_artificial_per_group = ap_manager.getArtificialParticleN();
-#pragma omp parallel for        
+        PS::S32 n_group_member_remote_artificial=0;
+#pragma omp parallel for reduction(+:n_group_member_remote_artificial)
         for(PS::S32 i=0; i<num_thread; i++) {
             // ptcl_artificial should be integer times of n_partificial_per_group 
             assert(ptcl_artificial_thread[i].size()%n_artificial_per_group==0);
@@ -2879,6 +3615,12 @@ public:
                 auto* pj = &ptcl_artificial_thread[i][j];
                 auto* pcm = ap_manager.getCMParticles(pj);
                 PS::S32 n_members = ap_manager.getMemberN(pj);
+#ifdef ORBIT_QUADRUPOLE
+#ifdef ARTIFICIAL_PARTICLE_DEBUG
+                assert(orbit_quad_thread_[i].size()*n_artificial_per_group==ptcl_artificial_thread[i].size());
+#endif
+                _sys[pcm->adr_org].quad = orbit_quad_thread_[i][j/n_artificial_per_group];
+#endif
                 PS::S32 i_cluster = ap_manager.getStoredData(pj,0,true)-1; 
                 PS::S32 j_group = ap_manager.getStoredData(pj,1,true)-1;
 #ifdef ARTIFICIAL_PARTICLE_DEBUG
@@ -2918,7 +3660,7 @@ public:
                     }
                     else {
                         // this is remoted member;
-                        n_group_member_remote_++;
+                        n_group_member_remote_artificial++;
                     }
 
                 }
@@ -2939,6 +3681,7 @@ public:
                 adr_first_ptcl_arti_in_cluster_[n_group_in_cluster_offset_[i_cluster]+j_group] = ptcl_artificial_thread[i][j].adr_org;
             }
         }
+        n_group_member_remote_ += n_group_member_remote_artificial;
         
         // merge i_cluster_changeover
         i_cluster_changeover_update_.resizeNoInitialize(0);
@@ -2946,6 +3689,8 @@ public:
             for (PS::S32 j=0; j<i_cluster_changeover_update_threads[i].size();j++) 
                 i_cluster_changeover_update_.push_back(i_cluster_changeover_update_threads[i][j]);
         }
+        if (reproducible_mode) 
+            std::sort(i_cluster_changeover_update_.getPointer(), i_cluster_changeover_update_.getPointer()+i_cluster_changeover_update_.size());
 #ifdef ARTIFICIAL_PARTICLE_DEBUG
         if (i_cluster_changeover_update_.size()>0) 
             std::cerr<<"Changeover change cluster found: T="<<time_origin_<<" n_cluster_change="<<i_cluster_changeover_update_.size()<<std::endl;
@@ -80,6 +80,15 @@ public:
         fwrite(&n_group, sizeof(PS::S32), 1, fp);
         fwrite(n_member_in_group.getPointer(), sizeof(PS::S32), n_group, fp);
         for (int i=0; i<n_arti; i++) ptcl_arti_bk[i].writeBinary(fp);
+#ifdef TIDAL_TENSOR_TREE
+        // acceleration gradient for tidal tensor
+        for (int i=0; i<n_arti; i++) {
+            fwrite(ptcl_arti_bk[i].acc_grad, sizeof(PS::F64), 6, fp);
+#ifdef TIDAL_TENSOR_3RD
+            fwrite(ptcl_arti_bk[i].acc_grad2, sizeof(PS::F64), 10, fp);
+#endif
+        }
+#endif
         fclose(fp);
     }
 
@@ -149,6 +158,21 @@ public:
         if (n_arti>0) {
             ptcl_arti_bk.resizeNoInitialize(n_arti);
             for (int i=0; i<n_arti; i++) ptcl_arti_bk[i].readBinary(fp);
+#ifdef TIDAL_TENSOR_TREE
+            for (int i=0; i<n_arti; i++) {
+                rcount = fread(ptcl_arti_bk[i].acc_grad, sizeof(PS::F64), 6, fp);
+#ifdef TIDAL_TENSOR_3RD
+                rcount += fread(ptcl_arti_bk[i].acc_grad2, sizeof(PS::F64), 10, fp);
+                const size_t n_grad = 16;
+#else
+                const size_t n_grad = 6;
+#endif
+                if (rcount<n_grad) {
+                    std::cerr<<"Error: Data reading fails! requiring data number is "<<n_grad<<", only obtain "<<rcount<<".\n";
+                    abort();
+                }
+            }
+#endif
         }
         fclose(fp);
     }
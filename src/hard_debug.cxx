@@ -28,6 +28,7 @@ int main(int argc, char **argv){
   PS::S32 step_arc_limit = 100000;
   std::string filename="hard_dump";
   std::string fhardpar="input.par.hard";
+  bool pair_cutoff_flag=true;
 #ifdef BSE
   int idum=0;
   std::string fbsepar = "input.par.bse";
@@ -44,7 +45,7 @@ int main(int argc, char **argv){
   bool soft_pert_flag=true;
 #endif
 
-  while ((arg_label = getopt(argc, argv, "k:E:A:a:D:d:e:s:c:m:b:B:p:I:v:i:Sh")) != -1)
+  while ((arg_label = getopt(argc, argv, "k:E:A:a:D:d:e:s:c:m:b:B:p:I:v:i:SCh")) != -1)
     switch (arg_label) {
     case 'k':
         slowdown_factor = atof(optarg);
@@ -81,6 +82,9 @@ int main(int argc, char **argv){
     case 'p':
         fhardpar = optarg;
         break;
+    case 'C':
+        pair_cutoff_flag=false;
+        break;
 #ifdef SOFT_PERT
     case 'S':
         soft_pert_flag=false;
@@ -121,6 +125,7 @@ int main(int argc, char **argv){
                  <<"    -d [int]:     hard time step min power (should use together with -D)\n"
                  <<"    -m [int]:     running mode: 0: evolve system to time_end; 1: stability check: "<<mode<<std::endl
                  <<"    -p [string]:  hard parameter file name: "<<fhardpar<<std::endl
+                 <<"    -C:           Calculate the changeover functions of all Hermite pairs (no skip beyond the changeover radius)\n"
 #ifdef STELLAR_EVOLUTION
                  <<"    -I [int]:     Stellar evolution option: \n"
 #endif
@@ -252,6 +257,11 @@ int main(int argc, char **argv){
       hard_manager.ar_manager.energy_error_relative_max = e_err_ar;
   }
 
+  if(!pair_cutoff_flag) {
+      std::cerr<<"Hermite pair cutoff beyond the changeover radius: off"<<std::endl;
+      hard_manager.h4_manager.interaction.pair_cutoff_flag = false;
+  }
+
   hard_manager.checkParams();
   hard_manager.print(std::cerr);
 
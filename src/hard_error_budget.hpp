@@ -0,0 +1,171 @@
+#pragma once
+#include<vector>
+#include<unordered_map>
+#include<algorithm>
+#include<cmath>
+
+//! accuracy factor of one cluster carried to the next tree step
+struct ErrorBudgetRecord{
+    PS::U64 key;      ///> hash of the sorted member ids (same as HardWarmStart::calcKey)
+    PS::S32 n_ptcl;   ///> number of particles in the cluster
+    PS::F64 factor;   ///> tolerance factor for the next drift
+};
+
+//! energy error of one cluster measured in the current drift
+struct ErrorBudgetSample{
+    PS::U64 key;      ///> hash of the sorted member ids
+    PS::S32 n_ptcl;   ///> number of particles in the cluster
+    PS::F64 factor;   ///> tolerance factor used in the current drift
+    PS::F64 de_abs;   ///> |dE_SD| of the current drift
+    PS::F64 etot_abs; ///> |E_SD| of the cluster at the end of the drift
+};
+
+//! statistics of the error-budget controller
+struct ErrorBudgetStat{
+    PS::S64 n_cluster;  ///> number of clusters checked with the budget
+    PS::S64 n_tight;    ///> number of clusters with factor < 1 for the next drift
+    PS::S64 n_relax;    ///> number of clusters with factor > 1 for the next drift
+    PS::F64 de_sum;     ///> sum of |dE_SD| of checked clusters
+    PS::F64 budget_sum; ///> sum of budgets of checked clusters
+    PS::F64 factor_min; ///> minimum factor
+    PS::F64 factor_max; ///> maximum factor
+
+    ErrorBudgetStat() {clear();}
+
+    void clear() {
+        n_cluster = n_tight = n_relax = 0;
+        de_sum = budget_sum = 0.0;
+        factor_min = NUMERIC_FLOAT_MAX;
+        factor_max = 0.0;
+    }
+
+    ErrorBudgetStat& operator +=(const ErrorBudgetStat& _stat) {
+        n_cluster  += _stat.n_cluster;
+        n_tight    += _stat.n_tight;
+        n_relax    += _stat.n_relax;
+        de_sum     += _stat.de_sum;
+        budget_sum += _stat.budget_sum;
+        factor_min = std::min(factor_min, _stat.factor_min);
+        factor_max = std::max(factor_max, _stat.factor_max);
+        return *this;
+    }
+};
+
+//! per-cluster error-budget controller of the hard integration
+/*! The energy error allowed for the whole system per tree step, energy_error_budget * |E_sys|, is distributed to clusters
+    proportional to their binding energies: budget_c = energy_error_budget * |E_sys| * |E_SD,c| / sum_c |E_SD,c|,
+    where the sum is over all clusters checked in the tree step on all MPI processes, thus the budgets of all clusters sum to the system budget.
+    The tolerance factor f of a cluster scales its accuracy parameters relative to the global ones:
+    the Hermite eta (eta_4th, eta_2nd) by f^(1/2) and the AR step sizes of groups by f^(1/6),
+    assuming the energy errors of the 4th-order Hermite (dt^2 ∝ eta) and the 6th-order symplectic AR integrators scale as f.
+    The energy errors of clusters are saved during the drift (saveCluster). At the end of the tree step, after the global sum of |E_SD,c| is known,
+    f is changed by the square root of budget_c/|dE_SD,c| (at most by a factor of 2) within [1/factor_range, factor_range] (finalize)
+    and carried to the next drift if the cluster has the same members.
+    The global energy_error_relative_max of AR and step_count_max are not changed.
+ */
+class HardErrorBudget{
+public:
+    PS::F64 energy_error_budget; ///> relative energy error of the system allowed per tree step, <=0: off
+    PS::F64 factor_range;        ///> the tolerance factor is limited to [1/factor_range, factor_range]
+    std::vector<std::vector<ErrorBudgetSample>> buffer_thread; ///> energy errors saved in the current drift by each thread
+    std::vector<ErrorBudgetSample> sample;                     ///> energy errors of the tree step sorted by the key, collected by getEnergySum
+    std::vector<ErrorBudgetRecord> record;                     ///> factors for the next drift computed by finalize
+    std::unordered_map<PS::U64, ErrorBudgetRecord> table;      ///> factors of the previous drift
+    ErrorBudgetStat stat; ///> statistics accumulated since the last clear
+
+    HardErrorBudget(): energy_error_budget(0.0), factor_range(10.0), buffer_thread(), sample(), record(), table(), stat() {}
+
+    bool isActive() const {
+        return energy_error_budget>0.0;
+    }
+
+    //! make the factors computed in the last finalize readable and clear the buffers for saving
+    /*! Should be called before the parallel integration of clusters
+      @param[in] _n_thread: number of threads
+     */
+    void update(const PS::S32 _n_thread) {
+        if ((PS::S32)buffer_thread.size()<_n_thread) buffer_thread.resize(_n_thread);
+        table.clear();
+        for (auto& rec : record) table[rec.key] = rec;
+        record.clear();
+    }
+
+    //! remove all saved factors and statistics
+    void clear() {
+        for (auto& buf : buffer_thread) buf.clear();
+        sample.clear();
+        record.clear();
+        table.clear();
+        stat.clear();
+    }
+
+    //! get the tolerance factor of one cluster
+    /*! @param[in] _key: cluster key
+        @param[in] _n_ptcl: number of particles in the cluster
+        \return the carried factor, 1 if the cluster is new
+     */
+    PS::F64 getFactor(const PS::U64 _key, const PS::S32 _n_ptcl) const {
+        auto it = table.find(_key);
+        if (it==table.end() || it->second.n_ptcl!=_n_ptcl) return 1.0;
+        return it->second.factor;
+    }
+
+    //! save the measured energy error of one cluster
+    /*! @param[in] _ith: thread index
+        @param[in] _key: cluster key
+        @param[in] _n_ptcl: number of particles in the cluster
+        @param[in] _factor: factor used in the current drift
+        @param[in] _de: energy error (slowdown) of the current drift
+        @param[in] _etot: total energy (slowdown) of the cluster
+     */
+    void saveCluster(const PS::S32 _ith, const PS::U64 _key, const PS::S32 _n_ptcl, const PS::F64 _factor, const PS::F64 _de, const PS::F64 _etot) {
+        buffer_thread[_ith].push_back(ErrorBudgetSample{_key, _n_ptcl, _factor, std::abs(_de), std::abs(_etot)});
+    }
+
+    //! collect the energy errors saved by all threads and return the local sum of |E_SD| of clusters
+    /*! The samples are sorted by the key so that the sum does not depend on the thread number
+        \return sum of |E_SD| of clusters saved since the last finalize
+     */
+    PS::F64 getEnergySum() {
+        for (auto& buf : buffer_thread) {
+            sample.insert(sample.end(), buf.begin(), buf.end());
+            buf.clear();
+        }
+        std::sort(sample.begin(), sample.end(), [](const ErrorBudgetSample& a, const ErrorBudgetSample& b) { return a.key<b.key; });
+        PS::F64 etot_sum = 0.0;
+        for (auto& smp : sample) etot_sum += smp.etot_abs;
+        return etot_sum;
+    }
+
+    //! calculate the factors for the next drift from the energy errors collected by getEnergySum
+    /*! @param[in] _energy_sys: total energy of the system
+        @param[in] _etot_sum_glb: global sum of |E_SD| of all clusters (of all hard systems)
+     */
+    void finalize(const PS::F64 _energy_sys, const PS::F64 _etot_sum_glb) {
+        const PS::F64 budget_sys = energy_error_budget*std::abs(_energy_sys);
+        for (auto& smp : sample) {
+            const PS::F64 budget = _etot_sum_glb>0.0 ? budget_sys*smp.etot_abs/_etot_sum_glb : 0.0;
+            PS::F64 scale = 2.0;
+            if (smp.de_abs>0.0) scale = std::max(0.5, std::min(2.0, std::sqrt(budget/smp.de_abs)));
+            const PS::F64 factor = std::max(1.0/factor_range, std::min(factor_range, smp.factor*scale));
+            record.push_back(ErrorBudgetRecord{smp.key, smp.n_ptcl, factor});
+
+            stat.n_cluster++;
+            if (factor<1.0) stat.n_tight++;
+            else if (factor>1.0) stat.n_relax++;
+            stat.de_sum += smp.de_abs;
+            stat.budget_sum += budget;
+            stat.factor_min = std::min(stat.factor_min, factor);
+            stat.factor_max = std::max(stat.factor_max, factor);
+        }
+        sample.clear();
+    }
+
+    //! get memory size used
+    size_t getMemSizeUsed() const {
+        size_t size = table.size()*(sizeof(PS::U64)+sizeof(ErrorBudgetRecord));
+        size += record.capacity()*sizeof(ErrorBudgetRecord) + sample.capacity()*sizeof(ErrorBudgetSample);
+        for (auto& buf : buffer_thread) size += buf.capacity()*sizeof(ErrorBudgetSample);
+        return size;
+    }
+};
@@ -0,0 +1,190 @@
+#pragma once
+#include<vector>
+#include<unordered_map>
+#include<algorithm>
+#include<cmath>
+
+//! integration step state of one single particle or one group c.m. carried to the next tree step
+struct WarmStartStep{
+    PS::S64 id;       ///> particle id (group: minimum member id)
+    PS::S32 n_member; ///> number of members, 0 for single
+    PS::F64 dt;       ///> Hermite block step at the end of the previous drift, 0 if not used (AR only)
+    PS::F64 t_acc;    ///> acceleration timescale |acc0|/|acc1| at the end of the previous drift
+    PS::F64 ds;       ///> AR step size (groups)
+    PS::F64 sd;       ///> slowdown factor of the root binary (groups)
+    PS::F64 semi;     ///> semi-major axis of the root binary (groups)
+    PS::F64 ecc;      ///> eccentricity of the root binary (groups)
+
+    bool operator < (const WarmStartStep& _step) const {
+        return id < _step.id;
+    }
+};
+
+//! Hermite and AR step states of hard clusters carried from the previous tree step
+/*! Clusters are identified by a hash of the sorted member ids.
+    The states are saved by each thread when a cluster finishes the drift (buffer_thread)
+    and become readable for the next drift after update().
+ */
+class HardWarmStart{
+public:
+    //! index of one saved cluster in the buffers
+    struct ClusterIndex{
+        PS::S32 i_thread; ///> thread index of the buffer
+        PS::S32 offset;   ///> offset of the first step in the buffer
+        PS::S32 n;        ///> number of steps
+        PS::S32 n_ptcl;   ///> number of particles in the cluster
+    };
+
+    //! one saved cluster in the key buffers
+    struct ClusterKey{
+        PS::U64 key;          ///> hash of the sorted member ids
+        ClusterIndex index;   ///> index in the buffer of the same thread
+    };
+
+    bool flag; ///> if true, save the step states and reuse them in the next drift
+    std::vector<std::vector<WarmStartStep>> buffer_thread;      ///> steps saved in the current drift by each thread
+    std::vector<std::vector<ClusterKey>> key_thread;           ///> clusters saved in the current drift by each thread
+    std::vector<std::vector<WarmStartStep>> buffer_thread_prev; ///> steps saved in the previous drift
+    std::unordered_map<PS::U64, ClusterIndex> table;            ///> cluster table of the previous drift
+
+    HardWarmStart(): flag(false), buffer_thread(), key_thread(), buffer_thread_prev(), table() {}
+
+    //! calculate the cluster key from member ids
+    /*! FNV-1a hash of sorted ids
+      @param[in,out] _id: member id array, sorted in return
+      @param[in] _n: number of members
+     */
+    static PS::U64 calcKey(PS::S64* _id, const PS::S32 _n) {
+        std::sort(_id, _id+_n);
+        PS::U64 key = 14695981039346656037ULL;
+        for (PS::S32 i=0; i<_n; i++) {
+            PS::U64 idi = (PS::U64)_id[i];
+            for (int k=0; k<8; k++) {
+                key ^= (idi & 0xff);
+                key *= 1099511628211ULL;
+                idi >>= 8;
+            }
+        }
+        return key;
+    }
+
+    //! make the steps saved in the last drift readable and clear the buffers for saving
+    /*! Should be called before the parallel integration of clusters
+      @param[in] _n_thread: number of threads
+     */
+    void update(const PS::S32 _n_thread) {
+        if ((PS::S32)buffer_thread.size()<_n_thread) {
+            buffer_thread.resize(_n_thread);
+            key_thread.resize(_n_thread);
+        }
+        std::swap(buffer_thread, buffer_thread_prev);
+        if (buffer_thread.size()<buffer_thread_prev.size()) buffer_thread.resize(buffer_thread_prev.size());
+        table.clear();
+        for (auto& keys : key_thread) {
+            for (auto& ckey : keys) table.insert(std::make_pair(ckey.key, ckey.index));
+            keys.clear();
+        }
+        for (auto& buf : buffer_thread) buf.clear();
+    }
+
+    //! remove all saved steps
+    void clear() {
+        for (auto& buf : buffer_thread) buf.clear();
+        for (auto& buf : buffer_thread_prev) buf.clear();
+        for (auto& keys : key_thread) keys.clear();
+        table.clear();
+    }
+
+    //! find the saved steps of one cluster
+    /*! @param[in] _key: cluster key
+        @param[in] _n_ptcl: number of particles in the cluster
+        @param[out] _n: number of saved steps
+        \return pointer to the first step sorted by id, NULL if not found
+     */
+    const WarmStartStep* find(const PS::U64 _key, const PS::S32 _n_ptcl, PS::S32& _n) const {
+        _n = 0;
+        auto it = table.find(_key);
+        if (it==table.end()) return NULL;
+        auto& index = it->second;
+        if (index.n_ptcl!=_n_ptcl) return NULL;
+        _n = index.n;
+        return buffer_thread_prev[index.i_thread].data() + index.offset;
+    }
+
+    //! find one step from the saved steps of one cluster
+    /*! @param[in] _steps: saved steps sorted by id
+        @param[in] _n: number of saved steps
+        @param[in] _id: particle or group id
+        @param[in] _n_member: number of members, 0 for single
+        \return pointer to the step, NULL if not found
+     */
+    static const WarmStartStep* findStep(const WarmStartStep* _steps, const PS::S32 _n, const PS::S64 _id, const PS::S32 _n_member) {
+        WarmStartStep step_id;
+        step_id.id = _id;
+        auto* p = std::lower_bound(_steps, _steps+_n, step_id);
+        if (p==_steps+_n || p->id!=_id || p->n_member!=_n_member) return NULL;
+        return p;
+    }
+
+    //! save the steps of one cluster to the buffer of the current thread
+    /*! @param[in] _ith: thread index
+        @param[in] _key: cluster key
+        @param[in] _n_ptcl: number of particles in the cluster
+        @param[in] _offset: offset of the first step of the cluster in the buffer, the steps are sorted by id
+     */
+    void saveCluster(const PS::S32 _ith, const PS::U64 _key, const PS::S32 _n_ptcl, const PS::S32 _offset) {
+        auto& buf = buffer_thread[_ith];
+        std::sort(buf.begin()+_offset, buf.end());
+        key_thread[_ith].push_back(ClusterKey{_key, ClusterIndex{_ith, _offset, (PS::S32)buf.size()-_offset, _n_ptcl}});
+    }
+
+    //! acceleration timescale |acc0|/|acc1| of a Hermite particle
+    template <class Tptcl>
+    static PS::F64 calcAccTimescale(const Tptcl& _p) {
+        const PS::F64 a2 = _p.acc0[0]*_p.acc0[0] + _p.acc0[1]*_p.acc0[1] + _p.acc0[2]*_p.acc0[2];
+        const PS::F64 j2 = _p.acc1[0]*_p.acc1[0] + _p.acc1[1]*_p.acc1[1] + _p.acc1[2]*_p.acc1[2];
+        if (j2==0.0) return NUMERIC_FLOAT_MAX;
+        return std::sqrt(a2/j2);
+    }
+
+    //! get the Hermite block step from the carried step validated by the new acceleration
+    /*! The carried step is halved until it is scaled by the ratio of the new and old acceleration timescales,
+        then it is used only if it is larger than the initial estimation
+      @param[in] _p: Hermite particle after initialization
+      @param[in] _step: carried step
+      \return new step, _p.dt if the carried step is not used
+     */
+    template <class Tptcl>
+    static PS::F64 calcWarmStartDt(const Tptcl& _p, const WarmStartStep& _step) {
+        if (_step.dt<=_p.dt) return _p.dt;
+        const PS::F64 t_acc = calcAccTimescale(_p);
+        PS::F64 dt_limit = _step.dt;
+        if (t_acc<_step.t_acc) dt_limit *= t_acc/_step.t_acc;
+        PS::F64 dt = _step.dt;
+        while (dt>dt_limit && dt>_p.dt) dt *= 0.5;
+        return std::max(dt, _p.dt);
+    }
+
+    //! check whether the carried AR step size is consistent with the new binary tree
+    /*! The orbit of the root binary and the slowdown factor should not change significantly after the kick
+      @param[in] _bin: root binary after initialization
+      @param[in] _step: carried step
+     */
+    template <class Tbin>
+    static bool isARStepValid(const Tbin& _bin, const WarmStartStep& _step) {
+        if (_step.ds<=0.0 || _bin.semi<=0.0 || _step.semi<=0.0) return false;
+        if (std::abs(_bin.semi/_step.semi-1.0)>0.01) return false;
+        if (std::abs(_bin.ecc-_step.ecc)>0.01) return false;
+        const PS::F64 sd_ratio = _bin.slowdown.getSlowDownFactor()/_step.sd;
+        return (sd_ratio>0.5 && sd_ratio<2.0);
+    }
+
+    //! get memory size used
+    size_t getMemSizeUsed() const {
+        size_t size = table.size()*(sizeof(PS::U64)+sizeof(ClusterIndex));
+        for (auto& buf : buffer_thread) size += buf.capacity()*sizeof(WarmStartStep);
+        for (auto& buf : buffer_thread_prev) size += buf.capacity()*sizeof(WarmStartStep);
+        for (auto& keys : key_thread) size += keys.capacity()*sizeof(ClusterKey);
+        return size;
+    }
+};
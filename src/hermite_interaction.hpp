@@ -8,9 +8,10 @@ class HermiteInteraction{
 public:
     Float eps_sq; // softening parameter
     Float gravitational_constant;      // gravitational constant
+    bool pair_cutoff_flag; // skip the changeover functions of pairs beyond the changeover region (not saved in the binary file)
 
     // constructor
-    HermiteInteraction(): eps_sq(Float(-1.0)), gravitational_constant(Float(-1.0)) {}
+    HermiteInteraction(): eps_sq(Float(-1.0)), gravitational_constant(Float(-1.0)), pair_cutoff_flag(true) {}
 
     //! check whether parameters values are correct
     /*! \return true: all correct
@@ -24,7 +25,8 @@ public:
     //! print parameters
     void print(std::ostream & _fout) const{
         _fout<<"eps_sq: "<<eps_sq<<std::endl
-             <<"G     : "<<gravitational_constant<<std::endl;
+             <<"G     : "<<gravitational_constant<<std::endl
+             <<"pair_cutoff_flag: "<<pair_cutoff_flag<<std::endl;
     }    
 
     //! calculate separation square between i and j particles
@@ -43,6 +45,17 @@ public:
         return dr2;
     }
 
+    //! check whether the pair separation is beyond the changeover region
+    /*! Beyond r_out the hard acceleration and jerk vanish (changeover W=0) and only a constant potential offset remains,
+        thus r^-1 and the changeover functions are not needed. In a large cluster most pairs are in this region.
+        The check is switched off by pair_cutoff_flag=false for comparison.
+      @param[in]: _dr2_eps: softened separation square
+      @param[in]: _r_out: maximum changeover outer radius of the pair
+     */
+    inline bool isOutsideChangeOver(const Float _dr2_eps, const Float _r_out) const {
+        return pair_cutoff_flag && _dr2_eps >= _r_out*_r_out;
+    }
+
     //! calculate acceleration and jerk of one pair
     /*!
       @param[out]: _fi: acceleration for i particle
@@ -59,6 +72,10 @@ public:
                              _pj.pos[2]-_pi.pos[2]};
         Float dr2 = dr[0]*dr[0] + dr[1]*dr[1] + dr[2]*dr[2];
         Float dr2_eps = dr2 + eps_sq;
+        if (isOutsideChangeOver(dr2_eps, std::max(_pi.changeover.getRout(), _pj.changeover.getRout()))) {
+            _fi.pot += - gravitational_constant*_pj.mass*ChangeOver::getPotOffTwo(_pi.changeover, _pj.changeover);
+            return dr2;
+        }
         const Float dv[3] = {_pj.vel[0] - _pi.vel[0],
                              _pj.vel[1] - _pi.vel[1],
                              _pj.vel[2] - _pi.vel[2]};
@@ -116,6 +133,11 @@ public:
                                  pj.pos[2]-_pi.pos[2]};
             Float dr2 = dr[0]*dr[0] + dr[1]*dr[1] + dr[2]*dr[2];
             Float dr2_eps = dr2 + eps_sq;
+            if (isOutsideChangeOver(dr2_eps, std::max(_pi.changeover.getRout(), pj.changeover.getRout()))) {
+                _fi.pot += - gravitational_constant*pj.mass*ChangeOver::getPotOffTwo(_pi.changeover, pj.changeover);
+                r2_min = std::min(r2_min, dr2);
+                continue;
+            }
             const Float dv[3] = {pj.vel[0] - _pi.vel[0],
                                  pj.vel[1] - _pi.vel[1],
                                  pj.vel[2] - _pi.vel[2]};
@@ -171,6 +193,15 @@ public:
                              _pj.pos[2]-_pi.pos[2]};
         Float dr2 = dr[0]*dr[0] + dr[1]*dr[1] + dr[2]*dr[2];
         Float dr2_eps = dr2 + eps_sq;
+        auto* ptcl_mem = _gj.particles.getDataAddress();
+        Float r_out_max = std::max(_pi.changeover.getRout(), _gj.perturber.r_out_max);
+        if (isOutsideChangeOver(dr2_eps, r_out_max)) {
+            Float mpot_off = 0.0;
+            for (int i=0; i<_gj.particles.getSize(); i++) 
+                mpot_off += ptcl_mem[i].mass * ChangeOver::getPotOffTwo(_pi.changeover, ptcl_mem[i].changeover);
+            _fi.pot += - gravitational_constant*mpot_off;
+            return dr2;
+        }
         const Float dv[3] = {_pj.vel[0] - _pi.vel[0],
                              _pj.vel[1] - _pi.vel[1],
                              _pj.vel[2] - _pi.vel[2]};
@@ -183,7 +214,6 @@ public:
         Float mkp = 0.0;
         Float mk = 0.0;
         Float mkdot = 0.0;
-        auto* ptcl_mem = _gj.particles.getDataAddress();
         ASSERT(_gj.particles.cm.mass==_pj.mass);
         for (int i=0; i<_gj.particles.getSize(); i++) {
             mkp   += ptcl_mem[i].mass * ChangeOver::calcPotWTwo(_pi.changeover, ptcl_mem[i].changeover, r);
@@ -230,6 +260,15 @@ public:
                              _pj.pos[2]-_pi.pos[2]};
         Float dr2 = dr[0]*dr[0] + dr[1]*dr[1] + dr[2]*dr[2];
         Float dr2_eps = dr2 + eps_sq;
+        auto* ptcl_mem = _gi.particles.getDataAddress();
+        Float r_out_max = std::max(std::max(_pi.changeover.getRout(), _pj.changeover.getRout()), _gi.perturber.r_out_max);
+        if (isOutsideChangeOver(dr2_eps, r_out_max)) {
+            Float kpot_off = 0.0;
+            for (int i=0; i<_gi.particles.getSize(); i++) 
+                kpot_off += ptcl_mem[i].mass * ChangeOver::getPotOffTwo(_pi.changeover, ptcl_mem[i].changeover);
+            _fi.pot += - gravitational_constant*_pj.mass*kpot_off/_pi.mass;
+            return dr2;
+        }
         const Float dv[3] = {_pj.vel[0] - _pi.vel[0],
                              _pj.vel[1] - _pi.vel[1],
                              _pj.vel[2] - _pi.vel[2]};
@@ -242,7 +281,6 @@ public:
         Float kp = 0.0;
         Float k = 0.0;
         Float kdot = 0.0;
-        auto* ptcl_mem = _gi.particles.getDataAddress();
         ASSERT(_gi.particles.cm.mass==_pi.mass);
         for (int i=0; i<_gi.particles.getSize(); i++) {
             kp   += ptcl_mem[i].mass * ChangeOver::calcPotWTwo(_pi.changeover, ptcl_mem[i].changeover, r);
@@ -294,6 +332,13 @@ public:
         auto* member_adr = _gj.particles.getOriginAddressArray();
         Float r2_min = NUMERIC_FLOAT_MAX;
         ASSERT(_gi.particles.cm.mass==_pi.mass);
+        // changeover radius and potential offset from the members of group i
+        auto* ptcl_mem_i = _gi.particles.getDataAddress();
+        const Float r_out_gi = std::max(_pi.changeover.getRout(), _gi.perturber.r_out_max);
+        Float kpot_off = 0.0;
+        for (int k=0; k<_gi.particles.getSize(); k++) 
+            kpot_off += ptcl_mem_i[k].mass * ChangeOver::getPotOffTwo(_pi.changeover, ptcl_mem_i[k].changeover);
+        kpot_off /= _pi.mass;
         for (int i=0; i<n_member; i++) {
             const auto& pj = *member_adr[i];
             ASSERT(_pi.id!=pj.id);
@@ -302,6 +347,11 @@ public:
                                  pj.pos[2]-_pi.pos[2]};
             Float dr2 = dr[0]*dr[0] + dr[1]*dr[1] + dr[2]*dr[2];
             Float dr2_eps = dr2 + eps_sq;
+            if (isOutsideChangeOver(dr2_eps, std::max(r_out_gi, pj.changeover.getRout()))) {
+                _fi.pot += - gravitational_constant*pj.mass*kpot_off;
+                r2_min = std::min(r2_min, dr2);
+                continue;
+            }
             const Float dv[3] = {pj.vel[0] - _pi.vel[0],
                                  pj.vel[1] - _pi.vel[1],
                                  pj.vel[2] - _pi.vel[2]};
@@ -369,6 +419,20 @@ public:
                              _pj.pos[2]-_pi.pos[2]};
         Float dr2 = dr[0]*dr[0] + dr[1]*dr[1] + dr[2]*dr[2];
         Float dr2_eps = dr2 + eps_sq;
+        auto* ptcl_mem_i = _gi.particles.getDataAddress();
+        auto* ptcl_mem_j = _gj.particles.getDataAddress();
+        Float r_out_max = std::max(_gi.perturber.r_out_max, _gj.perturber.r_out_max);
+        if (isOutsideChangeOver(dr2_eps, r_out_max)) {
+            Float mpot_off = 0.0;
+            for (int i=0; i<_gi.particles.getSize(); i++) {
+                Float mpot_offj = 0.0;
+                for (int j=0; j<_gj.particles.getSize(); j++) 
+                    mpot_offj += ptcl_mem_j[j].mass * ChangeOver::getPotOffTwo(ptcl_mem_i[i].changeover, ptcl_mem_j[j].changeover);
+                mpot_off += ptcl_mem_i[i].mass * mpot_offj;
+            }
+            _fi.pot += - gravitational_constant*mpot_off/_pi.mass;
+            return dr2;
+        }
         const Float dv[3] = {_pj.vel[0] - _pi.vel[0],
                              _pj.vel[1] - _pi.vel[1],
                              _pj.vel[2] - _pi.vel[2]};
@@ -382,8 +446,6 @@ public:
         Float mk = 0.0;
         Float mkdot = 0.0;
         Float mkp = 0.0;
-        auto* ptcl_mem_i = _gi.particles.getDataAddress();
-        auto* ptcl_mem_j = _gj.particles.getDataAddress();
         for (int i=0; i<_gi.particles.getSize(); i++) {
             Float mkj = 0.0;
             Float mkpj = 0.0;
@@ -520,16 +582,18 @@ public:
     /*! @param[in] _fp: FILE type file for output
      */
     void writeBinary(FILE *_fp) const {
-        fwrite(this, sizeof(*this),1,_fp);
+        fwrite(&eps_sq, sizeof(Float),1,_fp);
+        fwrite(&gravitational_constant, sizeof(Float),1,_fp);
     }
 
     //! read class data to file with binary format
     /*! @param[in] _fp: FILE type file for reading
      */
     void readBinary(FILE *_fin) {
-        size_t rcount = fread(this, sizeof(*this), 1, _fin);
-        if (rcount<1) {
-            std::cerr<<"Error: Data reading fails! requiring data number is 1, only obtain "<<rcount<<".\n";
+        size_t rcount = fread(&eps_sq, sizeof(Float), 1, _fin);
+        rcount += fread(&gravitational_constant, sizeof(Float), 1, _fin);
+        if (rcount<2) {
+            std::cerr<<"Error: Data reading fails! requiring data number is 2, only obtain "<<rcount<<".\n";
             abort();
         }
     }    
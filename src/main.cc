@@ -18,6 +18,19 @@ int main(int argc, char *argv[]){
 
     auto& inp = petar.input_parameters;
 
+    // ensemble mode (sequential batch driver): run simulations in the list one after another, each uses all threads and MPI processes;
+    // FDPS and allocated memory are reused. Concurrent instances are not possible because of the process-wide statics and the collectives on MPI_COMM_WORLD
+    if (inp.fname_ensemble.value!="__NONE__") {
+        petar.readEnsembleList();
+        for (std::size_t i=0; i<petar.ensemble_list.size(); i++) {
+            petar.initialEnsembleMember(i);
+            int n_interupt = 1;
+            while(n_interupt>0) n_interupt = petar.integrateToTime();
+        }
+        petar.printMemoryReport();
+        return 0;
+    }
+
     if (inp.fname_inp.value=="__Plummer") petar.generatePlummer();
     //else if (inp.fname_inp.value!="__KeplerDisk") petar.generateKeplerDisk();
     else petar.readDataFromFile();
@@ -56,6 +69,8 @@ int main(int argc, char *argv[]){
     ProfilerStop();
 #endif
 
+    petar.printMemoryReport();
+
     return 0;
 
 }
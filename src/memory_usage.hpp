@@ -0,0 +1,141 @@
+#pragma once
+#include<particle_simulator.hpp>
+#include<iomanip>
+#include<iostream>
+#include<string>
+#include<algorithm>
+
+struct MemCounter{
+    size_t current; // current allocated size in bytes
+    size_t peak;    // high-water mark in bytes
+    const char* name;
+
+    MemCounter(const char* _name): current(0), peak(0), name(_name) {}
+
+    void set(const size_t _size) {
+        current = _size;
+        peak = std::max(peak, _size);
+    }
+
+    void dump(std::ostream & fout, const PS::S32 width=20) const {
+        fout<<std::setw(width)<<current/1048576.0;
+    }
+
+    void dumpPeak(std::ostream & fout, const PS::S32 width=20) const {
+        fout<<std::setw(width)<<peak/1048576.0;
+    }
+
+    void dumpName(std::ostream & fout, const PS::S32 width=20) const {
+        std::string sname("Mem_");
+        sname += name;
+        fout<<std::setw(width)<<sname;
+    }
+
+    void dumpPeakName(std::ostream & fout, const PS::S32 width=20) const {
+        std::string sname("Peak_");
+        sname += name;
+        fout<<std::setw(width)<<sname;
+    }
+
+    void reset() {
+        current = 0;
+        peak = 0;
+    }
+};
+
+//! memory usage of subsystems (local), sizes are dumped in MB
+class SysMemory{
+public:
+    MemCounter system_soft;
+    MemCounter tree_soft;
+    MemCounter tree_nb;
+    MemCounter soft_direct;
+    MemCounter soft_kernel;
+    MemCounter search_cluster;
+    MemCounter system_hard;
+    MemCounter other;
+    MemCounter total;
+    const PS::S32 n_counter;
+
+    SysMemory(): system_soft   (MemCounter("sys_soft")),
+                 tree_soft     (MemCounter("tree_soft")),
+                 tree_nb       (MemCounter("tree_nb")),
+                 soft_direct   (MemCounter("soft_direct")),
+                 soft_kernel   (MemCounter("soft_kernel")),
+                 search_cluster(MemCounter("search_clu")),
+                 system_hard   (MemCounter("sys_hard")),
+                 other         (MemCounter("other")),
+                 total         (MemCounter("total")),
+                 n_counter(9) {}
+
+    //! set total from all subsystems, should be called after all subsystems are set
+    void setTotal() {
+        size_t size = 0;
+        for(PS::S32 i=0; i<n_counter-1; i++) {
+            MemCounter* iptr = (MemCounter*)this+i;
+            size += iptr->current;
+        }
+        total.set(size);
+    }
+
+    void dump(std::ostream & fout, const PS::S32 width=20) const {
+        for(PS::S32 i=0; i<n_counter; i++) {
+            MemCounter* iptr = (MemCounter*)this+i;
+            iptr->dump(fout, width);
+        }
+        for(PS::S32 i=0; i<n_counter; i++) {
+            MemCounter* iptr = (MemCounter*)this+i;
+            iptr->dumpPeak(fout, width);
+        }
+    }
+
+    void dumpName(std::ostream & fout, const PS::S32 width=20) const {
+        for(PS::S32 i=0; i<n_counter; i++) {
+            MemCounter* iptr = (MemCounter*)this+i;
+            iptr->dumpName(fout, width);
+        }
+        for(PS::S32 i=0; i<n_counter; i++) {
+            MemCounter* iptr = (MemCounter*)this+i;
+            iptr->dumpPeakName(fout, width);
+        }
+    }
+
+    //! print the breakdown table of current and peak sizes summed and maximized over all MPI ranks
+    /*! All ranks should call this function, only _print_flag=true prints
+     */
+    void printTable(std::ostream & fout, const bool _print_flag, const PS::S32 width=20) const {
+        if (_print_flag) {
+            fout<<"**** Memory usage [MB]:\n"
+                <<std::setw(width)<<"Subsystem"
+                <<std::setw(width)<<"Current(sum)"
+                <<std::setw(width)<<"Current(max)"
+                <<std::setw(width)<<"Peak(sum)"
+                <<std::setw(width)<<"Peak(max)"
+                <<std::endl;
+        }
+        for(PS::S32 i=0; i<n_counter; i++) {
+            MemCounter* iptr = (MemCounter*)this+i;
+            PS::F64 current = iptr->current/1048576.0;
+            PS::F64 peak = iptr->peak/1048576.0;
+            PS::F64 current_sum = PS::Comm::getSum(current);
+            PS::F64 current_max = PS::Comm::getMaxValue(current);
+            PS::F64 peak_sum = PS::Comm::getSum(peak);
+            PS::F64 peak_max = PS::Comm::getMaxValue(peak);
+            if (_print_flag) {
+                fout<<std::setw(width)<<iptr->name
+                    <<std::setw(width)<<current_sum
+                    <<std::setw(width)<<current_max
+                    <<std::setw(width)<<peak_sum
+                    <<std::setw(width)<<peak_max
+                    <<std::endl;
+            }
+        }
+    }
+
+    void clear() {
+        for(PS::S32 i=0; i<n_counter; i++) {
+            MemCounter* iptr = (MemCounter*)this+i;
+            iptr->reset();
+        }
+    }
+};
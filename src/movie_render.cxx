@@ -0,0 +1,1205 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <particle_simulator.hpp>
+#include <getopt.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "soft_ptcl.hpp"
+#include "io.hpp"
+
+//! particle data used for rendering
+struct RenderParticle{
+    PS::F64vec pos;
+    PS::F64vec vel;
+    PS::F64 mass;
+#ifdef BSE_BASE
+    PS::F64 lum;  ///> luminosity [Lsun]
+    PS::F64 temp; ///> effective temperature [K]
+    PS::S64 type; ///> SSE stellar type
+#endif
+};
+
+//! snapshot data read from one file
+struct RenderSnapshot{
+    PS::F64 time;
+    PS::F64vec pos_offset; ///> c.m. position offset in the header (RECORD_CM_IN_HEADER)
+    PS::F64vec vel_offset; ///> c.m. velocity offset in the header (RECORD_CM_IN_HEADER)
+    std::vector<RenderParticle> ptcl;
+
+    //! read snapshot with the FPSoft readers
+    /*! @param[in] _filename: snapshot filename
+        @param[in] _binary_flag: true: BINARY format; false: ASCII format
+     */
+    void read(const std::string& _filename, const bool _binary_flag) {
+        FILE* fin;
+        if( (fin = fopen(_filename.c_str(),"r")) == NULL) {
+            std::cerr<<"Error: Cannot open file "<<_filename<<"!\n";
+            abort();
+        }
+        FileHeader file_header;
+        if (_binary_flag) file_header.readBinary(fin);
+        else file_header.readAscii(fin);
+        time = file_header.time;
+#ifdef RECORD_CM_IN_HEADER
+        pos_offset = file_header.pos_offset;
+        vel_offset = file_header.vel_offset;
+#else
+        pos_offset = PS::F64vec(0.0);
+        vel_offset = PS::F64vec(0.0);
+#endif
+        ptcl.resize(file_header.n_body);
+        FPSoft p;
+        for (PS::S64 i=0; i<file_header.n_body; i++) {
+            if (_binary_flag) p.readBinary(fin);
+            else p.readAscii(fin);
+            auto& pi = ptcl[i];
+            pi.pos  = p.pos;
+            pi.vel  = p.vel;
+            pi.mass = p.mass;
+#ifdef BSE_BASE
+            pi.lum  = p.star.lum;
+            pi.temp = (p.star.r>0.0) ? 5778.0*std::pow(p.star.lum/(p.star.r*p.star.r), 0.25) : 0.0;
+            pi.type = p.star.kw;
+#endif
+        }
+        fclose(fin);
+    }
+};
+
+//! density center record in the core file generated by petar.data.process
+struct CoreRecord{
+    PS::F64 time;
+    PS::F64vec pos;
+    PS::F64vec vel;
+    PS::F64 rc;
+};
+
+//! read the core file (columns: time, pos[3], vel[3], rc)
+std::vector<CoreRecord> readCoreFile(const std::string& _filename) {
+    std::vector<CoreRecord> core;
+    std::ifstream fin(_filename);
+    if (!fin.is_open()) {
+        std::cerr<<"Error: core file "<<_filename<<" cannot be open! Use petar.data.process to generate it or change --cm-mode\n";
+        abort();
+    }
+    std::string line;
+    while (std::getline(fin, line)) {
+        std::istringstream sin(line);
+        CoreRecord c;
+        if (sin>>c.time>>c.pos.x>>c.pos.y>>c.pos.z>>c.vel.x>>c.vel.y>>c.vel.z>>c.rc) core.push_back(c);
+    }
+    return core;
+}
+
+//! find the core record at the time, return NULL if not found
+const CoreRecord* findCore(const std::vector<CoreRecord>& _core, const PS::F64 _time) {
+    const PS::F64 dt_tol = 1e-8*std::max(1.0, std::abs(_time));
+    for (auto& c: _core)
+        if (std::abs(c.time-_time)<=dt_tol) return &c;
+    return NULL;
+}
+
+//! matplotlib rainbow color map
+inline void colorRainbow(PS::F64 _x, PS::F64 _rgb[3]) {
+    _x = std::max(0.0, std::min(1.0, _x));
+    _rgb[0] = std::min(1.0, std::abs(2.0*_x-0.5));
+    _rgb[1] = std::sin(M_PI*_x);
+    _rgb[2] = std::cos(0.5*M_PI*_x);
+}
+
+//! 5x7 bitmap font for ASCII 32-126, 5 columns per glyph, bit 0 is the top row
+static const unsigned char RENDER_FONT[95][5] = {
+    {0x00,0x00,0x00,0x00,0x00}, {0x00,0x00,0x5F,0x00,0x00}, {0x00,0x07,0x00,0x07,0x00}, {0x14,0x7F,0x14,0x7F,0x14},
+    {0x24,0x2A,0x7F,0x2A,0x12}, {0x23,0x13,0x08,0x64,0x62}, {0x36,0x49,0x56,0x20,0x50}, {0x00,0x08,0x07,0x03,0x00},
+    {0x00,0x1C,0x22,0x41,0x00}, {0x00,0x41,0x22,0x1C,0x00}, {0x2A,0x1C,0x7F,0x1C,0x2A}, {0x08,0x08,0x3E,0x08,0x08},
+    {0x00,0x80,0x70,0x30,0x00}, {0x08,0x08,0x08,0x08,0x08}, {0x00,0x00,0x60,0x60,0x00}, {0x20,0x10,0x08,0x04,0x02},
+    {0x3E,0x51,0x49,0x45,0x3E}, {0x00,0x42,0x7F,0x40,0x00}, {0x72,0x49,0x49,0x49,0x46}, {0x21,0x41,0x49,0x4D,0x33},
+    {0x18,0x14,0x12,0x7F,0x10}, {0x27,0x45,0x45,0x45,0x39}, {0x3C,0x4A,0x49,0x49,0x31}, {0x41,0x21,0x11,0x09,0x07},
+    {0x36,0x49,0x49,0x49,0x36}, {0x46,0x49,0x49,0x29,0x1E}, {0x00,0x00,0x14,0x00,0x00}, {0x00,0x40,0x34,0x00,0x00},
+    {0x00,0x08,0x14,0x22,0x41}, {0x14,0x14,0x14,0x14,0x14}, {0x00,0x41,0x22,0x14,0x08}, {0x02,0x01,0x59,0x09,0x06},
+    {0x3E,0x41,0x5D,0x59,0x4E}, {0x7C,0x12,0x11,0x12,0x7C}, {0x7F,0x49,0x49,0x49,0x36}, {0x3E,0x41,0x41,0x41,0x22},
+    {0x7F,0x41,0x41,0x41,0x3E}, {0x7F,0x49,0x49,0x49,0x41}, {0x7F,0x09,0x09,0x09,0x01}, {0x3E,0x41,0x41,0x51,0x73},
+    {0x7F,0x08,0x08,0x08,0x7F}, {0x00,0x41,0x7F,0x41,0x00}, {0x20,0x40,0x41,0x3F,0x01}, {0x7F,0x08,0x14,0x22,0x41},
+    {0x7F,0x40,0x40,0x40,0x40}, {0x7F,0x02,0x1C,0x02,0x7F}, {0x7F,0x04,0x08,0x10,0x7F}, {0x3E,0x41,0x41,0x41,0x3E},
+    {0x7F,0x09,0x09,0x09,0x06}, {0x3E,0x41,0x51,0x21,0x5E}, {0x7F,0x09,0x19,0x29,0x46}, {0x26,0x49,0x49,0x49,0x32},
+    {0x03,0x01,0x7F,0x01,0x03}, {0x3F,0x40,0x40,0x40,0x3F}, {0x1F,0x20,0x40,0x20,0x1F}, {0x3F,0x40,0x38,0x40,0x3F},
+    {0x63,0x14,0x08,0x14,0x63}, {0x03,0x04,0x78,0x04,0x03}, {0x61,0x59,0x49,0x4D,0x43}, {0x00,0x7F,0x41,0x41,0x41},
+    {0x02,0x04,0x08,0x10,0x20}, {0x00,0x41,0x41,0x41,0x7F}, {0x04,0x02,0x01,0x02,0x04}, {0x40,0x40,0x40,0x40,0x40},
+    {0x00,0x03,0x07,0x08,0x00}, {0x20,0x54,0x54,0x78,0x40}, {0x7F,0x28,0x44,0x44,0x38}, {0x38,0x44,0x44,0x44,0x28},
+    {0x38,0x44,0x44,0x28,0x7F}, {0x38,0x54,0x54,0x54,0x18}, {0x00,0x08,0x7E,0x09,0x02}, {0x18,0xA4,0xA4,0x9C,0x78},
+    {0x7F,0x08,0x04,0x04,0x78}, {0x00,0x44,0x7D,0x40,0x00}, {0x20,0x40,0x40,0x3D,0x00}, {0x7F,0x10,0x28,0x44,0x00},
+    {0x00,0x41,0x7F,0x40,0x00}, {0x7C,0x04,0x78,0x04,0x78}, {0x7C,0x08,0x04,0x04,0x78}, {0x38,0x44,0x44,0x44,0x38},
+    {0xFC,0x18,0x24,0x24,0x18}, {0x18,0x24,0x24,0x18,0xFC}, {0x7C,0x08,0x04,0x04,0x08}, {0x48,0x54,0x54,0x54,0x24},
+    {0x04,0x04,0x3F,0x44,0x24}, {0x3C,0x40,0x40,0x20,0x7C}, {0x1C,0x20,0x40,0x20,0x1C}, {0x3C,0x40,0x30,0x40,0x3C},
+    {0x44,0x28,0x10,0x28,0x44}, {0x4C,0x90,0x90,0x90,0x7C}, {0x44,0x64,0x54,0x4C,0x44}, {0x00,0x08,0x36,0x41,0x00},
+    {0x00,0x00,0x77,0x00,0x00}, {0x00,0x41,0x36,0x08,0x00}, {0x02,0x01,0x02,0x04,0x02}};
+
+//! RGB image with 8-bit channels
+class RenderImage{
+public:
+    PS::S32 nx, ny;
+    std::vector<unsigned char> rgb;
+
+    RenderImage(): nx(0), ny(0), rgb() {}
+
+    void resize(const PS::S32 _nx, const PS::S32 _ny) {
+        nx = _nx;
+        ny = _ny;
+        rgb.assign((size_t)nx*ny*3, 0);
+    }
+
+    void setPixel(const PS::S32 _ix, const PS::S32 _iy, const unsigned char _r, const unsigned char _g, const unsigned char _b) {
+        if (_ix<0||_ix>=nx||_iy<0||_iy>=ny) return;
+        unsigned char* p = &rgb[((size_t)_iy*nx+_ix)*3];
+        p[0] = _r;
+        p[1] = _g;
+        p[2] = _b;
+    }
+
+    //! draw a rectangle frame
+    void drawRect(const PS::S32 _x0, const PS::S32 _y0, const PS::S32 _x1, const PS::S32 _y1, const unsigned char _c) {
+        for (PS::S32 i=_x0; i<=_x1; i++) {
+            setPixel(i, _y0, _c, _c, _c);
+            setPixel(i, _y1, _c, _c, _c);
+        }
+        for (PS::S32 j=_y0; j<=_y1; j++) {
+            setPixel(_x0, j, _c, _c, _c);
+            setPixel(_x1, j, _c, _c, _c);
+        }
+    }
+
+    //! draw text with the 5x7 font, (_x, _y) is the top-left corner
+    void drawText(const std::string& _text, const PS::S32 _x, const PS::S32 _y, const PS::S32 _scale) {
+        PS::S32 x = _x;
+        for (char ch: _text) {
+            PS::S32 k = (PS::S32)ch - 32;
+            if (k<0||k>=95) k = 0;
+            for (PS::S32 i=0; i<5; i++)
+                for (PS::S32 j=0; j<8; j++)
+                    if (RENDER_FONT[k][i]&(1<<j))
+                        for (PS::S32 si=0; si<_scale; si++)
+                            for (PS::S32 sj=0; sj<_scale; sj++)
+                                setPixel(x+i*_scale+si, _y+j*_scale+sj, 255, 255, 255);
+            x += 6*_scale;
+        }
+    }
+
+    //! text width in pixels
+    static PS::S32 getTextWidth(const std::string& _text, const PS::S32 _scale) {
+        return (PS::S32)_text.size()*6*_scale;
+    }
+
+    //! write the image in PNG format
+    /*! The zlib stream uses fixed Huffman codes with matches to the previous pixel and the previous row,
+        which compresses the dark background and smooth regions of the frames.
+        @param[in] _filename: PNG filename
+     */
+    void writePNG(const std::string& _filename) const {
+        // raw scanlines with filter type 0
+        const size_t stride = (size_t)nx*3+1;
+        std::vector<unsigned char> raw(stride*ny);
+        for (PS::S32 j=0; j<ny; j++) {
+            raw[j*stride] = 0;
+            std::memcpy(&raw[j*stride+1], &rgb[(size_t)j*nx*3], (size_t)nx*3);
+        }
+
+        std::vector<unsigned char> zdata;
+        zdata.push_back(0x78);
+        zdata.push_back(0x01);
+        deflateFixed(raw, stride, zdata);
+        PS::U32 adler = calcAdler32(raw);
+        for (PS::S32 k=3; k>=0; k--) zdata.push_back((adler>>(8*k))&0xFF);
+
+        FILE* fout;
+        if( (fout = fopen(_filename.c_str(),"wb")) == NULL) {
+            std::cerr<<"Error: Cannot open file "<<_filename<<"!\n";
+            abort();
+        }
+        const unsigned char signature[8] = {0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A};
+        fwrite(signature, 1, 8, fout);
+        std::vector<unsigned char> ihdr;
+        pushU32(ihdr, nx);
+        pushU32(ihdr, ny);
+        ihdr.push_back(8); // bit depth
+        ihdr.push_back(2); // RGB
+        ihdr.push_back(0); // deflate
+        ihdr.push_back(0); // adaptive filter
+        ihdr.push_back(0); // no interlace
+        writeChunk(fout, "IHDR", ihdr);
+        writeChunk(fout, "IDAT", zdata);
+        writeChunk(fout, "IEND", std::vector<unsigned char>());
+        fclose(fout);
+    }
+
+private:
+    static void pushU32(std::vector<unsigned char>& _buf, const PS::U32 _v) {
+        for (PS::S32 k=3; k>=0; k--) _buf.push_back((_v>>(8*k))&0xFF);
+    }
+
+    static PS::U32 calcCRC32(const char* _type, const std::vector<unsigned char>& _data) {
+        static PS::U32 table[256];
+        static bool table_flag = false;
+#pragma omp critical (render_crc_table)
+        {
+            if (!table_flag) {
+                for (PS::U32 n=0; n<256; n++) {
+                    PS::U32 c = n;
+                    for (PS::S32 k=0; k<8; k++) c = (c&1) ? (0xEDB88320u^(c>>1)) : (c>>1);
+                    table[n] = c;
+                }
+                table_flag = true;
+            }
+        }
+        PS::U32 crc = 0xFFFFFFFFu;
+        for (PS::S32 i=0; i<4; i++) crc = table[(crc^(unsigned char)_type[i])&0xFF]^(crc>>8);
+        for (auto c: _data) crc = table[(crc^c)&0xFF]^(crc>>8);
+        return crc^0xFFFFFFFFu;
+    }
+
+    static PS::U32 calcAdler32(const std::vector<unsigned char>& _data) {
+        PS::U32 a = 1, b = 0;
+        for (auto c: _data) {
+            a = (a+c)%65521;
+            b = (b+a)%65521;
+        }
+        return (b<<16)|a;
+    }
+
+    static void writeChunk(FILE* _fout, const char* _type, const std::vector<unsigned char>& _data) {
+        std::vector<unsigned char> head;
+        pushU32(head, _data.size());
+        head.insert(head.end(), _type, _type+4);
+        fwrite(head.data(), 1, 8, _fout);
+        if (_data.size()>0) fwrite(_data.data(), 1, _data.size(), _fout);
+        std::vector<unsigned char> tail;
+        pushU32(tail, calcCRC32(_type, _data));
+        fwrite(tail.data(), 1, 4, _fout);
+    }
+
+    //! LSB-first bit writer of deflate streams
+    struct BitWriter{
+        std::vector<unsigned char>& out;
+        PS::U32 bit_buf;
+        PS::S32 n_bit;
+        BitWriter(std::vector<unsigned char>& _out): out(_out), bit_buf(0), n_bit(0) {}
+        void write(const PS::U32 _bits, const PS::S32 _n) {
+            bit_buf |= _bits<<n_bit;
+            n_bit += _n;
+            while (n_bit>=8) {
+                out.push_back(bit_buf&0xFF);
+                bit_buf >>= 8;
+                n_bit -= 8;
+            }
+        }
+        //! write Huffman code (MSB first)
+        void writeCode(const PS::U32 _code, const PS::S32 _n) {
+            PS::U32 rev = 0;
+            for (PS::S32 k=0; k<_n; k++) rev |= ((_code>>k)&1)<<(_n-1-k);
+            write(rev, _n);
+        }
+        void flush() {
+            if (n_bit>0) out.push_back(bit_buf&0xFF);
+            bit_buf = 0;
+            n_bit = 0;
+        }
+    };
+
+    static void writeLiteral(BitWriter& _bw, const PS::S32 _v) {
+        if (_v<144)      _bw.writeCode(0x30+_v, 8);
+        else if (_v<256) _bw.writeCode(0x190+_v-144, 9);
+        else if (_v<280) _bw.writeCode(_v-256, 7);
+        else             _bw.writeCode(0xC0+_v-280, 8);
+    }
+
+    static void writeMatch(BitWriter& _bw, const PS::S32 _len, const PS::S32 _dist) {
+        static const PS::S32 len_base[29] = {3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,35,43,51,59,67,83,99,115,131,163,195,227,258};
+        static const PS::S32 len_extra[29] = {0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,4,4,4,4,5,5,5,5,0};
+        static const PS::S32 dist_base[30] = {1,2,3,4,5,7,9,13,17,25,33,49,65,97,129,193,257,385,513,769,1025,1537,2049,3073,4097,6145,8193,12289,16385,24577};
+        static const PS::S32 dist_extra[30] = {0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12,12,13,13};
+        PS::S32 lc = 28;
+        while (len_base[lc]>_len) lc--;
+        writeLiteral(_bw, 257+lc);
+        if (len_extra[lc]>0) _bw.write(_len-len_base[lc], len_extra[lc]);
+        PS::S32 dc = 29;
+        while (dist_base[dc]>_dist) dc--;
+        _bw.writeCode(dc, 5);
+        if (dist_extra[dc]>0) _bw.write(_dist-dist_base[dc], dist_extra[dc]);
+    }
+
+    //! deflate with one fixed Huffman block, matches are searched at the distances of one pixel and one scanline
+    static void deflateFixed(const std::vector<unsigned char>& _raw, const size_t _stride, std::vector<unsigned char>& _out) {
+        BitWriter bw(_out);
+        bw.write(1, 1); // final block
+        bw.write(1, 2); // fixed Huffman
+        const size_t n = _raw.size();
+        const size_t dist_cand[2] = {3, _stride};
+        size_t i = 0;
+        while (i<n) {
+            size_t len_best = 0, dist_best = 0;
+            for (auto dist: dist_cand) {
+                if (dist>i || dist>32768) continue;
+                size_t len = 0;
+                while (len<258 && i+len<n && _raw[i+len]==_raw[i+len-dist]) len++;
+                if (len>len_best) {
+                    len_best = len;
+                    dist_best = dist;
+                }
+            }
+            if (len_best>=3) {
+                writeMatch(bw, len_best, dist_best);
+                i += len_best;
+            }
+            else {
+                writeLiteral(bw, _raw[i]);
+                i++;
+            }
+        }
+        writeLiteral(bw, 256); // end of block
+        bw.flush();
+    }
+};
+
+//! Panel types
+enum class PanelType{xy, hr};
+
+//! one panel of the frame
+struct RenderPanel{
+    PanelType type;
+    std::string mode; ///> projection mode of the particle distribution panel (x-y, x-z, ...)
+    PS::F64 x_min, x_max, y_min, y_max;
+    PS::F64 cm_boxsize;  ///> boxsize to search the coordinate center
+};
+
+//! rendering parameters
+struct RenderParams{
+    bool binary_flag;         ///> snapshot in BINARY format
+    std::string cm_mode;      ///> core, density, average, none
+    std::string color_mode;   ///> white, mass, type, temp
+    std::string unit_time;    ///> label of time unit
+    PS::F64 mass_min, mass_max; ///> mass range of the color map
+    PS::F64 lum_min, lum_max, temp_min, temp_max; ///> HR diagram ranges
+    PS::F64 contrast;         ///> dynamic range of the logarithmic brightness scaling
+    PS::F64 kernel_size;      ///> radius of the splatting kernel in pixels
+    PS::S32 panel_nx, panel_ny; ///> panel size in pixels
+    PS::S32 font_scale;       ///> font size factor
+};
+
+//! calculate panel coordinates of particles for the particle distribution panels
+/*! Same definitions as PlotXY in tools/movie.py
+    @param[out] _x: x coordinates
+    @param[out] _y: y coordinates
+    @param[out] _xcm: x of the coordinate center
+    @param[out] _ycm: y of the coordinate center
+    @param[out] _label: labels of the center values
+    @param[in] _snap: snapshot
+    @param[in] _core: core record at the snapshot time (NULL: not used)
+    @param[in] _mode: projection mode
+ */
+void calcPanelCoordinate(std::vector<PS::F64>& _x, std::vector<PS::F64>& _y, PS::F64& _xcm, PS::F64& _ycm, std::string _label[2],
+                         const RenderSnapshot& _snap, const CoreRecord* _core, const std::string& _mode) {
+    const PS::S64 n = _snap.ptcl.size();
+    _x.resize(n);
+    _y.resize(n);
+    const bool vel_flag = (_mode[0]=='v');
+    const PS::F64vec& offset = vel_flag ? _snap.vel_offset : _snap.pos_offset;
+    // coordinate shift relative to the offset of the header
+    PS::F64vec shift(0.0);
+    PS::F64vec center = offset;
+    if (_core!=NULL) {
+        center = vel_flag ? _core->vel : _core->pos;
+        shift = offset - center;
+    }
+    auto getVec = [&](const RenderParticle& _p) -> PS::F64vec {
+        return (vel_flag ? _p.vel : _p.pos) + shift;
+    };
+
+    if (_mode=="x-y"||_mode=="x-z"||_mode=="y-z"||_mode=="vx-y"||_mode=="vx-z"||_mode=="vy-z") {
+        // the axis indices
+        PS::S32 ix = (_mode=="y-z"||_mode=="vy-z") ? 1 : 0;
+        PS::S32 iy = (_mode=="x-y"||_mode=="vx-y") ? 1 : 2;
+        const char* axis = "xyz";
+        for (PS::S64 i=0; i<n; i++) {
+            PS::F64vec v = getVec(_snap.ptcl[i]);
+            _x[i] = v[ix];
+            _y[i] = v[iy];
+        }
+        _xcm = center[ix];
+        _ycm = center[iy];
+        std::string prefix = vel_flag ? "v" : "";
+        _label[0] = prefix + axis[ix] + "_cm";
+        _label[1] = prefix + axis[iy] + "_cm";
+    }
+    else if (_mode=="rxy-z"||_mode=="vrxy-z") {
+        for (PS::S64 i=0; i<n; i++) {
+            PS::F64vec v = getVec(_snap.ptcl[i]);
+            _x[i] = std::sqrt(v.x*v.x+v.y*v.y);
+            _y[i] = v.z;
+        }
+        _xcm = std::sqrt(center.x*center.x+center.y*center.y);
+        _ycm = center.z;
+        std::string prefix = vel_flag ? "v" : "";
+        _label[0] = prefix + "rxy_cm";
+        _label[1] = prefix + "z_cm";
+    }
+    else {
+        std::cerr<<"Error: plot mode "<<_mode<<" is not supported in petar.movie.render!"<<std::endl;
+        abort();
+    }
+}
+
+//! correct the coordinate center with the density or the average of particles, same as PlotXY.correctCM in tools/movie.py
+void correctPanelCenter(std::vector<PS::F64>& _x, std::vector<PS::F64>& _y, PS::F64& _xcm, PS::F64& _ycm,
+                        const std::string& _cm_mode, const PS::F64 _boxsize) {
+    const PS::S64 n = _x.size();
+    if (n==0) return;
+    auto shift = [&](const PS::F64 _dx, const PS::F64 _dy) {
+        for (PS::S64 i=0; i<n; i++) {
+            _x[i] -= _dx;
+            _y[i] -= _dy;
+        }
+        _xcm += _dx;
+        _ycm += _dy;
+    };
+    // center of the histogram bins with more than 20% of the maximum counts
+    auto histCenter = [&](const PS::F64 _xmin, const PS::F64 _xmax, const PS::F64 _ymin, const PS::F64 _ymax, const PS::S32 _nbins, PS::F64& _dx, PS::F64& _dy) {
+        std::vector<PS::S64> count((size_t)_nbins*_nbins, 0);
+        const PS::F64 xscale = _nbins/(_xmax-_xmin);
+        const PS::F64 yscale = _nbins/(_ymax-_ymin);
+        for (PS::S64 i=0; i<n; i++) {
+            PS::S64 ix = (PS::S64)std::floor((_x[i]-_xmin)*xscale);
+            PS::S64 iy = (PS::S64)std::floor((_y[i]-_ymin)*yscale);
+            if (ix<0||ix>=_nbins||iy<0||iy>=_nbins) continue;
+            count[ix*_nbins+iy]++;
+        }
+        PS::S64 cmax = *std::max_element(count.begin(), count.end());
+        PS::F64 mtot=0, xsum=0, ysum=0;
+        for (PS::S32 ix=0; ix<_nbins; ix++)
+            for (PS::S32 iy=0; iy<_nbins; iy++) {
+                PS::S64 c = count[ix*_nbins+iy];
+                if (c>0.2*cmax) {
+                    mtot += c;
+                    xsum += c*ix;
+                    ysum += c*iy;
+                }
+            }
+        _dx = _dy = 0.0;
+        if (mtot>0) {
+            _dx = (xsum/mtot+0.5)/xscale + _xmin;
+            _dy = (ysum/mtot+0.5)/yscale + _ymin;
+        }
+    };
+
+    if (_cm_mode=="density") {
+        PS::F64 xmid=0, ymid=0;
+        for (PS::S64 i=0; i<n; i++) {
+            xmid += std::abs(_x[i]);
+            ymid += std::abs(_y[i]);
+        }
+        xmid /= n;
+        ymid /= n;
+        PS::F64 dx, dy;
+        if (xmid>0&&ymid>0) {
+            histCenter(-5*xmid, 5*xmid, -5*ymid, 5*ymid, 1000, dx, dy);
+            shift(dx, dy);
+        }
+        histCenter(-_boxsize, _boxsize, -_boxsize, _boxsize, 500, dx, dy);
+        shift(dx, dy);
+    }
+    else if (_cm_mode=="average") {
+        PS::F64 xsum=0, ysum=0;
+        for (PS::S64 i=0; i<n; i++) {
+            xsum += _x[i];
+            ysum += _y[i];
+        }
+        shift(xsum/n, ysum/n);
+        xsum = ysum = 0;
+        PS::S64 nsel = 0;
+        for (PS::S64 i=0; i<n; i++) {
+            if (_x[i]>-_boxsize && _x[i]<_boxsize && _y[i]>-_boxsize && _y[i]<_boxsize) {
+                xsum += _x[i];
+                ysum += _y[i];
+                nsel++;
+            }
+        }
+        if (nsel>0) shift(xsum/nsel, ysum/nsel);
+    }
+}
+
+//! splat weighted colored points onto a density grid and convert it to pixels in the image
+/*! @param[in,out] _image: frame image
+    @param[in] _ix0, _iy0: top-left pixel of the plot area
+    @param[in] _nx, _ny: size of the plot area
+    @param[in] _x, _y: coordinates of points
+    @param[in] _w: weights of points
+    @param[in] _color: colors of points (3 per point)
+    @param[in] _x_min, _x_max, _y_min, _y_max: axis ranges (x_min>x_max for reversed axis)
+    @param[in] _log_x, _log_y: logarithmic axes
+    @param[in] _par: rendering parameters
+    @param[in] _parallel: splat with OpenMP threads
+ */
+void splatPoints(RenderImage& _image, const PS::S32 _ix0, const PS::S32 _iy0, const PS::S32 _nx, const PS::S32 _ny,
+                 const std::vector<PS::F64>& _x, const std::vector<PS::F64>& _y, const std::vector<PS::F64>& _w, const std::vector<PS::F64>& _color,
+                 PS::F64 _x_min, PS::F64 _x_max, PS::F64 _y_min, PS::F64 _y_max, const bool _log_x, const bool _log_y,
+                 const RenderParams& _par, const bool _parallel) {
+    if (_nx<=0||_ny<=0) return;
+    if (_log_x) {
+        _x_min = std::log10(_x_min);
+        _x_max = std::log10(_x_max);
+    }
+    if (_log_y) {
+        _y_min = std::log10(_y_min);
+        _y_max = std::log10(_y_max);
+    }
+    const PS::F64 xscale = _nx/(_x_max-_x_min);
+    const PS::F64 yscale = _ny/(_y_max-_y_min);
+    const PS::F64 h = std::max(0.5, _par.kernel_size);
+    const PS::S32 nh = (PS::S32)std::ceil(h);
+    const PS::S64 n = _x.size();
+    const size_t ngrid = (size_t)_nx*_ny;
+    // weight and weighted colors of each pixel
+    std::vector<PS::F64> grid(ngrid*4, 0.0);
+
+#pragma omp parallel if(_parallel)
+    {
+        std::vector<PS::F64> grid_local;
+        std::vector<PS::F64>* grid_ptr = &grid;
+#ifdef _OPENMP
+        if (omp_get_num_threads()>1) {
+            grid_local.assign(ngrid*4, 0.0);
+            grid_ptr = &grid_local;
+        }
+#endif
+        auto& g = *grid_ptr;
+#pragma omp for schedule(static)
+        for (PS::S64 i=0; i<n; i++) {
+            PS::F64 xi = _log_x ? (_x[i]>0 ? std::log10(_x[i]) : -1e30) : _x[i];
+            PS::F64 yi = _log_y ? (_y[i]>0 ? std::log10(_y[i]) : -1e30) : _y[i];
+            // pixel coordinates, y axis points downward in the image
+            PS::F64 px = (xi-_x_min)*xscale - 0.5;
+            PS::F64 py = (_y_max-yi)*yscale - 0.5;
+            if (!(px>-nh-1&&px<_nx+nh&&py>-nh-1&&py<_ny+nh)) continue;
+            PS::S32 cx = (PS::S32)std::floor(px);
+            PS::S32 cy = (PS::S32)std::floor(py);
+            // tent kernel
+            for (PS::S32 jy=cy-nh+1; jy<=cy+nh; jy++) {
+                if (jy<0||jy>=_ny) continue;
+                PS::F64 wy = 1.0 - std::abs(jy-py)/h;
+                if (wy<=0) continue;
+                for (PS::S32 jx=cx-nh+1; jx<=cx+nh; jx++) {
+                    if (jx<0||jx>=_nx) continue;
+                    PS::F64 wx = 1.0 - std::abs(jx-px)/h;
+                    if (wx<=0) continue;
+                    PS::F64 wk = _w[i]*wx*wy;
+                    PS::F64* gk = &g[((size_t)jy*_nx+jx)*4];
+                    gk[0] += wk;
+                    gk[1] += wk*_color[3*i];
+                    gk[2] += wk*_color[3*i+1];
+                    gk[3] += wk*_color[3*i+2];
+                }
+            }
+        }
+        if (grid_ptr!=&grid) {
+#pragma omp critical (render_splat_reduce)
+            for (size_t k=0; k<ngrid*4; k++) grid[k] += grid_local[k];
+        }
+    }
+
+    // logarithmic brightness relative to the maximum density
+    PS::F64 wmax = 0.0;
+    for (size_t k=0; k<ngrid; k++) wmax = std::max(wmax, grid[k*4]);
+    if (wmax<=0.0) return;
+    const PS::F64 a = std::max(1.0, _par.contrast);
+    const PS::F64 norm = 1.0/std::log1p(a);
+    for (PS::S32 jy=0; jy<_ny; jy++)
+        for (PS::S32 jx=0; jx<_nx; jx++) {
+            const PS::F64* gk = &grid[((size_t)jy*_nx+jx)*4];
+            if (gk[0]<=0.0) continue;
+            PS::F64 b = std::log1p(a*gk[0]/wmax)*norm;
+            PS::F64 winv = b/gk[0];
+            unsigned char c[3];
+            for (PS::S32 l=0; l<3; l++) c[l] = (unsigned char)std::min(255.0, 255.0*gk[l+1]*winv+0.5);
+            _image.setPixel(_ix0+jx, _iy0+jy, c[0], c[1], c[2]);
+        }
+}
+
+//! format a floating number for labels
+std::string formatNumber(const PS::F64 _v, const char* _fmt="%g") {
+    char buf[64];
+    snprintf(buf, 64, _fmt, _v);
+    return std::string(buf);
+}
+
+//! render one panel of one model
+/*! @param[in,out] _image: frame image
+    @param[in] _px0, _py0: top-left pixel of the panel
+    @param[in] _panel: panel definition
+    @param[in] _snap: snapshot
+    @param[in] _core: core record (NULL: not used)
+    @param[in] _title: title text of the panel (empty: no title)
+    @param[in] _par: rendering parameters
+    @param[in] _parallel: use OpenMP threads in the panel
+ */
+void renderPanel(RenderImage& _image, const PS::S32 _px0, const PS::S32 _py0, const RenderPanel& _panel, const RenderSnapshot& _snap,
+                 const CoreRecord* _core, const std::string& _title, const RenderParams& _par, const bool _parallel) {
+    const PS::S32 fs = _par.font_scale;
+    const PS::S32 line = 10*fs;
+    // plot area inside the panel, leave space for the title and the axis labels
+    PS::S32 ax0 = _px0 + line;
+    PS::S32 ay0 = _py0 + 2*line;
+    PS::S32 anx = _par.panel_nx - 2*line;
+    PS::S32 any = _par.panel_ny - 4*line;
+    if (anx<=0||any<=0) {
+        std::cerr<<"Error: panel size is too small for the font size!"<<std::endl;
+        abort();
+    }
+
+    if (_title.size()>0) _image.drawText(_title, _px0+(_par.panel_nx-RenderImage::getTextWidth(_title, fs))/2, _py0+line/2, fs);
+
+    const PS::S64 n = _snap.ptcl.size();
+    std::vector<PS::F64> x, y, w(n), color(3*n, 1.0);
+    std::string axis_label;
+
+    if (_panel.type==PanelType::xy) {
+        // keep the aspect ratio of the axis ranges
+        const PS::F64 xr = _panel.x_max-_panel.x_min, yr = _panel.y_max-_panel.y_min;
+        if (xr*any > yr*anx) {
+            PS::S32 any_new = std::max(1, (PS::S32)(anx*yr/xr));
+            ay0 += (any-any_new)/2;
+            any = any_new;
+        }
+        else {
+            PS::S32 anx_new = std::max(1, (PS::S32)(any*xr/yr));
+            ax0 += (anx-anx_new)/2;
+            anx = anx_new;
+        }
+
+        PS::F64 xcm, ycm;
+        std::string cm_label[2];
+        calcPanelCoordinate(x, y, xcm, ycm, cm_label, _snap, _core, _panel.mode);
+        if (_par.cm_mode=="density"||_par.cm_mode=="average") correctPanelCenter(x, y, xcm, ycm, _par.cm_mode, _panel.cm_boxsize);
+
+        for (PS::S64 i=0; i<n; i++) {
+            auto& pi = _snap.ptcl[i];
+            w[i] = pi.mass;
+            PS::F64* ci = &color[3*i];
+            if (_par.color_mode=="mass")
+                colorRainbow(std::log10(pi.mass/_par.mass_min)/std::log10(_par.mass_max/_par.mass_min), ci);
+#ifdef BSE_BASE
+            else if (_par.color_mode=="type") colorRainbow(pi.type/15.0, ci);
+            else if (_par.color_mode=="temp") {
+                PS::F64 log_temp = pi.temp>0 ? (std::log10(pi.temp)-std::log10(_par.temp_min))/(std::log10(_par.temp_max)-std::log10(_par.temp_min)) : 0.0;
+                colorRainbow(1.0-log_temp, ci);
+            }
+#endif
+        }
+        splatPoints(_image, ax0, ay0, anx, any, x, y, w, color, _panel.x_min, _panel.x_max, _panel.y_min, _panel.y_max, false, false, _par, _parallel);
+
+        _image.drawText(cm_label[0]+"="+formatNumber(xcm, "%f"), ax0+fs*3, ay0+fs*3, fs);
+        _image.drawText(cm_label[1]+"="+formatNumber(ycm, "%f"), ax0+fs*3, ay0+fs*3+line, fs);
+        axis_label = _panel.mode + " x[" + formatNumber(_panel.x_min) + "," + formatNumber(_panel.x_max) + "] y[" + formatNumber(_panel.y_min) + "," + formatNumber(_panel.y_max) + "]";
+    }
+#ifdef BSE_BASE
+    else if (_panel.type==PanelType::hr) {
+        x.resize(n);
+        y.resize(n);
+        for (PS::S64 i=0; i<n; i++) {
+            auto& pi = _snap.ptcl[i];
+            x[i] = pi.temp;
+            y[i] = pi.lum;
+            w[i] = 1.0;
+            colorRainbow(pi.type/15.0, &color[3*i]);
+        }
+        // temperature decreases along x axis
+        splatPoints(_image, ax0, ay0, anx, any, x, y, w, color, _par.temp_max, _par.temp_min, _par.lum_min, _par.lum_max, true, true, _par, _parallel);
+        axis_label = "Teff[" + formatNumber(_par.temp_max) + "," + formatNumber(_par.temp_min) + "] L[" + formatNumber(_par.lum_min) + "," + formatNumber(_par.lum_max) + "]";
+    }
+#endif
+
+    _image.drawRect(ax0-1, ay0-1, ax0+anx, ay0+any, 128);
+    _image.drawText(axis_label, _px0+(_par.panel_nx-RenderImage::getTextWidth(axis_label, fs))/2, ay0+any+line/2, fs);
+}
+
+int main(int argc, char *argv[]){
+    std::string fname_list("dat.lst");    // list of snapshot paths
+    std::string model_path("");           // list of model directories and names
+    std::string core_file("data.core");   // core data file
+    std::string output_file("movie");     // prefix of the frame list for ffmpeg
+    std::string mode_str("x-y");          // panel modes
+    std::vector<PS::F64> boxsize_list, x_min_list, x_max_list, y_min_list, y_max_list, cm_boxsize_list;
+    bool plot_hr_flag = false;
+    bool use_previous = false;
+    bool compare_in_column = false;
+    PS::F64 fps = 30;
+    PS::S32 ncol = -1;
+    PS::F64 frame_xsize = 4, frame_ysize = 4;
+    PS::S32 dpi = 100;
+
+    RenderParams par;
+    par.binary_flag = false;
+    par.cm_mode = "core";
+#ifdef BSE_BASE
+    par.color_mode = "temp";
+#else
+    par.color_mode = "white";
+#endif
+    par.unit_time = "";
+    par.mass_min = par.mass_max = -1.0;
+    par.lum_min = 1e-5;
+    par.lum_max = 1e6;
+    par.temp_min = 1000;
+    par.temp_max = 50000;
+    par.contrast = 1000;
+    par.kernel_size = 1.5;
+    par.font_scale = 0;
+
+    auto readList = [](const char* _arg) {
+        std::vector<PS::F64> list;
+        std::stringstream sin(_arg);
+        std::string item;
+        while (std::getline(sin, item, ',')) list.push_back(atof(item.c_str()));
+        return list;
+    };
+
+    static int long_flag=-1;
+    static struct option long_options[] = {
+        {"x-min",             required_argument, &long_flag, 0},
+        {"x-max",             required_argument, &long_flag, 1},
+        {"y-min",             required_argument, &long_flag, 2},
+        {"y-max",             required_argument, &long_flag, 3},
+        {"lum-min",           required_argument, &long_flag, 4},
+        {"lum-max",           required_argument, &long_flag, 5},
+        {"temp-min",          required_argument, &long_flag, 6},
+        {"temp-max",          required_argument, &long_flag, 7},
+        {"cm-mode",           required_argument, &long_flag, 8},
+        {"cm-boxsize",        required_argument, &long_flag, 9},
+        {"core-file",         required_argument, &long_flag, 10},
+        {"unit-time",         required_argument, &long_flag, 11},
+        {"plot-ncols",        required_argument, &long_flag, 12},
+        {"plot-xsize",        required_argument, &long_flag, 13},
+        {"plot-ysize",        required_argument, &long_flag, 14},
+        {"dpi",               required_argument, &long_flag, 15},
+        {"color",             required_argument, &long_flag, 16},
+        {"mass-min",          required_argument, &long_flag, 17},
+        {"mass-max",          required_argument, &long_flag, 18},
+        {"contrast",          required_argument, &long_flag, 19},
+        {"kernel-size",       required_argument, &long_flag, 20},
+        {"compare-in-column", no_argument,       &long_flag, 21},
+        {"help",              no_argument, 0, 'h'},
+        {0,0,0,0}
+    };
+
+    int copt;
+    int option_index;
+    optind = 0; // reset getopt
+    bool print_flag = true;
+
+    while ((copt = getopt_long(argc, argv, "m:R:f:o:s:l:pHbL:h", long_options, &option_index)) != -1)
+        switch (copt) {
+        case 0:
+            switch (long_flag) {
+            case 0:
+                x_min_list = readList(optarg);
+                break;
+            case 1:
+                x_max_list = readList(optarg);
+                break;
+            case 2:
+                y_min_list = readList(optarg);
+                break;
+            case 3:
+                y_max_list = readList(optarg);
+                break;
+            case 4:
+                par.lum_min = atof(optarg);
+                break;
+            case 5:
+                par.lum_max = atof(optarg);
+                break;
+            case 6:
+                par.temp_min = atof(optarg);
+                break;
+            case 7:
+                par.temp_max = atof(optarg);
+                break;
+            case 8:
+                par.cm_mode = optarg;
+                assert(par.cm_mode=="core"||par.cm_mode=="density"||par.cm_mode=="average"||par.cm_mode=="none");
+                break;
+            case 9:
+                cm_boxsize_list = readList(optarg);
+                break;
+            case 10:
+                core_file = optarg;
+                break;
+            case 11:
+                par.unit_time = optarg;
+                break;
+            case 12:
+                ncol = atoi(optarg);
+                break;
+            case 13:
+                frame_xsize = atof(optarg);
+                assert(frame_xsize>0.0);
+                break;
+            case 14:
+                frame_ysize = atof(optarg);
+                assert(frame_ysize>0.0);
+                break;
+            case 15:
+                dpi = atoi(optarg);
+                assert(dpi>0);
+                break;
+            case 16:
+                par.color_mode = optarg;
+#ifdef BSE_BASE
+                assert(par.color_mode=="white"||par.color_mode=="mass"||par.color_mode=="type"||par.color_mode=="temp");
+#else
+                assert(par.color_mode=="white"||par.color_mode=="mass");
+#endif
+                break;
+            case 17:
+                par.mass_min = atof(optarg);
+                assert(par.mass_min>0.0);
+                break;
+            case 18:
+                par.mass_max = atof(optarg);
+                assert(par.mass_max>0.0);
+                break;
+            case 19:
+                par.contrast = atof(optarg);
+                assert(par.contrast>=1.0);
+                break;
+            case 20:
+                par.kernel_size = atof(optarg);
+                assert(par.kernel_size>0.0);
+                break;
+            case 21:
+                compare_in_column = true;
+                break;
+            default:
+                break;
+            }
+            break;
+        case 'm':
+            mode_str = optarg;
+            break;
+        case 'R':
+            boxsize_list = readList(optarg);
+            break;
+        case 'f':
+            fps = atof(optarg);
+            assert(fps>0.0);
+            break;
+        case 'o':
+            output_file = optarg;
+            break;
+        case 's':
+            if (std::string(optarg)=="binary") par.binary_flag = true;
+            else if (std::string(optarg)=="ascii") par.binary_flag = false;
+            else {
+                std::cerr<<"Error: snapshot format should be binary or ascii, given "<<optarg<<std::endl;
+                abort();
+            }
+            break;
+        case 'l':
+            model_path = optarg;
+            break;
+        case 'p':
+            use_previous = true;
+            break;
+        case 'H':
+#ifdef BSE_BASE
+            plot_hr_flag = true;
+#else
+            std::cerr<<"Error: HR diagram (-H) needs the SSE/BSE based stellar evolution (configure --with-interrupt)!"<<std::endl;
+            abort();
+#endif
+            break;
+        case 'b':
+        case 'L':
+            std::cerr<<"Error: semi-ecc (-b) and Lagrangian radii (-L) panels are not supported in petar.movie.render, use petar.movie instead"<<std::endl;
+            abort();
+        case 'h':
+            if(print_flag){
+                std::cout<<"The native tool to render the frames of snapshots in PNG format for movies with OpenMP, the panel layouts are the same as petar.movie\n";
+                std::cout<<"Usage: petar.movie.render [options] data_list_filename\n";
+                std::cout<<"       data_list_filename: A list of snapshot data path, each line for one snapshot: "<<fname_list<<std::endl;
+                std::cout<<"Each frame is saved as [snapshot path].png, frames are rendered in parallel with OpenMP threads (OMP_NUM_THREADS).\n"
+                         <<"A list of frames for ffmpeg is saved as [output].ffconcat, the movie can be generated by\n"
+                         <<"       ffmpeg -f concat -safe 0 -i [output].ffconcat -c:v libx264 -pix_fmt yuv420p [output].mp4\n";
+                std::cout<<"Stellar evolution method: ";
+#ifdef STELLAR_EVOLUTION
+#ifdef BSE
+                std::cout<<"BSE\n";
+#elif MOBSE
+                std::cout<<"MOBSE\n";
+#else
+                std::cout<<"Base\n";
+#endif
+#else
+                std::cout<<"None\n";
+#endif
+#ifdef EXTERNAL_POT_IN_PTCL
+                std::cout<<"External potential column exists\n";
+#else
+                std::cout<<"External potential column not exists\n";
+#endif
+                std::cout<<"Important: Ensure that the stellar evolution method and external mode used in the snapshots and this tool are consistent.\n";
+                std::cout<<"Options: default values are shown at last\n"
+                         <<"  -h(--help): help\n"
+                         <<"  -m [S]: panels of the distribution of particles: "<<mode_str<<std::endl
+                         <<"          x-y, x-z, y-z, rxy-z, vx-y, vx-z, vy-z, vrxy-z (same as petar.movie), multiple panels are separated by ','\n"
+                         <<"  -R [F]: x- and y-axis length of -m; suppressed when --x-min/max, --y-min/max are used: 2.0\n"
+                         <<"          For multiple panels, values are separated by ',', such as -R 10,10\n"
+                         <<"  -H    : add one panel of HR-diagram (SSE/BSE)\n"
+                         <<"  -f [F]: output frame FPS: "<<fps<<std::endl
+                         <<"  -o [S]: prefix of the frame list file for ffmpeg: "<<output_file<<std::endl
+                         <<"  -p    : skip the snapshots with existing png images\n"
+                         <<"  -s [S]: snapshot format: binary or ascii: ascii\n"
+                         <<"  -l [S]: the filename of a list of pathes to different models, this switches on the comparison mode.\n"
+                         <<"          Each line contains two values: directory path of model, name of model.\n"
+                         <<"  --compare-in-column: in comparison mode, models are compared in columns instead of rows\n"
+                         <<"  --x-min       [F]: minimum of the x-axis ranges of -m panels, separated by ','\n"
+                         <<"  --x-max       [F]: maximum of the x-axis ranges of -m panels, separated by ','\n"
+                         <<"  --y-min       [F]: minimum of the y-axis ranges of -m panels, separated by ','\n"
+                         <<"  --y-max       [F]: maximum of the y-axis ranges of -m panels, separated by ','\n"
+                         <<"  --lum-min     [F]: minimum lumonisity: "<<par.lum_min<<std::endl
+                         <<"  --lum-max     [F]: maximum lumonisity: "<<par.lum_max<<std::endl
+                         <<"  --temp-min    [F]: minimum temperature: "<<par.temp_min<<std::endl
+                         <<"  --temp-max    [F]: maximum temperature: "<<par.temp_max<<std::endl
+                         <<"  --cm-mode     [S]: plot origin position determination: "<<par.cm_mode<<std::endl
+                         <<"                       density: density center;\n"
+                         <<"                       average: average of x,y;\n"
+                         <<"                       core: use core data file generated from petar.data.process;\n"
+                         <<"                       none: use origin of snapshots.\n"
+                         <<"  --core-file   [S]: core data file name: "<<core_file<<std::endl
+                         <<"  --cm-boxsize  [F]: boxsize to search the coordinate center for each -m panel: same as -R\n"
+                         <<"  --unit-time   [S]: set label of time unit: no print\n"
+                         <<"  --plot-ncols  [I]: column number of panels: same as panels\n"
+                         <<"  --plot-xsize  [F]: x size of panel in inch: "<<frame_xsize<<std::endl
+                         <<"  --plot-ysize  [F]: y size of panel in inch: "<<frame_ysize<<std::endl
+                         <<"  --dpi         [I]: pixels per inch: "<<dpi<<std::endl
+#ifdef BSE_BASE
+                         <<"  --color       [S]: color of particles: white, mass (logarithmic), type (SSE type), temp (effective temperature): "<<par.color_mode<<std::endl
+#else
+                         <<"  --color       [S]: color of particles: white, mass (logarithmic): "<<par.color_mode<<std::endl
+#endif
+                         <<"  --mass-min    [F]: minimum mass of the color map: minimum mass in the first snapshot\n"
+                         <<"  --mass-max    [F]: maximum mass of the color map: maximum mass in the first snapshot\n"
+                         <<"  --contrast    [F]: dynamic range of the logarithmic brightness of the projected density: "<<par.contrast<<std::endl
+                         <<"  --kernel-size [F]: radius of the splatting kernel of particles in pixels: "<<par.kernel_size<<std::endl
+                         <<"PS: the sky coordinate modes of -m, semi-ecc (-b) and Lagrangian radii (-L) panels are only available in petar.movie\n";
+            }
+            return -1;
+        case '?':
+            break;
+        default:
+            break;
+        }
+
+    if (optind<argc) fname_list = argv[argc-1];
+
+    // snapshot list
+    std::vector<std::string> path_list;
+    {
+        std::fstream fin;
+        fin.open(fname_list,std::fstream::in);
+        if(!fin.is_open()) {
+            std::cerr<<"Error: data file "<<fname_list<<" cannot be open!\n";
+            abort();
+        }
+        std::string filename;
+        while (fin>>filename) path_list.push_back(filename);
+    }
+    const PS::S32 n_frame = path_list.size();
+    if (n_frame==0) {
+        std::cerr<<"Error: no snapshot in "<<fname_list<<std::endl;
+        abort();
+    }
+
+    // models: directory and name
+    std::vector<std::pair<std::string,std::string>> model_list;
+    if (model_path!="") {
+        std::fstream fin;
+        fin.open(model_path,std::fstream::in);
+        if(!fin.is_open()) {
+            std::cerr<<"Error: model list "<<model_path<<" cannot be open!\n";
+            abort();
+        }
+        std::string line;
+        while (std::getline(fin, line)) {
+            std::istringstream sin(line);
+            std::string dir, name;
+            if (sin>>dir) {
+                sin>>name;
+                model_list.push_back(std::make_pair(dir, name));
+            }
+        }
+    }
+    else model_list.push_back(std::make_pair(std::string("."), std::string("")));
+    const PS::S32 n_model = model_list.size();
+
+    // panels
+    std::vector<RenderPanel> panels;
+    {
+        std::stringstream sin(mode_str);
+        std::string mode;
+        PS::S32 imain = 0;
+        while (std::getline(sin, mode, ',')) {
+            RenderPanel p;
+            p.type = PanelType::xy;
+            p.mode = mode;
+            auto getItem = [&](const std::vector<PS::F64>& _list, const PS::F64 _default) {
+                if ((PS::S32)_list.size()>imain) return _list[imain];
+                return _default;
+            };
+            PS::F64 boxsize = getItem(boxsize_list, 2.0);
+            p.x_min = getItem(x_min_list, -boxsize);
+            p.x_max = getItem(x_max_list,  boxsize);
+            p.y_min = getItem(y_min_list, -boxsize);
+            p.y_max = getItem(y_max_list,  boxsize);
+            p.cm_boxsize = getItem(cm_boxsize_list, boxsize);
+            assert(p.x_max>p.x_min&&p.y_max>p.y_min);
+            panels.push_back(p);
+            imain++;
+        }
+        if (plot_hr_flag) {
+            RenderPanel p;
+            p.type = PanelType::hr;
+            panels.push_back(p);
+        }
+    }
+    const PS::S32 n_panel = panels.size();
+
+    // figure layout, same as initFig in tools/movie.py
+    PS::S32 nrow = 1;
+    if (n_model>1) {
+        ncol = n_panel;
+        nrow = n_model;
+        if (compare_in_column) {
+            nrow = ncol;
+            ncol = n_model;
+        }
+    }
+    else if (ncol<0) ncol = n_panel;
+    else {
+        nrow = n_panel/ncol;
+        if (nrow*ncol<n_panel) nrow++;
+    }
+    // grid position of panel k of model i
+    auto getPanelPosition = [&](const PS::S32 _i, const PS::S32 _k, PS::S32& _row, PS::S32& _col) {
+        if (n_model>1) {
+            if (compare_in_column) {
+                _row = _k;
+                _col = _i;
+            }
+            else {
+                _row = _i;
+                _col = _k;
+            }
+        }
+        else {
+            _row = _k/ncol;
+            _col = _k%ncol;
+        }
+    };
+    par.panel_nx = (PS::S32)(frame_xsize*dpi);
+    par.panel_ny = (PS::S32)(frame_ysize*dpi);
+    if (par.font_scale==0) par.font_scale = std::max(1, dpi/50);
+
+    // core data
+    std::vector<std::vector<CoreRecord>> core(n_model);
+    if (par.cm_mode=="core")
+        for (PS::S32 i=0; i<n_model; i++) core[i] = readCoreFile(model_list[i].first+"/"+core_file);
+
+    // mass range of the color map from the first snapshot
+    if (par.color_mode=="mass" && (par.mass_min<=0.0||par.mass_max<=0.0)) {
+        RenderSnapshot snap;
+        snap.read(model_list[0].first+"/"+path_list[0], par.binary_flag);
+        PS::F64 mmin = PS::LARGE_FLOAT, mmax = 0.0;
+        for (auto& p: snap.ptcl) {
+            if (p.mass<=0.0) continue;
+            mmin = std::min(mmin, p.mass);
+            mmax = std::max(mmax, p.mass);
+        }
+        if (par.mass_min<=0.0) par.mass_min = mmin;
+        if (par.mass_max<=0.0) par.mass_max = mmax;
+        if (par.mass_max<=par.mass_min) par.mass_max = 2.0*par.mass_min;
+        if(print_flag) std::cout<<"Mass range of the color map: "<<par.mass_min<<" "<<par.mass_max<<std::endl;
+    }
+
+    // frames are rendered in parallel when there are enough frames, otherwise the particles of each panel are splatted in parallel
+    PS::S32 n_thread = 1;
+#ifdef _OPENMP
+    n_thread = omp_get_max_threads();
+#endif
+    const bool frame_parallel = (n_frame>=n_thread);
+    if(print_flag) std::cout<<"Render "<<n_frame<<" frames of "<<n_model<<" models and "<<n_panel<<" panels ("<<ncol*par.panel_nx<<"x"<<nrow*par.panel_ny<<" pixels) with "<<n_thread<<" threads"<<std::endl;
+
+#pragma omp parallel for schedule(dynamic) if(frame_parallel)
+    for (PS::S32 k=0; k<n_frame; k++) {
+        const std::string& file_path = path_list[k];
+        const std::string fname_png = file_path + ".png";
+        if (use_previous) {
+            FILE* ftest = fopen(fname_png.c_str(), "r");
+            if (ftest!=NULL) {
+                fclose(ftest);
+#pragma omp critical (render_print)
+                std::cout<<"find existing "<<file_path<<std::endl;
+                continue;
+            }
+        }
+        RenderImage image;
+        image.resize(ncol*par.panel_nx, nrow*par.panel_ny);
+        RenderSnapshot snap;
+        for (PS::S32 i=0; i<n_model; i++) {
+            snap.read(model_list[i].first+"/"+file_path, par.binary_flag);
+            const CoreRecord* core_i = NULL;
+            if (par.cm_mode=="core") {
+                core_i = findCore(core[i], snap.time);
+                if (core_i==NULL) {
+#pragma omp critical (render_print)
+                    std::cerr<<"Warning: no core data found at time "<<snap.time<<" in "<<model_list[i].first+"/"+core_file<<", the snapshot origin is used"<<std::endl;
+                }
+            }
+            for (PS::S32 ip=0; ip<n_panel; ip++) {
+                PS::S32 row, col;
+                getPanelPosition(i, ip, row, col);
+                // the title of the time is on the first panel of each model
+                std::string title;
+                if (ip==0) {
+                    title = "T = " + formatNumber(snap.time);
+                    if (par.unit_time!="") title += " " + par.unit_time;
+                    if (model_list[i].second!="") title = model_list[i].second + ": " + title;
+                }
+                renderPanel(image, col*par.panel_nx, row*par.panel_ny, panels[ip], snap, core_i, title, par, !frame_parallel);
+            }
+        }
+        image.writePNG(fname_png);
+#pragma omp critical (render_print)
+        std::cout<<"processing "<<file_path<<std::endl;
+    }
+
+    // frame list for ffmpeg concat demuxer
+    std::string fname_concat = output_file + ".ffconcat";
+    std::ofstream fout(fname_concat);
+    if (!fout.is_open()) {
+        std::cerr<<"Error: Cannot open file "<<fname_concat<<"!\n";
+        abort();
+    }
+    fout<<"ffconcat version 1.0\n";
+    for (auto& file_path: path_list)
+        fout<<"file '"<<file_path<<".png'\nduration "<<1.0/fps<<"\n";
+    fout.close();
+    if(print_flag) std::cout<<"Frame list for ffmpeg: "<<fname_concat<<std::endl;
+
+    return 0;
+}
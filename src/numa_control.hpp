@@ -0,0 +1,156 @@
+#pragma once
+#ifdef __linux__
+#include<sched.h>
+#include<unistd.h>
+#include<sys/syscall.h>
+#endif
+#include<cstdint>
+#include<cstdlib>
+#include<algorithm>
+#include<vector>
+#include<iostream>
+#include<iomanip>
+#include<particle_simulator.hpp>
+
+#ifndef MPOL_MF_MOVE
+#define MPOL_MF_MOVE (1<<1)
+#endif
+
+//! NUMA-aware thread pinning and page placement (Linux only)
+/*! The pages of an array are moved to the NUMA node of the OpenMP thread that processes them in the default static partition,
+    which is equivalent to a parallel first-touch initialization of the array.
+    The system calls move_pages and getcpu are used directly, thus libnuma is not required.
+    On other systems, the functions do nothing.
+    PeTar only places the local particle array (system_soft) in this way. The tree buffers allocated inside FDPS
+    and the arrays of SystemHard (processed per cluster with a dynamic schedule) are not moved.
+ */
+class NumaControl{
+private:
+    const void* ptr_last_; // array pointer at the last placement
+    PS::S64 n_last_;       // array size at the last placement
+
+public:
+    PS::S64 n_page_moved; ///> number of pages moved in the last placement
+
+    NumaControl(): ptr_last_(NULL), n_last_(0), n_page_moved(0) {}
+
+    //! get the cpu and the NUMA node of the calling thread
+    /*! @param[out] _cpu: cpu index, -1 if not available
+        @param[out] _node: NUMA node index, -1 if not available
+     */
+    static void getCpuNode(int& _cpu, int& _node) {
+        _cpu = -1;
+        _node = -1;
+#if defined(__linux__) && defined(SYS_getcpu)
+        unsigned int cpu, node;
+        if (syscall(SYS_getcpu, &cpu, &node, NULL)==0) {
+            _cpu = cpu;
+            _node = node;
+        }
+#endif
+    }
+
+    //! pin each OpenMP thread to one cpu of the affinity mask of the process
+    /*! The threads are placed compactly (thread i on the i-th available cpu), so that the static partition of arrays follows the NUMA nodes.
+        If there are fewer cpus than threads, the cpus are reused cyclically.
+        \return true if all threads are pinned successfully
+     */
+    static bool pinThreads() {
+#ifdef __linux__
+        cpu_set_t mask;
+        if (sched_getaffinity(0, sizeof(mask), &mask)!=0) return false;
+        std::vector<int> cpus;
+        for (int i=0; i<CPU_SETSIZE; i++)
+            if (CPU_ISSET(i, &mask)) cpus.push_back(i);
+        if (cpus.size()==0) return false;
+
+        bool success = true;
+#pragma omp parallel reduction(&&:success)
+        {
+            const PS::S32 ith = PS::Comm::getThreadNum();
+            cpu_set_t mask_thread;
+            CPU_ZERO(&mask_thread);
+            CPU_SET(cpus[ith%cpus.size()], &mask_thread);
+            success = (sched_setaffinity(0, sizeof(mask_thread), &mask_thread)==0);
+        }
+        return success;
+#else
+        return false;
+#endif
+    }
+
+    //! print the cpu and the NUMA node of each OpenMP thread
+    static void printThreadBinding(std::ostream& _fout) {
+        const PS::S32 n_thread = PS::Comm::getNumberOfThread();
+        std::vector<int> cpu(n_thread), node(n_thread);
+#pragma omp parallel
+        {
+            const PS::S32 ith = PS::Comm::getThreadNum();
+            getCpuNode(cpu[ith], node[ith]);
+        }
+        _fout<<"Thread binding (thread: cpu/NUMA node):";
+        for (PS::S32 i=0; i<n_thread; i++) _fout<<" "<<i<<": "<<cpu[i]<<"/"<<node[i];
+        _fout<<std::endl;
+    }
+
+    //! move the pages of one array to the NUMA node of the thread using it in the static OpenMP partition
+    /*! The partition is the same as "omp for" with schedule(static) without chunk size.
+        Only pages fully inside the range of one thread are moved, pages already on the local node are skipped.
+        @param[in] _ptr: array pointer
+        @param[in] _n: array size
+     */
+    template<class T>
+    void placeArray(const T* _ptr, const PS::S64 _n) {
+        ptr_last_ = _ptr;
+        n_last_ = _n;
+        n_page_moved = 0;
+#if defined(__linux__) && defined(SYS_move_pages) && defined(SYS_getcpu)
+        if (_n<=0) return;
+        const uintptr_t page_size = sysconf(_SC_PAGESIZE);
+        PS::S64 n_moved = 0;
+#pragma omp parallel reduction(+:n_moved)
+        {
+            const PS::S64 n_thread = PS::Comm::getNumberOfThread();
+            const PS::S64 ith = PS::Comm::getThreadNum();
+            const PS::S64 n_chunk = _n/n_thread;
+            const PS::S64 n_rem = _n%n_thread;
+            const PS::S64 i_start = ith*n_chunk + std::min(ith, n_rem);
+            const PS::S64 i_end = i_start + n_chunk + (ith<n_rem?1:0);
+            const uintptr_t adr_start = ((uintptr_t)(_ptr+i_start) + page_size - 1)/page_size*page_size;
+            const uintptr_t adr_end = (uintptr_t)(_ptr+i_end)/page_size*page_size;
+            int cpu, node;
+            getCpuNode(cpu, node);
+            if (adr_end>adr_start && node>=0) {
+                const long n_page = (adr_end-adr_start)/page_size;
+                std::vector<void*> pages(n_page);
+                std::vector<int> status(n_page);
+                for (long k=0; k<n_page; k++) pages[k] = (void*)(adr_start + k*page_size);
+
+                // query the current nodes and collect the remote pages
+                if (syscall(SYS_move_pages, 0, n_page, pages.data(), NULL, status.data(), 0)==0) {
+                    long n_remote = 0;
+                    for (long k=0; k<n_page; k++)
+                        if (status[k]>=0 && status[k]!=node) pages[n_remote++] = pages[k];
+                    if (n_remote>0) {
+                        std::vector<int> nodes(n_remote, node);
+                        if (syscall(SYS_move_pages, 0, n_remote, pages.data(), nodes.data(), status.data(), MPOL_MF_MOVE)>=0) {
+                            for (long k=0; k<n_remote; k++) if (status[k]==node) n_moved++;
+                        }
+                    }
+                }
+            }
+        }
+        n_page_moved = n_moved;
+#endif
+    }
+
+    //! move the pages of one array if the pointer is changed or the size is changed by more than 10% after the last placement
+    /*! \return true if the placement is done
+     */
+    template<class T>
+    bool placeArrayIfChanged(const T* _ptr, const PS::S64 _n) {
+        if (_ptr==ptr_last_ && std::abs(_n-n_last_)*10<=n_last_) return false;
+        placeArray(_ptr, _n);
+        return true;
+    }
+};
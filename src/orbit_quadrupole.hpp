@@ -0,0 +1,89 @@
+#pragma once
+#include "Common/binary_tree.h"
+#include <iostream>
+
+//! Orbit-averaged quadrupole method for counter force from binaries
+/*! No orbital particle is created, the group c.m. particle carries the total mass.
+    The orbit-averaged second moment of the members relative to the c.m. is calculated analytically from the binary tree
+    and is stored in the c.m. entry of the soft tree (FPSoft::quad and EPJSoft::quad).
+    The soft force kernels add the quadrupole term for the c.m. entry beyond r_out.
+ */
+class OrbitalQuadrupoleManager{
+public:
+    //! check paramters
+    bool checkParams() {
+        return true;
+    }
+
+    //! create sample particles, nothing is needed
+    template <class Tptcl>
+    void createSampleParticles(Tptcl* _ptcl_artificial,
+                               COMM::BinaryTree<Tptcl,COMM::Binary> &_bin) {
+    }
+
+    //! calculate the orbit-averaged second moment of one binary and its sub-systems
+    /*! In the orbital frame (x: periapsis direction, z: angular momentum), the time-averaged second moment of the relative position is
+        <x^2> = a^2 (1+4e^2)/2, <y^2> = a^2 (1-e^2)/2, others are zero.
+        The mass-weighted moment relative to the c.m. is the reduced mass times it.
+        The moments of the sub-systems are added since their c.m. follow the outer orbit.
+        @param[in,out] _quad: second moment to be accumulated (xx, yy, zz, xy, xz, yz)
+        @param[in] _bin: binary tree node
+     */
+    template <class Tptcl>
+    static void calcQuadrupoleIter(PS::F64mat& _quad, COMM::BinaryTree<Tptcl,COMM::Binary> &_bin) {
+#ifdef ARTIFICIAL_PARTICLE_DEBUG
+        assert(_bin.semi>0.0 && _bin.ecc<1.0);
+#endif
+        const PS::F64 mu_a2 = _bin.m1*_bin.m2/_bin.mass*_bin.semi*_bin.semi;
+        const PS::F64 ecc2 = _bin.ecc*_bin.ecc;
+        const PS::F64 qx = 0.5*mu_a2*(1.0+4.0*ecc2);
+        const PS::F64 qy = 0.5*mu_a2*(1.0-ecc2);
+
+        PS::F64vec ex(1.0, 0.0, 0.0), ey(0.0, 1.0, 0.0);
+        _bin.rotateToOriginalFrame(&(ex.x));
+        _bin.rotateToOriginalFrame(&(ey.x));
+
+        _quad.xx += qx*ex.x*ex.x + qy*ey.x*ey.x;
+        _quad.yy += qx*ex.y*ex.y + qy*ey.y*ey.y;
+        _quad.zz += qx*ex.z*ex.z + qy*ey.z*ey.z;
+        _quad.xy += qx*ex.x*ex.y + qy*ey.x*ey.y;
+        _quad.xz += qx*ex.x*ex.z + qy*ey.x*ey.z;
+        _quad.yz += qx*ex.y*ex.z + qy*ey.y*ey.z;
+
+        for (int k=0; k<2; k++) {
+            if (_bin.isMemberTree(k)) calcQuadrupoleIter(_quad, *_bin.getMemberAsTree(k));
+        }
+    }
+
+    //! calculate the orbit-averaged second moment of a group
+    /*! @param[in] _bin: root of the binary tree of the group
+        \return second moment relative to the c.m. (xx, yy, zz, xy, xz, yz)
+     */
+    template <class Tptcl>
+    static PS::F64mat calcQuadrupole(COMM::BinaryTree<Tptcl,COMM::Binary> &_bin) {
+        PS::F64mat quad(0.0);
+        calcQuadrupoleIter(quad, _bin);
+        return quad;
+    }
+
+    //! get particle number
+    static PS::S32 getParticleN() {
+        return 0;
+    }
+
+    //! write class data to file with binary format
+    /*! @param[in] _fp: FILE type file for output
+     */
+    void writeBinary(FILE *_fp) {
+    }
+
+    //! read class data to file with binary format
+    /*! @param[in] _fp: FILE type file for reading
+     */
+    void readBinary(FILE *_fin) {
+    }
+
+    //! print parameters
+    void print(std::ostream & _fout) const{
+    }
+};
@@ -0,0 +1,203 @@
+#pragma once
+#include<cstdio>
+#include<cstdlib>
+#include<cassert>
+#include<vector>
+#include<algorithm>
+#include<string>
+#include<iostream>
+#include<particle_simulator.hpp>
+
+//! high-cadence output of tracked particles
+/*! Only the particles with ids in the tracked list are written, to a binary record stream per MPI process: [prefix].track.[rank].
+    Each block of the stream is one output time: a header (TrackHeader) followed by the particle records (TrackRecord) sorted by id.
+    An ASCII index file [prefix].track.idx.[rank] contains one line per block: time, tree step count, byte offset of the block and number of records.
+    The tracked ids are kept as a sorted list in all processes, each tracked id is looked up in the id-address map of local particles with OpenMP,
+    thus the cost is O(M log N) for M tracked ids and N local particles, and no global communication is needed.
+ */
+class ParticleTrack{
+public:
+    //! header of one output block
+    struct TrackHeader{
+        PS::F64 time;    ///> time
+        PS::S64 n_loop;  ///> tree step count
+        PS::S64 n;       ///> number of records in the block
+    };
+
+    //! one particle record
+    struct TrackRecord{
+        PS::S64 id;      ///> particle id
+        PS::S64 id_cm;   ///> id of the c.m. artificial particle of the group (binary, triple...) if the particle is a group member, otherwise 0
+        PS::F64 mass;    ///> mass (the original mass for group members)
+        PS::F64 pos[3];  ///> position
+        PS::F64 vel[3];  ///> velocity synchronized with the position
+    };
+
+private:
+    std::vector<PS::S64> id_list_;                   // sorted tracked ids
+    std::vector<std::vector<TrackRecord>> record_thx_; // record buffer of each thread
+    std::vector<TrackRecord> record_;                // records of one block
+    FILE* fout_;      // record stream
+    FILE* fidx_;      // index file
+    PS::S64 offset_;  // byte offset of the next block
+    PS::F64 time_last_; // time of the last block
+
+public:
+    ParticleTrack(): id_list_(), record_thx_(), record_(), fout_(NULL), fidx_(NULL), offset_(0), time_last_(-PS::LARGE_FLOAT) {}
+
+    ~ParticleTrack() {
+        closeFiles();
+    }
+
+    //! read tracked ids from an ASCII file (ids separated by spaces or new lines)
+    /*! The existing list is replaced
+      @param[in] _fname: file name
+     */
+    void readIdList(const std::string& _fname) {
+        FILE* fin = fopen(_fname.c_str(), "r");
+        if (fin==NULL) {
+            std::cerr<<"Error: cannot open the tracked id list file "<<_fname<<std::endl;
+            abort();
+        }
+        id_list_.clear();
+        long long int id;
+        while (fscanf(fin, "%lld", &id)==1) id_list_.push_back(id);
+        fclose(fin);
+        std::sort(id_list_.begin(), id_list_.end());
+        id_list_.erase(std::unique(id_list_.begin(), id_list_.end()), id_list_.end());
+    }
+
+    //! add one tracked id
+    void addId(const PS::S64 _id) {
+        auto it = std::lower_bound(id_list_.begin(), id_list_.end(), _id);
+        if (it==id_list_.end()||*it!=_id) id_list_.insert(it, _id);
+    }
+
+    //! remove one tracked id
+    /*! \return true if the id is found and removed
+     */
+    bool removeId(const PS::S64 _id) {
+        auto it = std::lower_bound(id_list_.begin(), id_list_.end(), _id);
+        if (it==id_list_.end()||*it!=_id) return false;
+        id_list_.erase(it);
+        return true;
+    }
+
+    //! clear the tracked id list
+    void clearIdList() {
+        id_list_.clear();
+    }
+
+    //! get number of tracked ids
+    PS::S64 getIdN() const {
+        return id_list_.size();
+    }
+
+    //! whether the output files are opened
+    bool isOpen() const {
+        return fout_!=NULL;
+    }
+
+    //! open the record stream and the index file
+    /*! @param[in] _prefix: prefix of filenames
+        @param[in] _rank: MPI rank
+        @param[in] _append: if true, append to existing files
+     */
+    void openFiles(const std::string& _prefix, const PS::S32 _rank, const bool _append) {
+        closeFiles();
+        std::string rank_str = std::to_string(_rank);
+        std::string fname_out = _prefix + ".track." + rank_str;
+        std::string fname_idx = _prefix + ".track.idx." + rank_str;
+        fout_ = fopen(fname_out.c_str(), _append ? "ab" : "wb");
+        fidx_ = fopen(fname_idx.c_str(), _append ? "a" : "w");
+        if (fout_==NULL||fidx_==NULL) {
+            std::cerr<<"Error: cannot open the tracked particle files "<<fname_out<<" and "<<fname_idx<<std::endl;
+            abort();
+        }
+        fseek(fout_, 0, SEEK_END);
+        offset_ = ftell(fout_);
+        time_last_ = -PS::LARGE_FLOAT;
+    }
+
+    //! close files
+    void closeFiles() {
+        if (fout_!=NULL) {
+            fclose(fout_);
+            fout_ = NULL;
+        }
+        if (fidx_!=NULL) {
+            fclose(fidx_);
+            fidx_ = NULL;
+        }
+    }
+
+    //! find local tracked particles and write one block
+    /*! The velocity of a particle is synchronized with the position by the closing part of the current kick:
+        vel + acc * _dt_close, where the c.m. acceleration is used for group members (same as the kick).
+        A block with the same time as the last one is skipped (e.g. when the integration restarts after an interruption).
+      @param[in] _sys: particle system
+      @param[in] _id_adr_map: map from id to address of local real particles
+      @param[in] _n_loc: number of local real particles
+      @param[in] _time: current time
+      @param[in] _n_loop: tree step count
+      @param[in] _dt_close: closing kick step of the current kick
+     */
+    template <class Tsys, class Tmap>
+    void write(Tsys& _sys, const Tmap& _id_adr_map, const PS::S64 _n_loc, const PS::F64 _time, const PS::S64 _n_loop, const PS::F64 _dt_close) {
+        assert(fout_!=NULL);
+        if (_time==time_last_) return;
+        time_last_ = _time;
+
+        const PS::S32 n_thread = PS::Comm::getNumberOfThread();
+        if ((PS::S32)record_thx_.size()!=n_thread) record_thx_.resize(n_thread);
+        const PS::S64 n_id = id_list_.size();
+#pragma omp parallel
+        {
+            const PS::S32 ith = PS::Comm::getThreadNum();
+            auto& record_loc = record_thx_[ith];
+            record_loc.clear();
+            // static schedule: the per-thread records are joined in thread order, thus the records are sorted by id as id_list_
+#pragma omp for schedule(static)
+            for (PS::S64 k=0; k<n_id; k++) {
+                auto item = _id_adr_map.find(id_list_[k]);
+                // not a local particle
+                if (item==_id_adr_map.end()) continue;
+                const PS::S64 i = item->second;
+                assert(i<_n_loc);
+                auto& pi = _sys[i];
+                assert(pi.id==id_list_[k]);
+                TrackRecord rec;
+                rec.id = pi.id;
+                rec.id_cm = 0;
+                rec.mass = pi.mass;
+                PS::F64vec acc = pi.acc;
+                if (pi.group_data.artificial.isMember()) {
+                    rec.mass = pi.group_data.artificial.getMassBackup();
+                    const PS::S64 cm_adr = pi.getParticleCMAddress();
+                    if (cm_adr>0) {
+                        rec.id_cm = _sys[cm_adr].id;
+                        acc = _sys[cm_adr].acc;
+                    }
+                }
+                PS::F64vec vel = pi.vel + acc*_dt_close;
+                for (int k=0; k<3; k++) {
+                    rec.pos[k] = pi.pos[k];
+                    rec.vel[k] = vel[k];
+                }
+                record_loc.push_back(rec);
+            }
+        }
+
+        record_.clear();
+        for (PS::S32 i=0; i<n_thread; i++) record_.insert(record_.end(), record_thx_[i].begin(), record_thx_[i].end());
+
+        TrackHeader header;
+        header.time = _time;
+        header.n_loop = _n_loop;
+        header.n = record_.size();
+        fwrite(&header, sizeof(TrackHeader), 1, fout_);
+        if (header.n>0) fwrite(record_.data(), sizeof(TrackRecord), header.n, fout_);
+        fprintf(fidx_, "%.17g %lld %lld %lld\n", _time, (long long int)_n_loop, (long long int)offset_, (long long int)header.n);
+        offset_ += sizeof(TrackHeader) + header.n*sizeof(TrackRecord);
+    }
+};
@@ -26,6 +26,7 @@
 #include<sstream>
 //#include<unistd.h>
 #include<getopt.h>
+#include<new>
 
 #ifdef MPI_DEBUG
 #include <mpi.h>
@@ -63,12 +64,17 @@ int MPI_Irecv(void* buffer, int count, MPI_Datatype datatype, int dest, int tag,
 #include"hard_assert.hpp"
 #include"soft_ptcl.hpp"
 #include"soft_force.hpp"
+#include"soft_force_direct.hpp"
 #ifdef USE_GPU
 #include"force_gpu_cuda.hpp"
 #endif
 #ifdef USE_FUGAKU
 #include "force_fugaku.hpp"
 #endif
+#ifdef USE_AARCH64
+#include "force_aarch64.hpp"
+#endif
+#include"force_cpu_multiwalk.hpp"
 #include"energy.hpp"
 #include"hard.hpp"
 #include"io.hpp"
@@ -80,8 +86,13 @@ int MPI_Irecv(void* buffer, int count, MPI_Datatype datatype, int dest, int tag,
 #ifdef PROFILE
 #include"profile.hpp"
 #endif
+#include"memory_usage.hpp"
+#include"numa_control.hpp"
+#include"fixed_order_sum.hpp"
 #include"static_variables.hpp"
 #include"escaper.hpp"
+#include"particle_track.hpp"
+#include"group_catalog.hpp"
 #ifdef GALPY
 #include"galpy_interface.h"
 #endif
@@ -97,6 +108,30 @@ public:
     IOParams<PS::S64> n_group_limit;
     IOParams<PS::S64> n_interrupt_limit;
     IOParams<PS::S64> n_smp_ave;
+    IOParams<PS::S64> soft_force_mode;
+    IOParams<PS::S64> n_direct_max;
+    IOParams<PS::S64> tree_level_max;
+    IOParams<PS::F64> tree_level_eta;
+    IOParams<PS::F64> changeover_adapt_min;
+    IOParams<PS::F64> changeover_adapt_max;
+    IOParams<PS::F64> changeover_adapt_nb;
+    IOParams<PS::S64> changeover_adapt_interval;
+    IOParams<PS::F64> tree_tune_interval;
+    IOParams<PS::F64> tree_tune_theta_err;
+    IOParams<PS::S64> memory_report;
+    IOParams<PS::S64> numa_mode;
+    IOParams<PS::S64> morton_sort_interval;
+    IOParams<PS::S64> reproducible;
+    IOParams<PS::S64> interrupt_park;
+    IOParams<PS::S64> track_interval;
+    IOParams<PS::S64> group_catalog;
+    IOParams<PS::S64> nb_group_cm;
+    IOParams<PS::S64> hard_warm_start;
+    IOParams<PS::S64> cpu_multi_walk;
+    IOParams<PS::F64> hard_error_budget;
+    IOParams<PS::F64> hard_error_budget_range;
+    IOParams<PS::S64> cluster_stat;
+    IOParams<PS::S64> hermite_pair_cutoff;
 #ifdef ORBIT_SAMPLING
     IOParams<PS::S64> n_split;
 #endif
@@ -142,6 +177,8 @@ public:
     IOParams<std::string> fname_snp;
     IOParams<std::string> fname_par;
     IOParams<std::string> fname_inp;
+    IOParams<std::string> fname_ensemble;
+    IOParams<std::string> fname_track;
 
     // flag
     bool print_flag; 
@@ -159,6 +196,30 @@ public:
 #endif
                      n_interrupt_limit(input_par_store, 128,  "number-interrupt-limit", "Interrupted hard integrator limit"),
                      n_smp_ave        (input_par_store, 100,  "number-sample-average", "Average target number of sample particles per process"),
+                     soft_force_mode  (input_par_store, 0,    "soft-force-mode", "Soft force backend: 0: particle-tree; 1: direct summation; 2: auto, choose the faster one by measuring both (force and neighbor lists) at the initial step if the total particle number <= direct-n-max"),
+                     n_direct_max     (input_par_store, 20000,"direct-n-max", "Maximum total particle number (including artificial particles) to try direct summation soft force in the auto mode"),
+                     tree_level_max   (input_par_store, 0,    "tree-level-max", "Hierarchical tree step (needs configure --enable-tree-level-step): single particles without neighbors use the block step dt_soft*2^level with level <= this value; the soft force of a particle is only calculated at the beginning of its block; 0: all particles share dt_soft"),
+                     tree_level_eta   (input_par_store, 0.1,  "tree-level-eta", "Hierarchical tree step: the block step of a single particle satisfies step < eta*|acc|/|jerk|, where the jerk is estimated from the soft accelerations at the beginning and the end of the last block"),
+                     changeover_adapt_min(input_par_store, 1.0, "changeover-adapt-min", "Adaptive changeover: minimum factor to rescale the mass-scaled changeover radii by the local density; the adaptive mode is switched on if this value < 1 or changeover-adapt-max > 1"),
+                     changeover_adapt_max(input_par_store, 1.0, "changeover-adapt-max", "Adaptive changeover: maximum factor to rescale the mass-scaled changeover radii by the local density"),
+                     changeover_adapt_nb (input_par_store, 0.0, "changeover-adapt-nb", "Adaptive changeover: target neighbor number inside r_out, estimated from the neighbor number inside r_search; 0: use the average of all particles at the first rescaling"),
+                     changeover_adapt_interval(input_par_store, 8, "changeover-adapt-interval", "Adaptive changeover: number of tree steps between two rescalings"),
+                     tree_tune_interval (input_par_store, -1.0, "tree-tune-interval", "Tune number-leaf-limit and number-group-limit (and T if tree-tune-theta-err > 0) by measuring the soft tree force: <0: off; 0: only at the initial step; >0: also repeat with this time interval"),
+                     tree_tune_theta_err(input_par_store, 0.0, "tree-tune-theta-err", "Maximum RMS relative error of soft accelerations (compared with the direct summation on sample particles) when tuning T; 0: T is not tuned"),
+                     memory_report    (input_par_store, 0,    "memory-report", "Print a breakdown table of the current and peak memory usage of subsystems (summed and maximized over MPI processes) at exit: 0: off; 1: on"),
+                     numa_mode        (input_par_store, 0,    "numa-mode", "NUMA-aware mode (Linux): 0: off; 1: after particle exchanges, move the memory pages of local particles to the NUMA node of the OpenMP thread processing them (static partition), tree and hard integration buffers are not moved; 2: also pin OpenMP threads to cpus compactly at startup"),
+                     morton_sort_interval(input_par_store, 0, "morton-sort-interval", "Sort local particles in Morton order of positions after the particle exchange once per this number of tree steps to improve the memory locality; 0: off"),
+                     reproducible     (input_par_store, 0,    "reproducible", "Bitwise-reproducible results independent of the OpenMP thread number (for the same MPI process number): 0: off; 1: on, the artificial particles and interrupted clusters are ordered by clusters and the auto soft force mode uses the tree without timing; tree-tune-interval must be off"),
+                     interrupt_park   (input_par_store, 0,    "interrupt-park", "Handling of interrupted hard clusters (detect-interrupt 2): 0: stop the drift of all clusters in all MPI processes when any cluster is interrupted; 1: park interrupted clusters, write back the other clusters and resolve the parked ones inside each process (by the interrupt handler if set), no global reduction is needed; 2: park interrupted isolated clusters and return them to the caller (e.g. AMUSE) with one global reduction at the end of the drift, interrupted connected clusters are resolved inside the drift"),
+                     track_interval   (input_par_store, 1,    "track-interval", "Write the tracked particles (track-list) once per this number of tree steps"),
+                     nb_group_cm      (input_par_store, 0,    "nb-group-cm", "Neighbor searching with stable groups represented by one member (needs configure --enable-nb-group-cm): 0: off, all particles are in the neighbor tree; 1: on, each stable group (bound, apocenter inside the group radius and stable inner sub-systems) in isolated clusters at the end of the last drift is represented by its member with the minimum id with the search radius enlarged by the global maximum search radius, the neighbors are checked with the original radii of all members and the other members are added to the same cluster, thus clusters are the same as those of mode 0"),
+                     group_catalog    (input_par_store, 0,    "group-catalog", "Write the catalog of binaries and multiple systems (hierarchical orbits, stability and slowdown factors) in the hard integrators at each output time to [prefix].catalog.[MPI rank] (needs w>0): 0: off; 1: on"),
+                     hard_warm_start  (input_par_store, 0,    "hard-warm-start", "Warm start of hard clusters: 0: off; 1: on, for a cluster with the same members as in the last tree step, reuse the last Hermite block steps of singles and group c.m. (reduced if the new acceleration timescale is shorter) and the AR step sizes of groups with unchanged orbits and slowdown factors"),
+                     cpu_multi_walk   (input_par_store, 0,    "cpu-multi-walk", "CPU multi-walk mode of the tree soft force (x86 SIMD builds without GPU and tidal-tensor tree): 0: off; >0: number of particle-tree groups (walks) per kernel dispatch, j particles of all walks are shared in one buffer and indexed as in the GPU multi-walk mode, walks are distributed to OpenMP threads and groups with fewer active particles than the SIMD width use a j-parallel kernel"),
+                     hard_error_budget(input_par_store, 0.0, "hard-error-budget", "Per-cluster error budget of hard integration (needs HARD_CHECK_ENERGY): <=0: off, all clusters use the same hermite-eta and AR step sizes; >0: relative energy error of the system allowed per tree step, the budget of the system (this value times |E_sys|) is distributed to clusters in proportion to their slowdown energies |E_SD| (the sum is over all clusters of the tree step), clusters with the same members as in the last tree step have their Hermite eta scaled by f^(1/2) and AR step sizes by f^(1/6), where the factor f is tightened or relaxed by the ratio of the last energy error to the budget"),
+                     hard_error_budget_range(input_par_store, 10.0, "hard-error-budget-range", "Range of the tolerance factor f of hard-error-budget: [1/value, value]"),
+                     cluster_stat     (input_par_store, 0,    "cluster-stat", "Print the cluster size distribution, the neighbor number and the changeover radii at each output: 0: only with the adaptive changeover (changeover-adapt-min < 1 or changeover-adapt-max > 1); 1: always"),
+                     hermite_pair_cutoff(input_par_store, 1, "hermite-pair-cutoff", "Hermite pair force in hard clusters: 0: calculate the changeover functions of all pairs; 1: skip the changeover functions of pairs beyond the changeover outer radius (only the constant potential offset is added)"),
 #ifdef ORBIT_SAMPLING
                      n_split          (input_par_store, 4,    "number-split", "Number of binary sample points for tree perturbation force"),
 #endif
@@ -211,6 +272,8 @@ public:
                      fname_snp(input_par_store, "data", "f", "The prefix of filenames for output data: [prefix].**"),
                      fname_par(input_par_store, "input.par", "p", "Input parameter file (this option should be used first before any other options)"),
                      fname_inp(input_par_store, "__NONE__", "snap-filename", "Input data file", NULL, false),
+                     fname_ensemble(input_par_store, "__NONE__", "ensemble-list", "Ensemble mode (sequential batch): run independent simulations listed in this file one after another in the same process, each simulation uses all threads and MPI processes; each line: [input data filename (__Plummer for the internal generator)] [output prefix] [parameter file (optional)]; other options are shared by all simulations; the trees are initialized once, thus the tree options (theta, n-leaf-limit, n-group-limit) cannot be changed in the parameter files"),
+                     fname_track(input_par_store, "__NONE__", "track-list", "File of particle ids (ASCII) to track: the positions, velocities, masses and group memberships of these particles are written every track-interval tree steps to binary files [prefix].track.[MPI rank] with index files [prefix].track.idx.[MPI rank]"),
                      print_flag(false), update_changeover_flag(false), update_rsearch_flag(false) {}
 
     
@@ -257,6 +320,32 @@ public:
 #ifdef ADJUST_GROUP_PRINT
             {adjust_group_write_option.key,   required_argument, &petar_flag, 24},
 #endif            
+            {soft_force_mode.key,      required_argument, &petar_flag, 25},
+            {n_direct_max.key,         required_argument, &petar_flag, 26},
+            {fname_ensemble.key,       required_argument, &petar_flag, 27},
+            {tree_level_max.key,       required_argument, &petar_flag, 28},
+            {tree_level_eta.key,       required_argument, &petar_flag, 29},
+            {changeover_adapt_min.key, required_argument, &petar_flag, 30},
+            {changeover_adapt_max.key, required_argument, &petar_flag, 31},
+            {changeover_adapt_nb.key,  required_argument, &petar_flag, 32},
+            {changeover_adapt_interval.key, required_argument, &petar_flag, 33},
+            {tree_tune_interval.key,   required_argument, &petar_flag, 34},
+            {tree_tune_theta_err.key,  required_argument, &petar_flag, 35},
+            {memory_report.key,        required_argument, &petar_flag, 36},
+            {numa_mode.key,            required_argument, &petar_flag, 37},
+            {morton_sort_interval.key, required_argument, &petar_flag, 38},
+            {reproducible.key,         required_argument, &petar_flag, 39},
+            {interrupt_park.key,       required_argument, &petar_flag, 40},
+            {fname_track.key,          required_argument, &petar_flag, 41},
+            {track_interval.key,       required_argument, &petar_flag, 42},
+            {group_catalog.key,        required_argument, &petar_flag, 43},
+            {nb_group_cm.key,          required_argument, &petar_flag, 44},
+            {hard_warm_start.key,      required_argument, &petar_flag, 45},
+            {cpu_multi_walk.key,       required_argument, &petar_flag, 46},
+            {hard_error_budget.key,    required_argument, &petar_flag, 47},
+            {hard_error_budget_range.key, required_argument, &petar_flag, 48},
+            {cluster_stat.key,         required_argument, &petar_flag, 49},
+            {hermite_pair_cutoff.key,  required_argument, &petar_flag, 50},
             {"help",                  no_argument, 0, 'h'},        
             {0,0,0,0}
         };
@@ -421,6 +510,158 @@ public:
                     opt_used += 2;
                     break;
 #endif
+                case 25:
+                    soft_force_mode.value = atoi(optarg);
+                    if(print_flag) soft_force_mode.print(std::cout);
+                    opt_used += 2;
+                    assert(soft_force_mode.value>=0&&soft_force_mode.value<=2);
+                    break;
+                case 26:
+                    n_direct_max.value = atol(optarg);
+                    if(print_flag) n_direct_max.print(std::cout);
+                    opt_used += 2;
+                    assert(n_direct_max.value>=0);
+                    break;
+                case 27:
+                    fname_ensemble.value = optarg;
+                    if(print_flag) fname_ensemble.print(std::cout);
+                    opt_used += 2;
+                    break;
+                case 28:
+                    tree_level_max.value = atoi(optarg);
+                    if(print_flag) tree_level_max.print(std::cout);
+                    opt_used += 2;
+                    assert(tree_level_max.value>=0&&tree_level_max.value<=30);
+                    break;
+                case 29:
+                    tree_level_eta.value = atof(optarg);
+                    if(print_flag) tree_level_eta.print(std::cout);
+                    opt_used += 2;
+                    assert(tree_level_eta.value>0.0);
+                    break;
+                case 30:
+                    changeover_adapt_min.value = atof(optarg);
+                    if(print_flag) changeover_adapt_min.print(std::cout);
+                    opt_used += 2;
+                    assert(changeover_adapt_min.value>0.0&&changeover_adapt_min.value<=1.0);
+                    break;
+                case 31:
+                    changeover_adapt_max.value = atof(optarg);
+                    if(print_flag) changeover_adapt_max.print(std::cout);
+                    opt_used += 2;
+                    assert(changeover_adapt_max.value>=1.0);
+                    break;
+                case 32:
+                    changeover_adapt_nb.value = atof(optarg);
+                    if(print_flag) changeover_adapt_nb.print(std::cout);
+                    opt_used += 2;
+                    assert(changeover_adapt_nb.value>=0.0);
+                    break;
+                case 33:
+                    changeover_adapt_interval.value = atol(optarg);
+                    if(print_flag) changeover_adapt_interval.print(std::cout);
+                    opt_used += 2;
+                    assert(changeover_adapt_interval.value>0);
+                    break;
+                case 34:
+                    tree_tune_interval.value = atof(optarg);
+                    if(print_flag) tree_tune_interval.print(std::cout);
+                    opt_used += 2;
+                    break;
+                case 35:
+                    tree_tune_theta_err.value = atof(optarg);
+                    if(print_flag) tree_tune_theta_err.print(std::cout);
+                    opt_used += 2;
+                    assert(tree_tune_theta_err.value>=0.0);
+                    break;
+                case 36:
+                    memory_report.value = atoi(optarg);
+                    if(print_flag) memory_report.print(std::cout);
+                    opt_used += 2;
+                    assert(memory_report.value==0||memory_report.value==1);
+                    break;
+                case 37:
+                    numa_mode.value = atoi(optarg);
+                    if(print_flag) numa_mode.print(std::cout);
+                    opt_used += 2;
+                    assert(numa_mode.value>=0&&numa_mode.value<=2);
+                    break;
+                case 38:
+                    morton_sort_interval.value = atol(optarg);
+                    if(print_flag) morton_sort_interval.print(std::cout);
+                    opt_used += 2;
+                    assert(morton_sort_interval.value>=0);
+                    break;
+                case 39:
+                    reproducible.value = atoi(optarg);
+                    if(print_flag) reproducible.print(std::cout);
+                    opt_used += 2;
+                    assert(reproducible.value==0||reproducible.value==1);
+                    break;
+                case 40:
+                    interrupt_park.value = atoi(optarg);
+                    if(print_flag) interrupt_park.print(std::cout);
+                    opt_used += 2;
+                    assert(interrupt_park.value>=0&&interrupt_park.value<=2);
+                    break;
+                case 41:
+                    fname_track.value = optarg;
+                    if(print_flag) fname_track.print(std::cout);
+                    opt_used += 2;
+                    break;
+                case 42:
+                    track_interval.value = atol(optarg);
+                    if(print_flag) track_interval.print(std::cout);
+                    opt_used += 2;
+                    assert(track_interval.value>0);
+                    break;
+                case 43:
+                    group_catalog.value = atoi(optarg);
+                    if(print_flag) group_catalog.print(std::cout);
+                    opt_used += 2;
+                    assert(group_catalog.value==0||group_catalog.value==1);
+                    break;
+                case 44:
+                    nb_group_cm.value = atoi(optarg);
+                    if(print_flag) nb_group_cm.print(std::cout);
+                    opt_used += 2;
+                    assert(nb_group_cm.value==0||nb_group_cm.value==1);
+                    break;
+                case 45:
+                    hard_warm_start.value = atoi(optarg);
+                    if(print_flag) hard_warm_start.print(std::cout);
+                    opt_used += 2;
+                    assert(hard_warm_start.value==0||hard_warm_start.value==1);
+                    break;
+                case 46:
+                    cpu_multi_walk.value = atoi(optarg);
+                    if(print_flag) cpu_multi_walk.print(std::cout);
+                    opt_used += 2;
+                    assert(cpu_multi_walk.value>=0);
+                    break;
+                case 47:
+                    hard_error_budget.value = atof(optarg);
+                    if(print_flag) hard_error_budget.print(std::cout);
+                    opt_used += 2;
+                    break;
+                case 48:
+                    hard_error_budget_range.value = atof(optarg);
+                    if(print_flag) hard_error_budget_range.print(std::cout);
+                    opt_used += 2;
+                    assert(hard_error_budget_range.value>=1.0);
+                    break;
+                case 49:
+                    cluster_stat.value = atoi(optarg);
+                    if(print_flag) cluster_stat.print(std::cout);
+                    opt_used += 2;
+                    assert(cluster_stat.value==0||cluster_stat.value==1);
+                    break;
+                case 50:
+                    hermite_pair_cutoff.value = atoi(optarg);
+                    if(print_flag) hermite_pair_cutoff.print(std::cout);
+                    opt_used += 2;
+                    assert(hermite_pair_cutoff.value==0||hermite_pair_cutoff.value==1);
+                    break;
                 default:
                     break;
                 }
@@ -597,6 +838,61 @@ public:
         assert(n_interrupt_limit.value>0);
         assert(n_leaf_limit.value>0);
         assert(n_smp_ave.value>0.0);
+        assert(soft_force_mode.value>=0&&soft_force_mode.value<=2);
+        assert(n_direct_max.value>=0);
+        assert(tree_level_max.value>=0&&tree_level_max.value<=30);
+        assert(tree_level_eta.value>0.0);
+        assert(changeover_adapt_min.value>0.0&&changeover_adapt_min.value<=1.0);
+        assert(changeover_adapt_max.value>=1.0);
+        assert(changeover_adapt_nb.value>=0.0);
+        assert(changeover_adapt_interval.value>0);
+        assert(tree_tune_theta_err.value>=0.0);
+        assert(memory_report.value==0||memory_report.value==1);
+        assert(numa_mode.value>=0&&numa_mode.value<=2);
+        assert(morton_sort_interval.value>=0);
+        assert(reproducible.value==0||reproducible.value==1);
+        // the tree tuning depends on the timing
+        if (reproducible.value==1) assert(tree_tune_interval.value<0.0);
+        assert(interrupt_park.value>=0&&interrupt_park.value<=2);
+        assert(track_interval.value>0);
+        assert(group_catalog.value==0||group_catalog.value==1);
+        assert(nb_group_cm.value==0||nb_group_cm.value==1);
+        assert(hard_warm_start.value==0||hard_warm_start.value==1);
+        assert(cpu_multi_walk.value>=0);
+        assert(hard_error_budget_range.value>=1.0);
+        assert(cluster_stat.value==0||cluster_stat.value==1);
+        assert(hermite_pair_cutoff.value==0||hermite_pair_cutoff.value==1);
+#ifndef HARD_CHECK_ENERGY
+        if (hard_error_budget.value>0.0) {
+            std::cerr<<"Error: hard-error-budget needs the energy check of hard integration (HARD_CHECK_ENERGY)!"<<std::endl;
+            abort();
+        }
+#endif
+#ifndef TREE_LEVEL_STEP
+        if (tree_level_max.value>0) {
+            std::cerr<<"Error: tree-level-max > 0 needs the hierarchical tree step build (configure --enable-tree-level-step)!"<<std::endl;
+            abort();
+        }
+#endif
+#ifndef NB_GROUP_CM
+        if (nb_group_cm.value>0) {
+            std::cerr<<"Error: nb-group-cm needs the neighbor group c.m. build (configure --enable-nb-group-cm)!"<<std::endl;
+            abort();
+        }
+#endif
+#ifndef USE_CPU_MULTI_WALK
+        if (cpu_multi_walk.value>0) {
+            std::cerr<<"Error: cpu-multi-walk needs the x86 SIMD build without GPU and tidal-tensor tree!"<<std::endl;
+            abort();
+        }
+#endif
+#ifdef FIX_CHANGEOVER
+        assert(changeover_adapt_min.value==1.0&&changeover_adapt_max.value==1.0);
+#endif
+#if (defined KDKDK_2ND) || (defined KDKDK_4TH)
+        // the block kick assumes the second-order KDK coefficients
+        assert(tree_level_max.value==0);
+#endif
         assert(theta.value>=0.0);
         assert(eta.value>0.0);
         return true;
@@ -609,9 +905,9 @@ public:
 class PeTar {
 public:
 #ifdef USE_QUAD
-    typedef PS::TreeForForceLong<ForceSoft, EPISoft, EPJSoft>::QuadrupoleWithSymmetrySearch TreeForce; 
+    typedef PS::TreeForForceLong<ForceSoft, EPISoft, EPJSoftTree>::QuadrupoleWithSymmetrySearch TreeForce; 
 #else
-    typedef PS::TreeForForceLong<ForceSoft, EPISoft, EPJSoft>::MonopoleWithSymmetrySearch TreeForce;
+    typedef PS::TreeForForceLong<ForceSoft, EPISoft, EPJSoftTree>::MonopoleWithSymmetrySearch TreeForce;
 #endif
     typedef PS::ParticleSystem<FPSoft> SystemSoft;
 
@@ -647,12 +943,24 @@ public:
     Escaper escaper;
     std::ofstream fesc;
 
+    // tracked particle output
+    ParticleTrack particle_track;
+
+    // catalog of groups in the hard integrators
+    std::ofstream fcatalog;
+    std::vector<GroupCatalogEntry> group_catalog_list;
+
     // file system
     FileHeader file_header;
     SystemSoft system_soft;
 
     // particle index map
     std::map<PS::S64, PS::S32> id_adr_map;
+    bool id_adr_map_valid; // false if local particle addresses may have changed after the last reconstructIdAdrMap
+
+    // Morton order sorting of local particles
+    PS::ReallocatableArray<std::pair<PS::U64, PS::S32>> morton_key_list; // key and address
+    PS::ReallocatableArray<FPSoft> ptcl_sort_buf;                      // particle buffer for reordering
 
     // domain
     PS::S64 n_loop; // count for domain decomposition
@@ -662,10 +970,39 @@ public:
 
     // tree time step manager
     KickDriftStep dt_manager;
+    PS::S64 n_step_tree;   // number of dt_soft steps from time zero to the time of particles (counted after each drift)
+    PS::S64 n_step_output; // number of dt_soft steps of the output interval
+
+    // hierarchical tree step
+    PS::S64 tree_level_step_count; // number of dt_soft steps since the last synchronization of all particles
+    PS::S64 n_tree_step_sum;       // number of steps after the last report
+    PS::S64 n_tree_active_sum;     // accumulated local active particle number after the last report
+    PS::S64 n_tree_real_sum;       // accumulated local real particle number after the last report
+
+    // adaptive changeover
+    bool changeover_adapt_flag;          // rescale changeover radii by the local density
+    PS::S64 changeover_adapt_count;      // number of tree steps after the last rescaling
+    PS::F64 changeover_adapt_nb_target;  // target neighbor number inside r_out
+
+    // tree parameter tuning
+    PS::F64 time_next_tree_tune; // time of the next tuning
+    PS::F64 theta_tree_soft;          // opening angle of tree_soft
+    PS::S64 n_leaf_limit_tree_soft;   // leaf number limit of tree_soft
+    PS::S64 n_group_limit_tree_soft;  // group number limit of tree_soft
+
+    // memory usage of subsystems, updated at output steps
+    SysMemory mem_usage;
+
+    // NUMA page placement of local particles
+    NumaControl numa_control;
 
     // tree
     TreeNB tree_nb;
-    TreeForce tree_soft;
+    TreeForce* tree_soft; // soft force tree, a new tree is created when the tree parameters are changed by tuning
+
+    // direct summation soft force
+    SoftForceDirect soft_force_direct;
+    bool use_direct_soft_force;
 
 #ifdef GALPY
     GalpyManager galpy_manager;
@@ -679,6 +1016,8 @@ public:
     SystemHard system_hard_connected;
 #endif
     int n_interrupt_glb;
+    InterruptHandler interrupt_handler; // handler of parked interrupted clusters (interrupt-park 1), NULL: continue the integration directly
+    void* interrupt_handler_data;       // user data passed to interrupt_handler
 
     // mass change particle list
     PS::ReallocatableArray<PS::S32> mass_modify_list;
@@ -695,6 +1034,21 @@ public:
     PS::S32 my_rank;
     PS::S32 n_proc;
 
+    // ensemble mode
+    struct EnsembleMember{
+        std::string fname_inp; // input data filename
+        std::string fname_snp; // output prefix
+        std::string fname_par; // parameter file, __NONE__ if not provided
+    };
+    std::vector<EnsembleMember> ensemble_list;
+    FILE* fpar_ensemble_backup; // shared parameters backup
+#ifdef BSE_BASE
+    FILE* fbse_par_ensemble_backup;
+#endif
+#ifdef GALPY
+    FILE* fgalpy_par_ensemble_backup;
+#endif
+
     // safety check flag
     bool initial_fdps_flag;
     bool read_parameters_flag;
@@ -716,11 +1070,16 @@ public:
         dn_loop(0), profile(), n_count(), n_count_sum(), tree_soft_profile(), fprofile(), 
 #endif
         stat(), fstatus(), time_kick(0.0),
-        escaper(), fesc(),
-        file_header(), system_soft(), id_adr_map(),
+        escaper(), fesc(), particle_track(), fcatalog(), group_catalog_list(),
+        file_header(), system_soft(), id_adr_map(), id_adr_map_valid(false), morton_key_list(), ptcl_sort_buf(),
         n_loop(0), domain_decompose_weight(1.0), dinfo(), pos_domain(NULL), 
-        dt_manager(),
-        tree_nb(), tree_soft(), 
+        dt_manager(), n_step_tree(0), n_step_output(1),
+        tree_level_step_count(0), n_tree_step_sum(0), n_tree_active_sum(0), n_tree_real_sum(0),
+        changeover_adapt_flag(false), changeover_adapt_count(0), changeover_adapt_nb_target(0.0),
+        time_next_tree_tune(0.0), theta_tree_soft(0.0), n_leaf_limit_tree_soft(0), n_group_limit_tree_soft(0),
+        mem_usage(), numa_control(),
+        tree_nb(), tree_soft(NULL), 
+        soft_force_direct(), use_direct_soft_force(false),
 #ifdef GALPY
         galpy_manager(),
 #endif
@@ -728,9 +1087,16 @@ public:
 #ifdef PARTICLE_SIMULATOR_MPI_PARALLEL
         system_hard_connected(), 
 #endif
-        n_interrupt_glb(0),
+        n_interrupt_glb(0), interrupt_handler(NULL), interrupt_handler_data(NULL),
         mass_modify_list(), remove_list(), remove_id_record(),
         search_cluster(),
+        ensemble_list(), fpar_ensemble_backup(NULL),
+#ifdef BSE_BASE
+        fbse_par_ensemble_backup(NULL),
+#endif
+#ifdef GALPY
+        fgalpy_par_ensemble_backup(NULL),
+#endif
         initial_fdps_flag(false), read_parameters_flag(false), read_data_flag(false), initial_parameters_flag(false), initial_step_flag(false) {
         // set print format
         std::cout<<std::setprecision(PRINT_PRECISION);
@@ -756,16 +1122,36 @@ public:
         profile.tree_nb.start();
         tree_nb.clearNumberOfInteraction();
         tree_nb.clearTimeProfile();
+#endif
+        // stable groups are represented by their leaders, the other members are moved to the end and excluded from the tree
+        const PS::S64 n_loc = system_soft.getNumberOfParticleLocal();
+        PS::S64 n_tree = n_loc;
+#ifdef NB_GROUP_CM
+        const bool nb_group_flag = (input_parameters.nb_group_cm.value==1);
+        if (nb_group_flag) {
+            n_tree = search_cluster.setNeighborGroupLeader(system_soft, dinfo.getPosDomain(PS::Comm::getRank()));
+            system_soft.setNumberOfParticleLocal(n_tree);
+        }
 #endif
 #ifdef USE_SIMD
         tree_nb.calcForceAllAndWriteBack(SearchNeighborEpEpSimd(), system_soft, dinfo);
 #elif USE_FUGAKU
         tree_nb.calcForceAllAndWriteBack(SearchNeighborEpEpFugaku(), system_soft, dinfo);
+#elif USE_AARCH64
+        tree_nb.calcForceAllAndWriteBack(SearchNeighborEpEpAArch64(), system_soft, dinfo);
 #else
         tree_nb.calcForceAllAndWriteBack(SearchNeighborEpEpNoSimd(), system_soft, dinfo);
 #endif
+#ifdef NB_GROUP_CM
+        if (nb_group_flag) {
+            system_soft.setNumberOfParticleLocal(n_loc);
+            search_cluster.setNeighborGroupMemberNgb(system_soft);
+        }
+#endif
         
 #ifdef PROFILE
+        n_count.nb_tree_ptcl     += n_tree;
+        n_count_sum.nb_tree_ptcl += PS::Comm::getSum(n_tree);
         tree_nb_profile += tree_nb.getTimeProfile();
         profile.tree_nb.barrier();
         PS::Comm::barrier();
@@ -861,13 +1247,118 @@ public:
 #endif
     }
 
+    //! calculate soft force by direct summation
+    void directSoftForce() {
+#ifdef PROFILE
+        profile.tree_soft.start();
+#endif
+
+#ifdef USE_FUGAKU
+        PS::F64 eps2 = EPISoft::eps*EPISoft::eps;
+        PS::F64 rout2 = EPISoft::r_out*EPISoft::r_out;
+        PS::F64 G= ForceSoft::grav_const;
+        soft_force_direct.calcForceAllAndWriteBack(calcForceActiveOnly(CalcForceEpEpWithLinearCutoffFugaku(eps2, rout2, G)), system_soft);
+#elif USE_SIMD
+        soft_force_direct.calcForceAllAndWriteBack(calcForceActiveOnly(CalcForceEpEpWithLinearCutoffSimd()), system_soft);
+#elif USE_AARCH64
+        soft_force_direct.calcForceAllAndWriteBack(calcForceActiveOnly(CalcForceEpEpWithLinearCutoffAArch64()), system_soft);
+#else // for GPU, the CPU kernel is used
+        soft_force_direct.calcForceAllAndWriteBack(calcForceActiveOnly(CalcForceEpEpWithLinearCutoffNoSimd()), system_soft);
+#endif
+
+#ifdef PROFILE
+        n_count.ep_ep_interact     += soft_force_direct.n_interaction_loc;
+        n_count_sum.ep_ep_interact += PS::Comm::getSum(soft_force_direct.n_interaction_loc);
+        domain_decompose_weight = soft_force_direct.time_calc_force;
+
+        profile.tree_soft.barrier();
+        PS::Comm::barrier();
+        profile.tree_soft.end();
+#endif
+    }
+
+    //! wallclock time of getting neighbor lists of local particles having neighbors
+    /*! Used in the selection of the soft force backend, since the neighbor lists of the changeover correction are O(N) per particle in the direct summation.
+     */
+    template<class Ttree, class Tepj>
+    PS::F64 measureNeighborListTime(Ttree& _tree) {
+        const PS::S32 n_loc = system_soft.getNumberOfParticleLocal();
+        PS::F64 t0 = PS::GetWtime();
+#pragma omp parallel for schedule(dynamic)
+        for (PS::S32 i=0; i<n_loc; i++) {
+            if (system_soft[i].n_ngb>1) {
+                Tepj* nbl = NULL;
+                _tree.getNeighborListOneParticle(system_soft[i], nbl);
+            }
+        }
+        return PS::GetWtime() - t0;
+    }
+
+    //! select tree or direct summation backend for soft force by measuring the wallclock time of both
+    /*! Only used in the auto mode of soft force. If the total particle number is larger than n_direct_max, the tree is used without measurement, also in the reproducible mode.
+      The measured time includes the neighbor lists of the particles having neighbors (getNeighborListOneParticle), which are used in the changeover correction.
+      Each backend is evaluated once, the direct summation is only tried if the total particle number is not larger than n_direct_max,
+      since its neighbor lists scan all particles.
+      The soft force of the selected backend is kept in system_soft after return.
+     */
+    void selectSoftForceBackend() {
+        // in the reproducible mode, the backend cannot depend on the timing
+        if (input_parameters.soft_force_mode.value==0 || stat.n_all_glb>input_parameters.n_direct_max.value || input_parameters.reproducible.value==1) {
+            use_direct_soft_force = false;
+            treeSoftForce();
+            return;
+        }
+        if (input_parameters.soft_force_mode.value==1) {
+            use_direct_soft_force = true;
+            treeSoftForce();
+            return;
+        }
+
+        // measure each backend once, the tree result is saved and recovered if the tree is selected
+        const PS::S64 n_loc = system_soft.getNumberOfParticleLocal();
+        PS::Comm::barrier();
+        PS::F64 t0 = PS::GetWtime();
+        use_direct_soft_force = false;
+        treeSoftForce();
+        measureNeighborListTime<TreeForce, EPJSoftTree>(*tree_soft);
+        PS::F64 t1 = PS::GetWtime();
+        PS::ReallocatableArray<FPSoft> ptcl_tree;
+        ptcl_tree.resizeNoInitialize(n_loc);
+#pragma omp parallel for
+        for (PS::S64 i=0; i<n_loc; i++) ptcl_tree[i] = system_soft[i];
+        PS::Comm::barrier();
+        PS::F64 t2 = PS::GetWtime();
+        use_direct_soft_force = true;
+        treeSoftForce();
+        measureNeighborListTime<SoftForceDirect, EPJSoft>(soft_force_direct);
+        PS::F64 t3 = PS::GetWtime();
+        const PS::F64 time_tree   = PS::Comm::getMaxValue(t1-t0);
+        const PS::F64 time_direct = PS::Comm::getMaxValue(t3-t2);
+        use_direct_soft_force = time_direct<time_tree;
+        if (!use_direct_soft_force) {
+#pragma omp parallel for
+            for (PS::S64 i=0; i<n_loc; i++) system_soft[i] = ptcl_tree[i];
+        }
+
+        if (input_parameters.print_flag) 
+            std::cout<<"Soft force backend: N_all= "<<stat.n_all_glb
+                     <<" time(tree)= "<<time_tree
+                     <<" time(direct)= "<<time_direct
+                     <<" use "<<(use_direct_soft_force?"direct summation":"tree")
+                     <<std::endl;
+    }
+
     //! calculate tree solf force
     void treeSoftForce() {
+        if (use_direct_soft_force) {
+            directSoftForce();
+            return;
+        }
 #ifdef PROFILE
         profile.tree_soft.start();
 
-        tree_soft.clearNumberOfInteraction();
-        tree_soft.clearTimeProfile();
+        tree_soft->clearNumberOfInteraction();
+        tree_soft->clearTimeProfile();
 #endif
 
 #ifdef USE_GPU
@@ -877,14 +1368,14 @@ public:
         PS::F64 rout2 = EPISoft::r_out*EPISoft::r_out;
         PS::F64 G= ForceSoft::grav_const;
 #ifdef PARTICLE_SIMULATOR_GPU_MULIT_WALK_INDEX
-        tree_soft.calcForceAllAndWriteBackMultiWalkIndex(CalcForceWithLinearCutoffCUDAMultiWalk(my_rank, eps2, rout2, G),
+        tree_soft->calcForceAllAndWriteBackMultiWalkIndex(CalcForceWithLinearCutoffCUDAMultiWalk(my_rank, eps2, rout2, G),
                                                          RetrieveForceCUDA,
                                                          tag_max,
                                                          system_soft,
                                                          dinfo,
                                                          n_walk_limit);
 #else // no multi-walk index
-        tree_soft.calcForceAllAndWriteBackMultiWalk(CalcForceWithLinearCutoffCUDA(my_rank, eps2, rout2, G),
+        tree_soft->calcForceAllAndWriteBackMultiWalk(CalcForceWithLinearCutoffCUDA(my_rank, eps2, rout2, G),
                                                     RetrieveForceCUDA,
                                                     tag_max,
                                                     system_soft,
@@ -896,42 +1387,68 @@ public:
         PS::F64 eps2 = EPISoft::eps*EPISoft::eps;
         PS::F64 rout2 = EPISoft::r_out*EPISoft::r_out;
         PS::F64 G= ForceSoft::grav_const;
-        tree_soft.calcForceAllAndWriteBack(CalcForceEpEpWithLinearCutoffFugaku(eps2, rout2, G),
+        // inactive particles in the hierarchical tree step are skipped by the kernel wrapper
+        tree_soft->calcForceAllAndWriteBack(calcForceActiveOnly(CalcForceEpEpWithLinearCutoffFugaku(eps2, rout2, G)),
 #ifdef USE_QUAD
-                                           CalcForceEpSpQuadFugaku(eps2, G),
+                                           calcForceActiveOnly(CalcForceEpSpQuadFugaku(eps2, G)),
 #else // no quad
-                                           CalcForceEpSpMonoFugaku(eps2, G),
+                                           calcForceActiveOnly(CalcForceEpSpMonoFugaku(eps2, G)),
 #endif // end quad
                                            system_soft,
                                            dinfo);
         
 #elif USE_SIMD // end use_gpu
-        tree_soft.calcForceAllAndWriteBack(CalcForceEpEpWithLinearCutoffSimd(),
+#ifdef USE_CPU_MULTI_WALK
+        const PS::S64 n_walk_cpu = input_parameters.cpu_multi_walk.value;
+        if (n_walk_cpu>0) {
+            PS::F64 eps2 = EPISoft::eps*EPISoft::eps;
+            PS::F64 rout2 = EPISoft::r_out*EPISoft::r_out;
+            PS::F64 G= ForceSoft::grav_const;
+            // inactive particles in the hierarchical tree step are skipped by the kernel
+            tree_soft->calcForceAllAndWriteBackMultiWalkIndex(CalcForceWithLinearCutoffCPUMultiWalk(eps2, rout2, G),
+                                                             RetrieveForceCPUMultiWalk,
+                                                             1,
+                                                             system_soft,
+                                                             dinfo,
+                                                             n_walk_cpu);
+        }
+        else
+#endif
+        tree_soft->calcForceAllAndWriteBack(calcForceActiveOnly(CalcForceEpEpWithLinearCutoffSimd()),
 #ifdef USE_QUAD
-                                           CalcForceEpSpQuadSimd(),
+                                           calcForceActiveOnly(CalcForceEpSpQuadSimd()),
 #else // no quad
-                                           CalcForceEpSpMonoSimd(),
+                                           calcForceActiveOnly(CalcForceEpSpMonoSimd()),
 #endif // end quad
                                            system_soft,
                                            dinfo);
-#else // end use_simd
-        tree_soft.calcForceAllAndWriteBack(CalcForceEpEpWithLinearCutoffNoSimd(),
+#elif USE_AARCH64 // end use_simd
+        tree_soft->calcForceAllAndWriteBack(calcForceActiveOnly(CalcForceEpEpWithLinearCutoffAArch64()),
 #ifdef USE_QUAD
-                                           CalcForceEpSpQuadNoSimd(),
+                                           calcForceActiveOnly(CalcForceEpSpQuadAArch64()),
+#else // no quad
+                                           calcForceActiveOnly(CalcForceEpSpMonoAArch64()),
+#endif // end quad
+                                           system_soft,
+                                           dinfo);
+#else // end use_aarch64
+        tree_soft->calcForceAllAndWriteBack(calcForceActiveOnly(CalcForceEpEpWithLinearCutoffNoSimd()),
+#ifdef USE_QUAD
+                                           calcForceActiveOnly(CalcForceEpSpQuadNoSimd()),
 #else
-                                           CalcForceEpSpMonoNoSimd(),
+                                           calcForceActiveOnly(CalcForceEpSpMonoNoSimd()),
 #endif
                                            system_soft,
                                            dinfo);
 #endif // end else
 
 #ifdef PROFILE
-        n_count.ep_ep_interact     += tree_soft.getNumberOfInteractionEPEPLocal();
-        n_count_sum.ep_ep_interact += tree_soft.getNumberOfInteractionEPEPGlobal();
-        n_count.ep_sp_interact     += tree_soft.getNumberOfInteractionEPSPLocal();
-        n_count_sum.ep_sp_interact += tree_soft.getNumberOfInteractionEPSPGlobal(); 
+        n_count.ep_ep_interact     += tree_soft->getNumberOfInteractionEPEPLocal();
+        n_count_sum.ep_ep_interact += tree_soft->getNumberOfInteractionEPEPGlobal();
+        n_count.ep_sp_interact     += tree_soft->getNumberOfInteractionEPSPLocal();
+        n_count_sum.ep_sp_interact += tree_soft->getNumberOfInteractionEPSPGlobal(); 
 
-        tree_soft_profile += tree_soft.getTimeProfile();
+        tree_soft_profile += tree_soft->getTimeProfile();
         domain_decompose_weight = tree_soft_profile.calc_force;
 
         profile.tree_soft.barrier();
@@ -940,10 +1457,233 @@ public:
 #endif
     }
 
+    //! create and initialize a new soft force tree
+    /*! FDPS tree cannot be initialized twice, a new tree is needed for new tree parameters
+      @param[in] _theta: opening angle
+      @param[in] _n_leaf_limit: leaf number limit
+      @param[in] _n_group_limit: group number limit
+      \return new tree
+     */
+    TreeForce* createTreeSoft(const PS::F64 _theta, const PS::S64 _n_leaf_limit, const PS::S64 _n_group_limit) {
+        TreeForce* tree = new TreeForce();
+        PS::S64 n_tree_init = input_parameters.n_glb.value + input_parameters.n_bin.value;
+        tree->initialize(n_tree_init, _theta, _n_leaf_limit, _n_group_limit);
+        return tree;
+    }
+
+    //! replace the soft force tree by a new tree if the tree parameters are changed
+    /*! @param[in] _theta: opening angle
+      @param[in] _n_leaf_limit: leaf number limit
+      @param[in] _n_group_limit: group number limit
+     */
+    void setTreeSoft(const PS::F64 _theta, const PS::S64 _n_leaf_limit, const PS::S64 _n_group_limit) {
+        if (tree_soft!=NULL) {
+            if (_theta==theta_tree_soft && _n_leaf_limit==n_leaf_limit_tree_soft && _n_group_limit==n_group_limit_tree_soft) return;
+            delete tree_soft;
+        }
+        tree_soft = createTreeSoft(_theta, _n_leaf_limit, _n_group_limit);
+        theta_tree_soft = _theta;
+        n_leaf_limit_tree_soft = _n_leaf_limit;
+        n_group_limit_tree_soft = _n_group_limit;
+    }
+
+    //! calculate soft accelerations of sample particles by direct summation
+    /*! Sample particles are selected uniformly from local real particles. 
+      The same EP-EP kernel of the tree (linear cutoff) is used with all particles (including artificial particles) of all processes.
+      @param[out] _adr: local address of sample particles
+      @param[out] _acc_ref: soft acceleration of sample particles
+      @param[in] _n_sample_max: maximum local sample number
+     */
+    void calcSoftForceSampleDirect(PS::ReallocatableArray<PS::S32>& _adr, 
+                                   PS::ReallocatableArray<PS::F64vec>& _acc_ref, 
+                                   const PS::S32 _n_sample_max) {
+        const PS::S32 n_loc = system_soft.getNumberOfParticleLocal();
+        const PS::S32 n_real_loc = stat.n_real_loc;
+        const PS::S32 n_sample_loc = std::min(_n_sample_max, n_real_loc);
+        _adr.resizeNoInitialize(n_sample_loc);
+        _acc_ref.resizeNoInitialize(n_sample_loc);
+        for (PS::S32 k=0; k<n_sample_loc; k++) _adr[k] = (PS::S64)k*n_real_loc/n_sample_loc;
+
+        // gather sample particles of all processes
+        std::vector<PS::S32> n_sample(n_proc), n_sample_disp(n_proc+1);
+#ifdef PARTICLE_SIMULATOR_MPI_PARALLEL
+        PS::Comm::allGather(&n_sample_loc, 1, n_sample.data());
+#else
+        n_sample[0] = n_sample_loc;
+#endif
+        n_sample_disp[0] = 0;
+        for (PS::S32 i=0; i<n_proc; i++) n_sample_disp[i+1] = n_sample_disp[i] + n_sample[i];
+        const PS::S32 n_sample_glb = n_sample_disp[n_proc];
+
+        PS::ReallocatableArray<EPISoft> epi;
+        epi.resizeNoInitialize(n_sample_glb);
+        EPISoft* epi_loc = epi.getPointer(n_sample_disp[my_rank]);
+        for (PS::S32 k=0; k<n_sample_loc; k++) epi_loc[k].copyFromFP(system_soft[_adr[k]]);
+#ifdef PARTICLE_SIMULATOR_MPI_PARALLEL
+        MPI_Allgatherv(MPI_IN_PLACE, 0, PS::GetDataType<EPISoft>(), 
+                       epi.getPointer(), n_sample.data(), n_sample_disp.data(), PS::GetDataType<EPISoft>(), MPI_COMM_WORLD);
+#endif
+
+        PS::ReallocatableArray<EPJSoft> epj;
+        epj.resizeNoInitialize(n_loc);
+#pragma omp parallel for
+        for (PS::S32 j=0; j<n_loc; j++) epj[j].copyFromFP(system_soft[j]);
+
+        // partial force from local j particles
+        PS::ReallocatableArray<PS::F64> acc;
+        acc.resizeNoInitialize(3*n_sample_glb);
+#pragma omp parallel for
+        for (PS::S32 i=0; i<n_sample_glb; i++) {
+            ForceSoft force;
+            force.clear();
+            CalcForceEpEpWithLinearCutoffNoSimd()(&epi[i], 1, epj.getPointer(), n_loc, &force);
+            for (PS::S32 k=0; k<3; k++) acc[3*i+k] = force.acc[k];
+        }
+#ifdef PARTICLE_SIMULATOR_MPI_PARALLEL
+        MPI_Allreduce(MPI_IN_PLACE, acc.getPointer(), 3*n_sample_glb, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+#endif
+        for (PS::S32 k=0; k<n_sample_loc; k++) {
+            const PS::S32 i = n_sample_disp[my_rank] + k;
+            _acc_ref[k] = PS::F64vec(acc[3*i], acc[3*i+1], acc[3*i+2]);
+        }
+    }
+
+    //! tune n_leaf_limit, n_group_limit (and theta) of the soft force tree by measuring the wallclock time of treeSoftForce
+    /*! The trials are on the grid of (1/2, 1, 2) times the current n_leaf_limit and n_group_limit, and the fastest one is selected.
+      If tree_tune_theta_err>0, theta is then increased by a factor of 1.25 per trial (up to 1), until the RMS relative error of the soft accelerations of sample particles, 
+      compared with the direct summation, exceeds tree_tune_theta_err. The fastest admissible theta is selected.
+      A new tree is created for each trial (FDPS tree cannot be initialized twice), the trials are not included in the profile.
+      The selected values are kept in theta_tree_soft, n_leaf_limit_tree_soft and n_group_limit_tree_soft and printed, so that they can be fixed in the parameter file.
+      input_parameters are not changed, the neighbor search tree (tree_nb) always uses the input values.
+      This function replaces treeSoftForce, the soft force with the selected parameters is saved in system_soft after return.
+     */
+    void tuneTreeSoftParameters() {
+        if (use_direct_soft_force) {
+            treeSoftForce();
+            return;
+        }
+        const PS::F64 interval = input_parameters.tree_tune_interval.value;
+        time_next_tree_tune = interval>0.0? stat.time + interval: PS::LARGE_FLOAT;
+
+        const bool print_flag = input_parameters.print_flag;
+        const PS::F64 theta = theta_tree_soft;
+        const PS::S64 n_leaf_limit = n_leaf_limit_tree_soft;
+        const PS::S64 n_group_limit = n_group_limit_tree_soft;
+
+#ifdef PROFILE
+        // backup the counters updated by treeSoftForce to exclude the trials
+        const Tprofile profile_tree_soft_bk = profile.tree_soft;
+        const NumCounter ep_ep_interact_bk = n_count.ep_ep_interact;
+        const NumCounter ep_ep_interact_sum_bk = n_count_sum.ep_ep_interact;
+        const NumCounter ep_sp_interact_bk = n_count.ep_sp_interact;
+        const NumCounter ep_sp_interact_sum_bk = n_count_sum.ep_sp_interact;
+        const FDPSProfile tree_soft_profile_bk = tree_soft_profile;
+#endif
+
+        // soft force time of one setting, the minimum of two calls is used to avoid the overhead of the first call after reinitialization
+        auto measureTime = [&](const PS::F64 _theta, const PS::S64 _n_leaf_limit, const PS::S64 _n_group_limit) {
+            setTreeSoft(_theta, _n_leaf_limit, _n_group_limit);
+            PS::F64 time_min = PS::LARGE_FLOAT;
+            for (int k=0; k<2; k++) {
+                PS::Comm::barrier();
+                PS::F64 t0 = PS::GetWtime();
+                treeSoftForce();
+                time_min = std::min(time_min, PS::Comm::getMaxValue(PS::GetWtime()-t0));
+            }
+            return time_min;
+        };
+
+        // artificial particles of one binary should be able to stay in one leaf
+        const PS::S64 n_leaf_min = hard_manager.ap_manager.getArtificialParticleN();
+        const PS::S64 n_leaf_grid[3] = {std::max(n_leaf_limit/2, n_leaf_min), n_leaf_limit, 2*n_leaf_limit};
+        const PS::S64 n_group_grid[3] = {n_group_limit/2, n_group_limit, 2*n_group_limit};
+        PS::F64 time_best = PS::LARGE_FLOAT;
+        PS::F64 theta_best = theta;
+        PS::S64 n_leaf_best = n_leaf_limit, n_group_best = n_group_limit;
+        for (int i=0; i<3; i++) {
+            if (i>0 && n_leaf_grid[i]==n_leaf_grid[i-1]) continue;
+            for (int j=0; j<3; j++) {
+                if (n_group_grid[j]<n_leaf_grid[i]) continue;
+                PS::F64 time = measureTime(theta, n_leaf_grid[i], n_group_grid[j]);
+                if (print_flag) 
+                    std::cout<<"Tree tuning trial: T= "<<theta
+                             <<" number-leaf-limit= "<<n_leaf_grid[i]
+                             <<" number-group-limit= "<<n_group_grid[j]
+                             <<" time= "<<time<<std::endl;
+                if (time<time_best) {
+                    time_best = time;
+                    n_leaf_best = n_leaf_grid[i];
+                    n_group_best = n_group_grid[j];
+                }
+            }
+        }
+
+        // increase theta under the force accuracy constraint
+        const PS::F64 err_max = input_parameters.tree_tune_theta_err.value;
+        if (err_max>0.0 && theta>0.0) {
+            PS::ReallocatableArray<PS::S32> adr_sample;
+            PS::ReallocatableArray<PS::F64vec> acc_ref;
+            calcSoftForceSampleDirect(adr_sample, acc_ref, 64);
+            for (PS::F64 theta_new = theta*1.25; theta_new<=1.0; theta_new *= 1.25) {
+                PS::F64 time = measureTime(theta_new, n_leaf_best, n_group_best);
+                PS::F64 err_loc = 0.0;
+                PS::S64 n_err_loc = 0;
+                for (PS::S32 k=0; k<adr_sample.size(); k++) {
+                    auto& pk = system_soft[adr_sample[k]];
+#ifdef TREE_LEVEL_STEP
+                    // skip inactive particles in the hierarchical tree step
+                    if (!pk.tree_active) continue;
+#endif
+                    PS::F64vec da = pk.acc - acc_ref[k];
+                    PS::F64 a2 = acc_ref[k]*acc_ref[k];
+                    if (a2>0.0) {
+                        err_loc += da*da/a2;
+                        n_err_loc++;
+                    }
+                }
+                PS::S64 n_err = PS::Comm::getSum(n_err_loc);
+                PS::F64 err = n_err>0? std::sqrt(PS::Comm::getSum(err_loc)/n_err): 0.0;
+                if (print_flag) 
+                    std::cout<<"Tree tuning trial: T= "<<theta_new
+                             <<" number-leaf-limit= "<<n_leaf_best
+                             <<" number-group-limit= "<<n_group_best
+                             <<" time= "<<time
+                             <<" force error= "<<err<<std::endl;
+                if (err>err_max) break;
+                if (time<time_best) {
+                    time_best = time;
+                    theta_best = theta_new;
+                }
+            }
+        }
+
+#ifdef PROFILE
+        profile.tree_soft = profile_tree_soft_bk;
+        n_count.ep_ep_interact = ep_ep_interact_bk;
+        n_count_sum.ep_ep_interact = ep_ep_interact_sum_bk;
+        n_count.ep_sp_interact = ep_sp_interact_bk;
+        n_count_sum.ep_sp_interact = ep_sp_interact_sum_bk;
+        tree_soft_profile = tree_soft_profile_bk;
+#endif
+
+        setTreeSoft(theta_best, n_leaf_best, n_group_best);
+        treeSoftForce();
+
+        if (print_flag) 
+            std::cout<<"Tree tuning result: Time= "<<stat.time
+                     <<" T= "<<theta_tree_soft
+                     <<" number-leaf-limit= "<<n_leaf_limit_tree_soft
+                     <<" number-group-limit= "<<n_group_limit_tree_soft
+                     <<" time= "<<time_best<<std::endl;
+    }
+
     //! correct force due to change over function by using particle tree neighbor search
     void treeForceCorrectChangeoverTreeNeighbor() {
         // all particles
-        SystemHard::correctForceWithCutoffTreeNeighborOMP<SystemSoft, FPSoft, TreeForce, EPJSoft>(system_soft, tree_soft, system_soft.getNumberOfParticleLocal(), hard_manager.ap_manager);        
+        if (use_direct_soft_force)
+            SystemHard::correctForceWithCutoffTreeNeighborOMP<SystemSoft, FPSoft, SoftForceDirect, EPJSoft>(system_soft, soft_force_direct, system_soft.getNumberOfParticleLocal(), hard_manager.ap_manager);        
+        else
+            SystemHard::correctForceWithCutoffTreeNeighborOMP<SystemSoft, FPSoft, TreeForce, EPJSoftTree>(system_soft, *tree_soft, system_soft.getNumberOfParticleLocal(), hard_manager.ap_manager);        
     }
 
     //! correct force due to change over function
@@ -970,7 +1710,10 @@ public:
 
 #ifdef PARTICLE_SIMULATOR_MPI_PARALLEL        
         // Connected clusters
-        system_hard_connected.correctForceWithCutoffTreeNeighborAndClusterOMP<SystemSoft, FPSoft, TreeForce, EPJSoft>(system_soft, tree_soft, search_cluster.getAdrSysConnectClusterSend());
+        if (use_direct_soft_force)
+            system_hard_connected.correctForceWithCutoffTreeNeighborAndClusterOMP<SystemSoft, FPSoft, SoftForceDirect, EPJSoft>(system_soft, soft_force_direct, search_cluster.getAdrSysConnectClusterSend());
+        else
+            system_hard_connected.correctForceWithCutoffTreeNeighborAndClusterOMP<SystemSoft, FPSoft, TreeForce, EPJSoftTree>(system_soft, *tree_soft, search_cluster.getAdrSysConnectClusterSend());
 #endif
 
 #ifdef CORRECT_FORCE_DEBUG
@@ -983,15 +1726,18 @@ public:
         }
 
         // all particles
-        SystemHard::correctForceWithCutoffTreeNeighborOMP<SystemSoft, FPSoft, TreeForce, EPJSoft>(system_soft, tree_soft, n_loc, hard_manager.ap_manager);
+        if (use_direct_soft_force)
+            SystemHard::correctForceWithCutoffTreeNeighborOMP<SystemSoft, FPSoft, SoftForceDirect, EPJSoft>(system_soft, soft_force_direct, n_loc, hard_manager.ap_manager);
+        else
+            SystemHard::correctForceWithCutoffTreeNeighborOMP<SystemSoft, FPSoft, TreeForce, EPJSoftTree>(system_soft, *tree_soft, n_loc, hard_manager.ap_manager);
 
         // single 
         //system_hard_one_cluster.correctPotWithCutoffOMP(system_soft, search_cluster.getAdrSysOneCluster());
         // Isolated clusters
-        //system_hard_isolated.correctForceWithCutoffTreeNeighborOMP<SystemSoft, FPSoft, TreeForce, EPJSoft>(system_soft, tree_soft, n_loc);
+        //system_hard_isolated.correctForceWithCutoffTreeNeighborOMP<SystemSoft, FPSoft, TreeForce, EPJSoft>(system_soft, *tree_soft, n_loc);
 //#ifdef PARTICLE_SIMULATOR_MPI_PARALLEL        
 //        // Connected clusters
-//        system_hard_connected.correctForceWithCutoffTreeNeighborOMP<SystemSoft, FPSoft, TreeForce, EPJSoft>(system_soft, tree_soft, n_loc_all);
+//        system_hard_connected.correctForceWithCutoffTreeNeighborOMP<SystemSoft, FPSoft, TreeForce, EPJSoft>(system_soft, *tree_soft, n_loc_all);
 //#endif
 
         for (int i=0; i<n_loc_all; i++) {
@@ -1102,30 +1848,69 @@ public:
     void GradientKick() {
 #ifdef PROFILE
         profile.tree_soft.start();
-        tree_soft.clearNumberOfInteraction();
-        tree_soft.clearTimeProfile();
+        tree_soft->clearNumberOfInteraction();
+        tree_soft->clearTimeProfile();
 #endif
         // correction calculation
-        //tree_soft.setParticaleLocalTree(system_soft, false);
+        //tree_soft->setParticaleLocalTree(system_soft, false);
         
-        tree_soft.calcForceAllAndWriteBack(CalcCorrectEpEpWithLinearCutoffNoSimd(),
+        if (use_direct_soft_force) {
+#if defined(USE_SIMD) && !defined(__HPC_ACE__)
+            soft_force_direct.calcForceAllAndWriteBack(CalcCorrectEpEpWithLinearCutoffSimd(), system_soft);
+#elif USE_AARCH64
+            soft_force_direct.calcForceAllAndWriteBack(CalcCorrectEpEpWithLinearCutoffAArch64(), system_soft);
+#else
+            soft_force_direct.calcForceAllAndWriteBack(CalcCorrectEpEpWithLinearCutoffNoSimd(), system_soft);
+#endif
+#ifdef PROFILE
+            n_count.ep_ep_interact     += soft_force_direct.n_interaction_loc;
+            n_count_sum.ep_ep_interact += PS::Comm::getSum(soft_force_direct.n_interaction_loc);
+            domain_decompose_weight += soft_force_direct.time_calc_force;
+#endif
+        }
+        else {
+#if defined(USE_SIMD) && !defined(__HPC_ACE__)
+            // super particles carry no acceleration, the EP-SP kernels are the same as those in the tree force
+            tree_soft->calcForceAllAndWriteBack(CalcCorrectEpEpWithLinearCutoffSimd(),
 #ifdef USE_QUAD
-                                           CalcForceEpSpQuadNoSimd(),
+                                               CalcForceEpSpQuadSimd(),
 #else
-                                           CalcForceEpSpMonoNoSimd(),
+                                               CalcForceEpSpMonoSimd(),
+#endif
+                                               system_soft,
+                                               dinfo);
+#elif USE_AARCH64
+            tree_soft->calcForceAllAndWriteBack(CalcCorrectEpEpWithLinearCutoffAArch64(),
+#ifdef USE_QUAD
+                                               CalcForceEpSpQuadAArch64(),
+#else
+                                               CalcForceEpSpMonoAArch64(),
+#endif
+                                               system_soft,
+                                               dinfo);
+#else
+            tree_soft->calcForceAllAndWriteBack(CalcCorrectEpEpWithLinearCutoffNoSimd(),
+#ifdef USE_QUAD
+                                               CalcForceEpSpQuadNoSimd(),
+#else
+                                               CalcForceEpSpMonoNoSimd(),
+#endif
+                                               system_soft,
+                                               dinfo);
 #endif
-                                           system_soft,
-                                           dinfo);
 
 #ifdef PROFILE
-        n_count.ep_ep_interact     += tree_soft.getNumberOfInteractionEPEPLocal();
-        n_count_sum.ep_ep_interact += tree_soft.getNumberOfInteractionEPEPGlobal();
-        n_count.ep_sp_interact     += tree_soft.getNumberOfInteractionEPSPLocal();
-        n_count_sum.ep_sp_interact += tree_soft.getNumberOfInteractionEPSPGlobal(); 
+            n_count.ep_ep_interact     += tree_soft->getNumberOfInteractionEPEPLocal();
+            n_count_sum.ep_ep_interact += tree_soft->getNumberOfInteractionEPEPGlobal();
+            n_count.ep_sp_interact     += tree_soft->getNumberOfInteractionEPSPLocal();
+            n_count_sum.ep_sp_interact += tree_soft->getNumberOfInteractionEPSPGlobal(); 
 
-        tree_soft_profile += tree_soft.getTimeProfile();
-        domain_decompose_weight += tree_soft_profile.calc_force;
+            tree_soft_profile += tree_soft->getTimeProfile();
+            domain_decompose_weight += tree_soft_profile.calc_force;
+#endif
+        }
 
+#ifdef PROFILE
         profile.tree_soft.barrier();
         PS::Comm::barrier();
         profile.tree_soft.end();
@@ -1137,7 +1922,10 @@ public:
 
 #ifdef PARTICLE_SIMULATOR_MPI_PARALLEL        
         // Connected clusters
-        system_hard_connected.correctForceWithCutoffTreeNeighborAndClusterOMP<SystemSoft, FPSoft, TreeForce, EPJSoft>(system_soft, tree_soft, search_cluster.getAdrSysConnectClusterSend(), true);
+        if (use_direct_soft_force)
+            system_hard_connected.correctForceWithCutoffTreeNeighborAndClusterOMP<SystemSoft, FPSoft, SoftForceDirect, EPJSoft>(system_soft, soft_force_direct, search_cluster.getAdrSysConnectClusterSend(), true);
+        else
+            system_hard_connected.correctForceWithCutoffTreeNeighborAndClusterOMP<SystemSoft, FPSoft, TreeForce, EPJSoftTree>(system_soft, *tree_soft, search_cluster.getAdrSysConnectClusterSend(), true);
 #endif
 
 #ifdef PROFILE
@@ -1165,6 +1953,349 @@ public:
     }
 #endif
 
+#ifdef NB_GROUP_CM
+    //! reset stable group marks of all local particles for the neighbor group c.m. mode
+    void resetNeighborGroup() {
+        const PS::S64 n_loc = system_soft.getNumberOfParticleLocal();
+#pragma omp parallel for
+        for (PS::S64 i=0; i<n_loc; i++) {
+            system_soft[i].nb_group_id = 0;
+            system_soft[i].nb_group_n = 0;
+        }
+    }
+#endif
+
+#ifdef TREE_LEVEL_STEP
+    //! reset hierarchical tree step levels, all particles are synchronized and use dt_soft
+    void resetTreeLevel() {
+        const PS::S64 n_loc = system_soft.getNumberOfParticleLocal();
+#pragma omp parallel for
+        for (PS::S64 i=0; i<n_loc; i++) {
+            auto& pi = system_soft[i];
+            pi.tree_level = 0;
+            pi.tree_level_last = -1;
+            pi.tree_active = 1;
+            pi.tree_dt_sync = 0;
+        }
+    }
+
+    //! set active particles for the hierarchical tree step
+    /*! Called once per tree step after the neighbor search (only real particles exist).
+        A particle with level l is active if the step count since the last synchronization is a multiple of 2^l.
+        A particle with neighbors is moved to level 0 (clusters always use dt_soft), at output steps all particles are moved to level 0.
+        If such a particle is in the middle of a block (or its block is larger than dt_soft), the block is closed at the current time:
+        the opening kick and the drift done with the full block are corrected to the passed time tau,
+        the remaining closing kick, acc(t)*(tau - dt_soft)/2, is recorded in tree_dt_sync and applied by kickTreeLevelSync after the force calculation.
+     */
+    void setTreeLevelActive() {
+        if (dt_manager.isNextStart()) {
+            tree_level_step_count = 0;
+            resetTreeLevel();
+        }
+        else tree_level_step_count++;
+
+        const PS::F64 dt = dt_manager.getStep();
+        const PS::S64 count = tree_level_step_count;
+        const bool sync_all = (n_step_tree%n_step_output==0);
+        const PS::S64 n_loc = system_soft.getNumberOfParticleLocal();
+        PS::S64 n_active = 0;
+#pragma omp parallel for reduction(+:n_active)
+        for (PS::S64 i=0; i<n_loc; i++) {
+            auto& pi = system_soft[i];
+            const PS::S64 n_step_block = (PS::S64)1<<pi.tree_level;
+            const PS::S64 n_step_pass = count%n_step_block;
+            pi.tree_dt_sync = 0;
+            if (pi.n_ngb!=1 || (sync_all && n_step_pass!=0)) {
+                if (pi.tree_level>0) {
+                    const PS::F64 tau = (n_step_pass==0? n_step_block: n_step_pass)*dt;
+                    const PS::F64 dt_open_corr = 0.5*(tau - n_step_block*dt);
+                    pi.vel += pi.acc_block*dt_open_corr;
+                    pi.pos += pi.acc_block*(dt_open_corr*tau);
+                    pi.tree_dt_sync = 0.5*(tau - dt);
+                }
+                pi.tree_level = 0;
+                pi.tree_level_last = -1;
+                pi.tree_active = 1;
+            }
+            else pi.tree_active = (n_step_pass==0);
+            n_active += pi.tree_active;
+        }
+        n_tree_step_sum++;
+        n_tree_active_sum += n_active;
+        n_tree_real_sum += n_loc;
+    }
+
+    //! apply the remaining closing kicks of the blocks synchronized by setTreeLevelActive
+    /*! Called after the soft force calculation and before the kick, the soft force at the current time is used.
+        Single particles are kicked in system_soft, particles in clusters are kicked in system_hard,
+        group members use the c.m. force as kickClusterAndRecoverGroupMemberMass.
+        For connected clusters, the local particles in the sending list are also kicked before they are sent by kick.
+     */
+    void kickTreeLevelSync() {
+        auto& adr = search_cluster.getAdrSysOneCluster();
+        const PS::S64 n = adr.size();
+#pragma omp parallel for
+        for (PS::S64 k=0; k<n; k++) {
+            auto& pk = system_soft[adr[k]];
+            if (pk.tree_dt_sync!=0.0) pk.vel += pk.acc*pk.tree_dt_sync;
+        }
+        kickTreeLevelSyncCluster(system_hard_isolated.getPtcl());
+#ifdef PARTICLE_SIMULATOR_MPI_PARALLEL
+        kickTreeLevelSyncCluster(system_hard_connected.getPtcl());
+        auto& adr_send = search_cluster.getAdrSysConnectClusterSend();
+        const PS::S64 n_send = adr_send.size();
+#pragma omp parallel for
+        for (PS::S64 k=0; k<n_send; k++) {
+            auto& pk = system_soft[adr_send[k]];
+            if (pk.tree_dt_sync!=0.0 && (pk.group_data.artificial.isSingle() || (pk.group_data.artificial.isMember() && pk.getParticleCMAddress()<0))) 
+                pk.vel += pk.acc*pk.tree_dt_sync;
+        }
+#endif
+    }
+
+    //! apply the remaining closing kicks of synchronized blocks to the local particles in clusters
+    /*! Remote particles (adr_org<0) are kicked by their own nodes
+       @param[in,out] _ptcl: particle array in system hard
+     */
+    template<class Tptcl>
+    void kickTreeLevelSyncCluster(PS::ReallocatableArray<Tptcl>& _ptcl) {
+        const PS::S64 n = _ptcl.size();
+#pragma omp parallel for
+        for (PS::S64 i=0; i<n; i++) {
+            const PS::S64 i_adr = _ptcl[i].adr_org;
+            if (i_adr<0) continue;
+            const PS::F64 dt_sync = system_soft[i_adr].tree_dt_sync;
+            if (dt_sync==0.0) continue;
+            const PS::S64 cm_adr = _ptcl[i].group_data.artificial.isMember()? _ptcl[i].getParticleCMAddress(): -1;
+            if (cm_adr>0) _ptcl[i].vel += system_soft[cm_adr].acc * dt_sync;
+            else _ptcl[i].vel += system_soft[i_adr].acc * dt_sync;
+        }
+    }
+
+    //! update block levels of single particles for the hierarchical tree step
+    /*! Called after the soft force calculation and before the kick. 
+        For active single particles, the next level is determined by the jerk estimated from the last block, the level can increase at most by one per block.
+        The next block must start at a multiple of its size (counting from the last synchronization) and must not cross the next output step (counted by n_step_tree) or the ending time.
+        Inactive particles keep the force at the beginning of their blocks.
+        @param[in] _time_break: the ending time of the current integration
+     */
+    void updateTreeLevel(const PS::F64 _time_break) {
+        const PS::F64 dt = dt_manager.getStep();
+        const PS::S64 count = tree_level_step_count;
+        const PS::S32 level_max = input_parameters.tree_level_max.value;
+        const PS::F64 eta2 = input_parameters.tree_level_eta.value*input_parameters.tree_level_eta.value;
+        // number of steps to the next output and to the ending time
+        const PS::S64 n_step_break = (PS::S64)std::ceil((_time_break - stat.time)/dt - 1e-6);
+        const PS::S64 n_step_sync = std::min(n_step_output - n_step_tree%n_step_output, n_step_break);
+
+        auto& adr = search_cluster.getAdrSysOneCluster();
+        const PS::S64 n = adr.size();
+#pragma omp parallel for
+        for (PS::S64 k=0; k<n; k++) {
+            auto& pi = system_soft[adr[k]];
+            if (!pi.tree_active) {
+                pi.acc = pi.acc_block;
+                pi.pot_soft = pi.pot_tot = pi.pot_block;
+                continue;
+            }
+            const PS::S32 level_close = pi.tree_level;
+            PS::S32 level_new = 0;
+            if (pi.tree_level_last>=0) {
+                const PS::F64 dt_block = dt*((PS::S64)1<<level_close);
+                const PS::F64vec da = pi.acc - pi.acc_block;
+                const PS::F64 a2 = pi.acc*pi.acc;
+                const PS::F64 da2 = da*da;
+                for (level_new=std::min(level_close+1, level_max); level_new>0; level_new--) {
+                    const PS::S64 n_step_new = (PS::S64)1<<level_new;
+                    const PS::F64 dt_new = dt*n_step_new;
+                    // dt_new * |jerk| < eta * |acc|, jerk = da/dt_block
+                    if (count%n_step_new==0 && n_step_new<=n_step_sync && dt_new*dt_new*da2 < eta2*a2*dt_block*dt_block) break;
+                }
+            }
+            pi.tree_level_last = level_close;
+            pi.tree_level = level_new;
+            pi.acc_block = pi.acc;
+            pi.pot_block = pi.pot_soft;
+        }
+    }
+#endif
+
+    //! set the rescaling factors of changeover radii by the local density for the adaptive changeover
+    /*! Called after the neighbor search (only real particles exist), the rescaling is done every changeover_adapt_interval tree steps.
+        The local number density is estimated from the neighbor number inside r_search, the target r_out (scaled by m^(1/3) as ChangeOver::setR) contains changeover_adapt_nb neighbors.
+        The new r_out is limited by 
+        1) [changeover_adapt_min, changeover_adapt_max] times the mass-scaled r_out; 
+        2) 10*|v|*dt_soft (but not larger than the mass-scaled r_out), following the default dt_soft = 0.1*r_out/sigma;
+        3) the current r_search, thus all pairs affected by the new changeover are in the neighbor list;
+        4) search_peri_factor times the current r_out, thus the velocity criterion of the cluster search keeps all pairs inside the new r_out.
+        The radii are not changed here, only r_scale_next is set. 
+        Clusters with r_scale_next != 1 are updated in correctForceChangeOverUpdate with the force correction, single particles are updated by updateChangeOverAdaptiveSingle.
+     */
+    void setChangeOverAdaptive() {
+        if (++changeover_adapt_count<input_parameters.changeover_adapt_interval.value) return;
+        changeover_adapt_count = 0;
+
+        const PS::S64 n_loc = system_soft.getNumberOfParticleLocal();
+
+        // use the average neighbor number inside r_out at the first rescaling as the target
+        if (changeover_adapt_nb_target==0.0) {
+            PS::ReallocatableArray<PS::F64> nb_ptcl;
+            nb_ptcl.resizeNoInitialize(n_loc);
+#pragma omp parallel for
+            for (PS::S64 i=0; i<n_loc; i++) {
+                auto& pi = system_soft[i];
+                const PS::F64 r_ratio = pi.changeover.getRout()/pi.r_search;
+                nb_ptcl[i] = (pi.n_ngb-1)*r_ratio*r_ratio*r_ratio;
+            }
+            const PS::F64 nb_loc = sumFixedOrder(nb_ptcl.getPointer(), n_loc);
+            const PS::F64 nb_glb = PS::Comm::getSum(nb_loc);
+            const PS::S64 n_glb = PS::Comm::getSum(n_loc);
+            // no neighbor exists, try next time
+            if (nb_glb==0.0) return;
+            changeover_adapt_nb_target = nb_glb/n_glb;
+            if (input_parameters.print_flag) 
+                std::cout<<"Adaptive changeover: target neighbor number inside r_out = "<<changeover_adapt_nb_target<<std::endl;
+        }
+
+        const PS::F64 nb_target = changeover_adapt_nb_target;
+        const PS::F64 r_out_base = input_parameters.r_out.value;
+        const PS::F64 fac_min = input_parameters.changeover_adapt_min.value;
+        const PS::F64 fac_max = input_parameters.changeover_adapt_max.value;
+        const PS::F64 peri_factor = input_parameters.search_peri_factor.value;
+        const PS::F64 dt = dt_manager.getStep();
+        // avoid force corrections for small changes
+        const PS::F64 r_scale_tolerance = 0.1;
+        PS::S64 n_change = 0;
+#pragma omp parallel for reduction(+:n_change)
+        for (PS::S64 i=0; i<n_loc; i++) {
+            auto& pi = system_soft[i];
+            // keep the pending update (from the group changeover)
+            if (pi.changeover.r_scale_next!=1.0) continue;
+
+            const PS::F64 r_out = pi.changeover.getRout();
+#ifdef FIX_CHANGEOVER
+            const PS::F64 m_fac3 = 1.0;
+#else
+            const PS::F64 m_fac3 = std::max(std::pow(pi.mass*Ptcl::mean_mass_inv, 1.0/3.0), 1.0);
+#endif
+            const PS::F64 r_out_mass = m_fac3*r_out_base;
+            const PS::F64 n_ngb = pi.n_ngb-1;
+
+            PS::F64 r_out_new = fac_max*r_out_mass;
+            if (n_ngb>0) r_out_new = std::min(r_out_new, m_fac3*pi.r_search*std::pow(nb_target/n_ngb, 1.0/3.0));
+            const PS::F64 v = std::sqrt(pi.vel*pi.vel);
+            r_out_new = std::max(r_out_new, std::max(fac_min*r_out_mass, std::min(10.0*v*dt, r_out_mass)));
+            r_out_new = std::min(r_out_new, std::min(pi.r_search, peri_factor*r_out));
+
+            const PS::F64 r_scale = r_out_new/r_out;
+            if (std::abs(r_scale-1.0)>r_scale_tolerance) {
+                pi.changeover.r_scale_next = r_scale;
+                n_change++;
+            }
+        }
+#ifdef PETAR_DEBUG
+        PS::S64 n_change_glb = PS::Comm::getSum(n_change);
+        if (input_parameters.print_flag) 
+            std::cout<<"Adaptive changeover: T= "<<stat.time<<" N_change= "<<n_change_glb<<std::endl;
+#endif
+    }
+
+    //! update changeover radii of single particles for the adaptive changeover
+    /*! Called after the cluster search. Single particles have no neighbor inside r_search >= new r_out, thus no force correction is needed.
+     */
+    void updateChangeOverAdaptiveSingle() {
+        auto& adr = search_cluster.getAdrSysOneCluster();
+        const PS::S64 n = adr.size();
+#pragma omp parallel for
+        for (PS::S64 k=0; k<n; k++) {
+            auto& pi = system_soft[adr[k]];
+            if (pi.changeover.r_scale_next!=1.0) pi.changeover.updateWithRScale();
+        }
+    }
+
+    //! print the cluster size distribution, the neighbor number and the changeover radii
+    /*! Called after the cluster search at output steps. Single particles are counted as clusters with one member.
+        The output is used to compare the adaptive changeover with the fixed one.
+        @param[in] _print_flag: print the result
+     */
+    void printClusterStatistics(const bool _print_flag) {
+        // cluster member number bins: 1, 2, 3-4, 5-8, ..., >2^(n_bin-2)
+        const PS::S32 n_bin = 12;
+        PS::S64 n_cluster_bin[n_bin];
+        for (PS::S32 k=0; k<n_bin; k++) n_cluster_bin[k] = 0;
+
+        auto& adr_single = search_cluster.getAdrSysOneCluster();
+        n_cluster_bin[0] = adr_single.size();
+
+        PS::S64 n_member_max = 1;
+        PS::S64 n_cluster_multi = 0;
+        PS::S64 n_member_multi = 0;
+        auto countCluster = [&](SystemHard& _sys_hard) {
+            const PS::S32 n_cluster = _sys_hard.getNumberOfClusters();
+            const PS::S32* n_member = _sys_hard.getClusterNumberOfMemberList();
+            for (PS::S32 i=0; i<n_cluster; i++) {
+                PS::S32 k = 1;
+                while (k<n_bin-1 && n_member[i]>((PS::S64)1<<k)) k++;
+                n_cluster_bin[k]++;
+                n_member_max = std::max(n_member_max, (PS::S64)n_member[i]);
+                n_member_multi += n_member[i];
+            }
+            n_cluster_multi += n_cluster;
+        };
+        countCluster(system_hard_isolated);
+#ifdef PARTICLE_SIMULATOR_MPI_PARALLEL
+        countCluster(system_hard_connected);
+#endif
+
+        // neighbor number after the cluster search and changeover radii of real particles
+        const PS::S64 n_loc = stat.n_real_loc;
+        PS::S64 n_ngb_sum = 0;
+        PS::F64 r_out_sum = 0.0;
+        PS::F64 r_out_min = PS::LARGE_FLOAT;
+        PS::F64 r_out_max = 0.0;
+#pragma omp parallel for reduction(+:n_ngb_sum,r_out_sum) reduction(min:r_out_min) reduction(max:r_out_max)
+        for (PS::S64 i=0; i<n_loc; i++) {
+            auto& pi = system_soft[i];
+            n_ngb_sum += pi.n_ngb;
+            const PS::F64 r_out = pi.changeover.getRout();
+            r_out_sum += r_out;
+            r_out_min = std::min(r_out_min, r_out);
+            r_out_max = std::max(r_out_max, r_out);
+        }
+        // single particles have n_ngb = 1 (from the neighbor search kernel) or 0
+        for (PS::S64 k=0; k<adr_single.size(); k++) n_ngb_sum -= system_soft[adr_single[k]].n_ngb;
+
+        PS::S64 n_cluster_bin_glb[n_bin];
+        for (PS::S32 k=0; k<n_bin; k++) n_cluster_bin_glb[k] = PS::Comm::getSum(n_cluster_bin[k]);
+        const PS::S64 n_cluster_multi_glb = PS::Comm::getSum(n_cluster_multi);
+        const PS::S64 n_member_multi_glb = PS::Comm::getSum(n_member_multi);
+        const PS::S64 n_member_max_glb = PS::Comm::getMaxValue(n_member_max);
+        const PS::S64 n_ngb_glb = PS::Comm::getSum(n_ngb_sum);
+        const PS::F64 r_out_sum_glb = PS::Comm::getSum(r_out_sum);
+        const PS::F64 r_out_min_glb = PS::Comm::getMinValue(r_out_min);
+        const PS::F64 r_out_max_glb = PS::Comm::getMaxValue(r_out_max);
+        const PS::S64 n_real_glb = stat.n_real_glb;
+
+        if (_print_flag) {
+            std::cout<<"Cluster statistics: N_single= "<<n_cluster_bin_glb[0]
+                     <<" N_cluster= "<<n_cluster_multi_glb
+                     <<" <N_member>= "<<(n_cluster_multi_glb>0? (PS::F64)n_member_multi_glb/n_cluster_multi_glb: 0.0)
+                     <<" N_member_max= "<<n_member_max_glb
+                     <<" <N_ngb>= "<<(PS::F64)n_ngb_glb/n_real_glb
+                     <<" r_out(min/mean/max)= "<<r_out_min_glb<<" "<<r_out_sum_glb/n_real_glb<<" "<<r_out_max_glb
+                     <<std::endl;
+            std::cout<<"Cluster size distribution (N_member: N_cluster):";
+            for (PS::S32 k=0; k<n_bin; k++) {
+                if (k==0) std::cout<<" 1: ";
+                else if (k==1) std::cout<<" 2: ";
+                else if (k<n_bin-1) std::cout<<" "<<((PS::S64)1<<(k-1))+1<<"-"<<((PS::S64)1<<k)<<": ";
+                else std::cout<<" >"<<((PS::S64)1<<(k-1))<<": ";
+                std::cout<<n_cluster_bin_glb[k];
+            }
+            std::cout<<std::endl;
+        }
+    }
+
     //!leap frog kick for single----------------------------------------------
     /* modify the velocity of particle in global system
        reset particle type to single
@@ -1188,6 +2319,36 @@ public:
         }
     }
 
+#ifdef TREE_LEVEL_STEP
+    //!leap frog kick for single with hierarchical tree step
+    /* Only active particles are kicked; the closing half uses the last block step and the opening half uses the next block step
+       reset particle type to single
+       @param[in,out] _sys: particle system
+       @param[in] _dt_close: closing kick step for level 0
+       @param[in] _dt_open: opening kick step for level 0
+       @param[in]; _adr: address for single particles
+    */
+    void kickOneTreeLevel(SystemSoft & _sys, 
+                          const PS::F64 _dt_close,
+                          const PS::F64 _dt_open,
+                          const PS::ReallocatableArray<PS::S32>& _adr) {
+        const PS::S64 n= _adr.size();
+#pragma omp parallel for
+        for(PS::S32 i=0; i<n; i++){
+            const PS::S32 k=_adr[i];
+            auto& pk = _sys[k];
+            if (pk.tree_active) {
+#ifdef HARD_DEBUG
+                assert(pk.tree_level_last>=0);
+#endif
+                const PS::F64 dt = _dt_close*((PS::S64)1<<pk.tree_level_last) + _dt_open*((PS::S64)1<<pk.tree_level);
+                pk.vel  += pk.acc * dt;
+            }
+            pk.group_data.artificial.setParticleTypeToSingle();
+        }
+    }
+#endif
+
     //!leap frog kick for clusters
     /*! modify the velocity of particle in local, if particle is from remote note and is not group member, do nothing, need MPI receive to update data
        Recover the mass of members for energy calculation
@@ -1324,7 +2485,24 @@ public:
 
         /// Member mass are recovered
         // single and reset particle type to single (due to binary disruption)
-        kickOne(system_soft, _dt_kick, search_cluster.getAdrSysOneCluster());
+#ifdef TREE_LEVEL_STEP
+        if (input_parameters.tree_level_max.value>0) {
+            // split the kick to the closing and opening parts:
+            // the ending step sets next to start (only closing); the starting step is half of the full step (only opening)
+            PS::F64 dt_close = 0.5*_dt_kick, dt_open = 0.5*_dt_kick;
+            if (dt_manager.isNextStart()) {
+                dt_close = _dt_kick;
+                dt_open = 0.0;
+            }
+            else if (_dt_kick<dt_manager.getStep()) {
+                dt_close = 0.0;
+                dt_open = _dt_kick;
+            }
+            kickOneTreeLevel(system_soft, dt_close, dt_open, search_cluster.getAdrSysOneCluster());
+        }
+        else 
+#endif
+            kickOne(system_soft, _dt_kick, search_cluster.getAdrSysOneCluster());
         // isolated
         kickClusterAndRecoverGroupMemberMass(system_soft, system_hard_isolated.getPtcl(), _dt_kick);
         // c.m. artificial
@@ -1380,16 +2558,37 @@ public:
 #endif
     }
 
+    //! resolve parked interrupted clusters of one hard system locally and write back their particles
+    /*! Used when interrupt-park is on, no MPI communication is done.
+        For connected clusters, the write back is done later by search_cluster.writeAndSendBackPtcl.
+     */
+    void resolveParkedClusters(SystemHard& _system_hard) {
+#ifdef PROFILE
+        profile.hard_interrupt.start();
+#endif
+        _system_hard.resolveInterruptClustersOMP(interrupt_handler, interrupt_handler_data);
+        if (&_system_hard==&system_hard_isolated) 
+            _system_hard.writeBackPtclForParkedClusters(system_soft, mass_modify_list);
+#ifdef PROFILE
+        profile.hard_interrupt.end();
+#endif
+    }
+
     //! hard drift
-    /*! \return interrupted cluster total number in all MPI processors
+    /*! If interrupt-park is on, interrupted clusters are parked and the other clusters are written back without waiting.
+      \return interrupted cluster total number in all MPI processors
      */
     PS::S32 drift(const PS::F64 _dt_drift) {
+        const PS::S64 interrupt_park = input_parameters.interrupt_park.value;
         ////// set time
         //system_hard_one_cluster.setTimeOrigin(stat.time);
         //system_hard_isolated.setTimeOrigin(stat.time);
         //system_hard_connected.setTimeOrigin(stat.time);
         ////// set time
 
+        // tolerance factors from the energy errors of the last tree step
+        if (system_hard_isolated.error_budget.isActive()) finalizeErrorBudget();
+
 #ifdef PROFILE
         profile.hard_single.start();
 #endif
@@ -1418,6 +2617,11 @@ public:
         //system_hard_isolated.writeBackPtclForMultiCluster(system_soft, search_cluster.adr_sys_multi_cluster_isolated_,remove_list);
         PS::S32 n_interrupt_isolated = system_hard_isolated.getNumberOfInterruptClusters();
         if(n_interrupt_isolated==0) system_hard_isolated.writeBackPtclForMultiCluster(system_soft, mass_modify_list);
+        else if (interrupt_park>0) {
+            // park interrupted clusters, the others are written back without waiting
+            system_hard_isolated.writeBackPtclForNonInterruptClusters(system_soft, mass_modify_list);
+            if (interrupt_park==1) resolveParkedClusters(system_hard_isolated);
+        }
         // integrate multi cluster A
 
 #ifdef PROFILE
@@ -1425,14 +2629,20 @@ public:
         profile.hard_isolated.barrier();
 #endif
 
+        // with parking, the global interrupt number is counted once at the end of the drift
+        if (interrupt_park==0) {
 #ifdef PARTICLE_SIMULATOR_MPI_PARALLEL        
-        n_interrupt_glb = PS::Comm::getSum(n_interrupt_isolated);
+            n_interrupt_glb = PS::Comm::getSum(n_interrupt_isolated);
 #else 
-        n_interrupt_glb = n_interrupt_isolated;
+            n_interrupt_glb = n_interrupt_isolated;
+#endif
+#ifdef PROFILE
+            n_count_sum.hard_interrupt += n_interrupt_glb;
 #endif
+        }
+        else n_interrupt_glb = 0;
 
 #ifdef PROFILE
-        n_count_sum.hard_interrupt += n_interrupt_glb;
         profile.hard_isolated.end();
 #endif
         /////////////
@@ -1453,7 +2663,10 @@ public:
         profile.hard_connected.barrier();
 #endif
 
-        PS::S32 n_interrupt_connected_glb = PS::Comm::getSum(n_interrupt_connected);
+        // with parking, interrupted connected clusters are resolved locally since the write back needs the communication of all processes
+        PS::S32 n_interrupt_connected_glb = 0;
+        if (interrupt_park==0) n_interrupt_connected_glb = PS::Comm::getSum(n_interrupt_connected);
+        else if (n_interrupt_connected>0) resolveParkedClusters(system_hard_connected);
 
 #ifdef PROFILE
         n_count_sum.hard_interrupt += n_interrupt_connected_glb;
@@ -1475,10 +2688,33 @@ public:
         profile.hard_connected.end();
 #endif
 #endif
+
+        // parked isolated clusters returned to the caller, one global reduction
+        if (interrupt_park==2) {
+#ifdef PARTICLE_SIMULATOR_MPI_PARALLEL        
+            n_interrupt_glb = PS::Comm::getSum(system_hard_isolated.getNumberOfInterruptClusters());
+#else 
+            n_interrupt_glb = system_hard_isolated.getNumberOfInterruptClusters();
+#endif
+#ifdef PROFILE
+            n_count_sum.hard_interrupt += n_interrupt_glb;
+#endif
+        }
+
         // drift cm
         stat.pcm.pos += stat.pcm.vel*_dt_drift;
         
         if (n_interrupt_glb==0) Ptcl::group_data_mode = GroupDataMode::cm;
+
+#ifdef NB_GROUP_CM
+        // mark members of stable groups for the next neighbor searching, before the particle system is reordered
+        if (system_hard_isolated.neighbor_group_flag) {
+            resetNeighborGroup();
+            system_hard_isolated.setNeighborGroupToPtcl(system_soft);
+        }
+#endif
+
+        if (system_hard_isolated.group_catalog.record_flag) writeGroupCatalog();
         
         return n_interrupt_glb;
     }
@@ -1494,11 +2730,19 @@ public:
 
         // finish interrupt clusters first
         // isolated clusters
+        const PS::S64 interrupt_park = input_parameters.interrupt_park.value;
         PS::S32 n_interrupt_isolated = 0;
         if (system_hard_isolated.getNumberOfInterruptClusters()>0) {
             system_hard_isolated.finishIntegrateInterruptClustersOMP();
+#ifdef NB_GROUP_CM
+            if (system_hard_isolated.neighbor_group_flag) system_hard_isolated.setNeighborGroupToPtcl(system_soft);
+#endif
             n_interrupt_isolated = system_hard_isolated.getNumberOfInterruptClusters();
-            if(n_interrupt_isolated==0) system_hard_isolated.writeBackPtclForMultiCluster(system_soft, mass_modify_list);
+            if(n_interrupt_isolated==0) {
+                // with parking, only the parked clusters are not written back yet
+                if (interrupt_park>0) system_hard_isolated.writeBackPtclForParkedClusters(system_soft, mass_modify_list);
+                else system_hard_isolated.writeBackPtclForMultiCluster(system_soft, mass_modify_list);
+            }
         }
 
 #ifdef PROFILE
@@ -1518,6 +2762,8 @@ public:
 #endif
 
 #ifdef PARTICLE_SIMULATOR_MPI_PARALLEL
+        // with parking, connected clusters are already finished in drift
+        if (interrupt_park==0) {
 #ifdef PROFILE
         profile.hard_connected.start();
 #endif
@@ -1555,6 +2801,7 @@ public:
         PS::Comm::barrier();
         profile.hard_connected.end();
 #endif
+        }
 #endif
 
 #ifdef HARD_INTERRUPT_PRINT
@@ -1623,7 +2870,55 @@ public:
         }
         return true;
     }
-    
+
+    //! write the groups recorded by the hard integrators at the beginning of the drift to the catalog file of this process
+    /*! The entries of all threads (isolated and connected clusters) are merged and sorted by group id, level and binary id.
+        No communication is needed.
+     */
+    void writeGroupCatalog() {
+#ifdef PROFILE
+        profile.output.start();
+#endif
+        group_catalog_list.clear();
+        system_hard_isolated.group_catalog.gather(group_catalog_list);
+        system_hard_isolated.group_catalog.record_flag = false;
+#ifdef PARTICLE_SIMULATOR_MPI_PARALLEL
+        system_hard_connected.group_catalog.gather(group_catalog_list);
+        system_hard_connected.group_catalog.record_flag = false;
+#endif
+        std::sort(group_catalog_list.begin(), group_catalog_list.end(), 
+                  [](const GroupCatalogEntry& a, const GroupCatalogEntry& b) { 
+                      if (a.id_group!=b.id_group) return a.id_group<b.id_group;
+                      if (a.level!=b.level) return a.level<b.level;
+                      return a.id<b.id;});
+        for (auto& entry : group_catalog_list) {
+            entry.printColumn(fcatalog, WRITE_WIDTH);
+            fcatalog<<std::endl;
+        }
+#ifdef PROFILE
+        profile.output.end();
+#endif
+    }
+
+    //! write the local tracked particles to the track files of this process
+    /*! Called before the kick, positions are synchronized at stat.time; the track files are opened at the first call.
+        No communication is needed.
+      @param[in] _dt_close: closing part of the current kick step, used to synchronize velocities
+     */
+    void writeTrackParticles(const PS::F64 _dt_close) {
+#ifdef PROFILE
+        profile.output.start();
+#endif
+        if (!particle_track.isOpen())
+            particle_track.openFiles(input_parameters.fname_snp.value, my_rank, input_parameters.append_switcher.value==1);
+        // the map is only reconstructed after the local particles are exchanged, sorted or removed
+        if (!id_adr_map_valid) reconstructIdAdrMap();
+        particle_track.write(system_soft, id_adr_map, stat.n_real_loc, stat.time, n_loop, _dt_close);
+#ifdef PROFILE
+        profile.output.end();
+#endif
+    }
+
     //! write back hard particles to global system
     void writeBackHardParticles() {
 #ifdef PROFILE
@@ -1675,12 +2970,18 @@ public:
 #endif
         // correct changeover for first step
         // Isolated clusters
-        system_hard_isolated.correctForceForChangeOverUpdateOMP<SystemSoft, TreeForce, EPJSoft>(system_soft, tree_soft);
+        if (use_direct_soft_force)
+            system_hard_isolated.correctForceForChangeOverUpdateOMP<SystemSoft, SoftForceDirect, EPJSoft>(system_soft, soft_force_direct);
+        else
+            system_hard_isolated.correctForceForChangeOverUpdateOMP<SystemSoft, TreeForce, EPJSoftTree>(system_soft, *tree_soft);
 
 #ifdef PARTICLE_SIMULATOR_MPI_PARALLEL        
         // Connected clusters
         auto& adr_send = search_cluster.getAdrSysConnectClusterSend();
-        system_hard_connected.correctForceForChangeOverUpdateOMP<SystemSoft, TreeForce, EPJSoft>(system_soft, tree_soft, adr_send.getPointer(), adr_send.size());
+        if (use_direct_soft_force)
+            system_hard_connected.correctForceForChangeOverUpdateOMP<SystemSoft, SoftForceDirect, EPJSoft>(system_soft, soft_force_direct, adr_send.getPointer(), adr_send.size());
+        else
+            system_hard_connected.correctForceForChangeOverUpdateOMP<SystemSoft, TreeForce, EPJSoftTree>(system_soft, *tree_soft, adr_send.getPointer(), adr_send.size());
 #endif
 
 #ifdef PROFILE
@@ -1773,6 +3074,12 @@ public:
             PS::F64 energy_old = stat.energy.ekin + stat.energy.epot;
             stat.energy.etot_sd_ref -= stat.energy.ekin_sd + stat.energy.epot_sd - energy_old;
 #endif
+#ifdef TREE_LEVEL_STEP
+            // setTreeLevelActive synchronizes all particles at output steps, thus the soft potentials are calculated at the current time
+            if (input_parameters.tree_level_max.value>0) {
+                for (PS::S64 i=0; i<stat.n_real_loc; i++) assert(system_soft[i].tree_active);
+            }
+#endif
 #ifdef RECORD_CM_IN_HEADER
             stat.energy.calc(&system_soft[0], stat.n_real_loc,false, &(stat.pcm.pos), &(stat.pcm.vel));
 #else
@@ -1833,7 +3140,56 @@ public:
 #endif
     }
 
+    //! update the tolerance factors of the error-budget controller from the energy errors of the last tree step
+    /*! The budget of the system, hard-error-budget * |E_sys| with the total energy from the last energy check, is distributed to all clusters 
+        by |E_SD| of clusters, the sum of |E_SD| is reduced over all hard systems and MPI processes. 
+        Called at the beginning of the drift, thus the clusters finished after interruptions in the last tree step are included.
+     */
+    void finalizeErrorBudget() {
+        PS::F64 etot_sum_loc = system_hard_isolated.error_budget.getEnergySum();
+#ifdef PARTICLE_SIMULATOR_MPI_PARALLEL
+        etot_sum_loc += system_hard_connected.error_budget.getEnergySum();
+        const PS::F64 etot_sum_glb = PS::Comm::getSum(etot_sum_loc);
+#else
+        const PS::F64 etot_sum_glb = etot_sum_loc;
+#endif
+        const PS::F64 energy_sys = stat.energy.ekin + stat.energy.epot;
+        system_hard_isolated.error_budget.finalize(energy_sys, etot_sum_glb);
+#ifdef PARTICLE_SIMULATOR_MPI_PARALLEL
+        system_hard_connected.error_budget.finalize(energy_sys, etot_sum_glb);
+#endif
+    }
+
     //! output data
+    //! print the statistics of the error-budget controller of hard clusters since the last call and reset them
+    /*! @param[in] _print_flag: print on rank 0
+     */
+    void printErrorBudgetStatistics(const bool _print_flag) {
+        ErrorBudgetStat st;
+        st += system_hard_isolated.error_budget.stat;
+        system_hard_isolated.error_budget.stat.clear();
+#ifdef PARTICLE_SIMULATOR_MPI_PARALLEL
+        st += system_hard_connected.error_budget.stat;
+        system_hard_connected.error_budget.stat.clear();
+#endif
+        const PS::S64 n_cluster = PS::Comm::getSum(st.n_cluster);
+        const PS::S64 n_tight = PS::Comm::getSum(st.n_tight);
+        const PS::S64 n_relax = PS::Comm::getSum(st.n_relax);
+        const PS::F64 de_sum = PS::Comm::getSum(st.de_sum);
+        const PS::F64 budget_sum = PS::Comm::getSum(st.budget_sum);
+        const PS::F64 factor_min = PS::Comm::getMinValue(st.factor_min);
+        const PS::F64 factor_max = PS::Comm::getMaxValue(st.factor_max);
+        if (_print_flag && n_cluster>0) 
+            std::cout<<"Hard error budget: N_cluster= "<<n_cluster
+                     <<" N_tight= "<<n_tight
+                     <<" N_relax= "<<n_relax
+                     <<" factor_min= "<<factor_min
+                     <<" factor_max= "<<factor_max
+                     <<" sum|dE_SD|= "<<de_sum
+                     <<" sum(budget)= "<<budget_sum
+                     <<std::endl;
+    }
+
     void output() {
 #ifdef PROFILE
         profile.output.start();
@@ -1846,6 +3202,31 @@ public:
             std::cout<<std::endl;
             stat.print(std::cout);
         }
+
+        // hierarchical tree step: report the average active (i-particle) fraction since the last output
+        if(input_parameters.tree_level_max.value>0 && n_tree_step_sum>0) {
+            PS::S64 n_active_glb = PS::Comm::getSum(n_tree_active_sum);
+            PS::S64 n_real_glb = PS::Comm::getSum(n_tree_real_sum);
+            if(print_flag) 
+                std::cout<<"Hierarchical tree step: N_step= "<<n_tree_step_sum
+                         <<" <N_active>= "<<(PS::F64)n_active_glb/n_tree_step_sum
+                         <<" <N_real>= "<<(PS::F64)n_real_glb/n_tree_step_sum
+                         <<" active fraction= "<<(PS::F64)n_active_glb/n_real_glb
+                         <<std::endl;
+            n_tree_step_sum = 0;
+            n_tree_active_sum = 0;
+            n_tree_real_sum = 0;
+        }
+
+        // error-budget controller of hard clusters: report the statistics since the last output
+        if(input_parameters.hard_error_budget.value>0.0) printErrorBudgetStatistics(print_flag);
+
+        // cluster size distribution, neighbor number and changeover radii
+        if((changeover_adapt_flag || input_parameters.cluster_stat.value==1) && stat.n_real_glb>1) printClusterStatistics(print_flag);
+
+        // memory usage of subsystems
+        updateMemoryUsage();
+
         // write status, output to separate snapshots
         if(write_style==1) {
             // status output
@@ -1887,6 +3268,14 @@ public:
             fstatus<<std::endl;
         }
 
+        // record groups in the hard integrators at the beginning of the next drift, which starts from the current time
+        if (fcatalog.is_open()) {
+            system_hard_isolated.group_catalog.record_flag = true;
+#ifdef PARTICLE_SIMULATOR_MPI_PARALLEL
+            system_hard_connected.group_catalog.record_flag = true;
+#endif
+        }
+
         // save current error
         stat.energy.saveEnergyError();
 
@@ -1917,6 +3306,7 @@ public:
         PS::S64 ARC_n_groups      = system_hard_isolated.ARC_n_groups;
         PS::S64 ARC_n_groups_iso  = system_hard_isolated.ARC_n_groups_iso;
         PS::S64 H4_step_sum       = system_hard_isolated.H4_step_sum;
+        PS::S64 warm_start_count  = system_hard_isolated.warm_start_count;
 #ifdef HARD_COUNT_NO_NEIGHBOR
         PS::S64 n_neighbor_zero   = system_hard_isolated.n_neighbor_zero;
 #endif
@@ -1931,6 +3321,7 @@ public:
         ARC_n_groups += system_hard_connected.ARC_n_groups;
         ARC_n_groups_iso += system_hard_connected.ARC_n_groups_iso;
         H4_step_sum +=  system_hard_connected.H4_step_sum;
+        warm_start_count += system_hard_connected.warm_start_count;
 #ifdef HARD_COUNT_NO_NEIGHBOR
         n_neighbor_zero+= system_hard_connected.n_neighbor_zero;
 #endif
@@ -1941,6 +3332,7 @@ public:
         n_count.ARC_n_groups     += ARC_n_groups;
         n_count.ARC_n_groups_iso += ARC_n_groups_iso;
         n_count.H4_step_sum      += H4_step_sum;
+        n_count.hard_warm_start  += warm_start_count;
 #ifdef HARD_COUNT_NO_NEIGHBOR
         n_count.n_neighbor_zero  += n_neighbor_zero;
 #endif
@@ -1950,6 +3342,7 @@ public:
         n_count_sum.ARC_n_groups     += PS::Comm::getSum(ARC_n_groups);
         n_count_sum.ARC_n_groups_iso     += PS::Comm::getSum(ARC_n_groups_iso);
         n_count_sum.H4_step_sum      += PS::Comm::getSum(H4_step_sum);
+        n_count_sum.hard_warm_start  += PS::Comm::getSum(warm_start_count);
 #ifdef HARD_COUNT_NO_NEIGHBOR
         n_count_sum.n_neighbor_zero  += PS::Comm::getSum(n_neighbor_zero);
 #endif
@@ -1959,6 +3352,7 @@ public:
         system_hard_isolated.ARC_n_groups = 0;
         system_hard_isolated.ARC_n_groups_iso = 0;
         system_hard_isolated.H4_step_sum = 0;
+        system_hard_isolated.warm_start_count = 0;
 #ifdef HARD_COUNT_NO_NEIGHBOR
         system_hard_isolated.n_neighbor_zero = 0;
 #endif
@@ -1969,6 +3363,7 @@ public:
         system_hard_connected.ARC_n_groups = 0;
         system_hard_connected.ARC_n_groups_iso = 0;
         system_hard_connected.H4_step_sum = 0;
+        system_hard_connected.warm_start_count = 0;
 #ifdef HARD_COUNT_NO_NEIGHBOR
         system_hard_connected.n_neighbor_zero = 0;
 #endif
@@ -2087,6 +3482,12 @@ public:
                 
             std::cout<<"**** Number of members in clusters (global):\n";
             n_count_sum.printHist(std::cout,PRINT_WIDTH,dn_loop);
+
+            std::cout<<"**** Memory usage [MB] (local): [Current/Peak]\n";
+            mem_usage.dumpName(std::cout,PRINT_WIDTH);
+            std::cout<<std::endl;
+            mem_usage.dump(std::cout,PRINT_WIDTH);
+            std::cout<<std::endl;
         }
 
         if(input_parameters.write_style.value>0) {
@@ -2104,11 +3505,52 @@ public:
             gpu_counter.dump(fprofile, WRITE_WIDTH, dn_loop);
 #endif
             n_count.dump(fprofile, WRITE_WIDTH, dn_loop);
+            mem_usage.dump(fprofile, WRITE_WIDTH);
             fprofile<<std::endl;
         }
     }
 #endif
 
+    //! update the current and peak memory usage of subsystems (local)
+    /*! The allocated capacities of particle arrays, FDPS trees (including LETs), cluster searching and hard system buffers are collected.
+        The thread-local buffers of SIMD force kernels are counted when USE_SIMD is used, including the shared buffers of the CPU multi-walk mode.
+     */
+    void updateMemoryUsage() {
+        mem_usage.system_soft.set(system_soft.getMemSizeUsed());
+        if (tree_soft!=NULL) mem_usage.tree_soft.set(tree_soft->getMemSizeUsed());
+        mem_usage.tree_nb.set(tree_nb.getMemSizeUsed());
+        mem_usage.soft_direct.set(soft_force_direct.getMemSizeUsed());
+#ifdef USE_SIMD
+        size_t size_kernel = PS::Comm::getNumberOfThread()*getSimdKernelBufferMemSizeOneThread();
+#ifdef USE_CPU_MULTI_WALK
+        if (input_parameters.cpu_multi_walk.value>0) size_kernel += getCPUMultiWalkMemSizeUsed();
+#endif
+        mem_usage.soft_kernel.set(size_kernel);
+#endif
+        mem_usage.search_cluster.set(search_cluster.getMemSizeUsed());
+        size_t size_hard = system_hard_one_cluster.getMemSizeUsed() + system_hard_isolated.getMemSizeUsed();
+#ifdef PARTICLE_SIMULATOR_MPI_PARALLEL
+        size_hard += system_hard_connected.getMemSizeUsed();
+#endif
+        mem_usage.system_hard.set(size_hard);
+        // the node size of std::map is estimated by the key-value pair and three link pointers
+        size_t size_other = id_adr_map.size()*(sizeof(std::pair<const PS::S64, PS::S32>)+3*sizeof(void*))
+            + mass_modify_list.getMemSize() + remove_list.getMemSize() + remove_id_record.getMemSize()
+            + morton_key_list.getMemSize() + ptcl_sort_buf.getMemSize();
+        if (pos_domain!=NULL) size_other += n_proc*sizeof(PS::F64ort);
+        mem_usage.other.set(size_other);
+        mem_usage.setTotal();
+    }
+
+    //! print the breakdown table of the memory usage if memory_report is switched on
+    /*! All MPI processes should call this function
+     */
+    void printMemoryReport() {
+        if (input_parameters.memory_report.value==0 || !initial_step_flag) return;
+        updateMemoryUsage();
+        mem_usage.printTable(std::cout, input_parameters.print_flag, PRINT_WIDTH);
+    }
+
     //! get address of particle from an id, if not found, return -1
     PS::S32 getParticleAdrFromID(const PS::S64 _id) {
         auto item = id_adr_map.find(_id);
@@ -2125,27 +3567,32 @@ public:
     void reconstructIdAdrMap() {
         id_adr_map.clear();
         for (PS::S32 i=0; i<stat.n_real_loc; i++) id_adr_map[system_soft[i].id] = i;
+        id_adr_map_valid = true;
     }
 
 #ifdef STELLAR_EVOLUTION
     //! Correct potential energy due to modificaiton of particle mass
     void correctSoftPotMassChange() {
         // correct soft potential energy due to mass change
-#pragma omp parallel for
-        for (int k=0; k<mass_modify_list.size(); k++)  {
+        // the loop is serial in the reproducible mode to keep the summation order
+        const bool reproducible_mode = (input_parameters.reproducible.value==1);
+        const PS::S32 n_modify = mass_modify_list.size();
+        PS::F64 dpot_sum = 0.0;
+#pragma omp parallel for reduction(+:dpot_sum) if(!reproducible_mode)
+        for (int k=0; k<n_modify; k++)  {
             PS::S32 i = mass_modify_list[k];
             auto& pi = system_soft[i];
-            PS::F64 dpot = pi.dm*pi.pot_soft;
-            stat.energy.etot_ref += dpot;
-            stat.energy.de_change_cum += dpot;
-            stat.energy.etot_sd_ref += dpot;
-            stat.energy.de_sd_change_cum += dpot;
+            dpot_sum += pi.dm*pi.pot_soft;
             pi.dm = 0.0;
             // ghost particle case, check in remove_particle instead
             //if(pi.mass==0.0&&pi.group_data.artificial.isUnused()) {
             //    remove_list.push_back(i);
             //}
         }
+        stat.energy.etot_ref += dpot_sum;
+        stat.energy.de_change_cum += dpot_sum;
+        stat.energy.etot_sd_ref += dpot_sum;
+        stat.energy.de_sd_change_cum += dpot_sum;
         mass_modify_list.resizeNoInitialize(0);
     }
 #endif
@@ -2197,21 +3644,22 @@ public:
         PS::ReallocatableArray<PS::S32> remove_list_thx[num_thread];
         for (PS::S32 i=0; i<num_thread; i++) remove_list_thx[i].resizeNoInitialize(0);
 
+        // energy loss of escapers, summed in the index order in the reproducible mode
+        const bool reproducible_mode = (input_parameters.reproducible.value==1);
+        auto calcEnergyLoss = [](const FPSoft& _pi) -> PS::F64 {
+            return _pi.mass*_pi.pot_tot + 0.5*_pi.mass*(_pi.vel*_pi.vel);
+        };
+        PS::F64 eloss_sum = 0.0;
 #pragma omp parallel
         { 
             const PS::S32 ith = PS::Comm::getThreadNum();
-#pragma omp for 
+            // static schedule: the per-thread remove lists are joined in thread order, thus the escapers are in the index order and the energy loss in the reproducible mode is summed in a fixed order
+#pragma omp for schedule(static) reduction(+:eloss_sum)
             for (PS::S32 i=0; i<stat.n_real_loc; i++) {
                 auto& pi = system_soft[i];
                 if (escaper.isEscaper(pi,stat.pcm)) {
                     remove_list_thx[ith].push_back(i);
-                    PS::F64 dpot = pi.mass*pi.pot_tot;
-                    PS::F64 dkin = 0.5*pi.mass*(pi.vel*pi.vel);
-                    PS::F64 eloss = dpot + dkin;
-                    stat.energy.etot_ref -= eloss;
-                    stat.energy.de_change_cum -= eloss;
-                    stat.energy.etot_sd_ref -= eloss;
-                    stat.energy.de_sd_change_cum -= eloss;
+                    if (!reproducible_mode && pi.mass>0) eloss_sum += calcEnergyLoss(pi);
                 }
                 // Registered removed particles have already done energy correction
                 else if (pi.mass==0.0&&pi.group_data.artificial.isUnused()) 
@@ -2226,6 +3674,7 @@ public:
                 PS::S32 index=remove_list_thx[i][k];
                 remove_list.push_back(index);
                 if (system_soft[index].mass>0) {
+                    if (reproducible_mode) eloss_sum += calcEnergyLoss(system_soft[index]);
                     if (input_parameters.write_style.value>0) {
                         fesc<<std::setw(WRITE_WIDTH)<<stat.time;
                         system_soft[index].printColumn(fesc,WRITE_WIDTH);
@@ -2235,9 +3684,15 @@ public:
                 }
             }
 
+        stat.energy.etot_ref -= eloss_sum;
+        stat.energy.de_change_cum -= eloss_sum;
+        stat.energy.etot_sd_ref -= eloss_sum;
+        stat.energy.de_sd_change_cum -= eloss_sum;
+
         // Remove particles
         n_remove = remove_list.size();
         system_soft.removeParticle(remove_list.getPointer(), remove_list.size());
+        if (n_remove>0) id_adr_map_valid = false;
 
         stat.n_escape_glb += PS::Comm::getSum(n_esc);
         stat.n_remove_glb += PS::Comm::getSum(n_remove);
@@ -2283,6 +3738,57 @@ public:
         return remove_id_record.getPointer();
     }
 
+    //! spread the lower 21 bits of an integer to every third bit for Morton key
+    static PS::U64 spreadBitsMorton(PS::U64 _x) {
+        _x &= 0x1fffff;
+        _x = (_x | _x<<32) & 0x1f00000000ffffULL;
+        _x = (_x | _x<<16) & 0x1f0000ff0000ffULL;
+        _x = (_x | _x<<8)  & 0x100f00f00f00f00fULL;
+        _x = (_x | _x<<4)  & 0x10c30c30c30c30c3ULL;
+        _x = (_x | _x<<2)  & 0x1249249249249249ULL;
+        return _x;
+    }
+
+    //! sort local real particles in Morton order of positions
+    /*! The key uses 21 bits per dimension in the bounding box of local particles.
+        Particles close in space become close in memory, which improves the cache usage of the neighbor search, cluster search, force correction and kick loops.
+        The particle addresses (adr) should be updated after sorting.
+     */
+    void sortParticleMorton() {
+        const PS::S32 n_loc = system_soft.getNumberOfParticleLocal();
+        PS::F64vec pos_min = system_soft[0].pos;
+        PS::F64vec pos_max = pos_min;
+        for (PS::S32 i=1; i<n_loc; i++) {
+            const PS::F64vec& pos = system_soft[i].pos;
+            pos_min.x = std::min(pos_min.x, pos.x);
+            pos_min.y = std::min(pos_min.y, pos.y);
+            pos_min.z = std::min(pos_min.z, pos.z);
+            pos_max.x = std::max(pos_max.x, pos.x);
+            pos_max.y = std::max(pos_max.y, pos.y);
+            pos_max.z = std::max(pos_max.z, pos.z);
+        }
+        const PS::F64vec dpos = pos_max - pos_min;
+        const PS::F64 len = std::max(dpos.x, std::max(dpos.y, dpos.z));
+        if (len<=0.0) return;
+        const PS::F64 scale = 2097151.0/len;
+
+        morton_key_list.resizeNoInitialize(n_loc);
+#pragma omp parallel for
+        for (PS::S32 i=0; i<n_loc; i++) {
+            const PS::F64vec dp = (system_soft[i].pos - pos_min)*scale;
+            const PS::U64 key = (spreadBitsMorton((PS::U64)dp.x)<<2) | (spreadBitsMorton((PS::U64)dp.y)<<1) | spreadBitsMorton((PS::U64)dp.z);
+            morton_key_list[i] = std::make_pair(key, i);
+        }
+        // the address is the second key, thus the order is deterministic
+        std::sort(morton_key_list.getPointer(), morton_key_list.getPointer(n_loc));
+
+        ptcl_sort_buf.resizeNoInitialize(n_loc);
+#pragma omp parallel for
+        for (PS::S32 i=0; i<n_loc; i++) ptcl_sort_buf[i] = system_soft[morton_key_list[i].second];
+#pragma omp parallel for
+        for (PS::S32 i=0; i<n_loc; i++) system_soft[i] = ptcl_sort_buf[i];
+    }
+
     //! exchange particles
     void exchangeParticle() {
         assert(n_interrupt_glb==0);
@@ -2291,9 +3797,22 @@ public:
         profile.exchange.start();
 #endif
         system_soft.exchangeParticle(dinfo);
+        if (PS::Comm::getNumberOfProc()>1) id_adr_map_valid = false;
 
         const PS::S32 n_loc = system_soft.getNumberOfParticleLocal();
 
+        // periodic reordering in Morton order, the particle addresses are set below
+        const PS::S64 n_sort_interval = input_parameters.morton_sort_interval.value;
+        bool sort_flag = (n_sort_interval>0 && n_loop%n_sort_interval==0 && n_loc>1);
+        if (sort_flag) {
+            sortParticleMorton();
+            id_adr_map_valid = false;
+        }
+
+        // NUMA-aware mode: keep the pages of local particles on the node of the thread processing them
+        if (input_parameters.numa_mode.value>0 && n_loc>0) 
+            numa_control.placeArrayIfChanged(&system_soft[0], n_loc);
+
 #pragma omp parallel for
         for(PS::S32 i=0; i<n_loc; i++){
             system_soft[i].rank_org = my_rank;
@@ -2302,6 +3821,9 @@ public:
 
         // record real particle n_loc/glb
         stat.n_real_loc = n_loc;
+
+        // the addresses are changed by sorting, update the map if it is used
+        if (sort_flag && id_adr_map.size()>0) reconstructIdAdrMap();
 #ifdef PETAR_DEBUG
         assert(stat.n_real_glb==system_soft.getNumberOfParticleGlobal());
 #endif
@@ -2373,6 +3895,8 @@ public:
 
 #ifdef ORBIT_SAMPLING
         fout<<"Use orbit-sampling method\n";
+#elif defined(ORBIT_QUADRUPOLE)
+        fout<<"Use orbit-averaged quadrupole method\n";
 #else
         fout<<"Use Pseudoparticle multipole method\n";
 #endif
@@ -2416,10 +3940,22 @@ public:
 #endif
 #endif
 
+#ifdef COMPACT_LET
+        fout<<"Use compact LET: j particle of soft tree "<<sizeof(EPJSoftTree)<<" bytes (EPJSoft "<<sizeof(EPJSoft)<<" bytes), single-precision super particle moments\n";
+#endif
+
 #ifdef USE_FUGAKU
         fout<<"Use Fugaku\n";
 #endif
 
+#ifdef USE_AARCH64
+#ifdef __ARM_FEATURE_SVE
+        fout<<"Use aarch64 SVE: "<<AArch64Vec::getLaneN()<<" single-precision lanes\n";
+#else
+        fout<<"Use aarch64 NEON: "<<AArch64Vec::getLaneN()<<" single-precision lanes\n";
+#endif
+#endif
+
 #ifdef USE_GPU
         fout<<"Use GPU\n";
 #endif
@@ -2464,60 +4000,11 @@ public:
         H4::printDebugFeatures(fout);
     }
 
-    //! reading input parameters using getopt method
-    /*! 
-      @param[in] argc: number of options
-      @param[in] argv: string of options
-      \return -1 if help is used
-     */
-    int readParameters(int argc, char *argv[]) {
-        // print reference
-        if (my_rank==0) {
-            printLogo(std::cerr);
-            printReference(std::cerr);
-            printFeatures(std::cerr);
-            printDebugFeatures(std::cerr);
-            std::cerr<<"====================================="<<std::endl;
-        }
-
-        //assert(initial_fdps_flag);
-        assert(!read_parameters_flag);
-        // reading parameters
-        opterr = 0;
-        read_parameters_flag = true;
-        if (my_rank==0) input_parameters.print_flag=true;
-        else input_parameters.print_flag=false;
-        int read_flag = input_parameters.read(argc,argv);
-#ifdef BSE_BASE
-        if (my_rank==0) bse_parameters.print_flag=true;
-        else bse_parameters.print_flag=false;
-        bse_parameters.read(argc,argv);
-#endif
-#ifdef GALPY
-        if (my_rank==0) galpy_parameters.print_flag=true;
-        else galpy_parameters.print_flag=false;
-        galpy_parameters.read(argc,argv);
-#endif
-
-        // help case, return directly
-        if (read_flag==-1) {
-            // avoid segmentation fault due to FDPS clear function bug
-            tree_nb.initialize(input_parameters.n_glb.value, input_parameters.theta.value, input_parameters.n_leaf_limit.value, input_parameters.n_group_limit.value);
-            tree_soft.initialize(input_parameters.n_glb.value, input_parameters.theta.value, input_parameters.n_leaf_limit.value, input_parameters.n_group_limit.value);
-
-            return read_flag;
-        }
-
-        bool print_flag = input_parameters.print_flag;
+    //! open output files using the prefix fname_snp
+    void openOutputFiles() {
         int write_style = input_parameters.write_style.value;
 
 #ifdef PROFILE
-        if(print_flag) {
-            std::cout<<"----- Parallelization information -----\n";
-            std::cout<<"MPI processors: "<<n_proc<<std::endl;
-            std::cout<<"OMP threads:    "<<PS::Comm::getNumberOfThread()<<std::endl;
-        }
-    
         // open profile file
         if(write_style>0) {
             std::string fproname=input_parameters.fname_snp.value+".prof.rank."+std::to_string(my_rank);
@@ -2539,6 +4026,7 @@ public:
                 gpu_counter.dumpName(fprofile, WRITE_WIDTH);
 #endif
                 n_count.dumpName(fprofile, WRITE_WIDTH);
+                mem_usage.dumpName(fprofile, WRITE_WIDTH);
                 fprofile<<std::endl;
             }
         }
@@ -2593,6 +4081,19 @@ public:
             hard_manager.ar_manager.interaction.fout_bse<<std::setprecision(WRITE_PRECISION);
 #endif 
 
+            // open group catalog file
+            if (input_parameters.group_catalog.value==1) {
+                std::string fcatalog_name = fname_snp + ".catalog." + my_rank_str;
+                if(input_parameters.append_switcher.value==1) 
+                    fcatalog.open(fcatalog_name.c_str(), std::ofstream::out|std::ofstream::app);
+                else {
+                    fcatalog.open(fcatalog_name.c_str(), std::ofstream::out);
+                    GroupCatalogEntry::printColumnTitle(fcatalog, WRITE_WIDTH);
+                    fcatalog<<std::endl;
+                }
+                fcatalog<<std::setprecision(WRITE_PRECISION);
+            }
+
 #ifdef ADJUST_GROUP_PRINT
             // open file for new/end group information
             if (input_parameters.adjust_group_write_option.value==1) {
@@ -2606,6 +4107,74 @@ public:
 #endif
         }
 
+        // tracked particle list, the track files are opened at the first writing
+        if (input_parameters.fname_track.value!="__NONE__") particle_track.readIdList(input_parameters.fname_track.value);
+    }
+
+    //! reading input parameters using getopt method
+    /*! 
+      @param[in] argc: number of options
+      @param[in] argv: string of options
+      \return -1 if help is used
+     */
+    int readParameters(int argc, char *argv[]) {
+        // print reference
+        if (my_rank==0) {
+            printLogo(std::cerr);
+            printReference(std::cerr);
+            printFeatures(std::cerr);
+            printDebugFeatures(std::cerr);
+            std::cerr<<"====================================="<<std::endl;
+        }
+
+        //assert(initial_fdps_flag);
+        assert(!read_parameters_flag);
+        // reading parameters
+        opterr = 0;
+        read_parameters_flag = true;
+        if (my_rank==0) input_parameters.print_flag=true;
+        else input_parameters.print_flag=false;
+        int read_flag = input_parameters.read(argc,argv);
+#ifdef BSE_BASE
+        if (my_rank==0) bse_parameters.print_flag=true;
+        else bse_parameters.print_flag=false;
+        bse_parameters.read(argc,argv);
+#endif
+#ifdef GALPY
+        if (my_rank==0) galpy_parameters.print_flag=true;
+        else galpy_parameters.print_flag=false;
+        galpy_parameters.read(argc,argv);
+#endif
+
+        // help case, return directly
+        if (read_flag==-1) {
+            // avoid segmentation fault due to FDPS clear function bug
+            tree_nb.initialize(input_parameters.n_glb.value, input_parameters.theta.value, input_parameters.n_leaf_limit.value, input_parameters.n_group_limit.value);
+
+            return read_flag;
+        }
+
+        bool print_flag = input_parameters.print_flag;
+
+#ifdef PROFILE
+        if(print_flag) {
+            std::cout<<"----- Parallelization information -----\n";
+            std::cout<<"MPI processors: "<<n_proc<<std::endl;
+            std::cout<<"OMP threads:    "<<PS::Comm::getNumberOfThread()<<std::endl;
+        }
+
+#endif
+
+        // NUMA-aware mode: pin threads before the main arrays are allocated
+        if (input_parameters.numa_mode.value==2) {
+            bool pin_flag = NumaControl::pinThreads();
+            if (!pin_flag && print_flag) std::cerr<<"Warning: fail to pin OpenMP threads to cpus."<<std::endl;
+        }
+        if (input_parameters.numa_mode.value>0 && print_flag) NumaControl::printThreadBinding(std::cout);
+
+        // open output files, in the ensemble mode, files are opened for each simulation separately
+        if (input_parameters.fname_ensemble.value=="__NONE__") openOutputFiles();
+
 #ifdef HARD_DUMP
         // initial hard_dump 
         const PS::S32 num_thread = PS::Comm::getNumberOfThread();
@@ -2630,8 +4199,7 @@ public:
         tree_nb.initialize(input_parameters.n_glb.value, input_parameters.theta.value, input_parameters.n_leaf_limit.value, input_parameters.n_group_limit.value);
 
         // tree for force
-        PS::S64 n_tree_init = input_parameters.n_glb.value + input_parameters.n_bin.value;
-        tree_soft.initialize(n_tree_init, input_parameters.theta.value, input_parameters.n_leaf_limit.value, input_parameters.n_group_limit.value);
+        setTreeSoft(input_parameters.theta.value, input_parameters.n_leaf_limit.value, input_parameters.n_group_limit.value);
 
         // initial search cluster
         search_cluster.initialize();
@@ -3112,8 +4680,13 @@ public:
         // if r_bin is not defined, set to theta * r_in
         if (r_bin==0.0) r_bin = 0.8*r_in;
 
+        // adaptive changeover: r_out can be reduced to changeover_adapt_min * r_out, 
+        // the linear cutoff radius of the soft force and r_search_min should not be larger than the minimum r_out, so that the changeover correction can be done by using neighbor lists.
+        changeover_adapt_flag = (input_parameters.changeover_adapt_min.value<1.0 || input_parameters.changeover_adapt_max.value>1.0);
+        const PS::F64 r_out_cutoff = changeover_adapt_flag? r_out*input_parameters.changeover_adapt_min.value : r_out;
+
         // if r_search_min is not defined, calculate by search_vel_factor*velocity_dispersion*tree_time_step + r_out
-        if (r_search_min==0.0) r_search_min = search_vel_factor*vel_disp*dt_soft + r_out;
+        if (r_search_min==0.0) r_search_min = search_vel_factor*vel_disp*dt_soft + r_out_cutoff;
         // if r_search_max is not defined, calcualte by 5*r_out
 //        if (r_search_max==0.0) r_search_max = 5*r_out;
         // calculate v_max based on r_search_max, tree time step and search_vel_factor
@@ -3123,7 +4696,10 @@ public:
         dt_snap = regularTimeStep(dt_snap);
 
         EPISoft::eps   = input_parameters.eps.value;
-        EPISoft::r_out = r_out;
+        EPISoft::r_out = r_out_cutoff;
+#ifdef TREE_LEVEL_STEP
+        EPISoft::active_check = (input_parameters.tree_level_max.value>0);
+#endif
         ForceSoft::grav_const = input_parameters.gravitational_constant.value;
         Ptcl::search_factor = search_vel_factor;
         Ptcl::r_search_min = r_search_min;
@@ -3140,6 +4716,7 @@ public:
                      <<" r_out        = "<<r_out          <<std::endl
                      <<" r_bin        = "<<r_bin          <<std::endl
                      <<" r_search_min = "<<r_search_min   <<std::endl
+                     <<" r_out_cutoff = "<<r_out_cutoff   <<std::endl
                      <<" vel_disp     = "<<vel_disp       <<std::endl
                      <<" dt_soft      = "<<dt_soft        <<std::endl;
         }
@@ -3234,6 +4811,7 @@ public:
         hard_manager.ap_manager.orbit_manager.setParticleSplitN(input_parameters.n_split.value);
 #endif
         hard_manager.h4_manager.step.eta_4th = input_parameters.eta.value;
+        hard_manager.h4_manager.interaction.pair_cutoff_flag = (input_parameters.hermite_pair_cutoff.value==1);
         hard_manager.h4_manager.step.eta_2nd = 0.01*input_parameters.eta.value;
         hard_manager.h4_manager.step.calcAcc0OffsetSq(mass_average, r_out, input_parameters.gravitational_constant.value);
         hard_manager.ar_manager.energy_error_relative_max = input_parameters.e_err_ar.value;
@@ -3268,17 +4846,30 @@ public:
         hard_manager.checkParams();
 
         // initial hard class and parameters
+        const bool reproducible_mode = (input_parameters.reproducible.value==1);
         system_hard_one_cluster.manager = &hard_manager;
         system_hard_one_cluster.setTimeOrigin(stat.time);
+        system_hard_one_cluster.reproducible_mode = reproducible_mode;
 
         system_hard_isolated.allocateHardIntegrator(input_parameters.n_interrupt_limit.value);
         system_hard_isolated.manager = &hard_manager;
         system_hard_isolated.setTimeOrigin(stat.time);
+        system_hard_isolated.reproducible_mode = reproducible_mode;
+        system_hard_isolated.neighbor_group_flag = (input_parameters.nb_group_cm.value==1);
+        system_hard_isolated.changeover_adapt_flag = changeover_adapt_flag;
+        system_hard_isolated.warm_start.flag = (input_parameters.hard_warm_start.value==1);
+        system_hard_isolated.error_budget.energy_error_budget = input_parameters.hard_error_budget.value;
+        system_hard_isolated.error_budget.factor_range = input_parameters.hard_error_budget_range.value;
 
 #ifdef PARTICLE_SIMULATOR_MPI_PARALLEL
         system_hard_connected.allocateHardIntegrator(input_parameters.n_interrupt_limit.value);
         system_hard_connected.manager = &hard_manager;
         system_hard_connected.setTimeOrigin(stat.time);
+        system_hard_connected.reproducible_mode = reproducible_mode;
+        system_hard_connected.changeover_adapt_flag = changeover_adapt_flag;
+        system_hard_connected.warm_start.flag = (input_parameters.hard_warm_start.value==1);
+        system_hard_connected.error_budget.energy_error_budget = input_parameters.hard_error_budget.value;
+        system_hard_connected.error_budget.factor_range = input_parameters.hard_error_budget_range.value;
 #endif
 
         time_kick = stat.time;
@@ -3346,6 +4937,11 @@ public:
 
         assert(checkTimeConsistence());
 
+        // integer step counters for the output alignment, dt_soft and dt_snap are powers of two
+        const PS::F64 dt_soft = input_parameters.dt_soft.value;
+        n_step_tree = (PS::S64)llround(stat.time/dt_soft);
+        n_step_output = std::max((PS::S64)1, (PS::S64)llround(input_parameters.dt_snap.value/dt_soft));
+
         // one particle case
         if (stat.n_real_glb==1) {
             Ptcl::group_data_mode = GroupDataMode::artificial;
@@ -3371,6 +4967,16 @@ public:
         // exchange particles
         exchangeParticle();
 
+#ifdef TREE_LEVEL_STEP
+        // all particles are active in the initial step
+        resetTreeLevel();
+#endif
+
+#ifdef NB_GROUP_CM
+        // no stable group is known in the initial step
+        resetNeighborGroup();
+#endif
+
         PS::F64 dt_tree = input_parameters.dt_soft.value;
         dt_manager.setStep(dt_tree);
 
@@ -3388,8 +4994,11 @@ public:
         createGroup(dt_tree);
 
         // >4 tree soft force
-        /// calculate tree force with linear cutoff, save to system_soft.acc
-        treeSoftForce();
+        /// select tree or direct summation backend and calculate soft force with linear cutoff, save to system_soft.acc
+        selectSoftForceBackend();
+
+        /// tune tree parameters by measuring the soft force
+        if (input_parameters.tree_tune_interval.value>=0.0 && !use_direct_soft_force) tuneTreeSoftParameters();
 
         /// force from external potential
         externalForce();
@@ -3448,7 +5057,6 @@ public:
         if (stat.time>=time_break) return 0;
 
         PS::F64 dt = std::min(input_parameters.dt_soft.value, time_break-stat.time);
-        PS::F64 dt_output = input_parameters.dt_snap.value;
         bool start_flag=true;
         while (stat.time < time_break) {
 #ifdef PROFILE
@@ -3482,6 +5090,7 @@ public:
 
             stat.time += dt;
             time_kick = stat.time;
+            n_step_tree++;
 
 #ifdef PROFILE
             profile.hard_single.barrier();
@@ -3489,7 +5098,7 @@ public:
             profile.hard_single.end();
 #endif
             // output 
-            if (!start_flag&&fmod(stat.time, dt_output) == 0.0) {
+            if (!start_flag && dt==input_parameters.dt_soft.value && n_step_tree%n_step_output==0) {
                 updateStatus(false);
                 output();
 #ifdef PROFILE
@@ -3540,7 +5149,6 @@ public:
         PS::F64 time_break = _time_break==0.0? input_parameters.time_end.value: std::min(_time_break,input_parameters.time_end.value);
         if (stat.time>=time_break) return 0;
 
-        PS::F64 dt_output = input_parameters.dt_snap.value;
         PS::F64 dt_tree = dt_manager.getStep();
 
         /// Main loop
@@ -3572,17 +5180,30 @@ public:
             /// get neighbor list to tree_nb
             treeNeighborSearch();
 
+            /// hierarchical tree step: select active particles, particles with neighbors use dt_soft
+#ifdef TREE_LEVEL_STEP
+            if (input_parameters.tree_level_max.value>0) setTreeLevelActive();
+#endif
+
+            /// adaptive changeover: set the rescaling factors of changeover radii by the local density
+            if (changeover_adapt_flag) setChangeOverAdaptive();
+
             // >2. search clusters
             /// gether clusters information to search_cluster, using tree_nb and velocity criterion (particles status/mass_bk)
             searchCluster();
 
+            /// adaptive changeover: single particles are updated directly, clusters are updated in correctForceChangeOverUpdate
+            if (changeover_adapt_flag) updateChangeOverAdaptiveSingle();
+
             // >3. find group and create artificial particles
             /// find group and create artificial particles, using search_cluster, save to system_hard and system_soft (particle status/mass_bk updated)
             createGroup(dt_tree);
 
             // >4 tree soft force
             /// calculate tree force with linear cutoff, save to system_soft.acc
-            treeSoftForce() ;
+            /// tree parameters are tuned at the given time interval
+            if (input_parameters.tree_tune_interval.value>0.0 && stat.time>=time_next_tree_tune) tuneTreeSoftParameters();
+            else treeSoftForce() ;
 
             /// force from external potential
             externalForce();
@@ -3603,6 +5224,7 @@ public:
             //bool dt_mod_flag = false;    // for check whether tree time step need update
             bool changeover_flag = false; // for check whether changeover need update
             PS::F64 dt_kick, dt_drift;
+            PS::F64 dt_kick_close = 0.0; // closing part of the kick to the current time, for synchronizing tracked particle velocities
 
             // for initial the system
             if (dt_manager.isNextStart()) {
@@ -3634,7 +5256,7 @@ public:
                     //if(dt_mod_flag) dt_kick = dt_manager.getDtEndContinue();
 
                     // output step, get last kick step
-                    output_flag = (fmod(stat.time, dt_output) == 0.0);
+                    output_flag = (n_step_tree%n_step_output==0);
 
                     // check changeover change
                     changeover_flag = (system_hard_isolated.getNClusterChangeOverUpdate()>0);
@@ -3649,10 +5271,19 @@ public:
                     interrupt_flag = (stat.time>=time_break);
 
                     // set next step to be last
-                    if (output_flag||changeover_flag||interrupt_flag) dt_kick = dt_manager.getDtEndContinue();
-                    else dt_kick = dt_manager.getDtKickContinue();
+                    if (output_flag||changeover_flag||interrupt_flag) {
+                        dt_kick = dt_manager.getDtEndContinue();
+                        dt_kick_close = dt_kick;
+                    }
+                    else {
+                        dt_kick = dt_manager.getDtKickContinue();
+                        dt_kick_close = 0.5*dt_kick;
+                    }
+                }
+                else {
+                    dt_kick = dt_manager.getDtKickContinue();
+                    dt_kick_close = 0.5*dt_kick;
                 }
-                else dt_kick = dt_manager.getDtKickContinue();
 #ifdef PROFILE
                 profile.other.barrier();
                 PS::Comm::barrier();
@@ -3661,6 +5292,18 @@ public:
             }
 
 
+            /// write tracked particles at the full step boundaries
+            if (particle_track.getIdN()>0 && dt_manager.getCountContinue()==0 && n_loop%input_parameters.track_interval.value==0) 
+                writeTrackParticles(dt_kick_close);
+
+            /// hierarchical tree step: update block levels of active single particles
+#ifdef TREE_LEVEL_STEP
+            if (input_parameters.tree_level_max.value>0) {
+                updateTreeLevel(time_break);
+                kickTreeLevelSync();
+            }
+#endif
+
             // >6. kick 
             kick(dt_kick);
 
@@ -3749,6 +5392,7 @@ public:
             dt_drift = dt_manager.getDtDriftContinue();
 
             drift(dt_drift);
+            n_step_tree++;
 
 #ifdef PROFILE
             // calculate profile
@@ -3772,10 +5416,12 @@ public:
         return 0;
     }
 
-    void clear() {
-
+    //! close all output files
+    void closeOutputFiles() {
         if (fstatus.is_open()) fstatus.close();
         if (fesc.is_open()) fesc.close();
+        particle_track.closeFiles();
+        if (fcatalog.is_open()) fcatalog.close();
 #ifdef PROFILE
         if (fprofile.is_open()) fprofile.close();
 #endif
@@ -3788,11 +5434,225 @@ public:
 #ifdef ADJUST_GROUP_PRINT
         if (hard_manager.h4_manager.fgroup.is_open()) hard_manager.h4_manager.fgroup.close();
 #endif
+    }
+
+    //! read the simulation list for the ensemble mode and backup the shared parameters
+    /*! Each line of the list file: [input data filename] [output prefix] [parameter file (optional)]. 
+        Empty lines and lines starting with '#' are skipped. The list file is read by all MPI processes.
+     */
+    void readEnsembleList() {
+        assert(read_parameters_flag);
+        std::string fname_list = input_parameters.fname_ensemble.value;
+        std::ifstream fin(fname_list.c_str());
+        if (!fin.is_open()) {
+            std::cerr<<"Error: Cannot open ensemble list file "<<fname_list<<std::endl;
+            abort();
+        }
+        ensemble_list.clear();
+        std::string line;
+        while (std::getline(fin, line)) {
+            std::istringstream iss(line);
+            EnsembleMember member;
+            if (!(iss>>member.fname_inp)) continue;
+            if (member.fname_inp[0]=='#') continue;
+            if (!(iss>>member.fname_snp)) {
+                std::cerr<<"Error: output prefix is missing in the ensemble list line: "<<line<<std::endl;
+                abort();
+            }
+            if (!(iss>>member.fname_par)) member.fname_par = "__NONE__";
+            ensemble_list.push_back(member);
+        }
+        fin.close();
+
+        if (input_parameters.print_flag) 
+            std::cout<<"----- Ensemble mode: "<<ensemble_list.size()<<" simulations from "<<fname_list<<" -----"<<std::endl;
+
+        // avoid that the ensemble list is saved in the parameter files of each simulation
+        input_parameters.fname_ensemble.value = "__NONE__";
+
+        // backup shared parameters, initialParameters modifies some of them (r_out, dt_soft ...)
+        if (fpar_ensemble_backup!=NULL) fclose(fpar_ensemble_backup);
+        fpar_ensemble_backup = tmpfile();
+        input_parameters.input_par_store.writeAscii(fpar_ensemble_backup);
+#ifdef BSE_BASE
+        if (fbse_par_ensemble_backup!=NULL) fclose(fbse_par_ensemble_backup);
+        fbse_par_ensemble_backup = tmpfile();
+        bse_parameters.input_par_store.writeAscii(fbse_par_ensemble_backup);
+#endif
+#ifdef GALPY
+        if (fgalpy_par_ensemble_backup!=NULL) fclose(fgalpy_par_ensemble_backup);
+        fgalpy_par_ensemble_backup = tmpfile();
+        galpy_parameters.input_par_store.writeAscii(fgalpy_par_ensemble_backup);
+#endif
+    }
+
+    //! reset the data of the finished simulation for the next one in the ensemble mode
+    /*! Output files are closed, particle data, status and counters are cleared. 
+        FDPS objects (particle system, trees, domain) and the hard integrator arrays keep their allocated memory and are reused.
+     */
+    void resetForNextSimulation() {
+        closeOutputFiles();
+
+        stat = Status();
+        file_header = FileHeader();
+        time_kick = 0.0;
+        escaper = Escaper();
+        particle_track.clearIdList();
+        // saved states of clusters are keyed by member ids, which are reused by the next simulation
+        system_hard_isolated.warm_start.clear();
+        system_hard_isolated.error_budget.clear();
+#ifdef PARTICLE_SIMULATOR_MPI_PARALLEL
+        system_hard_connected.warm_start.clear();
+        system_hard_connected.error_budget.clear();
+#endif
+        system_soft.setNumberOfParticleLocal(0);
+        id_adr_map.clear();
+        id_adr_map_valid = false;
+        n_loop = 0;
+        domain_decompose_weight = 1.0;
+        dt_manager = KickDriftStep();
+        n_step_tree = 0;
+        n_step_output = 1;
+        tree_level_step_count = 0;
+        n_tree_step_sum = 0;
+        n_tree_active_sum = 0;
+        n_tree_real_sum = 0;
+        changeover_adapt_flag = false;
+        changeover_adapt_count = 0;
+        changeover_adapt_nb_target = 0.0;
+        time_next_tree_tune = 0.0;
+        // recover the tree parameters changed by tuning
+        setTreeSoft(input_parameters.theta.value, input_parameters.n_leaf_limit.value, input_parameters.n_group_limit.value);
+        use_direct_soft_force = false;
+        n_interrupt_glb = 0;
+        mass_modify_list.resizeNoInitialize(0);
+        remove_list.resizeNoInitialize(0);
+        remove_id_record.resizeNoInitialize(0);
+#ifdef PROFILE
+        clearProfile();
+#endif
+        read_data_flag = false;
+        initial_parameters_flag = false;
+        initial_step_flag = false;
+    }
+
+    //! initialize one simulation in the ensemble mode
+    /*! Reset the previous simulation, restore the shared parameters, read the parameter file of the simulation if provided, 
+        open output files, read (or generate) particle data, initialize parameters and do the initial step.
+      @param[in] _index: index of the simulation in ensemble_list
+     */
+    void initialEnsembleMember(const std::size_t _index) {
+        assert(_index<ensemble_list.size());
+        assert(fpar_ensemble_backup!=NULL);
+        const EnsembleMember& member = ensemble_list[_index];
+
+        if (_index>0) resetForNextSimulation();
+
+        auto readParFile = [&](const std::string& _fname, IOParamsContainer& _store) {
+            if (my_rank==0) {
+                FILE* fpar_in;
+                if( (fpar_in = fopen(_fname.c_str(),"r")) == NULL) {
+                    fprintf(stderr,"Error: Cannot open file %s.\n", _fname.c_str());
+                    abort();
+                }
+                _store.readAscii(fpar_in);
+                fclose(fpar_in);
+            }
+#ifdef PARTICLE_SIMULATOR_MPI_PARALLEL        
+            _store.mpi_broadcast();
+            PS::Comm::barrier();
+#endif
+        };
+
+        // restore shared parameters
+        rewind(fpar_ensemble_backup);
+        input_parameters.input_par_store.readAscii(fpar_ensemble_backup);
+#ifdef BSE_BASE
+        rewind(fbse_par_ensemble_backup);
+        bse_parameters.input_par_store.readAscii(fbse_par_ensemble_backup);
+#endif
+#ifdef GALPY
+        rewind(fgalpy_par_ensemble_backup);
+        galpy_parameters.input_par_store.readAscii(fgalpy_par_ensemble_backup);
+#endif
+
+        // parameters of this simulation
+        if (member.fname_par!="__NONE__") {
+            // the trees are initialized once in readParameters, the tree parameters must be shared
+            const PS::F64 theta_shared = input_parameters.theta.value;
+            const PS::S64 n_leaf_limit_shared = input_parameters.n_leaf_limit.value;
+            const PS::S64 n_group_limit_shared = input_parameters.n_group_limit.value;
+            readParFile(member.fname_par, input_parameters.input_par_store);
+            if (input_parameters.theta.value!=theta_shared || 
+                input_parameters.n_leaf_limit.value!=n_leaf_limit_shared || 
+                input_parameters.n_group_limit.value!=n_group_limit_shared) {
+                if (my_rank==0) std::cerr<<"Error: ensemble simulation "<<_index+1<<": the tree parameters ("
+                                         <<input_parameters.theta.key<<", "
+                                         <<input_parameters.n_leaf_limit.key<<", "
+                                         <<input_parameters.n_group_limit.key<<") in "<<member.fname_par
+                                         <<" differ from the shared ones, which cannot be changed in the ensemble mode."<<std::endl;
+                abort();
+            }
+#ifdef BSE_BASE
+            readParFile(member.fname_par+fbse_par_suffix, bse_parameters.input_par_store);
+#endif
+#ifdef GALPY
+            readParFile(member.fname_par+".galpy", galpy_parameters.input_par_store);
+#endif
+            input_parameters.fname_par.value = member.fname_par;
+        }
+        else input_parameters.fname_par.value = member.fname_snp + ".input.par";
+        input_parameters.fname_inp.value = member.fname_inp;
+        input_parameters.fname_snp.value = member.fname_snp;
+        input_parameters.fname_ensemble.value = "__NONE__";
+
+        if (input_parameters.print_flag) 
+            std::cout<<"----- Ensemble simulation "<<_index+1<<"/"<<ensemble_list.size()
+                     <<": input "<<member.fname_inp
+                     <<", output prefix "<<member.fname_snp
+                     <<" -----"<<std::endl;
+
+        openOutputFiles();
+
+        if (member.fname_inp=="__Plummer") generatePlummer();
+        else readDataFromFile();
+
+        initialParameters();
+
+        initialStep();
+    }
+
+    void clear() {
+
+        closeOutputFiles();
+
+        if (fpar_ensemble_backup!=NULL) {
+            fclose(fpar_ensemble_backup);
+            fpar_ensemble_backup = NULL;
+        }
+#ifdef BSE_BASE
+        if (fbse_par_ensemble_backup!=NULL) {
+            fclose(fbse_par_ensemble_backup);
+            fbse_par_ensemble_backup = NULL;
+        }
+#endif
+#ifdef GALPY
+        if (fgalpy_par_ensemble_backup!=NULL) {
+            fclose(fgalpy_par_ensemble_backup);
+            fgalpy_par_ensemble_backup = NULL;
+        }
+#endif
+
         if (pos_domain) {
             delete[] pos_domain;
             pos_domain=NULL;
         }
 
+        if (tree_soft!=NULL) {
+            delete tree_soft;
+            tree_soft=NULL;
+        }
+
         if (initial_fdps_flag) PS::Finalize();
         remove_list.resizeNoInitialize(0);
         n_interrupt_glb = 0;
@@ -433,6 +433,8 @@ public:
     NumCounter n_neighbor_zero;
     NumCounter ep_ep_interact;
     NumCounter ep_sp_interact;
+    NumCounter nb_tree_ptcl;
+    NumCounter hard_warm_start;
     //NumCounter ARC_step_group;
     const PS::S32 n_counter;
     std::map<PS::S32,PS::S32> n_cluster; ///<Histogram of number of particles in clusters
@@ -451,8 +453,10 @@ public:
                  n_neighbor_zero  (NumCounter("Hermite_no_NB")),
                  ep_ep_interact   (NumCounter("Ep-Ep_interaction")),
                  ep_sp_interact   (NumCounter("Ep-Sp_interaction")),
+                 nb_tree_ptcl     (NumCounter("NB_tree_ptcl")),
+                 hard_warm_start  (NumCounter("Hard_warm_start")),
                  //ARC_step_group   (NumCounter("ARC step per group")),
-                 n_counter(14) {}
+                 n_counter(16) {}
 
     void clusterCount(const PS::S32 n, const PS::S32 ntimes=1) {
         if (n_cluster.count(n)) n_cluster[n] += ntimes;
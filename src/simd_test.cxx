@@ -39,6 +39,9 @@
 #ifdef USE_FUGAKU
 #include "force_fugaku.hpp"
 #endif
+#ifdef USE_AARCH64
+#include "force_aarch64.hpp"
+#endif
 #endif
 
 void setSpj(const PS::F64 N, SPJSoft& sp) {
@@ -91,6 +94,9 @@ int main(int argc, char **argv){
     ForceSoft force[Nepi];
     ForceSoft force_sp[Nepi];
     ForceSoft force_nb[Nepi];
+#ifdef KDKDK_4TH
+    ForceSoft force_acorr[Nepi];
+#endif
 #ifdef USE_GPU
     ForceSoft force_gpu[Nepi];
 #endif
@@ -98,15 +104,43 @@ int main(int argc, char **argv){
     ForceSoft force_simd[Nepi];
     ForceSoft force_sp_simd[Nepi];
     ForceSoft force_nb_simd[Nepi];
+#ifdef KDKDK_4TH
+    ForceSoft force_acorr_simd[Nepi];
+#endif
 #endif
 #ifdef USE_FUGAKU
     ForceSoft force_fgk[Nepi];
     ForceSoft force_sp_fgk[Nepi];
     ForceSoft force_nb_fgk[Nepi];
+#endif
+#ifdef USE_AARCH64
+    ForceSoft force_a64[Nepi];
+    ForceSoft force_sp_a64[Nepi];
+    ForceSoft force_nb_a64[Nepi];
+#ifdef KDKDK_4TH
+    ForceSoft force_acorr_a64[Nepi];
+#endif
 #endif
 
     for (int i=0; i<N; i++) ptcl[i].calcRSearch(1.0/2048.0);
 
+#ifdef KDKDK_4TH
+    // accelerations of all particles for the gradient correction
+    {
+        EPISoft epi_all[N];
+        EPJSoft epj_all[N];
+        ForceSoft force_all[N];
+        for (int i=0; i<N; i++) {
+            epi_all[i].copyFromFP(ptcl[i]);
+            epj_all[i].copyFromFP(ptcl[i]);
+            force_all[i].clear();
+        }
+        CalcForceEpEpWithLinearCutoffNoSimd f_ep_ep_all;
+        f_ep_ep_all(epi_all, N, epj_all, N, force_all);
+        for (int i=0; i<N; i++) ptcl[i].acc = force_all[i].acc;
+    }
+#endif
+
     for (int i=0; i<Nepi; i++) {
         epi[i].copyFromFP(ptcl[i]);
         force[i].clear();
@@ -114,15 +148,29 @@ int main(int argc, char **argv){
         force_gpu[i].clear();
 #endif
         force_sp[i].clear();
+#ifdef KDKDK_4TH
+        force_acorr[i].clear();
+#endif
 #ifdef USE_SIMD
         force_simd[i].clear();
         force_sp_simd[i].clear();
         force_nb_simd[i].clear();
+#ifdef KDKDK_4TH
+        force_acorr_simd[i].clear();
+#endif
 #endif
 #ifdef USE_FUGAKU
         force_fgk[i].clear();
         force_sp_fgk[i].clear();
         force_nb_fgk[i].clear();
+#endif
+#ifdef USE_AARCH64
+        force_a64[i].clear();
+        force_sp_a64[i].clear();
+        force_nb_a64[i].clear();
+#ifdef KDKDK_4TH
+        force_acorr_a64[i].clear();
+#endif
 #endif
     }
     for (int i=0; i<Nepj; i++) 
@@ -182,6 +230,15 @@ int main(int argc, char **argv){
     t_nb_simd -= PS::GetWtime();
     f_nb_simd(epi, Nepi, epj, Nepj, force_nb_simd);
     t_nb_simd += PS::GetWtime();
+
+#ifdef KDKDK_4TH
+    std::cout<<"calc Ep Ep gradient correction simd\n";
+    CalcCorrectEpEpWithLinearCutoffSimd f_acorr_simd;
+    PS::F64 t_acorr_simd=0;
+    t_acorr_simd -= PS::GetWtime();
+    f_acorr_simd(epi, Nepi, epj, Nepj, force_acorr_simd);
+    t_acorr_simd += PS::GetWtime();
+#endif
 #endif
 
 #ifdef USE_FUGAKU
@@ -212,6 +269,43 @@ int main(int argc, char **argv){
     t_nb_fgk += PS::GetWtime();
 #endif
 
+#ifdef USE_AARCH64
+    std::cout<<"calc Ep Ep aarch64\n";
+    CalcForceEpEpWithLinearCutoffAArch64 f_ep_ep_a64;
+    PS::F64 t_ep_a64=0;
+    t_ep_a64 -= PS::GetWtime();
+    f_ep_ep_a64(epi, Nepi, epj, Nepj, force_a64);
+    t_ep_a64 += PS::GetWtime();
+
+#ifdef USE_QUAD
+    std::cout<<"calc Ep Sp quad aarch64\n";
+    CalcForceEpSpQuadAArch64 f_ep_sp_a64;
+#else
+    std::cout<<"calc Ep Sp mono aarch64\n";
+    CalcForceEpSpMonoAArch64 f_ep_sp_a64;
+#endif
+    PS::F64 t_sp_a64=0;
+    t_sp_a64 -= PS::GetWtime();
+    f_ep_sp_a64(epi, Nepi, spj, Nspj, force_sp_a64);
+    t_sp_a64 += PS::GetWtime();
+
+    std::cout<<"neighbor search aarch64\n";
+    SearchNeighborEpEpAArch64 f_nb_a64;
+    PS::F64 t_nb_a64=0;
+    t_nb_a64 -= PS::GetWtime();
+    f_nb_a64(epi, Nepi, epj, Nepj, force_nb_a64);
+    t_nb_a64 += PS::GetWtime();
+
+#ifdef KDKDK_4TH
+    std::cout<<"calc Ep Ep gradient correction aarch64\n";
+    CalcCorrectEpEpWithLinearCutoffAArch64 f_acorr_a64;
+    PS::F64 t_acorr_a64=0;
+    t_acorr_a64 -= PS::GetWtime();
+    f_acorr_a64(epi, Nepi, epj, Nepj, force_acorr_a64);
+    t_acorr_a64 += PS::GetWtime();
+#endif
+#endif
+
     std::cout<<"calc Ep Ep\n";
     CalcForceEpEpWithLinearCutoffNoSimd f_ep_ep;
     PS::F64 t_ep_no=0;
@@ -238,6 +332,15 @@ int main(int argc, char **argv){
     f_nb(epi, Nepi, epj, Nepj, force_nb);
     t_nb += PS::GetWtime();
 
+#ifdef KDKDK_4TH
+    std::cout<<"calc Ep Ep gradient correction\n";
+    CalcCorrectEpEpWithLinearCutoffNoSimd f_acorr;
+    PS::F64 t_acorr_no=0;
+    t_acorr_no -= PS::GetWtime();
+    f_acorr(epi, Nepi, epj, Nepj, force_acorr);
+    t_acorr_no += PS::GetWtime();
+#endif
+
     std::cout<<"compare results\n";
     PS::S32 nbcount[20];
     for(int i=0; i<20; i++) nbcount[i]=0;
@@ -247,6 +350,9 @@ int main(int argc, char **argv){
     PS::F64 dfmax_simd=0, dfpmax_simd=0;
     PS::F64 dsmax_simd=0, dspmax_simd=0;
     PS::F64 nbcount_ave_simd=0;
+#ifdef KDKDK_4TH
+    PS::F64 damax_simd=0;
+#endif
 #endif
 #ifdef USE_GPU
     PS::F64 dfmax_gpu=0, dfpmax_gpu=0;
@@ -256,6 +362,14 @@ int main(int argc, char **argv){
     PS::F64 dfmax_fgk=0,dfpmax_fgk=0;
     PS::F64 dsmax_fgk=0,dspmax_fgk=0;
     PS::F64 nbcount_ave_fgk=0;
+#endif
+#ifdef USE_AARCH64
+    PS::F64 dfmax_a64=0,dfpmax_a64=0;
+    PS::F64 dsmax_a64=0,dspmax_a64=0;
+    PS::F64 nbcount_ave_a64=0;
+#ifdef KDKDK_4TH
+    PS::F64 damax_a64=0;
+#endif
 #endif
     PS::F64 df;
 
@@ -282,6 +396,15 @@ int main(int argc, char **argv){
             df=(force_sp[i].acc[j]-force_sp_fgk[i].acc[j])/force_sp[i].acc[j];
             dsmax_fgk = std::max(dsmax_fgk, df);
             if(df>DF_MAX) std::cerr<<"Force sp diff: i="<<i<<" nosimd["<<j<<"] "<<force_sp[i].acc[j]<<" fugaku["<<j<<"] "<<force_sp_fgk[i].acc[j]<<std::endl;
+#endif
+#ifdef USE_AARCH64
+            df=(force[i].acc[j]-force_a64[i].acc[j])/force[i].acc[j];
+            dfmax_a64 = std::max(dfmax_a64, df);
+            if(df>DF_MAX) std::cerr<<"Force diff: i="<<i<<" nosimd["<<j<<"] "<<force[i].acc[j]<<" aarch64["<<j<<"] "<<force_a64[i].acc[j]<<std::endl;
+
+            df=(force_sp[i].acc[j]-force_sp_a64[i].acc[j])/force_sp[i].acc[j];
+            dsmax_a64 = std::max(dsmax_a64, df);
+            if(df>DF_MAX) std::cerr<<"Force sp diff: i="<<i<<" nosimd["<<j<<"] "<<force_sp[i].acc[j]<<" aarch64["<<j<<"] "<<force_sp_a64[i].acc[j]<<std::endl;
 #endif
         }
 #ifdef USE_SIMD
@@ -295,6 +418,14 @@ int main(int argc, char **argv){
             std::cerr<<"NB search diff: i="<<i<<" nosimd "<<force[i].n_ngb<<" simd "<<force_nb_simd[i].n_ngb<<std::endl;
         }
         nbcount_ave_simd += force_simd[i].n_ngb;
+
+#ifdef KDKDK_4TH
+        // relative difference of the gradient correction vector
+        const PS::F64vec dacorr = force_acorr[i].acorr - force_acorr_simd[i].acorr;
+        df = sqrt((dacorr*dacorr)/(force_acorr[i].acorr*force_acorr[i].acorr));
+        damax_simd = std::max(damax_simd, df);
+        if(df>DF_MAX) std::cerr<<"Acorr diff: i="<<i<<" nosimd "<<force_acorr[i].acorr<<" simd "<<force_acorr_simd[i].acorr<<std::endl;
+#endif
 #endif
 #ifdef USE_GPU
         dfpmax_gpu = std::max(dfpmax_gpu, (force_sp[i].pot+force[i].pot - force_gpu[i].pot)/force_gpu[i].pot);
@@ -315,6 +446,25 @@ int main(int argc, char **argv){
             std::cerr<<"NB search diff: i="<<i<<" nosimd "<<force_nb[i].n_ngb<<" fugaku "<<force_nb_fgk[i].n_ngb<<std::endl;
         }
         nbcount_ave_fgk += force_fgk[i].n_ngb;
+#endif
+#ifdef USE_AARCH64
+        dfpmax_a64 = std::max(dfpmax_a64, (force[i].pot-force_a64[i].pot)/force[i].pot);
+        dspmax_a64 = std::max(dspmax_a64, (force_sp[i].pot-force_sp_a64[i].pot)/force_sp[i].pot);
+
+        if(force[i].n_ngb!=force_a64[i].n_ngb) {
+            std::cerr<<"Neighbor diff: i="<<i<<" nosimd "<<force[i].n_ngb<<" aarch64 "<<force_a64[i].n_ngb<<std::endl;
+        }
+        if(force_nb[i].n_ngb!=force_nb_a64[i].n_ngb) {
+            std::cerr<<"NB search diff: i="<<i<<" nosimd "<<force_nb[i].n_ngb<<" aarch64 "<<force_nb_a64[i].n_ngb<<std::endl;
+        }
+        nbcount_ave_a64 += force_a64[i].n_ngb;
+
+#ifdef KDKDK_4TH
+        const PS::F64vec dacorr_a64 = force_acorr[i].acorr - force_acorr_a64[i].acorr;
+        df = sqrt((dacorr_a64*dacorr_a64)/(force_acorr[i].acorr*force_acorr[i].acorr));
+        damax_a64 = std::max(damax_a64, df);
+        if(df>DF_MAX) std::cerr<<"Acorr diff: i="<<i<<" nosimd "<<force_acorr[i].acorr<<" aarch64 "<<force_acorr_a64[i].acorr<<std::endl;
+#endif
 #endif
         nbcount_ave += force[i].n_ngb;
         if (force[i].n_ngb<20) nbcount[force[i].n_ngb]++;
@@ -334,6 +484,13 @@ int main(int argc, char **argv){
     std::cout<<" FUGAKU_mono";
 #endif
 #endif
+#ifdef USE_AARCH64
+#ifdef __ARM_FEATURE_SVE
+    std::cout<<"Use SVE ("<<AArch64Vec::getLaneN()<<" lanes)";
+#else
+    std::cout<<"Use NEON ("<<AArch64Vec::getLaneN()<<" lanes)";
+#endif
+#endif
 #ifdef USE_GPU
 #ifdef USE_QUAD
     std::cout<<" GPU_quad";
@@ -369,6 +526,9 @@ int main(int argc, char **argv){
 #ifdef USE_SIMD    
     std::cout<<"SIMD EP-EP force diff max: "<<dfmax_simd<<" Pot diff max: "<<dfpmax_simd<<std::endl
              <<"SIMD EP-Sp force diff max: "<<dsmax_simd<<" Pot diff max: "<<dspmax_simd<<std::endl;
+#ifdef KDKDK_4TH
+    std::cout<<"SIMD EP-EP gradient correction diff max: "<<damax_simd<<std::endl;
+#endif
 #endif
 #ifdef USE_GPU
     std::cout<<"GPU EP+SP force diff max: "<<dfmax_gpu<<" Pot diff max: "<<dfpmax_gpu<<std::endl;
@@ -376,6 +536,13 @@ int main(int argc, char **argv){
 #ifdef USE_FUGAKU
     std::cout<<"Fugaku EP-EP diff max: "<<dfmax_fgk<<" Pot diff max: "<<dfpmax_fgk<<std::endl;
     std::cout<<"Fugaku EP-SP diff max: "<<dsmax_fgk<<" Pot diff max: "<<dspmax_fgk<<std::endl;
+#endif
+#ifdef USE_AARCH64
+    std::cout<<"AArch64 EP-EP diff max: "<<dfmax_a64<<" Pot diff max: "<<dfpmax_a64<<std::endl;
+    std::cout<<"AArch64 EP-SP diff max: "<<dsmax_a64<<" Pot diff max: "<<dspmax_a64<<std::endl;
+#ifdef KDKDK_4TH
+    std::cout<<"AArch64 EP-EP gradient correction diff max: "<<damax_a64<<std::endl;
+#endif
 #endif
 
     for (int i=0; i<20; i++)
@@ -390,12 +557,18 @@ int main(int argc, char **argv){
 #endif
 #ifdef USE_FUGAKU
     std::cout<<" fugaku: "<<nbcount_ave_fgk;
+#endif
+#ifdef USE_AARCH64
+    std::cout<<" aarch64: "<<nbcount_ave_a64;
 #endif
     std::cout<<std::endl;
     
 #ifdef USE_SIMD
     std::cout<<"Time: epj  simd="<<t_ep_simd<<" no="<<t_ep_no<<" ratio="<<t_ep_no/t_ep_simd<<std::endl;
     std::cout<<"Time: spj  simd="<<t_sp_simd<<" no="<<t_sp_no<<" ratio="<<t_sp_no/t_sp_simd<<std::endl;
+#ifdef KDKDK_4TH
+    std::cout<<"Time: acorr simd="<<t_acorr_simd<<" no="<<t_acorr_no<<" ratio="<<t_acorr_no/t_acorr_simd<<std::endl;
+#endif
 #endif
 #ifdef USE_GPU
     std::cout<<"Time: gpu ="<<t_gpu<<" no="<<t_ep_no+t_sp_no<<" ratio="<<(t_ep_no+t_sp_no)/t_gpu<<std::endl;
@@ -403,6 +576,14 @@ int main(int argc, char **argv){
 #ifdef USE_FUGAKU
     std::cout<<"Time: fugaku ="<<t_ep_fgk<<" no="<<t_ep_no<<" ratio="<<t_ep_no/t_ep_fgk<<std::endl;
     std::cout<<"Time: fugaku ="<<t_sp_fgk<<" no="<<t_sp_no<<" ratio="<<t_sp_no/t_sp_fgk<<std::endl;
+#endif
+#ifdef USE_AARCH64
+    std::cout<<"Time: epj  aarch64="<<t_ep_a64<<" no="<<t_ep_no<<" ratio="<<t_ep_no/t_ep_a64<<std::endl;
+    std::cout<<"Time: spj  aarch64="<<t_sp_a64<<" no="<<t_sp_no<<" ratio="<<t_sp_no/t_sp_a64<<std::endl;
+    std::cout<<"Time: nb   aarch64="<<t_nb_a64<<" no="<<t_nb<<" ratio="<<t_nb/t_nb_a64<<std::endl;
+#ifdef KDKDK_4TH
+    std::cout<<"Time: acorr aarch64="<<t_acorr_a64<<" no="<<t_acorr_no<<" ratio="<<t_acorr_no/t_acorr_a64<<std::endl;
+#endif
 #endif
 
     return 0;
@@ -6,6 +6,35 @@
 #include"phantomquad_for_p3t_x86.hpp"
 #endif
 
+#ifdef ORBIT_QUADRUPOLE
+//! add the quadrupole term of one group c.m. j particle (without gravitational constant)
+/*! The orbit-averaged second moment of the group is used, monopole is calculated by the EPEP kernel.
+    Only used beyond r_out, inside r_out the linear cutoff potential is harmonic and the quadrupole term has no force.
+  @param[in,out] _acc: acceleration
+  @param[in,out] _pot: potential
+  @param[in] _rij: xi - xj
+  @param[in] _r2_eps: rij^2 + eps^2
+  @param[in] _quad: second moment of the group relative to c.m.
+ */
+template<class Tmat>
+inline void calcAccPotOrbitQuadrupole(PS::F64vec& _acc, PS::F64& _pot, const PS::F64vec& _rij, const PS::F64 _r2_eps, const Tmat& _quad) {
+    const PS::F64 tr = _quad.getTrace();
+    const PS::F64vec qr( (_quad.xx*_rij.x + _quad.xy*_rij.y + _quad.xz*_rij.z),
+                         (_quad.yy*_rij.y + _quad.yz*_rij.z + _quad.xy*_rij.x),
+                         (_quad.zz*_rij.z + _quad.xz*_rij.x + _quad.yz*_rij.y) );
+    const PS::F64 qrr = qr * _rij;
+    const PS::F64 r_inv = 1.0/sqrt(_r2_eps);
+    const PS::F64 r2_inv = r_inv * r_inv;
+    const PS::F64 r3_inv = r2_inv * r_inv;
+    const PS::F64 r5_inv = r2_inv * r3_inv * 1.5;
+    const PS::F64 qrr_r5 = r5_inv * qrr;
+    const PS::F64 qrr_r7 = r2_inv * qrr_r5;
+    const PS::F64 A = - tr*r5_inv + 5*qrr_r7;
+    const PS::F64 B = -2.0*r5_inv;
+    _acc -= A*_rij + B*qr;
+    _pot -= - 0.5*tr*r3_inv + qrr_r5;
+}
+#endif
 
 // Neighbor search function
 struct SearchNeighborEpEpNoSimd{
@@ -36,9 +65,10 @@ struct SearchNeighborEpEpNoSimd{
 ////////////////////
 /// FORCE FUNCTOR
 struct CalcForceEpEpWithLinearCutoffNoSimd{
+    template<class Tepj>
     void operator () (const EPISoft * ep_i,
                       const PS::S32 n_ip,
-                      const EPJSoft * ep_j,
+                      const Tepj * ep_j,
                       const PS::S32 n_jp,
                       ForceSoft * force){
         const PS::F64 eps2 = EPISoft::eps * EPISoft::eps;
@@ -55,10 +85,10 @@ struct CalcForceEpEpWithLinearCutoffNoSimd{
                 //    n_ngb_i++;
                 //    continue;
                 //}
-                const PS::F64vec rij = xi - ep_j[j].pos;
+                const PS::F64vec rij = xi - ep_j[j].getPos();
                 const PS::F64 r2 = rij * rij;
                 const PS::F64 r2_eps = r2 + eps2;
-                const PS::F64 r_search = std::max(ep_i[i].r_search,ep_j[j].r_search);
+                const PS::F64 r_search = std::max(ep_i[i].r_search, (PS::F64)ep_j[j].r_search);
                 if(r2 < r_search*r_search){
                     n_ngb_i++;
                 }
@@ -68,6 +98,9 @@ struct CalcForceEpEpWithLinearCutoffNoSimd{
                 const PS::F64 m_r3 = m_r * r_inv * r_inv;
                 ai -= m_r3 * rij;
                 poti -= m_r;
+#ifdef ORBIT_QUADRUPOLE
+                if (r2_eps > r_out2) calcAccPotOrbitQuadrupole(ai, poti, rij, r2_eps, ep_j[j].quad);
+#endif
             }
             //std::cerr<<"poti= "<<poti<<std::endl;
             force[i].acc += G*ai;
@@ -88,9 +121,10 @@ struct CalcForceEpEpWithLinearCutoffNoSimd{
 
 #ifdef KDKDK_4TH
 struct CalcCorrectEpEpWithLinearCutoffNoSimd{
+    template<class Tepj>
     void operator () (const EPISoft * ep_i,
                       const PS::S32 n_ip,
-                      const EPJSoft * ep_j,
+                      const Tepj * ep_j,
                       const PS::S32 n_jp,
                       ForceSoft * force){
         const PS::F64 eps2 = EPISoft::eps * EPISoft::eps;
@@ -101,8 +135,8 @@ struct CalcCorrectEpEpWithLinearCutoffNoSimd{
             const PS::F64vec posi = ep_i[i].pos;
             const PS::F64vec acci = ep_i[i].acc;
             for(PS::S32 j=0; j<n_jp; j++){
-                const PS::F64vec dr = posi - ep_j[j].pos;
-                const PS::F64vec da = acci - ep_j[j].acc; 
+                const PS::F64vec dr = posi - ep_j[j].getPos();
+                const PS::F64vec da = acci - PS::F64vec(ep_j[j].acc.x, ep_j[j].acc.y, ep_j[j].acc.z);
                 const PS::F64 r2    = dr * dr + eps2;
                 const PS::F64 drda  = dr * da;
                 const PS::F64 r2_tmp = (r2 > r_out2) ? r2 : r_out2;
@@ -312,17 +346,27 @@ struct CalcForcePPSimd{
     Member particles will be excluded in the I particle list
  */
 struct CalcForceEpEpWithLinearCutoffSimd{
+    template<class Tepj>
     void operator () (const EPISoft * ep_i,
                       const PS::S32 n_ip,
-                      const EPJSoft * ep_j,
+                      const Tepj * ep_j,
                       const PS::S32 n_jp,
                       ForceSoft * force){
         const PS::F64 eps2 = EPISoft::eps * EPISoft::eps;
         const PS::F64 G = ForceSoft::grav_const;
         PS::S32 ep_j_list[n_jp], n_jp_local=0;
         PS::S32 ep_i_list[n_ip], n_ip_local=0;
+#ifdef ORBIT_QUADRUPOLE
+        // group c.m. with quadrupole, the quadrupole term is added after the monopole SIMD kernel
+        PS::S32 ep_j_quad_list[n_jp], n_jp_quad=0;
+#endif
         for (PS::S32 i=0; i<n_jp; i++){
-            if(ep_j[i].mass>0) ep_j_list[n_jp_local++] = i;
+            if(ep_j[i].mass>0) {
+                ep_j_list[n_jp_local++] = i;
+#ifdef ORBIT_QUADRUPOLE
+                if(ep_j[i].quad.getTrace()>0) ep_j_quad_list[n_jp_quad++] = i;
+#endif
+            }
         }
 //        std::cerr<<"n_jp="<<n_jp<<" reduced n_jp="<<n_jp_local<<std::endl;
 //        const PS::F64 r_crit2 = EPJSoft::r_search * EPJSoft::r_search;
@@ -385,8 +429,89 @@ struct CalcForceEpEpWithLinearCutoffSimd{
                 force[i].n_ngb += (PS::S32)(n_ngb*1.00001);
             }
         }
+#ifdef ORBIT_QUADRUPOLE
+        if (n_jp_quad>0) {
+            const PS::F64 r_out2 = EPISoft::r_out*EPISoft::r_out;
+            for(PS::S32 k=0; k<n_ip_local; k++){
+                const PS::S32 i=ep_i_list[k];
+                const PS::F64vec xi = ep_i[i].pos;
+                PS::F64vec ai = 0.0;
+                PS::F64 poti = 0.0;
+                for(PS::S32 jq=0; jq<n_jp_quad; jq++){
+                    const PS::S32 j = ep_j_quad_list[jq];
+                    const PS::F64vec rij = xi - ep_j[j].getPos();
+                    const PS::F64 r2_eps = rij * rij + eps2;
+                    if (r2_eps > r_out2) calcAccPotOrbitQuadrupole(ai, poti, rij, r2_eps, ep_j[j].quad);
+                }
+                force[i].acc += G*ai;
+                force[i].pot += G*poti;
+            }
+        }
+#endif
+    }
+};
+
+#if defined(KDKDK_4TH) && !defined(__HPC_ACE__)
+//! gradient correction of the KDKDK 4th-order step with linear cutoff (SIMD version of CalcCorrectEpEpWithLinearCutoffNoSimd)
+/*! The single precision PhantomGrapeQuad is always used since the correction is scaled by dt^3 in the kick
+ */
+struct CalcCorrectEpEpWithLinearCutoffSimd{
+    template<class Tepj>
+    void operator () (const EPISoft * ep_i,
+                      const PS::S32 n_ip,
+                      const Tepj * ep_j,
+                      const PS::S32 n_jp,
+                      ForceSoft * force){
+        const PS::F64 eps2 = EPISoft::eps * EPISoft::eps;
+        PS::S32 ep_j_list[n_jp], n_jp_local=0;
+        for (PS::S32 i=0; i<n_jp; i++){
+            if(ep_j[i].mass>0) ep_j_list[n_jp_local++] = i;
+        }
+        static thread_local PhantomGrapeQuad pg;
+        if(n_ip > pg.NIMAX || n_jp > pg.NJMAX){
+            std::cout<<"ni= "<<n_ip<<" NIMAX= "<<pg.NIMAX<<" nj= "<<n_jp<<" NJMAX= "<<pg.NJMAX<<std::endl;
+        }
+        assert(n_ip<=pg.NIMAX);
+        assert(n_jp<=pg.NJMAX);
+        pg.set_eps2(eps2);
+        pg.set_r_crit2(EPISoft::r_out*EPISoft::r_out);
+        for(PS::S32 i=0; i<n_ip; i++){
+            const PS::F64vec pos_i = ep_i[i].getPos();
+            const PS::F64vec acc_i = ep_i[i].acc;
+            pg.set_xi_one(i, pos_i.x, pos_i.y, pos_i.z, 0.0);
+            pg.set_xi_acc_one(i, acc_i.x, acc_i.y, acc_i.z);
+            force[i].acc = acc_i;
+        }
+        PS::S32 loop_max = (n_jp_local-1) / PhantomGrapeQuad::NJMAX + 1;
+        for(PS::S32 loop=0; loop<loop_max; loop++){
+            const PS::S32 ih = PhantomGrapeQuad::NJMAX*loop;
+            const PS::S32 n_jp_tmp = ( (n_jp_local - ih) < PhantomGrapeQuad::NJMAX) ? (n_jp_local - ih) : PhantomGrapeQuad::NJMAX;
+            const PS::S32 it =ih + n_jp_tmp;
+            PS::S32 i_tmp = 0;
+            for(PS::S32 i=ih; i<it; i++, i_tmp++){
+                const PS::S32 ij = ep_j_list[i];
+                const PS::F64vec pos_j = ep_j[ij].getPos();
+                const PS::F64vec acc_j = PS::F64vec(ep_j[ij].acc.x, ep_j[ij].acc.y, ep_j[ij].acc.z);
+                pg.set_epj_one(i_tmp, pos_j.x, pos_j.y, pos_j.z, ep_j[ij].mass, 0.0);
+                pg.set_epj_acc_one(i_tmp, acc_j.x, acc_j.y, acc_j.z);
+            }
+            pg.run_epj_acorr_for_p3t_with_linear_cutoff(n_ip, n_jp_tmp);
+            for(PS::S32 i=0; i<n_ip; i++){
+                PS::F64 a[3]= {0,0,0};
+                pg.accum_acorr_one(i, a[0], a[1], a[2]);
+#ifdef NAN_CHECK_DEBUG
+                assert(!std::isnan(a[0]));
+                assert(!std::isnan(a[1]));
+                assert(!std::isnan(a[2]));
+#endif
+                force[i].acorr[0] += 2.0*a[0];
+                force[i].acorr[1] += 2.0*a[1];
+                force[i].acorr[2] += 2.0*a[2];
+            }
+        }
     }
 };
+#endif
 
 struct CalcForceEpSpMonoSimd{
     template<class Tsp>
@@ -516,4 +641,187 @@ struct CalcForceEpSpQuadSimd{
         }
     }
 };
+
+//! get memory size (bytes) of the thread-local PhantomGrapeQuad buffers of the SIMD kernels in one thread
+/*! Each of the five kernels above (neighbor search, PP, EP-EP, EP-SP monopole and quadrupole) keeps one buffer per thread,
+    with KDKDK_4TH the gradient correction kernel keeps one more.
+    With __HPC_ACE__ the buffers are on the stack and are not counted.
+ */
+inline size_t getSimdKernelBufferMemSizeOneThread() {
+#if defined(__HPC_ACE__)
+    return 0;
+#else
+#ifdef KDKDK_4TH
+    // the gradient correction kernel uses the single precision version
+    const size_t n_byte_acorr = sizeof(PhantomGrapeQuad);
+#else
+    const size_t n_byte_acorr = 0;
+#endif
+#if defined(CALC_EP_64bit)
+    return 5*sizeof(PhantomGrapeQuad64Bit) + n_byte_acorr;
+#elif defined(CALC_EP_MIX)
+    // EP-SP kernels use the single precision version
+    return 3*sizeof(PhantomGrapeQuad64Bit) + 2*sizeof(PhantomGrapeQuad) + n_byte_acorr;
+#else
+    return 5*sizeof(PhantomGrapeQuad) + n_byte_acorr;
+#endif
+#endif
+}
+#endif
+
+#ifdef TIDAL_TENSOR_TREE
+//! accumulate the soft acceleration gradient of group c.m. particles from EP-EP interactions with linear cutoff
+/*! The c.m. particles are identified by the negative id. 
+    The contributions of the group members and the neighbors inside r_out are corrected later in the hard part.
+ */
+template<class Tepj>
+inline void calcTidalGradientEpEp(const EPISoft * ep_i,
+                                  const PS::S32 n_ip,
+                                  const Tepj * ep_j,
+                                  const PS::S32 n_jp,
+                                  ForceSoft * force){
+    const PS::F64 eps2 = EPISoft::eps * EPISoft::eps;
+    const PS::F64 r_out2 = EPISoft::r_out*EPISoft::r_out;
+    const PS::F64 G = ForceSoft::grav_const;
+    for(PS::S32 i=0; i<n_ip; i++){
+        if (ep_i[i].id>=0) continue;
+        const PS::F64vec xi = ep_i[i].pos;
+        for(PS::S32 j=0; j<n_jp; j++){
+            if (ep_j[j].mass==0.0) continue;
+            const PS::F64vec rij = xi - ep_j[j].getPos();
+            const PS::F64 r2_eps = rij * rij + eps2;
+#ifdef TIDAL_TENSOR_3RD
+            TidalTensor::addPointMassGradientWithLinearCutoff(force[i].acc_grad, force[i].acc_grad2, rij, r2_eps, G*ep_j[j].mass, r_out2);
+#else
+            TidalTensor::addPointMassGradientWithLinearCutoff(force[i].acc_grad, NULL, rij, r2_eps, G*ep_j[j].mass, r_out2);
+#endif
+        }
+    }
+}
+
+inline void calcTidalGradient(const EPISoft * ep_i,
+                              const PS::S32 n_ip,
+                              const EPJSoft * ep_j,
+                              const PS::S32 n_jp,
+                              ForceSoft * force){
+    calcTidalGradientEpEp(ep_i, n_ip, ep_j, n_jp, force);
+}
+
+#ifdef COMPACT_LET
+inline void calcTidalGradient(const EPISoft * ep_i,
+                              const PS::S32 n_ip,
+                              const EPJSoftCompact * ep_j,
+                              const PS::S32 n_jp,
+                              ForceSoft * force){
+    calcTidalGradientEpEp(ep_i, n_ip, ep_j, n_jp, force);
+}
+#endif
+
+//! accumulate the soft acceleration gradient of group c.m. particles from EP-SP interactions
+/*! Only the monopole of super particles is used for the gradient
+ */
+template<class Tsp>
+void calcTidalGradient(const EPISoft * ep_i,
+                           const PS::S32 n_ip,
+                           const Tsp * sp_j,
+                           const PS::S32 n_jp,
+                           ForceSoft * force){
+    const PS::F64 eps2 = EPISoft::eps * EPISoft::eps;
+    const PS::F64 G = ForceSoft::grav_const;
+    for(PS::S32 i=0; i<n_ip; i++){
+        if (ep_i[i].id>=0) continue;
+        const PS::F64vec xi = ep_i[i].pos;
+        for(PS::S32 j=0; j<n_jp; j++){
+            const PS::F64vec rij = xi - sp_j[j].getPos();
+            const PS::F64 r2_eps = rij * rij + eps2;
+#ifdef TIDAL_TENSOR_3RD
+            TidalTensor::addPointMassGradient(force[i].acc_grad, force[i].acc_grad2, rij, r2_eps, G*sp_j[j].getCharge());
+#else
+            TidalTensor::addPointMassGradient(force[i].acc_grad, NULL, rij, r2_eps, G*sp_j[j].getCharge());
+#endif
+        }
+    }
+}
+#endif
+
+#ifdef TREE_LEVEL_STEP
+//! buffers of active i particles in CalcForceActiveOnly for one thread
+struct ActiveIBuffer{
+    PS::ReallocatableArray<PS::S32> adr;
+    PS::ReallocatableArray<EPISoft> ep_i;
+    PS::ReallocatableArray<ForceSoft> force;
+};
+#endif
+
+//! force kernel wrapper for the hierarchical tree step
+/*! Only active i particles (EPISoft::active==1) are passed to the kernel, the forces of inactive ones are not modified.
+    Works for both EP-EP and EP-SP kernels.
+    Without TREE_LEVEL_STEP or if EPISoft::active_check is false (the hierarchical tree step is off), the kernel is called directly.
+    The active i particles are gathered in reusable buffers of each thread.
+    With TIDAL_TENSOR_TREE, the acceleration gradient of the group c.m. particles is also accumulated.
+ */
+template<class Tkernel>
+struct CalcForceActiveOnly{
+    Tkernel kernel;
+
+    CalcForceActiveOnly(const Tkernel& _kernel): kernel(_kernel) {}
+
+    template<class Tpj>
+    void calcForce(const EPISoft * ep_i,
+                   const PS::S32 n_ip,
+                   const Tpj * ep_j,
+                   const PS::S32 n_jp,
+                   ForceSoft * force){
+        kernel(ep_i, n_ip, ep_j, n_jp, force);
+#ifdef TIDAL_TENSOR_TREE
+        calcTidalGradient(ep_i, n_ip, ep_j, n_jp, force);
+#endif
+    }
+
+    template<class Tpj>
+    void operator () (const EPISoft * ep_i,
+                      const PS::S32 n_ip,
+                      const Tpj * ep_j,
+                      const PS::S32 n_jp,
+                      ForceSoft * force){
+#ifdef TREE_LEVEL_STEP
+        if (!EPISoft::active_check) {
+            calcForce(ep_i, n_ip, ep_j, n_jp, force);
+            return;
+        }
+        PS::S32 n_act = 0;
+        for(PS::S32 i=0; i<n_ip; i++) n_act += ep_i[i].active;
+        if (n_act==n_ip) {
+            calcForce(ep_i, n_ip, ep_j, n_jp, force);
+            return;
+        }
+        if (n_act==0) return;
+
+        // gather active i particles
+        static std::vector<ActiveIBuffer> buffer(PS::Comm::getNumberOfThread());
+        auto& buf = buffer[PS::Comm::getThreadNum()];
+        buf.adr.resizeNoInitialize(n_act);
+        buf.ep_i.resizeNoInitialize(n_act);
+        buf.force.resizeNoInitialize(n_act);
+        PS::S32 k=0;
+        for(PS::S32 i=0; i<n_ip; i++) {
+            if (ep_i[i].active) {
+                buf.adr[k] = i;
+                buf.ep_i[k] = ep_i[i];
+                buf.force[k] = force[i];
+                k++;
+            }
+        }
+        calcForce(buf.ep_i.getPointer(), n_act, ep_j, n_jp, buf.force.getPointer());
+        for(PS::S32 k=0; k<n_act; k++) force[buf.adr[k]] = buf.force[k];
+#else
+        calcForce(ep_i, n_ip, ep_j, n_jp, force);
 #endif
+    }
+};
+
+//! create the force kernel wrapper for the hierarchical tree step
+template<class Tkernel>
+CalcForceActiveOnly<Tkernel> calcForceActiveOnly(const Tkernel& _kernel) {
+    return CalcForceActiveOnly<Tkernel>(_kernel);
+}
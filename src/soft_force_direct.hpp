@@ -0,0 +1,172 @@
+#pragma once
+#include"soft_ptcl.hpp"
+
+//! Direct summation backend for the soft force
+/*! Replace the particle-tree soft force by a blocked O(N^2) summation for small-N systems.
+    The same EP-EP kernels used in the tree (linear cutoff) are applied to all j particles, thus no EP-SP interaction exists.
+    With MPI, the j particles are shifted along a ring of processes, the force of the current block is calculated while the next block is transferred.
+    All j particles are kept after the force calculation, so that the neighbor list required by the changeover correction can be obtained in the same way as the tree (getNeighborListOneParticle).
+ */
+class SoftForceDirect{
+private:
+    PS::ReallocatableArray<EPISoft> epi_;
+    PS::ReallocatableArray<EPJSoft> epj_;
+    PS::ReallocatableArray<ForceSoft> force_;
+    PS::ReallocatableArray<PS::S32> n_ngb_bk_;  // backup of the neighbor number during the kernel calls of one j group
+    PS::ReallocatableArray<PS::S32> n_epj_;     // j particle number of each process
+    PS::ReallocatableArray<PS::S32> n_epj_disp_; // j particle offset of each process in epj_
+    PS::ReallocatableArray<EPJSoft>* epj_ngb_;  // neighbor list buffer for each thread
+    PS::S32 n_thread_;
+
+    //! force of all local i particles from one j block
+    template<class Tfunc>
+    void calcForceOneBlock(Tfunc& _func, const EPJSoft* _epj, const PS::S32 _n_epj) {
+        const PS::S32 n_epi = epi_.size();
+        const PS::S32 n_i_block = (n_epi-1)/n_i_group + 1;
+        n_ngb_bk_.resizeNoInitialize(n_epi);
+#pragma omp parallel for schedule(dynamic)
+        for (PS::S32 k=0; k<n_i_block; k++) {
+            const PS::S32 i_start = k*n_i_group;
+            const PS::S32 n_i = std::min(n_i_group, n_epi-i_start);
+            const EPISoft* epi = epi_.getPointer(i_start);
+            ForceSoft* force = force_.getPointer(i_start);
+            PS::S32* n_ngb_bk = n_ngb_bk_.getPointer(i_start);
+            for (PS::S32 j_start=0; j_start<_n_epj; j_start+=n_j_group) {
+                const PS::S32 n_j = std::min(n_j_group, _n_epj-j_start);
+                // some kernels overwrite the neighbor number instead of accumulation, keep the sum separately
+                for (PS::S32 i=0; i<n_i; i++) {
+                    n_ngb_bk[i] = force[i].n_ngb;
+                    force[i].n_ngb = 0;
+                }
+                _func(epi, n_i, &_epj[j_start], n_j, force);
+                for (PS::S32 i=0; i<n_i; i++) force[i].n_ngb += n_ngb_bk[i];
+            }
+        }
+    }
+
+public:
+    PS::S32 n_i_group; ///> i particle group size for one kernel call
+    PS::S32 n_j_group; ///> j particle group size for one kernel call
+    PS::F64 time_calc_force; ///> wallclock time of the last force calculation
+    PS::S64 n_interaction_loc; ///> local number of interactions of the last force calculation
+
+    SoftForceDirect(): epi_(), epj_(), force_(), n_ngb_bk_(), n_epj_(), n_epj_disp_(), epj_ngb_(NULL), n_thread_(0), n_i_group(256), n_j_group(4096), time_calc_force(0.0), n_interaction_loc(0) {}
+
+    ~SoftForceDirect() {
+        if (epj_ngb_!=NULL) delete [] epj_ngb_;
+    }
+
+    //! calculate force for all local particles and write back to the particle system
+    /*! The interface follows calcForceAllAndWriteBack of FDPS tree.
+      @param[in] _func: EP-EP force kernel
+      @param[in,out] _sys: particle system, force is written back
+     */
+    template<class Tfunc, class Tsys>
+    void calcForceAllAndWriteBack(Tfunc _func, Tsys& _sys) {
+        const PS::F64 time_start = PS::GetWtime();
+        const PS::S32 n_loc = _sys.getNumberOfParticleLocal();
+        const PS::S32 n_proc = PS::Comm::getNumberOfProc();
+        const PS::S32 my_rank = PS::Comm::getRank();
+
+        // get j particle number of all processes
+        n_epj_.resizeNoInitialize(n_proc);
+        n_epj_disp_.resizeNoInitialize(n_proc+1);
+#ifdef PARTICLE_SIMULATOR_MPI_PARALLEL
+        PS::Comm::allGather(&n_loc, 1, n_epj_.getPointer());
+#else
+        n_epj_[0] = n_loc;
+#endif
+        n_epj_disp_[0] = 0;
+        for (PS::S32 i=0; i<n_proc; i++) n_epj_disp_[i+1] = n_epj_disp_[i] + n_epj_[i];
+
+        epi_.resizeNoInitialize(n_loc);
+        force_.resizeNoInitialize(n_loc);
+        epj_.resizeNoInitialize(n_epj_disp_[n_proc]);
+        EPJSoft* epj_loc = epj_.getPointer(n_epj_disp_[my_rank]);
+#pragma omp parallel for
+        for (PS::S32 i=0; i<n_loc; i++) {
+            epi_[i].copyFromFP(_sys[i]);
+            epj_loc[i].copyFromFP(_sys[i]);
+            force_[i].clear();
+        }
+
+        // ring: in step k, the block from rank (my_rank-k) is used and the block from rank (my_rank-k-1) is received
+        for (PS::S32 k=0; k<n_proc; k++) {
+            const PS::S32 rank_blk = (my_rank-k+n_proc)%n_proc;
+#ifdef PARTICLE_SIMULATOR_MPI_PARALLEL
+            MPI_Request req[2];
+            MPI_Status stat[2];
+            PS::S32 n_req = 0;
+            if (k<n_proc-1) {
+                const PS::S32 rank_next = (my_rank+1)%n_proc;
+                const PS::S32 rank_prev = (my_rank-1+n_proc)%n_proc;
+                const PS::S32 rank_recv = (my_rank-k-1+n_proc)%n_proc;
+                if (n_epj_[rank_recv]>0)
+                    MPI_Irecv(epj_.getPointer(n_epj_disp_[rank_recv]), n_epj_[rank_recv], PS::GetDataType<EPJSoft>(),
+                              rank_prev, 2150, MPI_COMM_WORLD, &req[n_req++]);
+                if (n_epj_[rank_blk]>0)
+                    MPI_Isend(epj_.getPointer(n_epj_disp_[rank_blk]), n_epj_[rank_blk], PS::GetDataType<EPJSoft>(),
+                              rank_next, 2150, MPI_COMM_WORLD, &req[n_req++]);
+            }
+#endif
+            if (n_loc>0 && n_epj_[rank_blk]>0)
+                calcForceOneBlock(_func, epj_.getPointer(n_epj_disp_[rank_blk]), n_epj_[rank_blk]);
+#ifdef PARTICLE_SIMULATOR_MPI_PARALLEL
+            MPI_Waitall(n_req, req, stat);
+#endif
+        }
+
+#pragma omp parallel for
+        for (PS::S32 i=0; i<n_loc; i++) _sys[i].copyFromForce(force_[i]);
+
+        // neighbor list buffer should be allocated outside of the OpenMP parallel region
+        initialNeighborBuffer();
+
+        n_interaction_loc = (PS::S64)n_loc*(PS::S64)epj_.size();
+        time_calc_force = PS::GetWtime() - time_start;
+    }
+
+    //! get neighbor list of one particle from all j particles saved in the last force calculation
+    /*! Same interface as the FDPS tree, the neighbor criterion is max(r_search_i, r_search_j)
+      @param[in] _ptcl: particle to search
+      @param[out] _epj: pointer to the neighbor list (thread local buffer, valid until the next call in the same thread)
+      \return number of neighbors
+     */
+    template<class Tptcl>
+    PS::S32 getNeighborListOneParticle(const Tptcl& _ptcl, EPJSoft* & _epj) {
+        assert(epj_ngb_!=NULL);
+        auto& epj_ngb = epj_ngb_[PS::Comm::getThreadNum()];
+        epj_ngb.clearSize();
+        const PS::F64vec pos_i = _ptcl.getPos();
+        const PS::F64 r_search_i = _ptcl.getRSearch();
+        const PS::S32 n_epj = epj_.size();
+        for (PS::S32 j=0; j<n_epj; j++) {
+            const PS::F64vec dr = pos_i - epj_[j].pos;
+            const PS::F64 r_search = std::max(r_search_i, epj_[j].getRSearch());
+            if (dr*dr < r_search*r_search) epj_ngb.push_back(epj_[j]);
+        }
+        _epj = epj_ngb.getPointer();
+        return epj_ngb.size();
+    }
+
+    //! allocate neighbor list buffers for all threads
+    void initialNeighborBuffer() {
+        const PS::S32 n_thread = PS::Comm::getNumberOfThread();
+        if (n_thread_==n_thread) return;
+        if (epj_ngb_!=NULL) delete [] epj_ngb_;
+        epj_ngb_ = new PS::ReallocatableArray<EPJSoft>[n_thread];
+        n_thread_ = n_thread;
+    }
+
+    //! get total number of j particles
+    PS::S64 getNumberOfEPJ() const {
+        return epj_.size();
+    }
+
+    //! get allocated memory size (bytes) of all buffers
+    size_t getMemSizeUsed() const {
+        size_t size = epi_.getMemSize() + epj_.getMemSize() + force_.getMemSize() + n_ngb_bk_.getMemSize() + n_epj_.getMemSize() + n_epj_disp_.getMemSize();
+        for (PS::S32 i=0; i<n_thread_; i++) size += epj_ngb_[i].getMemSize();
+        return size;
+    }
+};
@@ -1,6 +1,33 @@
 #pragma once
 #include"ptcl.hpp"
 
+#ifdef TIDAL_TENSOR_TREE
+#ifdef KDKDK_4TH
+#error "TIDAL_TENSOR_TREE does not support KDKDK_4TH, the gradient is not kept in the acorr force calculation"
+#endif
+#ifdef USE_GPU
+#error "TIDAL_TENSOR_TREE does not support USE_GPU, the GPU kernel does not calculate the acceleration gradient"
+#endif
+#ifdef EXTERNAL_POT_IN_PTCL
+#error "TIDAL_TENSOR_TREE does not support external potential, the gradient of the external force is not available"
+#endif
+#endif
+
+#ifdef ORBIT_QUADRUPOLE
+#ifdef USE_GPU
+#error "ORBIT_QUADRUPOLE does not support USE_GPU, the GPU kernel does not include the quadrupole of group c.m."
+#endif
+#ifdef USE_FUGAKU
+#error "ORBIT_QUADRUPOLE does not support USE_FUGAKU, the Fugaku kernel does not include the quadrupole of group c.m."
+#endif
+#endif
+
+#ifdef COMPACT_LET
+#if !defined(USE_SIMD) || defined(P3T_64BIT) || defined(P3T_MIXBIT) || defined(USE_GPU) || defined(USE_FUGAKU)
+#error "COMPACT_LET needs the single-precision x86 SIMD soft force kernel, the j particles of the soft tree are stored in single precision"
+#endif
+#endif
+
 class ForceSoft{
 public:
     PS::F64vec acc; ///> soft acceleration (c.m.: averaged force from orbital particles; tensor: c.m. is substracted)
@@ -8,6 +35,12 @@ public:
 #ifdef KDKDK_4TH
     PS::F64vec acorr; ///> soft gradient correction for 4th order KDKDK method
 #endif
+#ifdef TIDAL_TENSOR_TREE
+    PS::F64 acc_grad[6];  ///> gradient of soft acceleration (xx, xy, xz, yy, yz, zz), only for group c.m. particles
+#ifdef TIDAL_TENSOR_3RD
+    PS::F64 acc_grad2[10]; ///> 2nd derivative of soft acceleration (same order as TidalTensor::T3), only for group c.m. particles
+#endif
+#endif
 #ifdef SAVE_NEIGHBOR_ID_IN_FORCE_KERNEL
     PS::S64 id_ngb[4]; /// five neighbor id
 #endif
@@ -19,6 +52,12 @@ public:
         n_ngb = 0;
 #ifdef SAVE_NEIGHBOR_ID_IN_FORCE_KERNEL
         id_ngb[0] = id_ngb[1] = id_ngb[2] = id_ngb[3] = 0;
+#endif
+#ifdef TIDAL_TENSOR_TREE
+        for (int k=0; k<6; k++) acc_grad[k] = 0.0;
+#ifdef TIDAL_TENSOR_3RD
+        for (int k=0; k<10; k++) acc_grad2[k] = 0.0;
+#endif
 #endif
     }
 };
@@ -40,6 +79,27 @@ public:
     PS::S64 n_ngb;
     PS::S32 rank_org;
     PS::S32 adr;
+#ifdef TREE_LEVEL_STEP
+    PS::F64vec acc_block; // hierarchical tree step: soft acceleration at the beginning of the current block
+    PS::F64 pot_block;    // hierarchical tree step: soft potential at the beginning of the current block
+    PS::S32 tree_level;   // hierarchical tree step: the current block step is dt_soft*2^tree_level
+    PS::S32 tree_level_last; // hierarchical tree step: level of the last block, -1: no history
+    PS::S32 tree_active;  // hierarchical tree step: 1: soft force is calculated in this step; 0: skipped
+    PS::F64 tree_dt_sync; // hierarchical tree step: remaining closing kick step of the block synchronized in this step, 0: none
+#endif
+#ifdef NB_GROUP_CM
+    PS::S64 nb_group_id;  // neighbor group c.m. mode: id of the stable group (minimum member id) found in the last drift, 0: not a member
+    PS::S32 nb_group_n;   // neighbor group c.m. mode: number of members of the stable group
+#endif
+#ifdef TIDAL_TENSOR_TREE
+    PS::F64 acc_grad[6];   // gradient of soft acceleration, only for group c.m. particles
+#ifdef TIDAL_TENSOR_3RD
+    PS::F64 acc_grad2[10]; // 2nd derivative of soft acceleration, only for group c.m. particles
+#endif
+#endif
+#ifdef ORBIT_QUADRUPOLE
+    PS::F64mat quad;       // orbit-averaged second moment of members relative to c.m., only for group c.m. particles
+#endif
 //    static PS::F64 r_out;
 
     FPSoft() {}
@@ -79,6 +139,27 @@ public:
         pot_ext = 0;
 #endif
         n_ngb = 0;
+#ifdef TREE_LEVEL_STEP
+        acc_block = 0;
+        pot_block = 0;
+        tree_level = 0;
+        tree_level_last = -1;
+        tree_active = 1;
+        tree_dt_sync = 0;
+#endif
+#ifdef NB_GROUP_CM
+        nb_group_id = 0;
+        nb_group_n = 0;
+#endif
+#ifdef TIDAL_TENSOR_TREE
+        for (int k=0; k<6; k++) acc_grad[k] = 0.0;
+#ifdef TIDAL_TENSOR_3RD
+        for (int k=0; k<10; k++) acc_grad2[k] = 0.0;
+#endif
+#endif
+#ifdef ORBIT_QUADRUPOLE
+        quad = 0.0;
+#endif
     }
 
     void copyFromForce(const ForceSoft & force){
@@ -90,6 +171,12 @@ public:
 #endif
 #ifdef SAVE_NEIGHBOR_ID_IN_FORCE_KERNEL
         for (int k=0; k<4; k++) id_ngb[k] = force.id_ngb[k];
+#endif
+#ifdef TIDAL_TENSOR_TREE
+        for (int k=0; k<6; k++) acc_grad[k] = force.acc_grad[k];
+#ifdef TIDAL_TENSOR_3RD
+        for (int k=0; k<10; k++) acc_grad2[k] = force.acc_grad2[k];
+#endif
 #endif
         n_ngb = force.n_ngb;
     }
@@ -246,17 +333,26 @@ public:
     PS::F64 r_search;
     PS::S32 rank_org;
     PS::S32 type; // 0: orbital artificial particles; 1: others
+#ifdef TREE_LEVEL_STEP
+    PS::S32 active; // 1: i particle of the soft force; 0: skipped (hierarchical tree step)
+#endif
 #ifdef KDKDK_4TH
     PS::F64vec acc;
 #endif
     static PS::F64 eps;
     static PS::F64 r_out;
+#ifdef TREE_LEVEL_STEP
+    static bool active_check; // if true, inactive i particles are skipped by CalcForceActiveOnly
+#endif
     PS::F64vec getPos() const { return pos;}
     void copyFromFP(const FPSoft & fp){ 
         id = fp.id;
         pos = fp.pos;
         if (fp.group_data.artificial.isArtificial() && !fp.group_data.artificial.isCM() && fp.mass>0 ) type = 0;
         else type = 1;
+#ifdef TREE_LEVEL_STEP
+        active = fp.tree_active;
+#endif
 
 #ifdef KDKDK_4TH
         acc = fp.acc;
@@ -287,6 +383,9 @@ public:
     PS::F64vec vel;
 #ifdef KDKDK_4TH
     PS::F64vec acc;
+#endif
+#ifdef ORBIT_QUADRUPOLE
+    PS::F64mat quad; // orbit-averaged second moment of group members, zero for others
 #endif
     PS::F64 r_in;
     PS::F64 r_out;
@@ -305,6 +404,10 @@ public:
         vel = fp.vel;
 #ifdef KDKDK_4TH
         acc = fp.acc;
+#endif
+#ifdef ORBIT_QUADRUPOLE
+        if (fp.group_data.artificial.isCM()) quad = fp.quad;
+        else quad = 0.0;
 #endif
         r_in = fp.changeover.getRin();
         r_out = fp.changeover.getRout();
@@ -342,7 +445,124 @@ public:
         r_in = r_out = 0.0;
         r_search = 0.0;
         r_scale_next = 1.0;
+#ifdef ORBIT_QUADRUPOLE
+        quad = 0.0;
+#endif
         id = rank_org = adr_org = -1;
     }
 };
 
+#ifdef COMPACT_LET
+//! artificial particle type information of EPJSoftCompact in single precision
+/*! Only the type queries used by the changeover correction of soft forces are provided, 
+    the mass backup is kept for members and c.m. particles.
+ */
+class ArtificialParticleInformationF32{
+private:
+    PS::F32 mass_backup;
+    PS::F32 status;
+
+public:
+    ArtificialParticleInformationF32(): mass_backup(0.0), status(0.0) {}
+
+    //! copy from double-precision information
+    void copy(const ArtificialParticleInformation& _info) {
+        status = _info.getStatus();
+        mass_backup = (_info.isMember()||_info.isCM()) ? _info.getMassBackup() : 0.0;
+    }
+
+    bool isMember() const { return (status<0.0); }
+
+    bool isCM() const { return (status>0.0 && mass_backup>0.0); }
+
+    bool isSingle() const { return (status==0.0 && mass_backup==0.0); }
+
+    bool isArtificial() const { return (status>0.0); }
+
+    PS::F64 getMassBackup() const { return mass_backup; }
+};
+
+//! compact j particle of the soft tree
+/*! The soft tree (PeTar::TreeForce) sends full j particles to other MPI processes in the LET exchange.
+    When the soft force kernel calculates in single precision, only the data used by the kernels and the changeover correction are kept,
+    and except the position they are stored in single precision: 64 bytes (without KDKDK_4TH and ORBIT_QUADRUPOLE) instead of 120 bytes of EPJSoft. 
+    The position is kept in double precision, because the same j particles are used as the neighbor list of the changeover correction in the hard part 
+    (calcAccPotShortWithLinearCutoffEpj, calcAcorrShortWithLinearCutoffEpj), where the i-j distance of close neighbors is calculated from absolute positions.
+    The member names are the same as EPJSoft, pos is read by getPos().
+ */
+class EPJSoftCompact{
+public:
+    PS::S64 id;
+    PS::F64vec pos;
+    PS::F32 mass;
+#ifdef KDKDK_4TH
+    PS::F32vec acc;
+#endif
+#ifdef ORBIT_QUADRUPOLE
+    PS::F32mat quad; // orbit-averaged second moment of group members, zero for others
+#endif
+    PS::F32 r_in;
+    PS::F32 r_out;
+    PS::F32 r_search;
+    PS::F32 r_scale_next;
+    struct { ArtificialParticleInformationF32 artificial; } group_data;
+
+    void copyFromFP(const FPSoft & fp){
+        id = fp.id;
+        mass = fp.mass;
+        pos = fp.pos;
+#ifdef KDKDK_4TH
+        acc = PS::F32vec(fp.acc.x, fp.acc.y, fp.acc.z);
+#endif
+#ifdef ORBIT_QUADRUPOLE
+        if (fp.group_data.artificial.isCM()) {
+            quad.xx = fp.quad.xx;
+            quad.yy = fp.quad.yy;
+            quad.zz = fp.quad.zz;
+            quad.xy = fp.quad.xy;
+            quad.xz = fp.quad.xz;
+            quad.yz = fp.quad.yz;
+        }
+        else quad = 0.0;
+#endif
+        r_in = fp.changeover.getRin();
+        r_out = fp.changeover.getRout();
+        r_scale_next = fp.changeover.r_scale_next;
+        r_search = fp.r_search;
+        group_data.artificial.copy(fp.group_data.artificial);
+    }
+    PS::F64vec getPos() const { return pos; }
+    void setPos(const PS::F64vec & pos_new){ pos = pos_new;}
+    PS::F64 getCharge() const { return mass; }
+    PS::F64 getRSearch() const {
+        return r_search*SAFTY_FACTOR_FOR_SEARCH;
+    }
+
+    PS::S64 getId() const {
+        return id;
+    }
+
+    void print(std::ostream & fout=std::cout) const {
+        fout<<" id="<<id
+            <<" mass="<<mass
+            <<" pos="<<pos
+            <<" r_search="<<r_search;
+    }
+    void clear(){
+        mass = 0.0;
+        pos = 0.0;
+        r_in = r_out = 0.0;
+        r_search = 0.0;
+        r_scale_next = 1.0;
+#ifdef ORBIT_QUADRUPOLE
+        quad = 0.0;
+#endif
+        id = -1;
+    }
+};
+
+//! j particle type of the soft tree
+typedef EPJSoftCompact EPJSoftTree;
+#else
+typedef EPJSoft EPJSoftTree;
+#endif
@@ -8,5 +8,8 @@ PS::F64 Ptcl::r_group_crit_ratio =0.0;
 GroupDataMode Ptcl::group_data_mode = GroupDataMode::none;
 PS::F64 EPISoft::eps = 0.0;
 PS::F64 EPISoft::r_out = 0.0;
+#ifdef TREE_LEVEL_STEP
+bool EPISoft::active_check = false;
+#endif
 PS::F64 ForceSoft::grav_const = 1.0;
 
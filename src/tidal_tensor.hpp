@@ -46,10 +46,14 @@ public:
     /*! 
        2nd order: creat 4 zero-mass particles at the corners of regular tentrahedron with edge size of 0.16*_size. the cente is c.m. particle
        3rd order: creat 8 zero-mass particles at the corners of cube with edge size of 0.16*_size. the cente is c.m. particle
+       TIDAL_TENSOR_TREE: no particle is created
      */
     template<class Tptcl>
     static void createTidalTensorMeasureParticles(Tptcl* _ptcl_tt, const Tptcl& _ptcl_cm, const PS::F64 _size) {
-#ifdef TIDAL_TENSOR_3RD
+#ifdef TIDAL_TENSOR_TREE
+        // no measure particles, the tensor is obtained from the acceleration gradient of the c.m. particle
+        return;
+#elif defined(TIDAL_TENSOR_3RD)
         ///* Assume _size is the maximum length inside box
         //   Then the edge length=_size/(2*sqrt(2))
         // */
@@ -120,12 +124,17 @@ public:
        zyx zyy zyz  4  7  8
        zzx zzy zzz  5  8  9
        
+       With TIDAL_TENSOR_TREE, the tensor is filled from the acceleration gradient of _ptcl_cm instead (see fillFromGradient).
+
        @param[in] _ptcl_tt: tidal tensor measure particles
        @param[in] _ptcl_cm: tidal tensor measure particle c.m.
        @param[in] _size: particle box size
     */
     template<class Tptcl>
     void fit(Tptcl* _ptcl_tt, Tptcl& _ptcl_cm,  const PS::F64 _size) {
+#ifdef TIDAL_TENSOR_TREE
+        fillFromGradient(_ptcl_cm);
+#else
         // get c.m. position
         pos = _ptcl_cm.pos;
 
@@ -218,8 +227,94 @@ public:
         PS::F64 T2S = 2.0/_size;
         for (PS::S32 i=0; i<9;  i++) T2[i] *= T2S;
 #endif
+#endif // TIDAL_TENSOR_TREE
     }
 
+#ifdef TIDAL_TENSOR_TREE
+    //! fill tensor from the soft acceleration gradient of the c.m. particle accumulated in the tree force
+    /*! T1 is zero (c.m. force is removed); T2 is the gradient; T3 is half of the 2nd derivative. 
+      The gradient is symmetric, the order of components is xx, xy, xz, yy, yz, zz; the 2nd derivative use the same order as T3.
+      @param[in] _ptcl_cm: c.m. particle with acc_grad (and acc_grad2 for 3rd order)
+    */
+    template<class Tptcl>
+    void fillFromGradient(const Tptcl& _ptcl_cm) {
+        pos = _ptcl_cm.pos;
+
+        T1[0] = T1[1] = T1[2] = 0.0;
+
+        const PS::F64* g = _ptcl_cm.acc_grad;
+        T2[0] = g[0];  T2[1] = g[1];  T2[2] = g[2];
+        T2[3] = g[1];  T2[4] = g[3];  T2[5] = g[4];
+        T2[6] = g[2];  T2[7] = g[4];  T2[8] = g[5];
+
+#ifdef TIDAL_TENSOR_3RD
+        for (PS::S32 i=0; i<10; i++) T3[i] = 0.5*_ptcl_cm.acc_grad2[i];
+#endif
+    }
+
+    //! add the acceleration gradient (and 2nd derivative for 3rd order) from one point mass
+    /*! acc = - k(r) m dr / r^3, with the changeover factor k and its derivative dk = dk/dr.
+      dk is only included in the gradient, the 2nd derivative assumes constant k.
+      @param[in,out] _grad: gradient (xx, xy, xz, yy, yz, zz)
+      @param[in,out] _grad2: 2nd derivative (same order as T3), only used for 3rd order
+      @param[in] _dr: position of the i particle relative to the point mass
+      @param[in] _r2: dr^2 + eps^2
+      @param[in] _gm: G*mass
+      @param[in] _k: changeover factor of force
+      @param[in] _dk: derivative of _k on r
+    */
+    static void addPointMassGradient(PS::F64* _grad, PS::F64* _grad2, const PS::F64vec& _dr, const PS::F64 _r2, const PS::F64 _gm, const PS::F64 _k=1.0, const PS::F64 _dk=0.0) {
+        const PS::F64 r_inv = 1.0/sqrt(_r2);
+        const PS::F64 r2_inv = r_inv*r_inv;
+        const PS::F64 gmr3 = _gm*r_inv*r2_inv;
+        const PS::F64 a = -_k*gmr3;                          // delta_ij 
+        const PS::F64 b = (3.0*_k*r2_inv - _dk*r_inv)*gmr3;  // x_i x_j
+        const PS::F64 x = _dr.x;
+        const PS::F64 y = _dr.y;
+        const PS::F64 z = _dr.z;
+        _grad[0] += a + b*x*x;
+        _grad[1] +=     b*x*y;
+        _grad[2] +=     b*x*z;
+        _grad[3] += a + b*y*y;
+        _grad[4] +=     b*y*z;
+        _grad[5] += a + b*z*z;
+#ifdef TIDAL_TENSOR_3RD
+        const PS::F64 c = 3.0*_k*gmr3*r2_inv; // delta_ij x_k + delta_ik x_j + delta_jk x_i
+        const PS::F64 d = -5.0*c*r2_inv;      // x_i x_j x_k
+        _grad2[0] += 3.0*c*x + d*x*x*x;
+        _grad2[1] +=     c*y + d*x*x*y;
+        _grad2[2] +=     c*z + d*x*x*z;
+        _grad2[3] +=     c*x + d*x*y*y;
+        _grad2[4] +=           d*x*y*z;
+        _grad2[5] +=     c*x + d*x*z*z;
+        _grad2[6] += 3.0*c*y + d*y*y*y;
+        _grad2[7] +=     c*z + d*y*y*z;
+        _grad2[8] +=     c*y + d*y*z*z;
+        _grad2[9] += 3.0*c*z + d*z*z*z;
+#endif
+    }
+
+    //! add the acceleration gradient (and 2nd derivative for 3rd order) from one point mass with the linear cutoff of the tree force
+    /*! Inside _r_out2 the force is linear, the gradient is constant and the 2nd derivative is zero.
+      @param[in,out] _grad: gradient (xx, xy, xz, yy, yz, zz)
+      @param[in,out] _grad2: 2nd derivative (same order as T3), only used for 3rd order
+      @param[in] _dr: position of the i particle relative to the point mass
+      @param[in] _r2: dr^2 + eps^2
+      @param[in] _gm: G*mass
+      @param[in] _r_out2: cutoff radius square
+    */
+    static void addPointMassGradientWithLinearCutoff(PS::F64* _grad, PS::F64* _grad2, const PS::F64vec& _dr, const PS::F64 _r2, const PS::F64 _gm, const PS::F64 _r_out2) {
+        if (_r2>_r_out2) addPointMassGradient(_grad, _grad2, _dr, _r2, _gm);
+        else {
+            const PS::F64 r_out_inv = 1.0/sqrt(_r_out2);
+            const PS::F64 a = -_gm*r_out_inv*r_out_inv*r_out_inv;
+            _grad[0] += a;
+            _grad[3] += a;
+            _grad[5] += a;
+        }
+    }
+#endif
+
     //! Shift c.m. to new reference position
     /*! Only the 1st order tensor need a correction from 2nd order 
       
@@ -433,7 +528,9 @@ public:
 
     //! get particle number 
     static PS::S32 getParticleN() {
-#ifdef TIDAL_TENSOR_3RD
+#ifdef TIDAL_TENSOR_TREE
+        return 0;
+#elif defined(TIDAL_TENSOR_3RD)
         return 8;
 #else
         return 4;
@@ -186,7 +186,8 @@ int main(int argc, char **argv){
 
     // print particle
     std::cout<<"Tidal tensor box and center:\n";
-    for (int i=0; i<n_tt+1; i++) std::cout<<"I"<<i<<" "<<ptcl_tt[i].pos<<std::endl;
+    for (int i=0; i<n_tt; i++) std::cout<<"I"<<i<<" "<<ptcl_tt[i].pos<<std::endl;
+    std::cout<<"I"<<n_tt<<" "<<ptcl_binary_cm.pos<<std::endl;
     std::cout<<"Measuring points:\n";
     for (int i=0; i<n_check; i++) {
         ptcl_check[i].pos = ptcl[i].pos;
@@ -203,7 +204,8 @@ int main(int argc, char **argv){
             epi[i].r_search = r_scale*2;
             ptcl_tt[i].group_data.artificial.setParticleTypeToSingle();
         }
-        epi[n_tt].id = 9;
+        // negative id for c.m. (used to identify the c.m. in the acceleration gradient calculation)
+        epi[n_tt].id = -9;
         epi[n_tt].pos = ptcl_binary_cm.pos;
         epi[n_tt].r_search  = r_scale*2;
 
@@ -223,15 +225,22 @@ int main(int argc, char **argv){
 
         // calculate force
         ForceSoft force_sp[Nepi]; //8: box; last cm
-        for (int i=0; i<Nepi; i++) force_sp[i].acc = PS::F64vec(0,0,0);
+        for (int i=0; i<Nepi; i++) force_sp[i].clear();
         CalcForceEpSpMonoNoSimd f_ep_sp;
         ForceSoft::grav_const = gravitational_constant;
         EPISoft::eps = 0.0;
+#ifdef TIDAL_TENSOR_TREE
+        // no linear cutoff for the acceleration gradient
+        EPISoft::r_out = 0.0;
+#endif
         
         std::cout<<"EPJ mass,pos: (perturber) \n";
         for (int i=0; i<Nepj; i++) std::cout<<"I"<<i<<" "<<epj[i].pos<<std::endl;
     
         f_ep_sp(epi, Nepi, epj, Nepj, force_sp);
+#ifdef TIDAL_TENSOR_TREE
+        calcTidalGradient(epi, Nepi, epj, Nepj, force_sp);
+#endif
         for (int i=0; i<n_tt; i++) ptcl_tt[i].copyFromForce(force_sp[i]);
         ptcl_binary_cm.copyFromForce(force_sp[n_tt]);
         for (int i=0; i<n_check; i++) ptcl_check[i].copyFromForce(force_sp[i+n_tt+1]);
@@ -240,11 +249,10 @@ int main(int argc, char **argv){
 #ifdef GALPY
     addExtAcc(ptcl_binary_cm, pos_off, galpy_manager);
     for (int i=0; i<n_tt; i++) addExtAcc(ptcl_tt[i], pos_off, galpy_manager);
-    for (int i=0; i<n_check; i++) {
-        addExtAcc(ptcl_check[i], pos_off, galpy_manager);
-        ptcl_check[i].acc -= ptcl_binary_cm.acc;
-    }
+    for (int i=0; i<n_check; i++) addExtAcc(ptcl_check[i], pos_off, galpy_manager);
 #endif
+    // tidal tensor gives the acceleration relative to the c.m.
+    for (int i=0; i<n_check; i++) ptcl_check[i].acc -= ptcl_binary_cm.acc;
 
     // print acc at box
     std::cout<<"Original acc at tensor box:\n";
@@ -0,0 +1,39 @@
+#!/bin/bash
+# Accuracy and throughput check of the aarch64 soft force kernels (configure --with-arch=aarch64)
+# build/petar.simd.test compares the SVE/NEON kernels (EP-EP force, EP-SP force, neighbor search, and the KDKDK_4TH gradient correction)
+# with the double-precision NoSimd kernels and prints the maximum relative differences and the time ratios.
+# With SVE, the vector-length-agnostic kernels can be checked for several vector lengths (in bytes) if /proc/sys/abi/sve_default_vector_length is writable (root);
+# the vector length applies to new processes.
+# The script returns 1 if any relative difference exceeds the tolerance.
+# Usage: aarch64_kernel.sh [petar.simd.test] [tolerance] [SVE vector lengths in bytes]
+
+prog=${1:-build/petar.simd.test}
+tol=${2:-7e-3}
+vlist=${3:-""}
+
+vl_file=/proc/sys/abi/sve_default_vector_length
+[ -n "$vlist" ] && [ ! -w $vl_file ] && echo "$vl_file is not writable, use the default vector length" && vlist=""
+[ -n "$vlist" ] && vl_org=`cat $vl_file`
+[ -z "$vlist" ] && vlist=default
+
+status=0
+for vl in $vlist
+do
+    [ $vl != default ] && echo $vl >$vl_file
+    log=aarch64_kernel.$vl.log
+    $prog &>$log
+    egrep '^Use' $log
+    egrep '^AArch64' $log
+    egrep '^Time: .* aarch64' $log
+    # relative differences of force and potential
+    dmax=`egrep '^AArch64' $log |awk '{for (i=1; i<=NF; i++) if ($i=="max:") {v=$(i+1); v=(v>0?v:-v); if (v>m) m=v}} END{print m+0}'`
+    nerr=`egrep -c 'Neighbor diff|NB search diff' $log`
+    echo "vector length: $vl  max relative difference: $dmax  neighbor count differences: $nerr"
+    if awk -v d=$dmax -v t=$tol 'BEGIN{exit !(d>t)}'; then
+        echo "Error: relative difference $dmax exceeds the tolerance $tol"
+        status=1
+    fi
+done
+[ -n "$vl_org" ] && echo $vl_org >$vl_file
+
+exit $status
@@ -0,0 +1,51 @@
+#!/bin/bash
+# Test of the adaptive changeover (--changeover-adapt-min/max) on a Plummer core embedded in an extended Plummer halo
+# The same model is integrated with the fixed changeover and with the adaptive changeover,
+# then the cluster statistics (cluster size, neighbor number, r_out), the cluster size distribution and the relative cumulative energy error at the last output are printed.
+# The model is generated by sampling two independent Plummer spheres, thus it is not in an exact equilibrium.
+# Usage: changeover_adapt.sh [petar executable] [core N] [halo N] [T] [minimum factor] [maximum factor] [OpenMP thread number]
+
+source `dirname $0`/common.sh
+
+petar=${1:-petar}
+ncore=${2:-8000}
+nhalo=${3:-8000}
+t=${4:-2.0}
+fmin=${5:-0.25}
+fmax=${6:-4.0}
+nomp=${7:-4}
+
+enter_rdir changeover_adapt.n$ncore.$nhalo
+
+# mass, position, velocity of a Plummer model with total mass M and scale radius a (G=1)
+awk -v nc=$ncore -v nh=$nhalo 'function plummer(n, m_tot, a,   i, r, x, y, z, ve, q, g, v, ct, phi) {
+    for (i=0; i<n; i++) {
+        do { x=rand(); } while (x<1e-10);
+        r = a/sqrt(x^(-2.0/3.0)-1.0);
+        if (r>100*a) { i--; continue; }
+        ct = 2.0*rand()-1.0; phi = 2.0*3.141592653589793*rand();
+        x = r*sqrt(1-ct*ct)*cos(phi); y = r*sqrt(1-ct*ct)*sin(phi); z = r*ct;
+        ve = sqrt(2.0*m_tot)*(r*r+a*a)^(-0.25);
+        do { q=rand(); g=0.1*rand(); } while (g>q*q*(1-q*q)^3.5);
+        v = q*ve;
+        ct = 2.0*rand()-1.0; phi = 2.0*3.141592653589793*rand();
+        printf("%.16e %.16e %.16e %.16e %.16e %.16e %.16e\n", m_tot/n, x, y, z, v*sqrt(1-ct*ct)*cos(phi), v*sqrt(1-ct*ct)*sin(phi), v*ct);
+    }
+}
+BEGIN { srand(1); plummer(nc, 0.8, 0.6); plummer(nh, 0.2, 10.0); }' >halo.dat
+
+petar.init -f halo.input halo.dat &>init.log
+
+for mode in fixed adapt
+do
+    echo 'changeover: '$mode
+    if [ $mode == fixed ]; then
+        opts=''
+    else
+        opts='--changeover-adapt-min '$fmin' --changeover-adapt-max '$fmax
+    fi
+    run_timed petar.$mode.log $petar -t $t -o 0.25 -f data.$mode --cluster-stat 1 $opts halo.input
+    egrep 'Cluster statistics' petar.$mode.log |tail -1
+    egrep 'Cluster size distribution' petar.$mode.log |tail -1
+    echo 'Relative energy error (cumulative): '`energy_error petar.$mode.log`
+done
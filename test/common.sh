@@ -0,0 +1,93 @@
+#!/bin/bash
+# Shared functions of the test scripts, load by: source `dirname $0`/common.sh (before changing the directory)
+# The log parsers read the standard output of petar, the profile tables are printed with PROFILE in the compilation.
+
+# create the result directory [dir] if it does not exist and enter it
+# Usage: enter_rdir [dir]
+enter_rdir() {
+    [ -d $1 ] || mkdir $1
+    cd $1
+}
+
+# run a command with OMP_NUM_THREADS=$nomp, write its standard and error outputs to [log file]
+# and store the wallclock time in seconds in the variable twall
+# Usage: run_timed [log file] [command and options, e.g. $mpirun $petar -n 1000 __Plummer]
+run_timed() {
+    local log=$1
+    shift 1
+    local tstart=`date +%s.%N`
+    OMP_NUM_THREADS=$nomp OMP_STACKSIZE=128M "$@" &>$log
+    local tend=`date +%s.%N`
+    twall=`echo $tend' - '$tstart|bc -l`
+}
+
+# relative cumulative energy error |Error_cum/Total| of the last 'Physic:' line in the petar log, empty if not found
+# Usage: energy_error [log file]
+energy_error() {
+    egrep '^Physic:' $1 |tail -1 |awk '{if ($5!=0) print ($4/$5>0?$4/$5:-$4/$5)}'
+}
+
+# maximum relative cumulative energy error of all 'Physic:' lines in the petar log
+# Usage: energy_error_max [log file]
+energy_error_max() {
+    egrep '^Physic:' $1 |awk 'BEGIN{m=0} {if ($5!=0) {e=$4/$5; e=e>0?e:-e; if (e>m) m=e}} END{print m}'
+}
+
+# pick columns by names from the last table printed after the line containing [title]: the name line is followed by the value lines,
+# [row] selects the value line (defaulted: 1); a missing column is printed as '-'
+# Usage: table_columns [log file] [title] [column names, e.g. 'Tree_force Kick'] [row]
+table_columns() {
+    awk -v title="$2" -v cols="$3" -v row=${4:-1} '
+        index($0, title) { getline; nn=NF; for (i=1; i<=NF; i++) name[i]=$i;
+                           for (k=0; k<row; k++) getline;
+                           split("", val); for (i=1; i<=nn; i++) val[name[i]]=$i }
+        END { n=split(cols, s, " "); for (k=1; k<=n; k++) printf("%s%s", (k>1?" ":""), (s[k] in val)? val[s[k]] : "-"); printf("\n") }' $1
+}
+
+# wallclock time per step of the profile columns in the last profile print, the maximum of MPI processes (second value line)
+# Usage: prof_time [log file] [column names]
+prof_time() {
+    table_columns $1 'Wallclock time per step (local)' "$2" 2
+}
+
+# numbers per step of the counter columns in the last profile print
+# Usage: prof_count [log file] [column names]
+prof_count() {
+    table_columns $1 'Number per step (global)' "$2"
+}
+
+# print the column names with the values in one line
+# Usage: print_columns [label] [column names] [values]
+print_columns() {
+    echo "$1" |tr -d '\n'
+    paste -d '=' <(echo $2 |tr ' ' '\n') <(echo $3 |tr ' ' '\n') |awk '{printf(" %s", $0)} END {printf("\n")}'
+}
+
+# check that [value] is not larger than [tolerance], print an error and increase nfail otherwise (also if [value] is empty)
+# Usage: check_le [value] [tolerance] [description]
+nfail=0
+check_le() {
+    if [ -n "$1" ] && awk -v v=$1 -v t=$2 'BEGIN{exit !(v<=t)}'; then
+        return 0
+    fi
+    echo "Error: $3 = ${1:-(not found)} exceeds the tolerance $2"
+    nfail=`expr $nfail + 1`
+    return 1
+}
+
+# check that two values agree within the relative [tolerance] of the larger absolute value, same failure handling as check_le
+# Usage: check_agree [value 1] [value 2] [tolerance] [description]
+check_agree() {
+    if [ -n "$1" ] && [ -n "$2" ] && awk -v a=$1 -v b=$2 -v t=$3 'BEGIN{d=a-b; d=d>0?d:-d; a=a>0?a:-a; b=b>0?b:-b; exit !(d<=t*(a>b?a:b))}'; then
+        return 0
+    fi
+    echo "Error: $4 differ: ${1:-(not found)} ${2:-(not found)}, relative tolerance $3"
+    nfail=`expr $nfail + 1`
+    return 1
+}
+
+# print PASS or FAIL by the failure count of the checks, and exit with 1 if any check failed
+# Usage: check_exit
+check_exit() {
+    [ $nfail -eq 0 ] && echo 'PASS' || { echo 'FAIL: '$nfail' check(s)'; exit 1; }
+}
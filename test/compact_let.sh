@@ -0,0 +1,39 @@
+#!/bin/bash
+# Benchmark of the compact LET records of the soft tree (configure --enable-compact-let)
+# The same Plummer model is integrated with the default build and the compact LET build for several MPI process numbers on one node.
+# For each run, the size of the soft-tree j particle record (printed by the compact LET build only),
+# the wallclock time per step of exchange_LET_1st and exchange_LET_2nd (FDPS tree soft force time profile), Tree_force,
+# and the final relative energy error are printed; the energy errors of the two builds should agree within the single-precision kernel rounding,
+# the script returns 1 if their relative difference exceeds the tolerance.
+# Usage: compact_let.sh [petar] [petar (compact LET)] [N] [T] [MPI process numbers] [OpenMP thread number] [energy error tolerance (relative)]
+
+source `dirname $0`/common.sh
+
+petar=${1:-petar}
+petar_cl=${2:-petar.cl}
+n=${3:-100000}
+t=${4:-0.0625}
+plist=${5:-"8 16 32 64"}
+nomp=${6:-1}
+tol=${7:-0.1}
+
+enter_rdir compact_let.n$n
+
+echo 'n_proc build EPJ_size[byte] exchange_LET_1st[s] exchange_LET_2nd[s] Tree_force[s] energy_error'
+for p in $plist
+do
+    for mode in default cl
+    do
+        [ $mode == default ] && prog=$petar || prog=$petar_cl
+        run_timed petar.$p.$mode.log mpiexec -n $p $prog -n $n -t $t -o $t -f data.$p.$mode -w 0 __Plummer
+        size=`egrep 'Use compact LET' petar.$p.$mode.log |awk '{print $9}'`
+        [ -z "$size" ] && size=-
+        let_prof=`table_columns petar.$p.$mode.log 'FDPS tree soft force time profile' 'exchange_LET_1st exchange_LET_2nd'`
+        prof=`prof_time petar.$p.$mode.log Tree_force`
+        err=`energy_error petar.$p.$mode.log`
+        echo $p $mode $size $let_prof $prof $err
+        [ $mode == default ] && err_ref=$err || check_agree "$err_ref" "$err" $tol 'energy errors of n_proc='$p
+    done
+done
+
+check_exit
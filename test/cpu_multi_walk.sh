@@ -0,0 +1,36 @@
+#!/bin/bash
+# Benchmark of the CPU multi-walk mode of the tree soft force (--cpu-multi-walk)
+# The same Plummer model is integrated with the default kernel dispatch (--cpu-multi-walk 0) and with the multi-walk mode,
+# for several particle-tree group number limits (--number-group-limit), which set the i-group sizes of the walks.
+# For each run, the wallclock time per step of Tree_force and the final relative energy error are printed;
+# the energy errors of the two modes should agree (the kernels differ only in the float rounding of small i-groups),
+# the script returns 1 if their relative difference exceeds the tolerance.
+# The petar build should use SIMD (x86) without GPU.
+# Usage: cpu_multi_walk.sh [petar] [N] [T] [OpenMP thread number] [walks per dispatch] [group limits] [energy error tolerance (relative)]
+
+source `dirname $0`/common.sh
+
+petar=${1:-petar}
+n=${2:-100000}
+t=${3:-0.0625}
+nomp=${4:-4}
+nwalk=${5:-256}
+glist=${6:-"64 256 1024"}
+tol=${7:-0.1}
+
+enter_rdir cpu_multi_walk.n$n
+
+echo 'n_group_limit cpu_multi_walk Tree_force[s] energy_error'
+for g in $glist
+do
+    for w in 0 $nwalk
+    do
+        run_timed petar.$g.$w.log $petar --number-group-limit $g --cpu-multi-walk $w -n $n -t $t -o $t -f data.$g.$w -w 0 __Plummer
+        prof=`prof_time petar.$g.$w.log Tree_force`
+        err=`energy_error petar.$g.$w.log`
+        echo $g $w $prof $err
+        [ $w == 0 ] && err_ref=$err || check_agree "$err_ref" "$err" $tol 'energy errors of n_group_limit='$g
+    done
+done
+
+check_exit
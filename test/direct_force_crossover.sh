@@ -0,0 +1,22 @@
+#!/bin/bash
+# Benchmark of tree and direct summation soft force to find the crossover particle number
+# The auto mode (--soft-force-mode 2) measures both backends at the initial step and prints the wallclock times
+# Usage: direct_force_crossover.sh [petar executable] [OpenMP thread number]
+
+source `dirname $0`/common.sh
+
+petar=${1:-petar}
+nomp=${2:-4}
+
+enter_rdir direct_crossover.omp$nomp
+
+rm -f crossover.dat
+echo 'N_all time(tree) time(direct) selection' >crossover.dat
+for n in 1000 2000 4000 8000 16000 32000 64000
+do
+    echo 'N='$n
+    run_timed petar.n$n.log $petar -n $n -t 0.0 -w 0 --soft-force-mode 2 --direct-n-max $n __Plummer
+    egrep 'Soft force backend' petar.n$n.log |awk '{print $5,$7,$9,$11}' >>crossover.dat
+done
+
+cat crossover.dat
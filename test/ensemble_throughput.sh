@@ -0,0 +1,54 @@
+#!/bin/bash
+# Throughput benchmark of the ensemble mode (--ensemble-list) against separate petar processes
+# The ensemble mode is a sequential batch driver: the simulations run one after another and each uses all OpenMP threads.
+# It is compared with separate processes run one after another (same core usage) and with concurrent separate processes,
+# where [number of concurrent processes] processes (defaulted: number of cores / OpenMP thread number) run at the same time.
+# Each simulation is a Plummer model with N particles integrated to time T (Henon unit)
+# The throughput is shown in simulated time per core-hour, the cores used by the concurrent processes are counted.
+# Usage: ensemble_throughput.sh [petar executable] [number of simulations] [N] [T] [OpenMP thread number] [number of concurrent processes]
+
+source `dirname $0`/common.sh
+
+petar=${1:-petar}
+nsim=${2:-16}
+n=${3:-1000}
+t=${4:-1.0}
+nomp=${5:-1}
+nconc=${6:-`expr \`nproc\` / $nomp`}
+[ $nconc -gt 0 ] || nconc=1
+
+enter_rdir ensemble_throughput.n$n.omp$nomp
+
+rm -f ensemble.list
+for i in `seq 1 $nsim`
+do
+    echo '__Plummer sim'$i >>ensemble.list
+done
+
+# separate processes, one after another
+tsep=0
+for i in `seq 1 $nsim`
+do
+    run_timed sep$i.log $petar -n $n -t $t -o $t -f sep$i __Plummer
+    tsep=`echo $tsep' + '$twall|bc -l`
+done
+
+# concurrent separate processes, at most nconc at the same time
+tstart=`date +%s.%N`
+for i in `seq 1 $nsim`
+do
+    run_timed conc$i.log $petar -n $n -t $t -o $t -f conc$i __Plummer &
+    while [ `jobs -rp |wc -l` -ge $nconc ]; do sleep 0.05; done
+done
+wait
+tend=`date +%s.%N`
+tconc=`echo $tend' - '$tstart|bc -l`
+
+# ensemble mode
+run_timed ensemble.log $petar -n $n -t $t -o $t --ensemble-list ensemble.list
+tens=$twall
+
+echo 'N_sim='$nsim' N='$n' T='$t' OMP='$nomp' N_concurrent='$nconc
+echo 'Separate processes (sequential): wallclock[s]= '$tsep' throughput[T/core-hour]= '`echo $nsim'*'$t'*3600/('$tsep'*'$nomp')'|bc -l`
+echo 'Separate processes (concurrent): wallclock[s]= '$tconc' throughput[T/core-hour]= '`echo $nsim'*'$t'*3600/('$tconc'*'$nomp'*'$nconc')'|bc -l`
+echo 'Ensemble mode (sequential):      wallclock[s]= '$tens' throughput[T/core-hour]= '`echo $nsim'*'$t'*3600/('$tens'*'$nomp')'|bc -l`
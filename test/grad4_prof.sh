@@ -1,33 +1,52 @@
 #!/bin/bash
-source ~/.uftools.sh
-
-lst=`powseq -n 11 -s 5 0.5`
-npath=`pwd`
-
-
-T=0.3
-r=0.01
-
-#n=5000
-#rdir=n$n.r$r.T$T.grad
-
-input=$npath'/input/Plum.N5k.input'
-rdir=n5000.r$r.T$T.imf.grad
-
-[ -d $rdir ] || mkdir $rdir
-cd $rdir
-
-for kd in kdk kdkdk2
+# Profile of the 4th-order tree step with the force-gradient correction (--with-step-mode=kdkdk4)
+# 1. Kernel: petar.simd.test built with kdkdk4 compares the SIMD gradient correction (CalcCorrectEpEpWithLinearCutoffSimd) with the scalar one,
+#    the maximum relative difference and the speed-up are printed, the script returns 1 if the difference exceeds the tolerance.
+# 2. Convergence: the same Plummer model (no binaries) is integrated with a fixed changeover radius and tree steps dt = 2^-k,
+#    the maximum relative cumulative energy error and the local order log2(err(2dt)/err(dt)) are printed;
+#    the order should approach 2 for kdk and 4 for kdkdk4 until the error of the hard part dominates.
+# 3. Performance: the wallclock time per step of Tree_force and Force_correct are printed for each run,
+#    with kdkdk4 both include GradientKick (the gradient correction of the soft force and of the neighbors in the changeover region).
+# Usage: grad4_prof.sh [petar (kdk)] [petar (kdkdk4)] [petar.simd.test (kdkdk4)] [N] [r_out] [T] [OpenMP thread number] [kernel tolerance]
+
+source `dirname $0`/common.sh
+
+petar_kdk=${1:-petar.kdk}
+petar_kdkdk4=${2:-petar.kdkdk4}
+simd_test=${3:-petar.simd.test.kdkdk4}
+n=${4:-2000}
+r=${5:-0.002}
+t=${6:-0.125}
+nomp=${7:-4}
+tol=${8:-7e-3}
+
+enter_rdir grad4_prof.n$n.r$r
+
+echo 'Gradient correction kernel (SIMD vs scalar)'
+if [ -x "`which $simd_test 2>/dev/null`" ]; then
+    $simd_test &>simd_test.log
+    egrep 'Use |gradient correction diff max|Time: acorr' simd_test.log
+    dmax=`egrep 'SIMD EP-EP gradient correction diff max' simd_test.log |awk '{print $NF}'`
+    check_le "$dmax" $tol 'SIMD gradient correction relative difference'
+else
+    echo $simd_test' not found, skip'
+fi
+
+echo 'Convergence and wallclock time per step (Plummer model)'
+for mode in kdk kdkdk4
 do
-    rm -f $kd.err
-    for dt in $lst
+    [ $mode == kdk ] && petar=$petar_kdk || petar=$petar_kdkdk4
+    rm -f $mode.err
+    for k in 6 7 8 9 10
     do
-	echo $kd.$dt
-	fac=`echo $dt'/0.00048828125*8'|bc -l`
-	#$npath/nbody.out.$kd -n $n -r $r -t 0.125 -o $dt -s $dt --dt-max-factor $fac -T $T &>$kd.$dt.log
-	$npath/nbody.out.$kd -r $r -t 0.125 -o $dt -s $dt --dt-max-factor $fac -T $T --r-bin 1e-10 $input &>$kd.$dt.log
-	egrep Enow-Einit $kd.$dt.log |awk -v dt=$dt 'BEGIN{t=0.0;h=0.0} {terr=$8>0?$8:-$8; herr=$11>0?$11:-$11; if (t<terr) t=terr; if (h<herr) h=herr;} END{print dt,t,h}' >>$kd.err
+        dt=`awk -v k=$k 'BEGIN{print 2^(-k)}'`
+        run_timed petar.$mode.$k.log $petar -n $n -t $t -o $t -s $dt -r $r -f data.$mode.$k -w 0 __Plummer
+        err=`energy_error_max petar.$mode.$k.log`
+        prof=`prof_time petar.$mode.$k.log 'Tree_force Force_correct'`
+        echo $dt $err $prof >>$mode.err
     done
+    echo $mode
+    awk 'BEGIN{print "dt energy_error order Tree_force[s] Force_correct[s]"} {order = (NR>1 && $2>0 && ep>0)? log(ep/$2)/log(2) : "-"; print $1, $2, order, $3, $4; ep=$2}' $mode.err
 done
 
-cd $npath
+check_exit
@@ -0,0 +1,48 @@
+#!/bin/bash
+# Test of the in-situ group catalog from the hard integrators (--group-catalog 1)
+# A Plummer model with primordial binaries is integrated with and without the catalog.
+# The number of output times, the number of groups (root orbits) and binaries per output time, the fraction of hierarchical systems,
+# the maximum relative deviation of periods from Kepler's third law (G=1, Henon unit) and the total wallclock times of both runs are printed.
+# The script returns 1 if the deviation exceeds the tolerance or a slowdown factor is below 1.
+# Usage: group_catalog.sh [petar executable] [N] [binary number] [T] [output interval] [OpenMP thread number] [MPI launcher, e.g. 'mpiexec -n 4'] [period tolerance]
+
+source `dirname $0`/common.sh
+
+petar=${1:-petar}
+n=${2:-10000}
+nb=${3:-1000}
+t=${4:-0.25}
+dt=${5:-0.0625}
+nomp=${6:-4}
+mpirun=$7
+tol=${8:-1e-6}
+
+enter_rdir group_catalog.n$n.b$nb
+
+for mode in off on
+do
+    [ $mode == on ] && opt="--group-catalog 1" || opt=''
+    run_timed petar.$mode.log $mpirun $petar -n $n -b $nb -t $t -o $dt -f data.$mode $opt __Plummer
+    echo 'catalog '$mode' total wallclock time[s]: '$twall
+done
+
+ls data.on.catalog.[0-9]* &>/dev/null || { echo 'Error: no catalog file is found, check petar.on.log'; exit 1; }
+
+# columns: time, id_group, id, level, n_members, id1, id2, m1, m2, semi, ecc, period, incline, stab, sd
+for f in data.on.catalog.[0-9]*; do sed '1d' $f; done |awk '
+    { t[$1]=1; nbin[$1]++; if ($4==0) { ngroup[$1]++; if ($5>2) nhier[$1]++ }
+      if ($10>0) { p=2*3.141592653589793*sqrt($10^3/($8+$9)); d=($12-p)/p; if (d<0) d=-d; if (d>dmax) dmax=d }
+      if ($15<1) nsd_err++ }
+    END { n=asorti(t, ts, "@ind_num_asc");
+          print "Number of output times in the catalog: "n;
+          print "Time N_group N_binary N_hierarchical";
+          for (i=1; i<=n; i++) print ts[i], ngroup[ts[i]], nbin[ts[i]], nhier[ts[i]]+0;
+          print "Maximum relative deviation of periods from Kepler law (bound orbits): "dmax+0;
+          print "Number of slowdown factors below 1 (should be 0): "nsd_err+0 }' >catalog.summary
+cat catalog.summary
+
+dmax=`egrep 'deviation of periods' catalog.summary |awk '{print $NF}'`
+nsd_err=`egrep 'slowdown factors below 1' catalog.summary |awk '{print $NF}'`
+check_le $dmax $tol 'maximum relative deviation of periods'
+check_le $nsd_err 0 'number of slowdown factors below 1'
+check_exit
@@ -0,0 +1,30 @@
+#!/bin/bash
+# Test of the per-cluster error budget of hard clusters (--hard-error-budget)
+# A Plummer model with 50% particles in primordial binaries (binary-rich clusters) is integrated with the fixed hermite-eta and AR step sizes
+# and with the error-budget controller for the given budget values.
+# The Hermite and AR steps per tree step (last profile print), the wallclock time per step of the hard integration,
+# the total wallclock time, the final relative energy error and the last statistics of the controller are printed.
+# Usage: hard_error_budget.sh [petar executable] [N] [T] [OpenMP thread number] [budgets, e.g. '1e-7 1e-5'] [MPI launcher, e.g. 'mpiexec -n 4']
+
+source `dirname $0`/common.sh
+
+petar=${1:-petar}
+n=${2:-20000}
+t=${3:-0.25}
+nomp=${4:-4}
+budgets=${5:-'1e-7 1e-5'}
+mpirun=$6
+nb=`expr $n / 4`
+
+enter_rdir hard_error_budget.n$n
+
+for budget in 0 $budgets
+do
+    run_timed petar.$budget.log $mpirun $petar -n $n -b $nb -t $t -o `echo $t/4|bc -l` -f data.$budget -w 0 --hard-error-budget $budget __Plummer
+    echo 'hard-error-budget '$budget
+    print_columns 'Number per step:' 'Hermite_step_sum AR_step_sum' "`prof_count petar.$budget.log 'Hermite_step_sum AR_step_sum'`"
+    print_columns 'Wallclock time per step [max]:' Hard_isolated "`prof_time petar.$budget.log Hard_isolated`"
+    echo 'Total wallclock time[s]: '$twall
+    echo 'Relative energy error: '`energy_error petar.$budget.log`
+    egrep '^Hard error budget:' petar.$budget.log |tail -1
+done
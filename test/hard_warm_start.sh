@@ -0,0 +1,28 @@
+#!/bin/bash
+# Test of the warm start of hard clusters (--hard-warm-start 1)
+# A Plummer model with 50% particles in primordial binaries (binary-rich clusters) is integrated with and without the warm start.
+# The Hermite steps, AR steps and the number of warm-started singles and groups per tree step (last profile print),
+# the wallclock time per step of the hard integration, the total wallclock time and the final relative energy error are printed.
+# Usage: hard_warm_start.sh [petar executable] [N] [T] [OpenMP thread number] [MPI launcher, e.g. 'mpiexec -n 4']
+
+source `dirname $0`/common.sh
+
+petar=${1:-petar}
+n=${2:-20000}
+t=${3:-0.25}
+nomp=${4:-4}
+mpirun=$5
+nb=`expr $n / 4`
+
+enter_rdir hard_warm_start.n$n
+
+for mode in 0 1
+do
+    run_timed petar.$mode.log $mpirun $petar -n $n -b $nb -t $t -o $t -f data.$mode -w 0 --hard-warm-start $mode __Plummer
+    echo 'hard-warm-start '$mode
+    cols='Hermite_step_sum AR_step_sum Hard_warm_start'
+    print_columns 'Number per step:' "$cols" "`prof_count petar.$mode.log "$cols"`"
+    print_columns 'Wallclock time per step [max]:' Hard_isolated "`prof_time petar.$mode.log Hard_isolated`"
+    echo 'Total wallclock time[s]: '$twall
+    echo 'Relative energy error: '`energy_error petar.$mode.log`
+done
@@ -0,0 +1,35 @@
+#!/bin/bash
+# Accuracy and speed comparison of the Hermite pair force with and without skipping pairs beyond the changeover radius
+# Each hard cluster dump is replayed by petar.hard.debug with pairs beyond r_out skipped (default) and without skipping (option -C).
+# The wallclock time, the Hermite step number and the energy error (last 'Hard Energy' line) of both runs are printed,
+# as well as the maximum difference of the final data columns (the hard force and jerk should be identical).
+# The script returns 1 if the difference of any dump exceeds the tolerance.
+# Usage: hermite_pair_cutoff.sh [petar.hard.debug] [tolerance] [dump files (defaulted: hard_dump*)]
+# For a dump file [dump], the hard parameter file [dump].par.hard (or input.par.hard) is used.
+
+source `dirname $0`/common.sh
+
+exe=${1:-petar.hard.debug}
+tol=${2:-0}
+[ $# -ge 2 ] && shift 2 || shift $#
+flist=${@:-`ls hard_dump* |egrep -v '\.(par|log|data)'`}
+
+for f in $flist
+do
+    [ -e $f.par.hard ] && opt="-p $f.par.hard" || opt=''
+    echo 'Dump: '$f
+    for mode in cutoff nocutoff
+    do
+        [ $mode == cutoff ] && mopt='' || mopt='-C'
+        tstart=`date +%s.%N`
+        $exe $opt $mopt $f 1>$f.$mode.data 2>$f.$mode.log
+        tend=`date +%s.%N`
+        echo '  '$mode' wallclock time[s]: '`echo $tend' - '$tstart|bc -l`
+        grep 'Hard Energy' $f.$mode.log |tail -1 |awk '{for (i=1; i<=NF; i++) {if ($i=="dE:") de=$(i+1); if ($i=="H4_step_sum:") nstep=$(i+1)}; print "  dE: "de"  H4_step_sum: "nstep}'
+    done
+    dmax=`paste <(tail -1 $f.cutoff.data) <(tail -1 $f.nocutoff.data) |awk '{n=NF/2; dmax=0; for (i=1; i<=n; i++) {d=$i-$(i+n); if (d<0) d=-d; if (d>dmax) dmax=d}; print dmax}'`
+    echo '  max difference of the last output line: '$dmax
+    check_le "$dmax" $tol 'max difference of '$f
+done
+
+check_exit
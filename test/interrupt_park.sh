@@ -0,0 +1,47 @@
+#!/bin/bash
+# Stall test of the interrupt handling (--interrupt-park) with a collision-heavy problem
+# A compact Plummer model with large stellar radii is integrated with '--detect-interrupt 2', so that many hard clusters are interrupted by collisions.
+# The same model is run with the stop-all mode (0) and the inline parking mode (1), then the number of interruptions per step,
+# the wallclock time per step of the hard parts and the total wallclock time are printed.
+# With MPI, the barrier (waiting) times are in [prefix].prof.rank.* (columns Bar_Hard_isolated, Bar_Hard_interrupt*).
+# petar should be compiled with the stellar evolution (--with-interrupt=base) and PROFILE.
+# Usage: interrupt_park.sh [petar executable] [N] [stellar radius] [T] [OpenMP thread number] [MPI launcher, e.g. 'mpiexec -n 4']
+
+source `dirname $0`/common.sh
+
+petar=${1:-petar}
+n=${2:-4000}
+radius=${3:-0.002}
+t=${4:-0.25}
+nomp=${5:-4}
+mpirun=$6
+
+enter_rdir interrupt_park.n$n.r$radius
+
+# compact Plummer model (Henon unit, scale radius 3pi/16 * 0.3)
+awk -v n=$n 'BEGIN { srand(1); a=3.0*3.141592653589793/16.0*0.3;
+    for (i=0; i<n; i++) {
+        do { x=rand(); } while (x<1e-10);
+        r = a/sqrt(x^(-2.0/3.0)-1.0);
+        if (r>100*a) { i--; continue; }
+        ct = 2.0*rand()-1.0; phi = 2.0*3.141592653589793*rand();
+        x = r*sqrt(1-ct*ct)*cos(phi); y = r*sqrt(1-ct*ct)*sin(phi); z = r*ct;
+        ve = sqrt(2.0)*(r*r+a*a)^(-0.25);
+        do { q=rand(); g=0.1*rand(); } while (g>q*q*(1-q*q)^3.5);
+        v = q*ve;
+        ct = 2.0*rand()-1.0; phi = 2.0*3.141592653589793*rand();
+        printf("%.16e %.16e %.16e %.16e %.16e %.16e %.16e\n", 1.0/n, x, y, z, v*sqrt(1-ct*ct)*cos(phi), v*sqrt(1-ct*ct)*sin(phi), v*ct);
+    }
+}' >collision.dat
+
+petar.init -s base -R $radius -f collision.input collision.dat &>init.log
+
+for p in 0 1
+do
+    echo 'interrupt-park= '$p
+    run_timed petar.p$p.log $mpirun $petar -t $t -o $t -f data.p$p --detect-interrupt 2 --interrupt-park $p collision.input
+    echo 'Interruptions per step: '`prof_count petar.p$p.log Hard_interrupt`
+    cols='Hard_isolated Hard_connected Hard_interrupt*'
+    print_columns 'Wallclock time per step [max]:' "$cols" "`prof_time petar.p$p.log "$cols"`"
+    echo 'Total wallclock time[s]: '$twall
+done
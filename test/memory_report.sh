@@ -0,0 +1,19 @@
+#!/bin/bash
+# Check of the memory usage report (--memory-report) for Plummer models with different particle numbers
+# The breakdown table of subsystems printed at exit is shown for each N, the peak total should scale roughly linearly with N
+# Usage: memory_report.sh [petar executable] [T] [OpenMP thread number]
+
+source `dirname $0`/common.sh
+
+petar=${1:-petar}
+t=${2:-0.25}
+nomp=${3:-4}
+
+enter_rdir memory_report.omp$nomp
+
+for n in 1000 4000 16000
+do
+    echo 'N='$n
+    run_timed petar.n$n.log $petar -n $n -t $t -o $t -f data.n$n --memory-report 1 __Plummer
+    egrep -A10 'Memory usage \[MB\]:' petar.n$n.log
+done
@@ -0,0 +1,24 @@
+#!/bin/bash
+# Benchmark of the Morton order sorting of local particles (--morton-sort-interval)
+# The same Plummer model is integrated without and with the sorting, then the wallclock time per step of 
+# the components (the profile output of the last output step, PROFILE should be switched on in the compilation) are printed.
+# Compare Search_cluster, Force_correct and Kick; the sorting cost is included in Exchange_ptcl.
+# Usage: morton_sort.sh [petar executable] [N] [T] [sort interval] [OpenMP thread number]
+
+source `dirname $0`/common.sh
+
+petar=${1:-petar}
+n=${2:-100000}
+t=${3:-0.25}
+nsort=${4:-16}
+nomp=${5:-4}
+
+enter_rdir morton_sort.n$n.omp$nomp
+
+for s in 0 $nsort
+do
+    echo 'morton-sort-interval= '$s
+    run_timed petar.s$s.log $petar -n $n -t $t -o $t -f data.s$s --morton-sort-interval $s __Plummer
+    cols='Total Search_cluster Force_correct Kick Exchange_ptcl'
+    print_columns 'Wallclock time per step [max]:' "$cols" "`prof_time petar.s$s.log "$cols"`"
+done
@@ -0,0 +1,48 @@
+#!/bin/bash
+# Test of the native movie frame renderer (petar.movie.render)
+# Snapshots of a Plummer model are generated and rendered with different OpenMP thread numbers,
+# the wallclock time of each run is printed and the frames should be identical (md5sum), otherwise the script returns 1.
+# If petar.movie is available, the wallclock time of the Python tool for the same panels is also printed.
+# Usage: movie_render.sh [petar executable] [N] [number of snapshots] [OpenMP thread numbers, e.g. '1 4']
+
+source `dirname $0`/common.sh
+
+petar=${1:-petar}
+n=${2:-100000}
+nsnap=${3:-32}
+nomps=${4:-'1 4'}
+dt=0.0625
+t=`echo $dt*$nsnap|bc -l`
+
+enter_rdir movie_render.n$n
+
+nomp=4 run_timed petar.log $petar -n $n -t $t -o $dt -s $dt __Plummer
+ls data.* |egrep '^data\.[0-9]+$' |sort -n -t '.' -k 2 >data.snap.lst
+echo 'Number of snapshots: '`cat data.snap.lst |wc -l`
+
+for nomp in $nomps
+do
+    run_timed render.omp$nomp.log petar.movie.render -m x-y,x-z --cm-mode average --color mass -o movie.omp$nomp data.snap.lst
+    echo 'petar.movie.render OMP_NUM_THREADS='$nomp' wallclock time[s]: '$twall
+    md5sum `sed 's/$/.png/' data.snap.lst` >frame.omp$nomp.md5
+done
+
+nomp_ref=`echo $nomps|awk '{print $1}'`
+[ -s frame.omp$nomp_ref.md5 ] || { echo 'Error: no frame is found, check render.omp'$nomp_ref'.log'; exit 1; }
+for nomp in $nomps
+do
+    [ $nomp == $nomp_ref ] && continue
+    if cmp -s frame.omp$nomp_ref.md5 frame.omp$nomp.md5; then
+        echo 'Frames of OMP_NUM_THREADS='$nomp' are identical'
+    else
+        echo 'Error: frames of OMP_NUM_THREADS='$nomp' differ from OMP_NUM_THREADS='$nomp_ref
+        nfail=`expr $nfail + 1`
+    fi
+done
+
+if command -v petar.movie &>/dev/null; then
+    run_timed movie.py.log petar.movie -m x-y,x-z --cm-mode average -R 2,2 -o movie.py data.snap.lst
+    echo 'petar.movie wallclock time[s]: '$twall
+fi
+
+check_exit
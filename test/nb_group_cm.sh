@@ -0,0 +1,30 @@
+#!/bin/bash
+# Test of the neighbor searching with stable groups represented by one member (--nb-group-cm 1)
+# The petar executable must be built with configure --enable-nb-group-cm.
+# A Plummer model with 50% particles in primordial binaries is integrated with and without the mode.
+# The number of particles in the neighbor tree per step, the wallclock times per step of the neighbor tree and the cluster searching (last output),
+# the number of particles in isolated and connected clusters, the total wallclock time and the final relative energy error are printed.
+# Usage: nb_group_cm.sh [petar executable] [N] [T] [OpenMP thread number] [MPI launcher, e.g. 'mpiexec -n 4']
+
+source `dirname $0`/common.sh
+
+petar=${1:-petar}
+n=${2:-20000}
+t=${3:-0.25}
+nomp=${4:-4}
+mpirun=$5
+nb=`expr $n / 4`
+
+enter_rdir nb_group_cm.n$n
+
+for mode in 0 1
+do
+    run_timed petar.$mode.log $mpirun $petar -n $n -b $nb -t $t -o $t -f data.$mode -w 0 --nb-group-cm $mode __Plummer
+    echo 'nb-group-cm '$mode
+    cols='NB_tree_ptcl Hard_isolated Hard_connected'
+    print_columns 'Number per step:' "$cols" "`prof_count petar.$mode.log "$cols"`"
+    cols='Tree_neighbor Search_cluster'
+    print_columns 'Wallclock time per step [max]:' "$cols" "`prof_time petar.$mode.log "$cols"`"
+    echo 'Total wallclock time[s]: '$twall
+    echo 'Relative energy error: '`energy_error petar.$mode.log`
+done
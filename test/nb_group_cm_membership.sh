@@ -0,0 +1,55 @@
+#!/bin/bash
+# Test of the cluster membership with the neighbor searching of stable groups (--nb-group-cm 1)
+# The petar executable must be built with configure --enable-nb-group-cm.
+# The same Plummer model with primordial binaries is integrated with --nb-group-cm 0 and 1 in the reproducible mode.
+# The histograms of the number of members in clusters and the numbers of particles in isolated and connected clusters printed at each output,
+# and the snapshots (compared after sorting the particle lines, the particle order in memory is changed by the mode) must be identical.
+# Usage: nb_group_cm_membership.sh [petar executable] [N] [binary number] [T] [OpenMP thread number] [MPI launcher, e.g. 'mpiexec -n 4']
+
+source `dirname $0`/common.sh
+
+petar=${1:-petar}
+n=${2:-2000}
+nb=${3:-500}
+t=${4:-0.5}
+nomp=${5:-4}
+mpirun=$6
+
+enter_rdir nb_group_cm_membership.n$n.b$nb
+
+for mode in 0 1
+do
+    [ -d mode$mode ] || mkdir mode$mode
+    rm -f mode$mode/data.*
+    run_timed mode$mode/petar.log $mpirun $petar -n $n -b $nb -t $t -o 0.0625 -f mode$mode/data --reproducible 1 --cluster-stat 1 --nb-group-cm $mode __Plummer
+    # cluster size histograms and hard particle numbers at each output
+    awk '/Number of members in clusters/ {getline; a=$0; getline; print a; print $0}
+         /Number per step \(global\)/ {getline; for (i=1; i<=NF; i++) cname[i]=$i; getline; for (i=1; i<=NF; i++) if (cname[i]=="Hard_isolated" || cname[i]=="Hard_connected" || cname[i]=="Hard_single") print cname[i], $i}' mode$mode/petar.log >mode$mode/cluster.lst
+done
+
+nhist=`egrep -c Hard_single mode0/cluster.lst`
+[ $nhist -gt 0 ] || { echo 'No profile output found, check mode0/petar.log'; exit 1; }
+if cmp -s mode0/cluster.lst mode1/cluster.lst; then
+    echo 'Cluster statistics of '$nhist' outputs: identical'
+else
+    echo 'Cluster statistics: different'
+    diff mode0/cluster.lst mode1/cluster.lst |head -20
+    nfail=`expr $nfail + 1`
+fi
+
+ndiff=0
+nsnp=0
+for f in `ls mode0 |egrep '^data\.[0-9]+$'`
+do
+    nsnp=`expr $nsnp + 1`
+    # the first line is the header, the particle lines are compared after sorting
+    cmp -s <(tail -n +2 mode0/$f |sort) <(tail -n +2 mode1/$f |sort) || ndiff=`expr $ndiff + 1`
+done
+if [ $ndiff -eq 0 ]; then
+    echo 'Snapshots ('$nsnp'): identical'
+else
+    echo 'Snapshots: '$ndiff' of '$nsnp' differ'
+    nfail=`expr $nfail + 1`
+fi
+
+check_exit
@@ -0,0 +1,26 @@
+#!/bin/bash
+# Benchmark of the NUMA-aware mode (--numa-mode) on a multi-socket node with one MPI process
+# The same Plummer model is integrated with numa-mode 0 (default), 1 (page placement) and 2 (page placement + thread pinning)
+# Use all cores of the node for OpenMP, e.g. the total core number of two sockets
+# Only the pages of the local particle array are placed, the tree buffers of FDPS and the arrays of the hard integration are not moved
+# Usage: numa_mode.sh [petar executable] [N] [T] [OpenMP thread number]
+
+source `dirname $0`/common.sh
+
+petar=${1:-petar}
+n=${2:-200000}
+t=${3:-0.125}
+nomp=${4:-`nproc`}
+
+n_node=`ls -d /sys/devices/system/node/node[0-9]* 2>/dev/null |wc -l`
+echo 'NUMA nodes: '$n_node
+[ $n_node -gt 1 ] || echo 'Warning: only one NUMA node is found, the modes are expected to give the same performance'
+
+enter_rdir numa_mode.n$n.omp$nomp
+
+for mode in 0 1 2
+do
+    run_timed petar.m$mode.log $petar -n $n -t $t -o $t -f data.m$mode --numa-mode $mode __Plummer
+    echo 'numa-mode= '$mode' wallclock[s]= '$twall
+    egrep 'Thread binding' petar.m$mode.log
+done
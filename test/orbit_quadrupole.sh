@@ -0,0 +1,88 @@
+#!/bin/bash
+# Comparison of the orbit-averaged quadrupole of group c.m. (--with-orbit=qp) with the orbit-sampling method (--with-orbit=os)
+# 1. Accuracy: for random binaries, the force at test points (distance d in the unit of semi-major axis) averaged over one orbit
+#    is compared with the force from the orbit samples (equal intervals of eccentric anomaly, mass weighted by mean anomaly, n_split pairs),
+#    the monopole + quadrupole force and the monopole force; the mean and maximum relative errors of the binary-induced force are printed.
+#    The script returns 1 if the mean total force error of the quadrupole exceeds the tolerance times that of the monopole at any distance.
+# 2. Performance: the same Plummer model with many primordial binaries is integrated by both petar builds,
+#    the wallclock time per step, the total wallclock time and the final relative energy error are printed.
+# The two builds should use the same options except --with-orbit, without interrupt and external modes.
+# Usage: orbit_quadrupole.sh [petar (orbit-sampling)] [petar (quadrupole)] [N] [binary number] [T] [OpenMP thread number] [n_split] [tolerance]
+
+source `dirname $0`/common.sh
+
+petar_os=${1:-petar.os}
+petar_qp=${2:-petar.qp}
+n=${3:-20000}
+nb=${4:-10000}
+t=${5:-0.125}
+nomp=${6:-4}
+nsplit=${7:-4}
+tol=${8:-0.5}
+
+enter_rdir orbit_quadrupole.n$n.b$nb
+
+echo 'Binary-induced force accuracy (relative error to the orbit-averaged force)'
+for d in 3 10 30
+do
+    awk -v d=$d -v ns=$nsplit 'function kepler(M, e,   E, k) { E=M; for (k=0; k<50; k++) E -= (E-e*sin(E)-M)/(1-e*cos(E)); return E; }
+    # acceleration at (px,py,pz) from the two members at eccentric anomaly E (a=1, m1+m2=1, orbit in x-y plane, periapsis along x)
+    function accE(E, w,   x, y, dx, dy, dz, r3, k) {
+        x = cos(E)-e; y = sqrt(1-e*e)*sin(E);
+        for (k=0; k<2; k++) {
+            mk = (k==0)? m1 : m2; fk = (k==0)? m2 : -m1;
+            dx = px-fk*x; dy = py-fk*y; dz = pz;
+            r3 = (dx*dx+dy*dy+dz*dz)^1.5;
+            ax -= w*mk*dx/r3; ay -= w*mk*dy/r3; az -= w*mk*dz/r3;
+        }
+    }
+    BEGIN { srand(3); pi=3.141592653589793; nt=2000;
+    for (i=0; i<1000; i++) {
+        e = rand()*0.9; m1 = 0.1+0.8*rand(); m2 = 1-m1;
+        ct = 2*rand()-1; ph = 2*pi*rand();
+        px = d*sqrt(1-ct*ct)*cos(ph); py = d*sqrt(1-ct*ct)*sin(ph); pz = d*ct;
+        r = sqrt(px*px+py*py+pz*pz); r3 = r*r*r;
+        amx = -px/r3; amy = -py/r3; amz = -pz/r3;
+        # reference: average over the mean anomaly
+        ax=ay=az=0;
+        for (k=0; k<nt; k++) accE(kepler(2*pi*(k+0.5)/nt, e), 1.0/nt);
+        rx = ax-amx; ry = ay-amy; rz = az-amz; rn = sqrt(rx*rx+ry*ry+rz*rz);
+        # orbit samples
+        ax=ay=az=0; ws=0;
+        for (k=0; k<ns; k++) { E = 2*pi*(k+0.5)/ns; w[k] = 1-e*cos(E); ws += w[k]; }
+        for (k=0; k<ns; k++) accE(2*pi*(k+0.5)/ns, w[k]/ws);
+        dx = ax-amx-rx; dy = ay-amy-ry; dz = az-amz-rz;
+        eos = sqrt(dx*dx+dy*dy+dz*dz)/rn;
+        # quadrupole, second moment mu*a^2*diag((1+4e^2)/2, (1-e^2)/2, 0)
+        mu = m1*m2; qx = 0.5*mu*(1+4*e*e); qy = 0.5*mu*(1-e*e); tr = qx+qy;
+        qrx = qx*px; qry = qy*py; qrr = qrx*px+qry*py;
+        r5 = r3*r*r; r7 = r5*r*r;
+        ax = 3*qrx/r5 - 7.5*qrr*px/r7 + 1.5*tr*px/r5;
+        ay = 3*qry/r5 - 7.5*qrr*py/r7 + 1.5*tr*py/r5;
+        az =          - 7.5*qrr*pz/r7 + 1.5*tr*pz/r5;
+        dx = ax-rx; dy = ay-ry; dz = az-rz;
+        eqp = sqrt(dx*dx+dy*dy+dz*dz)/rn;
+        sos += eos; sqp += eqp; if (eos>mos) mos=eos; if (eqp>mqp) mqp=eqp;
+        # total force error relative to the monopole
+        stos += eos*rn*r*r; stqp += eqp*rn*r*r; stm += rn*r*r;
+    }
+    printf("d/a= %s  orbit-sampling(n_split=%d): mean= %g max= %g  quadrupole: mean= %g max= %g  total force error: os= %g qp= %g monopole= %g\n", d, ns, sos/i, mos, sqp/i, mqp, stos/i, stqp/i, stm/i);
+    }' |tee accuracy.d$d.log
+    ratio=`awk '{for (i=1; i<=NF; i++) {if ($i=="qp=") qp=$(i+1); if ($i=="monopole=") m=$(i+1)}} END{if (m>0) print qp/m}' accuracy.d$d.log`
+    check_le "$ratio" $tol 'quadrupole/monopole total force error ratio at d/a='$d
+done
+
+echo 'Performance (Plummer model with binaries)'
+for mode in os qp
+do
+    [ $mode == os ] && petar=$petar_os || petar=$petar_qp
+    [ $mode == os ] && opt="--number-split $nsplit" || opt=''
+    run_timed petar.$mode.log $petar $opt -n $n -b $nb -t $t -o $t -f data.$mode -w 0 __Plummer
+    echo $mode
+    cols='Total Hard_single Hard_isolated Hard_connected Tree_force Force_correct'
+    print_columns 'Wallclock time per step [max]:' "$cols" "`prof_time petar.$mode.log "$cols"`"
+    echo 'Total wallclock time[s]: '$twall
+    echo 'Relative energy error: '`energy_error petar.$mode.log`
+done
+
+check_exit
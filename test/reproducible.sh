@@ -0,0 +1,46 @@
+#!/bin/bash
+# Test of the bitwise-reproducible mode (--reproducible 1)
+# The same Plummer model with primordial binaries is integrated with different OpenMP thread numbers,
+# then the snapshots are compared bitwise with the run using one thread.
+# The reproducibility is independent of the thread number only, the MPI process number must be the same.
+# Usage: reproducible.sh [petar executable] [N] [binary number] [T] [OpenMP thread numbers]
+
+source `dirname $0`/common.sh
+
+petar=${1:-petar}
+n=${2:-2000}
+nb=${3:-200}
+t=${4:-1.0}
+nomp_list=${5:-"1 4 16"}
+
+enter_rdir reproducible.n$n.b$nb
+
+for nomp in $nomp_list
+do
+    [ -d omp$nomp ] || mkdir omp$nomp
+    rm -f omp$nomp/data.*
+    run_timed omp$nomp/petar.log $petar -n $n -b $nb -t $t -o 0.125 -f omp$nomp/data --reproducible 1 __Plummer
+done
+
+nomp_ref=`echo $nomp_list |awk '{print $1}'`
+nsnp=`ls omp$nomp_ref |egrep '^data\.[0-9]+$' |wc -l`
+echo 'Reference: OMP= '$nomp_ref' snapshot number= '$nsnp
+[ $nsnp -gt 0 ] || { echo 'No snapshot found, check omp'$nomp_ref'/petar.log'; exit 1; }
+
+for nomp in $nomp_list
+do
+    [ $nomp == $nomp_ref ] && continue
+    ndiff=0
+    for f in `ls omp$nomp_ref |egrep '^data\.[0-9]+$'`
+    do
+        cmp -s omp$nomp_ref/$f omp$nomp/$f || ndiff=`expr $ndiff + 1`
+    done
+    if [ $ndiff -eq 0 ]; then
+        echo 'OMP= '$nomp': identical'
+    else
+        echo 'OMP= '$nomp': '$ndiff' snapshots differ'
+        nfail=`expr $nfail + 1`
+    fi
+done
+
+check_exit
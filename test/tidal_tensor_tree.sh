@@ -0,0 +1,67 @@
+#!/bin/bash
+# Comparison of the tidal tensor from the tree force gradient (--with-tidal-tensor=tree/tree3rd) with the measure-point fitting (2nd/3rd)
+# 1. Accuracy: the tidal field of a Plummer cluster at a binary c.m. is measured by petar.tt.test built with both modes,
+#    the tensor force is compared with the direct force at the check points around the c.m.; the mean and maximum relative errors are printed.
+#    The script returns 1 if the mean relative error of either mode exceeds the tolerance.
+# 2. Performance: the same Plummer model with many primordial binaries is integrated by both petar builds,
+#    the wallclock time per step, the total wallclock time and the final relative energy error are printed.
+# The two builds should use the same options except --with-tidal-tensor (e.g. 3rd and tree3rd), without interrupt and external modes.
+# Usage: tidal_tensor_tree.sh [petar (measure points)] [petar (tree)] [petar.tt.test (measure points)] [petar.tt.test (tree)] [N] [binary number] [T] [OpenMP thread number] [tolerance]
+
+source `dirname $0`/common.sh
+
+petar_mp=${1:-petar.tt3rd}
+petar_tree=${2:-petar.tttree3rd}
+tt_mp=${3:-petar.tt.test.tt3rd}
+tt_tree=${4:-petar.tt.test.tttree3rd}
+n=${5:-10000}
+nb=${6:-2000}
+t=${7:-0.25}
+nomp=${8:-4}
+tol=${9:-1e-2}
+
+enter_rdir tidal_tensor_tree.n$n.b$nb
+
+# tidal tensor input: 64 check points inside r_scale around a c.m. at 0.5 from the center of a Plummer cluster (Henon unit)
+awk -v n=$n 'BEGIN { srand(2); a=3.0*3.141592653589793/16.0; rs=0.002; nc=64;
+    print nc, n, 0.5, 0.0, 0.0, rs;
+    for (i=0; i<nc; i++) {
+        do { x=2*rand()-1; y=2*rand()-1; z=2*rand()-1; } while (x*x+y*y+z*z>1.0);
+        printf("%.16e %.16e %.16e %.16e 0 0 0 0\n", 0.0, 0.5+x*rs, y*rs, z*rs);
+    }
+    for (i=0; i<n; i++) {
+        do { x=rand(); } while (x<1e-10);
+        r = a/sqrt(x^(-2.0/3.0)-1.0);
+        if (r>100*a) { i--; continue; }
+        ct = 2.0*rand()-1.0; phi = 2.0*3.141592653589793*rand();
+        x = r*sqrt(1-ct*ct)*cos(phi); y = r*sqrt(1-ct*ct)*sin(phi); z = r*ct;
+        # exclude the close neighbors, which are treated by the hard part
+        if ((x-0.5)^2+y^2+z^2<0.01) { i--; continue; }
+        printf("%.16e %.16e %.16e %.16e 0 0 0 0\n", 1.0/n, x, y, z);
+    }
+}' >tt.dat
+
+echo 'Tidal tensor accuracy (relative acceleration error at check points)'
+for mode in mp tree
+do
+    [ $mode == mp ] && ttest=$tt_mp || ttest=$tt_tree
+    $ttest tt.dat &>tt.$mode.log
+    sed -n '/Check acc at measuring points/,$p' tt.$mode.log |awk -v mode=$mode 'NR>2 && NF==13 {
+        e = sqrt($11*$11+$12*$12+$13*$13)/sqrt($8*$8+$9*$9+$10*$10); s+=e; k++; if (e>m) m=e; }
+        END { if (k>0) print mode": mean= "s/k" max= "m; else print mode": no result, check tt."mode".log" }' |tee tt.$mode.err
+    check_le "`awk '$2=="mean=" {print $3}' tt.$mode.err`" $tol 'mean relative error of '$mode
+done
+
+echo 'Performance (Plummer model with binaries)'
+for mode in mp tree
+do
+    [ $mode == mp ] && petar=$petar_mp || petar=$petar_tree
+    run_timed petar.$mode.log $petar -n $n -b $nb -t $t -o $t -f data.$mode -w 0 __Plummer
+    echo $mode
+    cols='Total Hard_single Hard_isolated Hard_connected Tree_force Force_correct'
+    print_columns 'Wallclock time per step [max]:' "$cols" "`prof_time petar.$mode.log "$cols"`"
+    echo 'Total wallclock time[s]: '$twall
+    echo 'Relative energy error: '`energy_error petar.$mode.log`
+done
+
+check_exit
@@ -0,0 +1,68 @@
+#!/bin/bash
+# Test of the tracked particle output (--track-list)
+# A Plummer model with primordial binaries is integrated with and without tracking a subset of particles (including binary members).
+# The number of track outputs, the number of records per output, the fraction of records in groups and
+# the total wallclock times of both runs (tracking overhead) are printed.
+# The positions of the tracked particles at the last output time are compared with the last snapshot (should be identical),
+# the script returns 1 if the maximum difference exceeds the tolerance (the rounding of the ASCII snapshot).
+# Usage: track_output.sh [petar executable] [N] [binary number] [number of tracked particles] [track interval] [T] [OpenMP thread number] [MPI launcher, e.g. 'mpiexec -n 4'] [tolerance]
+
+source `dirname $0`/common.sh
+
+petar=${1:-petar}
+n=${2:-10000}
+nb=${3:-1000}
+ntrack=${4:-100}
+interval=${5:-1}
+t=${6:-0.25}
+nomp=${7:-4}
+mpirun=$8
+tol=${9:-1e-12}
+
+enter_rdir track_output.n$n.b$nb
+
+# track ntrack ids evenly from 1 to n, the first 2*nb ids are binary members
+awk -v n=$n -v nt=$ntrack 'BEGIN{for (i=0; i<nt; i++) print int(1+i*n/nt)}' >track.list
+
+for mode in off on
+do
+    [ $mode == on ] && opt="--track-list track.list --track-interval $interval" || opt=''
+    run_timed petar.$mode.log $mpirun $petar -n $n -b $nb -t $t -o $t -f data.$mode -i 1 $opt __Plummer
+    echo 'track '$mode' total wallclock time[s]: '$twall
+done
+
+python3 - <<'PYEOF' |tee track.check
+import glob
+import numpy as np
+import petar
+
+times = []
+records = []
+for f in sorted(glob.glob('data.on.track.[0-9]*')):
+    time, n_loop, rec = petar.readTrack(f)
+    times.append(time)
+    records.append(rec)
+time = np.concatenate(times)
+rec = np.concatenate(records)
+tout = np.unique(time)
+print('Number of track outputs: ', tout.size, ' time range: ', tout[0], tout[-1])
+print('Records per output: ', rec.size/tout.size, ' fraction in groups: ', (rec['id_cm']!=0).sum()/max(rec.size,1))
+
+# compare with the last snapshot (ASCII): mass, pos, vel are the first columns, id is found by the particle id list
+snap = sorted(glob.glob('data.on.[0-9]*'), key=lambda x: int(x.split('.')[-1]))[-1]
+header = open(snap).readline().split()
+tsnap = float(header[2])
+sel = (time==tsnap)
+if sel.sum()>0:
+    particle = petar.Particle(interrupt_mode='none', external_mode='none')
+    particle.loadtxt(snap, skiprows=1)
+    idx = np.searchsorted(particle.id, rec['id'][sel], sorter=particle.id.argsort())
+    idx = particle.id.argsort()[idx]
+    dpos = np.abs(rec['pos'][sel] - particle.pos[idx]).max()
+    print('Last snapshot time: ', tsnap, ' max position difference of tracked particles: ', dpos)
+else:
+    print('No track output at the last snapshot time ', tsnap)
+PYEOF
+
+check_le "`egrep 'max position difference' track.check |awk '{print $NF}'`" $tol 'max position difference of tracked particles'
+check_exit
@@ -0,0 +1,46 @@
+#!/bin/bash
+# Test of the hierarchical tree step (--tree-level-max) on a Plummer core embedded in an extended Plummer halo
+# The petar executable must be built with configure --enable-tree-level-step.
+# The halo particles have long dynamical timescales and can use large block steps.
+# The same model is integrated with the shared tree step and with the hierarchical tree step,
+# then the average active (i-particle) fraction per step and the relative cumulative energy error are printed.
+# The model is generated by sampling two independent Plummer spheres, thus it is not in an exact equilibrium.
+# Usage: tree_level_halo.sh [petar executable] [core N] [halo N] [T] [tree-level-max] [OpenMP thread number]
+
+source `dirname $0`/common.sh
+
+petar=${1:-petar}
+ncore=${2:-8000}
+nhalo=${3:-8000}
+t=${4:-4.0}
+lmax=${5:-6}
+nomp=${6:-4}
+
+enter_rdir tree_level_halo.n$ncore.$nhalo
+
+# mass, position, velocity of a Plummer model with total mass M and scale radius a (G=1)
+awk -v nc=$ncore -v nh=$nhalo 'function plummer(n, m_tot, a,   i, r, x, y, z, ve, q, g, v, ct, phi) {
+    for (i=0; i<n; i++) {
+        do { x=rand(); } while (x<1e-10);
+        r = a/sqrt(x^(-2.0/3.0)-1.0);
+        if (r>100*a) { i--; continue; }
+        ct = 2.0*rand()-1.0; phi = 2.0*3.141592653589793*rand();
+        x = r*sqrt(1-ct*ct)*cos(phi); y = r*sqrt(1-ct*ct)*sin(phi); z = r*ct;
+        ve = sqrt(2.0*m_tot)*(r*r+a*a)^(-0.25);
+        do { q=rand(); g=0.1*rand(); } while (g>q*q*(1-q*q)^3.5);
+        v = q*ve;
+        ct = 2.0*rand()-1.0; phi = 2.0*3.141592653589793*rand();
+        printf("%.16e %.16e %.16e %.16e %.16e %.16e %.16e\n", m_tot/n, x, y, z, v*sqrt(1-ct*ct)*cos(phi), v*sqrt(1-ct*ct)*sin(phi), v*ct);
+    }
+}
+BEGIN { srand(1); plummer(nc, 0.8, 0.6); plummer(nh, 0.2, 10.0); }' >halo.dat
+
+petar.init -f halo.input halo.dat &>init.log
+
+for l in 0 $lmax
+do
+    echo 'tree-level-max= '$l
+    run_timed petar.l$l.log $petar -t $t -o $t -s 0.0078125 -f data.l$l --tree-level-max $l halo.input
+    egrep 'Hierarchical tree step' petar.l$l.log |tail -1
+    echo 'Relative energy error (cumulative): '`energy_error petar.l$l.log`
+done
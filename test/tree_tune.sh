@@ -0,0 +1,27 @@
+#!/bin/bash
+# Test of the automatic tuning of the particle-tree parameters (--tree-tune-interval)
+# A Plummer model is integrated with the tuning at the initial step (and the tuning of theta under the force error limit),
+# then the trials and the selected parameters are printed, together with the wallclock time of the fixed default parameters.
+# Usage: tree_tune.sh [petar executable] [N] [T] [theta force error limit] [OpenMP thread number]
+
+source `dirname $0`/common.sh
+
+petar=${1:-petar}
+n=${2:-100000}
+t=${3:-0.25}
+err=${4:-1e-3}
+nomp=${5:-4}
+
+enter_rdir tree_tune.n$n.omp$nomp
+
+for mode in fixed tune
+do
+    if [ $mode == fixed ]; then
+        opts=''
+    else
+        opts='--tree-tune-interval 0 --tree-tune-theta-err '$err
+    fi
+    run_timed petar.$mode.log $petar -n $n -t $t -o $t -f data.$mode $opts __Plummer
+    echo $mode': wallclock[s]= '$twall
+    egrep 'Tree tuning' petar.$mode.log
+done
@@ -10,3 +10,4 @@ from .parallel_data_process import *
 from .group import *
 from .bse import *
 from .external import *
+from .track import *
@@ -84,11 +84,34 @@ class PeTarCount(DictNpArrayMix):
         n_neighbor_zero: particles have zero neighbors in Hermite 
         Ep_Ep_interaction: number of essential (active) i and j particle interactions 
         Ep_Sp_interaction: number of essential (active) i and superparticle interactions
+        NB_tree_ptcl: number of local particles in the neighbor searching tree
+        hard_warm_start: number of singles and groups in hard clusters using the step states of the last tree step
     """
     def __init__(self, _dat=None, _offset=int(0), _append=False, **kwargs):
         """ DictNpArrayMix type initialzation, see help(DictNpArrayMix.__init__)
         """
-        keys = [["hard_single",np.int64], ["hard_isolated",np.int64], ["hard_connected",np.int64], ["hard_interrupt",np.int64], ["cluster_isolated",np.int64], ["cluster_connected",np.int64], ["AR_step_sum",np.int64], ["AR_tsyn_step_sum",np.int64], ["AR_group_number",np.int64], ["iso_group_number",np.int64], ["Hermite_step_sum",np.int64], ["n_neighbor_zero",np.int64], ["Ep_Ep_interaction",np.int64], ["Ep_Sp_interaction",np.int64]]
+        keys = [["hard_single",np.int64], ["hard_isolated",np.int64], ["hard_connected",np.int64], ["hard_interrupt",np.int64], ["cluster_isolated",np.int64], ["cluster_connected",np.int64], ["AR_step_sum",np.int64], ["AR_tsyn_step_sum",np.int64], ["AR_group_number",np.int64], ["iso_group_number",np.int64], ["Hermite_step_sum",np.int64], ["n_neighbor_zero",np.int64], ["Ep_Ep_interaction",np.int64], ["Ep_Sp_interaction",np.int64], ["NB_tree_ptcl",np.int64], ["hard_warm_start",np.int64]]
+        DictNpArrayMix.__init__(self, keys, _dat, _offset, _append, **kwargs)
+
+class PeTarMemory(DictNpArrayMix):
+    """ PeTar memory usage (MB) of subsystems in the local MPI process at the output time
+    Keys: (class members)
+        system_soft (1D): particle system (FDPS)
+        tree_soft (1D): particle-tree for long-range force including LETs (FDPS)
+        tree_nb (1D): particle-tree for neighbor searching including LETs (FDPS)
+        soft_direct (1D): direct summation soft force buffers
+        soft_kernel (1D): thread-local buffers of SIMD force kernels
+        search_cluster (1D): cluster searching buffers
+        system_hard (1D): particle, cluster and group arrays of hard systems
+        other (1D): particle index map, mass change and remove lists
+        total (1D): total of all subsystems
+        peak_[subsystem] (1D): peak (high-water mark) of the subsystem since the beginning
+    """
+    def __init__ (self, _dat=None, _offset=int(0), _append=False, **kwargs):
+        """ DictNpArrayMix type initialzation, see help(DictNpArrayMix.__init__)
+        """
+        names = ["system_soft", "tree_soft", "tree_nb", "soft_direct", "soft_kernel", "search_cluster", "system_hard", "other", "total"]
+        keys = [[name,np.float64] for name in names] + [["peak_"+name,np.float64] for name in names]
         DictNpArrayMix.__init__(self, keys, _dat, _offset, _append, **kwargs)
 
 class Profile(DictNpArrayMix):
@@ -105,6 +128,7 @@ class Profile(DictNpArrayMix):
         if keyword arguments "use_gpu" == True:
             gpu (GPUProfile): GPU profile for tree force calculation
         count (PeTarCount): number counts
+        memory (PeTarMemory): memory usage of subsystems
     """
     def __init__ (self, _dat=None, _offset=int(0), _append=False, **kwargs):
         """ DictNpArrayMix type initialzation, see help(DictNpArrayMix.__init__)
@@ -118,8 +142,8 @@ class Profile(DictNpArrayMix):
         use_gpu=True
         if ('use_gpu' in kwargs.keys()): use_gpu=kwargs['use_gpu']
         if (use_gpu):
-            keys = [['rank',np.int64], ['time',np.float64], ['nstep',np.int64], ['n_loc',np.int64], ['comp',PeTarProfile], ['comp_bar', PeTarProfile], ['tree_soft', FDPSProfile], ['tree_nb', FDPSProfile], ['gpu',GPUProfile],['count',PeTarCount]]
+            keys = [['rank',np.int64], ['time',np.float64], ['nstep',np.int64], ['n_loc',np.int64], ['comp',PeTarProfile], ['comp_bar', PeTarProfile], ['tree_soft', FDPSProfile], ['tree_nb', FDPSProfile], ['gpu',GPUProfile],['count',PeTarCount], ['memory',PeTarMemory]]
             DictNpArrayMix.__init__(self, keys, _dat, _offset, _append, **kwargs)
         else:
-            keys = [['rank',np.int64], ['time',np.float64], ['nstep',np.int64], ['n_loc',np.int64], ['comp',PeTarProfile], ['comp_bar', PeTarProfile], ['tree_soft', FDPSProfile], ['tree_nb', FDPSProfile], ['count',PeTarCount]]
+            keys = [['rank',np.int64], ['time',np.float64], ['nstep',np.int64], ['n_loc',np.int64], ['comp',PeTarProfile], ['comp_bar', PeTarProfile], ['tree_soft', FDPSProfile], ['tree_nb', FDPSProfile], ['count',PeTarCount], ['memory',PeTarMemory]]
             DictNpArrayMix.__init__(self, keys, _dat, _offset, _append, **kwargs)
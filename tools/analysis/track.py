@@ -0,0 +1,59 @@
+import numpy as np
+
+# binary layout of the tracked particle output ([prefix].track.[MPI rank]), see ParticleTrack in src/particle_track.hpp
+track_header_dtype = np.dtype([('time',np.float64), ('n_loop',np.int64), ('n',np.int64)])
+track_record_dtype = np.dtype([('id',np.int64), ('id_cm',np.int64), ('mass',np.float64), ('pos',np.float64,3), ('vel',np.float64,3)])
+
+def readTrackIndex(filename):
+    """ Read the index file of the tracked particle output ([prefix].track.idx.[MPI rank])
+
+    Parameters
+    ----------
+    filename: string
+        index filename
+
+    Return
+    ----------
+    numpy structured array with fields: time, n_loop, offset (byte offset of the block in the track file), n (number of records)
+    """
+    return np.atleast_1d(np.loadtxt(filename, dtype=[('time',np.float64), ('n_loop',np.int64), ('offset',np.int64), ('n',np.int64)], ndmin=1))
+
+def readTrack(filename, time_min=-np.inf, time_max=np.inf, index_filename=None):
+    """ Read the tracked particle output ([prefix].track.[MPI rank])
+
+    Parameters
+    ----------
+    filename: string
+        track filename
+    time_min: float (-inf)
+        minimum time of blocks to read
+    time_max: float (inf)
+        maximum time of blocks to read
+    index_filename: string (None)
+        index filename, if None, use filename with '.track.' replaced by '.track.idx.'; 
+        the index is used to skip blocks outside the time range
+
+    Return
+    ----------
+    time: 1D numpy array, time of each record
+    n_loop: 1D numpy array, tree step count of each record
+    record: numpy structured array with fields: id, id_cm (c.m. id of the group if the particle is a group member, otherwise 0), mass, pos, vel
+    """
+    if index_filename is None:
+        index_filename = filename.replace('.track.', '.track.idx.', 1)
+    index = readTrackIndex(index_filename)
+    sel = (index['time']>=time_min) & (index['time']<=time_max)
+    times = []
+    n_loops = []
+    records = []
+    with open(filename, 'rb') as fin:
+        for block in index[sel]:
+            fin.seek(block['offset'])
+            header = np.fromfile(fin, dtype=track_header_dtype, count=1)[0]
+            rec = np.fromfile(fin, dtype=track_record_dtype, count=header['n'])
+            times.append(np.full(header['n'], header['time']))
+            n_loops.append(np.full(header['n'], header['n_loop']))
+            records.append(rec)
+    if len(records)==0:
+        return np.zeros(0), np.zeros(0, dtype=np.int64), np.zeros(0, dtype=track_record_dtype)
+    return np.concatenate(times), np.concatenate(n_loops), np.concatenate(records)
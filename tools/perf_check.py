@@ -0,0 +1,295 @@
+#!/usr/bin/env python3
+# Performance regression check of petar
+# Run a fixed set of deterministic problems (Plummer models with and without primordial binaries and stellar evolution),
+# collect the wallclock time per tree step of the SysProfile phases, the tree steps per second and the cumulative energy error,
+# then compare them with the baseline stored in a JSON file.
+# Only the standard library of python is used, no network access is needed.
+
+import sys
+import os
+import json
+import math
+import random
+import subprocess
+import time
+import getopt
+
+G_MSUN_PC_MYR=0.00449830997959438
+
+def usage():
+    print("Performance regression check of petar, used by 'make perf-check'")
+    print("Usage: perf_check.py [options]")
+    print("option:")
+    print("  -h(--help): help")
+    print("  -p(--petar): petar executable (build/petar)")
+    print("  -i(--petar-init): petar.init script for generating input files (tools/initdata.sh)")
+    print("  -b(--baseline): baseline JSON file (test/perf_baseline.json)")
+    print("  -w(--work-dir): directory for running the cases (perf_check)")
+    print("  -t(--threads): OpenMP thread number (4)")
+    print("  -r(--ranks): MPI process number, >1 requires --mpiexec (1)")
+    print("  -m(--mpiexec): MPI launcher, e.g. 'mpiexec -n' (the rank number is appended) (none)")
+    print("  -c(--cases): comma-separated names of cases to run (all)")
+    print("  -s(--se-mode): stellar evolution mode of the petar executable: off, bse, mobse, bseEmp; cases with stellar evolution are skipped if off (off)")
+    print("  -u(--update): write the measured metrics to the baseline file instead of comparing")
+    print("     --time-tolerance: relative tolerance of phase times (from baseline file)")
+    print("     --speed-tolerance: relative tolerance of tree steps per second (from baseline file)")
+    print("     --energy-factor: allowed factor of the energy error with respect to the baseline (from baseline file)")
+    print("PS: the baseline of each case is stored with the key [case name].omp[threads].mpi[ranks];")
+    print("    the timing baseline is machine dependent, update it on the reference machine after intended changes.")
+    print("    A case without the baseline records the current results as the baseline and reports 'no baseline' instead of failing.")
+    print("    The energy error is also checked with the loose upper limit energy_error_max of each case.")
+    print("    The cases run without the reproducible mode (--reproducible) so that the timing is that of production runs.")
+
+def generatePlummer(n, n_bin, seed):
+    """ Equal-mass Plummer model in the Henon unit with n_bin primordial binaries at the beginning
+    The binary components are placed at the apocenter with semi-major axes log-uniformly distributed in [1e-4, 1e-2] * r_vir
+    and eccentricities uniformly distributed in [0, 0.9].
+    Return: list of (mass, x, y, z, vx, vy, vz)
+    """
+    rng = random.Random(seed)
+    a_scale = 3.0*math.pi/16.0
+    n_obj = n - n_bin
+    m = 1.0/n
+
+    def isotropic(r):
+        ct = 2.0*rng.random()-1.0
+        st = math.sqrt(1.0-ct*ct)
+        phi = 2.0*math.pi*rng.random()
+        return (r*st*math.cos(phi), r*st*math.sin(phi), r*ct)
+
+    objs = []
+    for i in range(n_obj):
+        while True:
+            x = rng.random()
+            if x<1e-10: continue
+            r = a_scale/math.sqrt(x**(-2.0/3.0)-1.0)
+            if r<100*a_scale: break
+        ve = math.sqrt(2.0)*(r*r+a_scale*a_scale)**(-0.25)
+        while True:
+            q = rng.random()
+            g = 0.1*rng.random()
+            if g<=q*q*(1-q*q)**3.5: break
+        objs.append((isotropic(r), isotropic(q*ve)))
+
+    # correct the c.m. (object masses: binaries 2m, singles m)
+    mobj = [2.0*m if i<n_bin else m for i in range(n_obj)]
+    mtot = sum(mobj)
+    pcm = [sum(mobj[i]*objs[i][0][k] for i in range(n_obj))/mtot for k in range(3)]
+    vcm = [sum(mobj[i]*objs[i][1][k] for i in range(n_obj))/mtot for k in range(3)]
+
+    ptcl = []
+    for i in range(n_obj):
+        pos = [objs[i][0][k]-pcm[k] for k in range(3)]
+        vel = [objs[i][1][k]-vcm[k] for k in range(3)]
+        if i<n_bin:
+            semi = 10.0**(-4.0+2.0*rng.random())
+            ecc = 0.9*rng.random()
+            rapo = semi*(1.0+ecc)
+            vapo = math.sqrt(2.0*m*(1.0-ecc)/rapo)
+            dr = isotropic(1.0)
+            # a unit vector perpendicular to dr
+            t = (0.0, 0.0, 1.0) if abs(dr[2])<0.9 else (1.0, 0.0, 0.0)
+            dv = (dr[1]*t[2]-dr[2]*t[1], dr[2]*t[0]-dr[0]*t[2], dr[0]*t[1]-dr[1]*t[0])
+            dvn = math.sqrt(sum(x*x for x in dv))
+            for sign in (0.5, -0.5):
+                ptcl.append((m, *[pos[k]+sign*rapo*dr[k] for k in range(3)], *[vel[k]+sign*vapo*dv[k]/dvn for k in range(3)]))
+        else:
+            ptcl.append((m, *pos, *vel))
+    return ptcl
+
+def parseLog(log):
+    """ Parse the petar standard output
+    Return: dict of phase time per step (weighted by the step number of each output interval, maximum over MPI processes),
+            total tree step number, cumulative relative energy error
+    """
+    lines = log.split('\n')
+    phase_sum = dict()
+    n_step = 0
+    dn_loop = 0
+    de_rel = None
+    for i in range(len(lines)):
+        line = lines[i]
+        if line.startswith('Tree step number:'):
+            dn_loop = int(line.split()[-1])
+        elif line.startswith('**** Wallclock time per step (local)') and i+3<len(lines):
+            names = lines[i+1].split()
+            tmax = lines[i+3].split()
+            if len(names)==len(tmax) and dn_loop>0:
+                for name, value in zip(names, tmax):
+                    phase_sum[name] = phase_sum.get(name, 0.0) + float(value)*dn_loop
+                n_step += dn_loop
+        elif line.startswith('Physic:'):
+            items = line.split()
+            etot = float(items[4])
+            if etot!=0.0: de_rel = abs(float(items[3])/etot)
+    phase = dict()
+    if n_step>0:
+        for name in phase_sum.keys():
+            phase[name] = phase_sum[name]/n_step
+    return phase, n_step, de_rel
+
+def runCase(case, opts, common_options):
+    """ Generate the initial data and run one case
+    Return: dict of metrics or None if failed
+    """
+    name = case['name']
+    cdir = os.path.join(opts['work_dir'], name)
+    os.makedirs(cdir, exist_ok=True)
+
+    fdata = os.path.join(cdir, 'plummer.dat')
+    finput = os.path.join(cdir, 'plummer.input')
+    if not os.path.exists(finput):
+        ptcl = generatePlummer(case['n'], case['n_bin'], case['seed'])
+        with open(fdata, 'w') as f:
+            for p in ptcl:
+                f.write(' '.join('%.16e' % x for x in p)+'\n')
+        init_cmd = ['bash', opts['petar_init'], '-f', finput]
+        if case['se']:
+            # Henon unit to (Msun, pc, pc/Myr), mean stellar mass 0.5 Msun, virial radius 1 pc
+            init_cmd += ['-s', 'bse', '-m', str(0.5*case['n']), '-r', '1.0', '-u']
+        init_cmd.append(fdata)
+        if subprocess.run(init_cmd, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL).returncode!=0:
+            print(name, ': petar.init failed')
+            return None
+
+    t_end = case['t_end']
+    if case['se']:
+        # Henon time unit in Myr
+        t_end *= math.sqrt(1.0/(G_MSUN_PC_MYR*0.5*case['n']))
+    cmd = []
+    if opts['ranks']>1:
+        cmd = opts['mpiexec'].split() + [str(opts['ranks'])]
+    cmd += [os.path.abspath(opts['petar']), '-t', str(t_end), '-o', str(t_end/4), '-b', str(case['n_bin']), '-f', os.path.join(cdir,'data')]
+    if case['se']: cmd += ['-u', '1']
+    cmd += common_options.split()
+    cmd.append(finput)
+
+    env = dict(os.environ)
+    env['OMP_NUM_THREADS'] = str(opts['threads'])
+    env.setdefault('OMP_STACKSIZE', '128M')
+    tstart = time.time()
+    res = subprocess.run(cmd, env=env, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, universal_newlines=True)
+    twall = time.time() - tstart
+    with open(os.path.join(cdir, 'petar.log'), 'w') as f:
+        f.write(res.stdout)
+    if res.returncode!=0:
+        print(name, ': petar failed, see', os.path.join(cdir, 'petar.log'))
+        return None
+
+    phase, n_step, de_rel = parseLog(res.stdout)
+    if n_step==0 or de_rel is None:
+        print(name, ': no profile or energy output found, see', os.path.join(cdir, 'petar.log'))
+        return None
+    return {'phase_time': phase, 'steps_per_second': n_step/twall, 'energy_error': de_rel}
+
+def checkEnergyError(case, metric):
+    """ Check the energy error with the upper limit of the case
+    Return: list of failure messages
+    """
+    fails = []
+    if 'energy_error_max' in case and metric['energy_error']>case['energy_error_max']:
+        fails.append('%s: energy error %.4g > limit %.4g' % (case['name'], metric['energy_error'], case['energy_error_max']))
+    return fails
+
+def compareCase(name, metric, base, tol):
+    """ Compare the metrics with the baseline, only slowdowns and larger energy errors are failures
+    Return: list of failure messages
+    """
+    fails = []
+    for phase, t_base in base['phase_time'].items():
+        if phase not in metric['phase_time']: continue
+        t = metric['phase_time'][phase]
+        if t_base>tol['time_floor'] and t>t_base*(1.0+tol['time_relative']):
+            fails.append('%s: %s time per step %.4g > baseline %.4g' % (name, phase, t, t_base))
+    sps, sps_base = metric['steps_per_second'], base['steps_per_second']
+    if sps<sps_base*(1.0-tol['steps_per_second_relative']):
+        fails.append('%s: steps per second %.4g < baseline %.4g' % (name, sps, sps_base))
+    de, de_base = metric['energy_error'], base['energy_error']
+    if de>max(de_base*tol['energy_error_factor'], tol['energy_error_floor']):
+        fails.append('%s: energy error %.4g > baseline %.4g * %g' % (name, de, de_base, tol['energy_error_factor']))
+    return fails
+
+if __name__ == '__main__':
+
+    opts = {'petar': 'build/petar', 'petar_init': 'tools/initdata.sh', 'baseline': 'test/perf_baseline.json',
+            'work_dir': 'perf_check', 'threads': 4, 'ranks': 1, 'mpiexec': '', 'cases': '', 'se_mode': 'off', 'update': False}
+    tol_args = dict()
+
+    try:
+        shortargs = 'p:i:b:w:t:r:m:c:s:uh'
+        longargs = ['help', 'petar=', 'petar-init=', 'baseline=', 'work-dir=', 'threads=', 'ranks=', 'mpiexec=', 'cases=', 'se-mode=', 'update',
+                    'time-tolerance=', 'speed-tolerance=', 'energy-factor=']
+        optlist, args = getopt.getopt(sys.argv[1:], shortargs, longargs)
+        for opt, arg in optlist:
+            if opt in ('-h', '--help'):
+                usage()
+                sys.exit(0)
+            elif opt in ('-p', '--petar'): opts['petar'] = arg
+            elif opt in ('-i', '--petar-init'): opts['petar_init'] = arg
+            elif opt in ('-b', '--baseline'): opts['baseline'] = arg
+            elif opt in ('-w', '--work-dir'): opts['work_dir'] = arg
+            elif opt in ('-t', '--threads'): opts['threads'] = int(arg)
+            elif opt in ('-r', '--ranks'): opts['ranks'] = int(arg)
+            elif opt in ('-m', '--mpiexec'): opts['mpiexec'] = arg
+            elif opt in ('-c', '--cases'): opts['cases'] = arg
+            elif opt in ('-s', '--se-mode'): opts['se_mode'] = arg
+            elif opt in ('-u', '--update'): opts['update'] = True
+            elif opt=='--time-tolerance': tol_args['time_relative'] = float(arg)
+            elif opt=='--speed-tolerance': tol_args['steps_per_second_relative'] = float(arg)
+            elif opt=='--energy-factor': tol_args['energy_error_factor'] = float(arg)
+            else:
+                assert False, "unhandeld option"
+    except getopt.GetoptError as err:
+        print(err)
+        usage()
+        sys.exit(2)
+
+    if opts['ranks']>1 and opts['mpiexec']=='':
+        print('Error: --mpiexec is required for more than one MPI process')
+        sys.exit(2)
+
+    with open(opts['baseline']) as f:
+        baseline = json.load(f)
+    tol = baseline['tolerance']
+    tol.update(tol_args)
+
+    case_select = opts['cases'].split(',') if opts['cases']!='' else None
+    config = '.omp%d.mpi%d' % (opts['threads'], opts['ranks'])
+    os.makedirs(opts['work_dir'], exist_ok=True)
+
+    fails = []
+    n_run = 0
+    n_new = 0
+    for case in baseline['cases']:
+        name = case['name']
+        if case_select is not None and name not in case_select: continue
+        if case['se'] and opts['se_mode']=='off':
+            print(name, ': skipped, the stellar evolution is off in petar')
+            continue
+        metric = runCase(case, opts, baseline['common_options'])
+        if metric is None:
+            fails.append(name+': run failed')
+            continue
+        n_run += 1
+        print('%s: steps/s= %.4g  energy error= %.4g  time per step[s]: %s' %
+              (name, metric['steps_per_second'], metric['energy_error'],
+               ' '.join('%s=%.3g' % (k, v) for k, v in metric['phase_time'].items())))
+        fails += checkEnergyError(case, metric)
+        key = name + config
+        if opts['update']:
+            baseline['baseline'][key] = metric
+        elif key in baseline['baseline']:
+            fails += compareCase(name, metric, baseline['baseline'][key], tol)
+        else:
+            print('%s: no baseline for %s, the current results are recorded' % (name, key))
+            baseline['baseline'][key] = metric
+            n_new += 1
+
+    if opts['update'] or n_new>0:
+        with open(opts['baseline'], 'w') as f:
+            json.dump(baseline, f, indent=4)
+        print('Baseline updated:', opts['baseline'])
+
+    print('Cases run: %d, no baseline: %d, failures: %d' % (n_run, n_new, len(fails)))
+    for msg in fails: print('FAIL', msg)
+    sys.exit(1 if len(fails)>0 else 0)